@@ -0,0 +1,66 @@
+#include "Agent.hpp"
+
+#include <algorithm>
+
+RandomAgent::RandomAgent(std::uint32_t seed, unsigned delay_, unsigned samples_):
+  rng(seed,2),delay(delay_),samples(std::max(samples_,1u)),wait(0),lastPiece(0),
+  turns(0),shifts(0)
+{
+}
+
+std::size_t RandomAgent::act(const HeadlessGame &game, PieceInput *inputs, std::size_t max)
+{
+  if(0==max)
+    {
+      return 0;
+    }
+  if(game.getPieceCount()!=lastPiece)
+    {
+      lastPiece=game.getPieceCount();
+      turns=rng.bounded(4);
+      // Of a few random columns, aim for the lowest.
+      int best=-1,bestHeight=FIELD_HEIGHT+1;
+      for(unsigned k=0;k<samples;++k)
+	{
+	  const int x=rng.bounded(FIELD_WIDTH);
+	  int height=FIELD_HEIGHT;
+	  while(height>0 && !game.getField().get(x,height-1))
+	    {
+	      --height;
+	    }
+	  if(height<bestHeight)
+	    {
+	      best=x;
+	      bestHeight=height;
+	    }
+	}
+      shifts=best-game.getCurrent().getCenter().x;
+      wait=delay;
+    }
+  if(wait>0)
+    {
+      --wait;
+      return 0;
+    }
+  wait=delay;
+  if(turns>0)
+    {
+      --turns;
+      inputs[0]=rotate_cw;
+    }
+  else if(shifts<0)
+    {
+      ++shifts;
+      inputs[0]=shift_left;
+    }
+  else if(shifts>0)
+    {
+      --shifts;
+      inputs[0]=shift_right;
+    }
+  else
+    {
+      inputs[0]=hard_drop;
+    }
+  return 1;
+}
@@ -0,0 +1,46 @@
+#ifndef AGENT_HPP
+#define AGENT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+#include "HeadlessGame.hpp"
+#include "Randomizer.hpp"
+
+/* Agent
+   Anything that plays a HeadlessGame without a keyboard: a bot, a random
+   player, a recording. act is called once per frame, before the game steps,
+   and chooses that frame's inputs. An agent must be deterministic given its
+   construction and the games it is shown, so that simulations can be
+   repeated exactly.
+ */
+class Agent
+{
+public:
+  virtual ~Agent()
+  {}
+
+  // Write up to max inputs for the coming frame and return how many.
+  virtual std::size_t act(const HeadlessGame &, PieceInput *inputs, std::size_t max) = 0;
+};
+
+/* RandomAgent
+   For every new piece, picks a random orientation and the lowest of a few
+   random columns, makes one move towards them every few frames and then hard
+   drops. With one sample the column is uniformly random; more samples play a
+   flatter game which clears lines now and then, which keeps a battle moving.
+ */
+class RandomAgent : public Agent
+{
+public:
+  explicit RandomAgent(std::uint32_t seed, unsigned delay=2, unsigned samples=3);
+
+  std::size_t act(const HeadlessGame &, PieceInput *inputs, std::size_t max);
+private:
+  Pcg32 rng;
+  unsigned delay,samples,wait,lastPiece,turns;
+  int shifts;
+};
+
+#endif // AGENT_HPP
@@ -0,0 +1,55 @@
+#ifndef ARENA_HPP
+#define ARENA_HPP
+
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+/* Arena
+   Hands out objects of one type from blocks of BLOCK objects and takes them
+   all back at once with reset. Objects are never freed one at a time, and
+   their addresses stay valid until reset. Blocks are kept after a reset, so
+   once an arena has grown to the most it is asked for it stops allocating.
+
+   Objects are not constructed or destroyed, so T must be plain data. An
+   Arena is not thread safe; give each thread its own.
+ */
+template <class T, std::size_t BLOCK=1024>
+class Arena
+{
+  static_assert(std::is_trivial<T>::value,"Arena objects must be plain data!");
+public:
+  Arena():blocks(),used(0)
+  {}
+
+  T* allocate()
+  {
+    if(used==blocks.size()*BLOCK)
+      {
+	blocks.emplace_back(new T[BLOCK]);
+      }
+    T *ret=&blocks[used/BLOCK][used%BLOCK];
+    ++used;
+    return ret;
+  }
+  // Take back every object.
+  void reset()
+  {
+    used=0;
+  }
+  std::size_t size() const
+  {
+    return used;
+  }
+  std::size_t capacity() const
+  {
+    return blocks.size()*BLOCK;
+  }
+private:
+  Arena(const Arena&) = delete; // Uncopyable
+  std::vector<std::unique_ptr<T[]>> blocks;
+  std::size_t used;
+};
+
+#endif // ARENA_HPP
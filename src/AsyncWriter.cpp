@@ -0,0 +1,560 @@
+#include "AsyncWriter.hpp"
+#include "compat.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_IO_URING_H
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif // HAVE_LINUX_IO_URING_H
+
+static std::string errnoString(const std::string &what, int error=errno)
+{
+  return what+": "+std::strerror(error);
+}
+
+// A buffer of records on its way to the file. result is set by the backend:
+// the bytes written from done onwards, or -errno.
+struct AsyncWriter::Batch
+{
+  std::unique_ptr<std::uint8_t[]> data;
+  std::size_t size,done;
+  std::uint64_t offset;
+  struct iovec iov;
+  std::chrono::steady_clock::time_point start;
+  long result;
+
+  explicit Batch(std::size_t capacity):
+    data(new std::uint8_t[capacity]),size(0),done(0),offset(0),iov(),start(),result(0)
+  {}
+};
+
+class AsyncWriter::Backend
+{
+public:
+  virtual ~Backend()
+  {}
+  virtual const char* name() const = 0;
+  // Start writing the batch's bytes from done onwards, at offset+done.
+  // Returns false, setting errno, if the write could not be started.
+  virtual bool submit(Batch &) = 0;
+  // Move the batches whose writes have finished to done, waiting for at
+  // least one if wait.
+  virtual void reap(bool wait, std::vector<Batch*> &done) = 0;
+};
+
+// Writes on the I/O thread itself: a write that stalls stalls only the
+// gathering of records, which the streams absorb.
+class AsyncWriter::PwriteBackend : public AsyncWriter::Backend
+{
+public:
+  explicit PwriteBackend(int fd_):
+    fd(fd_),finished()
+  {}
+  const char* name() const
+  {
+    return "pwrite";
+  }
+  bool submit(AsyncWriter::Batch &b)
+  {
+    ssize_t r;
+    do
+      {
+	r=pwrite(fd,b.data.get()+b.done,b.size-b.done,b.offset+b.done);
+      }
+    while(-1==r && EINTR==errno);
+    b.result=-1==r ? -errno : r;
+    finished.push_back(&b);
+    return true;
+  }
+  void reap(bool, std::vector<AsyncWriter::Batch*> &done)
+  {
+    done.insert(done.end(),finished.begin(),finished.end());
+    finished.clear();
+  }
+private:
+  int fd;
+  std::vector<AsyncWriter::Batch*> finished;
+};
+
+#ifdef HAVE_LINUX_IO_URING_H
+// The kernel's submission and completion rings, used directly through the
+// system calls: a write is queued without a system call of its own for
+// the data, and the I/O thread can gather the next batch while the last
+// one is still being written.
+class AsyncWriter::UringBackend : public AsyncWriter::Backend
+{
+public:
+  // Throws WriterError if the kernel has no io_uring or refuses it.
+  UringBackend(int fd_, unsigned entries):
+    fd(fd_),ring(-1),sq(MAP_FAILED),cq(MAP_FAILED),sqes(MAP_FAILED),sqBytes(0),cqBytes(0),
+    sqesBytes(0)
+  {
+    struct io_uring_params p;
+    std::memset(&p,0,sizeof(p));
+    ring=syscall(__NR_io_uring_setup,entries,&p);
+    if(-1==ring)
+      {
+	throw WriterError(errnoString("io_uring_setup"));
+      }
+    sqBytes=p.sq_off.array+p.sq_entries*sizeof(unsigned);
+    cqBytes=p.cq_off.cqes+p.cq_entries*sizeof(struct io_uring_cqe);
+    sqesBytes=p.sq_entries*sizeof(struct io_uring_sqe);
+    const bool single=p.features & IORING_FEAT_SINGLE_MMAP;
+    if(single)
+      {
+	sqBytes=cqBytes=std::max(sqBytes,cqBytes);
+      }
+    sq=mmap(nullptr,sqBytes,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring,
+	    IORING_OFF_SQ_RING);
+    cq=single ? sq : mmap(nullptr,cqBytes,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring,
+			  IORING_OFF_CQ_RING);
+    sqes=mmap(nullptr,sqesBytes,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_POPULATE,ring,
+	      IORING_OFF_SQES);
+    if(MAP_FAILED==sq || MAP_FAILED==cq || MAP_FAILED==sqes)
+      {
+	const std::string what=errnoString("io_uring mmap");
+	release();
+	throw WriterError(what);
+      }
+    char *s=static_cast<char*>(sq),*c=static_cast<char*>(cq);
+    sqTail=reinterpret_cast<unsigned*>(s+p.sq_off.tail);
+    sqMask=*reinterpret_cast<unsigned*>(s+p.sq_off.ring_mask);
+    sqArray=reinterpret_cast<unsigned*>(s+p.sq_off.array);
+    cqHead=reinterpret_cast<unsigned*>(c+p.cq_off.head);
+    cqTail=reinterpret_cast<unsigned*>(c+p.cq_off.tail);
+    cqMask=*reinterpret_cast<unsigned*>(c+p.cq_off.ring_mask);
+    cqes=reinterpret_cast<struct io_uring_cqe*>(c+p.cq_off.cqes);
+  }
+  ~UringBackend()
+  {
+    release();
+  }
+  const char* name() const
+  {
+    return "io_uring";
+  }
+  // Never more writes are in flight than there are batches, and the ring
+  // has an entry for each, so the queue cannot overflow.
+  bool submit(AsyncWriter::Batch &b)
+  {
+    const unsigned tail=*sqTail,i=tail & sqMask;
+    struct io_uring_sqe &e=static_cast<struct io_uring_sqe*>(sqes)[i];
+    std::memset(&e,0,sizeof(e));
+    b.iov.iov_base=b.data.get()+b.done;
+    b.iov.iov_len=b.size-b.done;
+    e.opcode=IORING_OP_WRITEV;
+    e.fd=fd;
+    e.addr=reinterpret_cast<std::uint64_t>(&b.iov);
+    e.len=1;
+    e.off=b.offset+b.done;
+    e.user_data=reinterpret_cast<std::uint64_t>(&b);
+    sqArray[i]=i;
+    __atomic_store_n(sqTail,tail+1,__ATOMIC_RELEASE);
+    long r;
+    do
+      {
+	r=syscall(__NR_io_uring_enter,ring,1,0,0,nullptr,0);
+      }
+    while(-1==r && EINTR==errno);
+    return 1==r;
+  }
+  void reap(bool wait, std::vector<AsyncWriter::Batch*> &done)
+  {
+    for(;;)
+      {
+	unsigned head=*cqHead;
+	const unsigned tail=__atomic_load_n(cqTail,__ATOMIC_ACQUIRE);
+	for(;head!=tail;++head)
+	  {
+	    const struct io_uring_cqe &e=cqes[head & cqMask];
+	    AsyncWriter::Batch *b=reinterpret_cast<AsyncWriter::Batch*>(e.user_data);
+	    b->result=e.res;
+	    done.push_back(b);
+	  }
+	__atomic_store_n(cqHead,head,__ATOMIC_RELEASE);
+	if(!done.empty() || !wait)
+	  {
+	    return;
+	  }
+	syscall(__NR_io_uring_enter,ring,0,1,IORING_ENTER_GETEVENTS,nullptr,0);
+      }
+  }
+private:
+  int fd,ring;
+  void *sq,*cq,*sqes;
+  std::size_t sqBytes,cqBytes,sqesBytes;
+  unsigned *sqTail,*sqArray,*cqHead,*cqTail;
+  unsigned sqMask,cqMask;
+  struct io_uring_cqe *cqes;
+
+  void release()
+  {
+    if(MAP_FAILED!=sqes)
+      {
+	munmap(sqes,sqesBytes);
+      }
+    if(MAP_FAILED!=cq && cq!=sq)
+      {
+	munmap(cq,cqBytes);
+      }
+    if(MAP_FAILED!=sq)
+      {
+	munmap(sq,sqBytes);
+      }
+    ::close(ring);
+  }
+};
+#endif // HAVE_LINUX_IO_URING_H
+
+// The smallest power of two at least n, and at least 64.
+static std::size_t ringSize(std::size_t n)
+{
+  std::size_t ret=64;
+  while(ret<n)
+    {
+      ret*=2;
+    }
+  return ret;
+}
+
+AsyncWriter::Stream::Stream(std::size_t capacity):
+  mask(ringSize(capacity)-1),ring(new std::uint8_t[mask+1]),head(0),cachedTail(0),records(0),
+  bytes(0),dropped(0),droppedBytes(0),highWater(0),padding(),tail(0),closed(false)
+{
+}
+
+// Counters have one writer, so they need no read-modify-write.
+static void add(std::atomic<std::uint64_t> &counter, std::uint64_t n)
+{
+  counter.store(counter.load(std::memory_order_relaxed)+n,std::memory_order_relaxed);
+}
+
+bool AsyncWriter::Stream::append(const void *data, std::size_t n)
+{
+  const std::size_t capacity=mask+1,need=4+((n+3) & ~std::size_t(3));
+  if(need>capacity || n>0xffffffffu)
+    {
+      throw std::length_error("record larger than its stream");
+    }
+  const std::uint64_t h=head.load(std::memory_order_relaxed);
+  if(h+need-cachedTail>capacity)
+    {
+      cachedTail=tail.load(std::memory_order_acquire);
+      if(h+need-cachedTail>capacity)
+	{
+	  add(dropped,1);
+	  add(droppedBytes,n);
+	  return false;
+	}
+    }
+  const std::uint32_t length=n;
+  std::memcpy(&ring[h & mask],&length,4);
+  const std::size_t at=(h+4) & mask,first=std::min(n,capacity-at);
+  std::memcpy(&ring[at],data,first);
+  std::memcpy(&ring[0],static_cast<const std::uint8_t*>(data)+first,n-first);
+  head.store(h+need,std::memory_order_release);
+  add(records,1);
+  add(bytes,n);
+  if(h+need-cachedTail>highWater.load(std::memory_order_relaxed))
+    {
+      highWater.store(h+need-cachedTail,std::memory_order_relaxed);
+    }
+  return true;
+}
+
+constexpr unsigned AsyncWriter::INTERVAL_MS;
+
+AsyncWriter::AsyncWriter(const std::string &path_, std::size_t batch, bool uring):
+  path(path_),fd(::open(path_.c_str(),O_WRONLY|O_CREAT|O_CLOEXEC,0644)),offset(0),backend(),
+  batchSize(std::max<std::size_t>(batch,4096)),batches(),idle(),current(nullptr),mutex(),wake(),
+  flushed(),streams(),retired(),io(),flushRequested(0),flushDone(0),stopping(false),error(),
+  thread()
+{
+  if(-1==fd)
+    {
+      throw WriterError(errnoString("cannot open "+path));
+    }
+  struct stat st;
+  if(-1==fstat(fd,&st))
+    {
+      const std::string what=errnoString("cannot open "+path);
+      ::close(fd);
+      throw WriterError(what);
+    }
+  offset=st.st_size;
+#ifdef HAVE_LINUX_IO_URING_H
+  if(uring)
+    {
+      try
+	{
+	  backend.reset(new UringBackend(fd,BUFFERS));
+	}
+      catch(WriterError &)
+	{
+	  // Not in this kernel, or not allowed: write on the thread instead.
+	}
+    }
+#else
+  (void)uring;
+#endif // HAVE_LINUX_IO_URING_H
+  if(!backend)
+    {
+      backend.reset(new PwriteBackend(fd));
+    }
+  for(unsigned i=0;i<BUFFERS;++i)
+    {
+      batches.push_back(std::unique_ptr<Batch>(new Batch(batchSize)));
+      idle.push_back(batches.back().get());
+    }
+  thread=std::thread(&AsyncWriter::run,this);
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    stopping=true;
+  }
+  wake.notify_one();
+  thread.join();
+  backend.reset();
+  ::close(fd);
+}
+
+AsyncWriter::Stream* AsyncWriter::open(std::size_t capacity)
+{
+  std::unique_ptr<Stream> s(new Stream(capacity));
+  std::lock_guard<std::mutex> lock(mutex);
+  streams.push_back(std::move(s));
+  return streams.back().get();
+}
+
+void AsyncWriter::close(Stream *s)
+{
+  s->closed.store(true,std::memory_order_release);
+  wake.notify_one();
+}
+
+void AsyncWriter::flush()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  const std::uint64_t target=++flushRequested;
+  wake.notify_one();
+  flushed.wait(lock,[&]{return flushDone>=target;});
+  if(!error.empty())
+    {
+      throw WriterError(error);
+    }
+}
+
+AsyncWriterStats AsyncWriter::getStats() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  AsyncWriterStats ret=retired;
+  ret.written=io.written;
+  ret.writes=io.writes;
+  ret.writeMax=io.writeMax;
+  ret.stalls=io.stalls;
+  for(const auto &s : streams)
+    {
+      ret.records+=s->records.load(std::memory_order_relaxed);
+      ret.bytes+=s->bytes.load(std::memory_order_relaxed);
+      ret.dropped+=s->dropped.load(std::memory_order_relaxed);
+      ret.droppedBytes+=s->droppedBytes.load(std::memory_order_relaxed);
+      const std::size_t high=s->highWater.load(std::memory_order_relaxed);
+      if(0==ret.highWaterCapacity || (double)high/s->getCapacity()
+	 >(double)ret.highWater/ret.highWaterCapacity)
+	{
+	  ret.highWater=high;
+	  ret.highWaterCapacity=s->getCapacity();
+	}
+    }
+  return ret;
+}
+
+const char* AsyncWriter::getBackend() const
+{
+  return backend->name();
+}
+
+void AsyncWriter::run()
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  for(;;)
+    {
+      const std::uint64_t requested=flushRequested;
+      const bool stop=stopping,waiting=stop || requested>flushDone;
+      std::vector<Stream*> active;
+      for(const auto &s : streams)
+	{
+	  active.push_back(s.get());
+	}
+      lock.unlock();
+
+      // A closed stream is drained if it was closed before this pass took
+      // its records.
+      std::vector<Stream*> drained;
+      std::size_t gathered=0;
+      for(Stream *s : active)
+	{
+	  const bool closed=s->closed.load(std::memory_order_acquire);
+	  gathered+=gather(*s);
+	  if(closed)
+	    {
+	      drained.push_back(s);
+	    }
+	}
+      submit();
+      reap(false);
+      while(waiting && idle.size()<batches.size())
+	{
+	  reap(true);
+	}
+
+      lock.lock();
+      for(Stream *s : drained)
+	{
+	  retired.records+=s->records.load(std::memory_order_relaxed);
+	  retired.bytes+=s->bytes.load(std::memory_order_relaxed);
+	  retired.dropped+=s->dropped.load(std::memory_order_relaxed);
+	  retired.droppedBytes+=s->droppedBytes.load(std::memory_order_relaxed);
+	  streams.erase(std::find_if(streams.begin(),streams.end(),
+				     [&](const std::unique_ptr<Stream> &p){return p.get()==s;}));
+	}
+      if(waiting)
+	{
+	  flushDone=requested;
+	  flushed.notify_all();
+	}
+      if(stop)
+	{
+	  return;
+	}
+      if(0==gathered && flushRequested==flushDone && !stopping)
+	{
+	  wake.wait_for(lock,std::chrono::milliseconds(INTERVAL_MS));
+	}
+    }
+}
+
+// Copy every whole record in the stream to the batches, starting a new
+// batch whenever one fills, even part way through a record: batches are
+// written in order, so the record still reaches the file in one piece.
+std::size_t AsyncWriter::gather(Stream &s)
+{
+  const std::uint64_t h=s.head.load(std::memory_order_acquire);
+  std::uint64_t t=s.tail.load(std::memory_order_relaxed);
+  const std::size_t capacity=s.mask+1;
+  std::size_t ret=0;
+  while(t<h)
+    {
+      std::uint32_t length;
+      std::memcpy(&length,&s.ring[t & s.mask],4);
+      for(std::size_t done=0;done<length;)
+	{
+	  if(!current || batchSize==current->size)
+	    {
+	      submit();
+	      current=nextBatch();
+	    }
+	  const std::size_t at=(t+4+done) & s.mask,
+	    n=std::min(std::min<std::size_t>(length-done,batchSize-current->size),capacity-at);
+	  std::memcpy(current->data.get()+current->size,&s.ring[at],n);
+	  current->size+=n;
+	  done+=n;
+	}
+      t+=4+((length+3) & ~3u);
+      s.tail.store(t,std::memory_order_release);
+      ret+=length;
+    }
+  return ret;
+}
+
+void AsyncWriter::submit()
+{
+  if(!current || 0==current->size)
+    {
+      return;
+    }
+  Batch &b=*current;
+  current=nullptr;
+  b.offset=offset;
+  offset+=b.size;
+  b.start=std::chrono::steady_clock::now();
+  if(!backend->submit(b))
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      if(error.empty())
+	{
+	  error=errnoString("cannot write "+path);
+	}
+      idle.push_back(&b);
+    }
+}
+
+AsyncWriter::Batch* AsyncWriter::nextBatch()
+{
+  if(idle.empty())
+    {
+      {
+	std::lock_guard<std::mutex> lock(mutex);
+	++io.stalls;
+      }
+      while(idle.empty())
+	{
+	  reap(true);
+	}
+    }
+  Batch *b=idle.back();
+  idle.pop_back();
+  b->size=0;
+  b->done=0;
+  return b;
+}
+
+void AsyncWriter::reap(bool wait)
+{
+  std::vector<Batch*> done;
+  backend->reap(wait,done);
+  for(Batch *b : done)
+    {
+      if(b->result>0 && b->done+b->result<b->size)
+	{
+	  // Short write: write the rest.
+	  b->done+=b->result;
+	  if(backend->submit(*b))
+	    {
+	      continue;
+	    }
+	  b->result=-errno;
+	}
+      std::lock_guard<std::mutex> lock(mutex);
+      if(b->result<=0)
+	{
+	  if(error.empty())
+	    {
+	      error=errnoString("cannot write "+path,b->result ? -b->result : EIO);
+	    }
+	}
+      else
+	{
+	  const std::uint64_t ns=std::chrono::duration_cast<std::chrono::nanoseconds>
+	    (std::chrono::steady_clock::now()-b->start).count();
+	  io.written+=b->size;
+	  ++io.writes;
+	  io.writeMax=std::max(io.writeMax,ns);
+	}
+      idle.push_back(b);
+    }
+}
@@ -0,0 +1,144 @@
+#ifndef ASYNCWRITER_HPP
+#define ASYNCWRITER_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.hpp"
+
+/* AsyncWriter
+   Appends records to a file without the threads that make them ever waiting
+   for the disk. Each producer, such as a game thread, appends to its own
+   Stream: a ring buffer with a single writer which takes no lock. One I/O
+   thread gathers the records of every stream into large buffers and writes
+   those at the end of the file one after another, through io_uring where
+   the kernel has it and pwrite where it does not.
+
+   Memory is bounded: a stream holds at most its capacity, and the I/O thread
+   BUFFERS buffers of the batch size. A stream that fills because the disk
+   has fallen behind drops what is appended to it, and counts it, instead of
+   waiting; the statistics show how close the streams came to that.
+
+   The records of one stream reach the file whole, in the order they were
+   appended, and never with another stream's bytes inside them. The records
+   of different streams follow each other in no particular order. Nothing
+   else may write to the file while the writer has it.
+
+   Linux only.
+ */
+struct AsyncWriterStats
+{
+  // Over every stream: records and bytes appended, and records and bytes
+  // dropped because their stream was full.
+  std::uint64_t records,bytes,dropped,droppedBytes;
+  // Bytes written, the writes that took, and the longest a write took, in
+  // nanoseconds.
+  std::uint64_t written,writes,writeMax;
+  // Times the I/O thread had a full buffer and every buffer was still being
+  // written.
+  std::uint64_t stalls;
+  // The fullest any stream has been, in bytes, and that stream's capacity.
+  std::size_t highWater,highWaterCapacity;
+};
+
+class AsyncWriter
+{
+public:
+  class Stream
+  {
+  public:
+    // Append a record. Returns false, dropping the record, if the stream
+    // is full. Only one thread at a time may append to a stream. Throws
+    // std::length_error if the record is too big for the stream ever to
+    // hold it.
+    bool append(const void *data, std::size_t bytes);
+
+    std::size_t getCapacity() const
+    {
+      return mask+1;
+    }
+  private:
+    friend class AsyncWriter;
+    explicit Stream(std::size_t capacity);
+    Stream(const Stream&) = delete; // Uncopyable
+
+    const std::size_t mask;
+    std::unique_ptr<std::uint8_t[]> ring;
+    // Bytes ever appended and ever taken by the I/O thread. Each record is a
+    // u32 length and the record, padded to 4 bytes so a length never wraps.
+    std::atomic<std::uint64_t> head;
+    std::uint64_t cachedTail;
+    std::atomic<std::uint64_t> records,bytes,dropped,droppedBytes,highWater;
+    // Keeps the producer's fields and the I/O thread's off one cache line.
+    char padding[64];
+    std::atomic<std::uint64_t> tail;
+    std::atomic<bool> closed;
+  };
+
+  static constexpr std::size_t DEFAULT_CAPACITY=1<<20, DEFAULT_BATCH=1<<20;
+  static constexpr unsigned BUFFERS=4;
+  // How long the I/O thread sleeps when the streams are empty.
+  static constexpr unsigned INTERVAL_MS=10;
+
+  // Open path for appending, creating it if needed. Without uring, or if
+  // the kernel refuses it, writes use pwrite. Throws WriterError.
+  explicit AsyncWriter(const std::string &path, std::size_t batch=DEFAULT_BATCH,
+		       bool uring=true);
+  // Writes out everything appended so far.
+  ~AsyncWriter();
+
+  // A new stream of at least capacity bytes. Thread safe.
+  Stream* open(std::size_t capacity=DEFAULT_CAPACITY);
+  // The stream's records are still written, but the stream must not be
+  // used again. Thread safe.
+  void close(Stream *);
+
+  // Wait until everything appended to any stream before the call has been
+  // written. Throws WriterError if a write has failed.
+  void flush();
+
+  AsyncWriterStats getStats() const;
+  // "io_uring" or "pwrite".
+  const char* getBackend() const;
+private:
+  struct Batch;
+  class Backend;
+  class PwriteBackend;
+  class UringBackend;
+  AsyncWriter(const AsyncWriter&) = delete; // Uncopyable
+
+  std::string path;
+  int fd;
+  std::uint64_t offset;
+  std::unique_ptr<Backend> backend;
+  std::size_t batchSize;
+  std::vector<std::unique_ptr<Batch>> batches;
+  std::vector<Batch*> idle;
+  Batch *current;
+
+  mutable std::mutex mutex;
+  std::condition_variable wake,flushed;
+  std::vector<std::unique_ptr<Stream>> streams;
+  // Counts from streams closed and drained.
+  AsyncWriterStats retired;
+  AsyncWriterStats io;
+  std::uint64_t flushRequested,flushDone;
+  bool stopping;
+  std::string error;
+  std::thread thread;
+
+  void run();
+  std::size_t gather(Stream &);
+  void submit();
+  Batch* nextBatch();
+  void reap(bool wait);
+};
+
+#endif // ASYNCWRITER_HPP
@@ -0,0 +1,142 @@
+#include "BatchEnv.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+// One game and the placements its current piece can reach.
+struct BatchEnv::Slot
+{
+  HeadlessGame game;
+  MoveList moves;
+  // Index in moves of the placement each action takes, or -1.
+  std::int8_t action[ACTIONS];
+  std::uint64_t seed;
+
+  explicit Slot(std::uint64_t s):game(s),moves(),seed(s)
+  {}
+};
+
+BatchEnv::BatchEnv(WorkerPool &pool_, std::size_t count):
+  pool(pool_),games(),buffers(),steps(0)
+{
+  if(0==count)
+    {
+      throw std::invalid_argument("A batch needs at least one game.");
+    }
+  for(std::size_t i=0;i<count;++i)
+    {
+      games.emplace_back(new Slot(i+1));
+    }
+  buffers.observations=nullptr;
+  buffers.masks=nullptr;
+  buffers.rewards=nullptr;
+  buffers.dones=nullptr;
+  for(std::size_t i=0;i<count;++i)
+    {
+      observe(i);
+    }
+}
+
+BatchEnv::~BatchEnv()
+{
+}
+
+void BatchEnv::setBuffers(const Buffers &b)
+{
+  buffers=b;
+}
+
+const HeadlessGame& BatchEnv::getGame(std::size_t i) const
+{
+  return games.at(i)->game;
+}
+
+void BatchEnv::reset(const std::uint64_t *seeds)
+{
+  pool.runStealing(games.size(),[&](std::size_t i, unsigned)
+		   {
+		     Slot &s=*games[i];
+		     s.seed=seeds[i];
+		     s.game.reset(s.seed);
+		     observe(i);
+		   });
+}
+
+void BatchEnv::step(const std::int32_t *actions)
+{
+  pool.runStealing(games.size(),[&](std::size_t i, unsigned)
+		   {
+		     Slot &s=*games[i];
+		     PieceInput path[MoveList::MAX_PATH];
+		     std::size_t length=0;
+		     const int lines=s.game.getField().readScore();
+		     if(s.moves.size())
+		       {
+			 const std::int32_t a=actions[i];
+			 const int move=(a>=0 && a<(std::int32_t)ACTIONS && s.action[a]>=0) ? s.action[a] : 0;
+			 length=s.moves.path(move,path,MoveList::MAX_PATH);
+		       }
+		     else
+		       {
+			 path[length++]=hard_drop;
+		       }
+		     const bool lost=s.game.step(path,length);
+		     if(buffers.rewards)
+		       {
+			 buffers.rewards[i]=s.game.getField().readScore()-lines;
+		       }
+		     if(buffers.dones)
+		       {
+			 buffers.dones[i]=lost;
+		       }
+		     if(lost)
+		       {
+			 s.seed+=games.size();
+			 s.game.reset(s.seed);
+		       }
+		     observe(i);
+		   });
+  steps+=games.size();
+}
+
+// Find the current piece's placements, and write game i's observation and
+// mask.
+void BatchEnv::observe(std::size_t i)
+{
+  Slot &s=*games[i];
+  const Bitboard board=Bitboard::fromField(s.game.getField());
+  const Piece &current=s.game.getCurrent();
+  s.moves.generate(board,current.getType(),current.getOrientation(),current.getCenter());
+  std::fill(s.action,s.action+ACTIONS,-1);
+  for(std::size_t m=0;m<s.moves.size();++m)
+    {
+      s.action[s.moves[m].state]=m;
+    }
+
+  if(buffers.observations)
+    {
+      float *out=buffers.observations+i*OBSERVATION_SIZE;
+      for(int y=0;y<FIELD_HEIGHT;++y)
+	{
+	  for(int x=0;x<FIELD_WIDTH;++x)
+	    {
+	      *out++=(board.rows[y]>>x) & 1;
+	    }
+	}
+      std::fill(out,out+7*(1+PREVIEW),0.0f);
+      out[current.getType()]=1;
+      const PieceQueue &queue=s.game.getQueue();
+      for(unsigned p=0;p<PREVIEW && p<queue.size();++p)
+	{
+	  out[7*(p+1)+queue.peek(p)]=1;
+	}
+    }
+  if(buffers.masks)
+    {
+      std::uint8_t *mask=buffers.masks+i*ACTIONS;
+      for(unsigned a=0;a<ACTIONS;++a)
+	{
+	  mask[a]=s.action[a]>=0;
+	}
+    }
+}
@@ -0,0 +1,88 @@
+#ifndef BATCHENV_HPP
+#define BATCHENV_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Bot.hpp"
+#include "HeadlessGame.hpp"
+#include "WorkerPool.hpp"
+
+/* BatchEnv
+   Many headless games stepped together, for training loops that want dense
+   arrays rather than objects. An action places the current piece: it is
+   the search state of a MoveList (orientation times FIELD_WIDTH+4, plus the
+   center column plus 2) from which the piece is hard dropped, so one step
+   is one piece. The action mask marks one state for every distinct
+   placement; an action outside the mask hard drops the piece where it
+   spawned.
+
+   Everything is written straight into buffers the caller owns, laid out one
+   game after another:
+     observations  OBSERVATION_SIZE floats per game: the board, FIELD_WIDTH
+		   cells to a row from the bottom row up, 1 for a block;
+		   then the current piece one-hot over the seven types; then
+		   PREVIEW more one-hots for the pieces to come.
+     masks         ACTIONS bytes per game, 1 for a legal action.
+     rewards       one float per game: the lines the step cleared.
+     dones         one byte per game: 1 if the step lost the game.
+   Any of them may be NULL to skip it. A game that is lost starts again at
+   once, with its last seed plus the number of games, so the observation
+   after a done is the first of the next game.
+
+   Games are stepped in parallel on the pool, each touching only its own
+   part of the buffers, so the results are the same with any number of
+   threads.
+ */
+class BatchEnv
+{
+public:
+  static constexpr unsigned PREVIEW=5;
+  static constexpr unsigned OBSERVATION_SIZE=FIELD_SIZE+7*(1+PREVIEW);
+  static constexpr unsigned ACTIONS=MoveList::STATES;
+
+  struct Buffers
+  {
+    float *observations;
+    std::uint8_t *masks;
+    float *rewards;
+    std::uint8_t *dones;
+  };
+
+  // Games are seeded 1 to games until reset. Throws std::invalid_argument
+  // if games is 0.
+  BatchEnv(WorkerPool &, std::size_t games);
+  ~BatchEnv();
+
+  void setBuffers(const Buffers &);
+  // Start every game again, game i with seeds[i], and write the
+  // observations and masks.
+  void reset(const std::uint64_t *seeds);
+  // Place every game's current piece by its action and write everything.
+  void step(const std::int32_t *actions);
+
+  std::size_t size() const
+  {
+    return games.size();
+  }
+  const HeadlessGame& getGame(std::size_t i) const;
+  // Pieces placed by all games since they were made.
+  unsigned long getSteps() const
+  {
+    return steps;
+  }
+private:
+  struct Slot;
+  BatchEnv(const BatchEnv&) = delete; // Uncopyable
+
+  WorkerPool &pool;
+  std::vector<std::unique_ptr<Slot>> games;
+  Buffers buffers;
+  unsigned long steps;
+
+  void observe(std::size_t i);
+};
+
+#endif // BATCHENV_HPP
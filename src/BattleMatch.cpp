@@ -0,0 +1,206 @@
+#include "BattleMatch.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+struct BattleMatch::Player
+{
+  HeadlessGame game;
+  std::unique_ptr<Agent> agent;
+  PieceInput inputs[MAX_INPUTS];
+  int lastScore;
+  unsigned cleared,place,sent,received;
+
+  Player(std::uint32_t seed, std::unique_ptr<Agent> agent_):game(seed),agent(std::move(agent_)),
+							   lastScore(0),cleared(0),place(0),
+							   sent(0),received(0)
+  {}
+};
+
+BattleMatch::BattleMatch(unsigned count, std::uint32_t seed):players(),targets(),
+							     rng(seed,1),
+							     frame(0),alive(count)
+{
+  players.reserve(count);
+  targets.reserve(count);
+  for(unsigned i=0;i<count;++i)
+    {
+      players.push_back(std::unique_ptr<Player>
+			(new Player(seed,std::unique_ptr<Agent>(new RandomAgent(seed^(i*0x9e3779b9u))))));
+    }
+  if(1==count)
+    {
+      players[0]->place=1;
+    }
+}
+
+BattleMatch::~BattleMatch()
+{
+}
+
+void BattleMatch::setAgent(unsigned player, std::unique_ptr<Agent> agent)
+{
+  players.at(player)->agent=std::move(agent);
+}
+
+const HeadlessGame& BattleMatch::getGame(unsigned player) const
+{
+  return players.at(player)->game;
+}
+
+unsigned BattleMatch::getPlace(unsigned player) const
+{
+  return players.at(player)->place;
+}
+
+unsigned BattleMatch::getLinesSent(unsigned player) const
+{
+  return players.at(player)->sent;
+}
+
+unsigned BattleMatch::getLinesReceived(unsigned player) const
+{
+  return players.at(player)->received;
+}
+
+unsigned BattleMatch::attack(unsigned lines)
+{
+  static const unsigned table[5]={0,0,1,2,4};
+  return lines<5 ? table[lines] : 4;
+}
+
+bool BattleMatch::step(WorkerPool &pool)
+{
+  if(isOver())
+    {
+      return true;
+    }
+  // Phase one: boards are independent.
+  auto stepOne=[this](std::size_t i)
+    {
+      Player &p=*players[i];
+      if(p.game.isGameOver())
+	{
+	  p.cleared=0;
+	  return;
+	}
+      const std::size_t n=p.agent->act(p.game,p.inputs,MAX_INPUTS);
+      p.game.step(p.inputs,std::min<std::size_t>(n,MAX_INPUTS));
+      const int score=p.game.getField().readScore();
+      p.cleared=score-p.lastScore;
+      p.lastScore=score;
+    };
+  pool.run(players.size(),stepOne);
+  // Phase two: everything that depends on more than one board.
+  exchange();
+  ++frame;
+  return isOver();
+}
+
+unsigned BattleMatch::run(WorkerPool &pool, unsigned maxFrames)
+{
+  unsigned i;
+  for(i=0;i<maxFrames && !isOver();++i)
+    {
+      step(pool);
+    }
+  return i;
+}
+
+void BattleMatch::exchange()
+{
+  const unsigned count=players.size();
+  unsigned i,died=0;
+
+  targets.clear();
+  for(i=0;i<count;++i)
+    {
+      if(!players[i]->game.isGameOver())
+	{
+	  targets.push_back(i);
+	}
+    }
+  for(i=0;i<count;++i)
+    {
+      Player &p=*players[i];
+      if(0==p.cleared)
+	{
+	  continue;
+	}
+      const unsigned lines=p.game.cancelGarbage(attack(p.cleared));
+      if(0==lines || targets.empty() || (1==targets.size() && targets[0]==i))
+	{
+	  continue;
+	}
+      // Anyone left standing but the attacker.
+      unsigned target;
+      do
+	{
+	  target=targets[rng.bounded(targets.size())];
+	}
+      while(target==i);
+      players[target]->game.addGarbage(lines,rng.bounded(FIELD_WIDTH));
+      players[target]->received+=lines;
+      p.sent+=lines;
+    }
+
+  for(i=0;i<count;++i)
+    {
+      if(0==players[i]->place && players[i]->game.isGameOver())
+	{
+	  ++died;
+	}
+    }
+  if(0==died)
+    {
+      return;
+    }
+  const unsigned place=alive-died+1;
+  for(i=0;i<count;++i)
+    {
+      Player &p=*players[i];
+      if(0==p.place && p.game.isGameOver())
+	{
+	  p.place=place;
+	}
+    }
+  alive-=died;
+  if(1==alive)
+    {
+      for(i=0;i<count;++i)
+	{
+	  if(0==players[i]->place)
+	    {
+	      players[i]->place=1;
+	    }
+	}
+    }
+}
+
+// FNV-1a
+static void hashBytes(std::uint64_t &h, const void *data, std::size_t size)
+{
+  const unsigned char *bytes=static_cast<const unsigned char*>(data);
+  for(std::size_t i=0;i<size;++i)
+    {
+      h^=bytes[i];
+      h*=0x100000001b3ull;
+    }
+}
+
+std::uint64_t BattleMatch::checksum() const
+{
+  std::uint64_t h=0xcbf29ce484222325ull;
+  hashBytes(h,&frame,sizeof(frame));
+  for(const auto &p : players)
+    {
+      const FrameSnapshot snap=p->game.snapshot();
+      const unsigned pending=p->game.getPendingGarbage();
+      hashBytes(h,&snap,sizeof(snap));
+      hashBytes(h,&pending,sizeof(pending));
+      hashBytes(h,&p->place,sizeof(p->place));
+      hashBytes(h,&p->sent,sizeof(p->sent));
+      hashBytes(h,&p->received,sizeof(p->received));
+    }
+  return h;
+}
@@ -0,0 +1,85 @@
+#ifndef BATTLEMATCH_HPP
+#define BATTLEMATCH_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Agent.hpp"
+#include "HeadlessGame.hpp"
+#include "Randomizer.hpp"
+#include "WorkerPool.hpp"
+
+/* BattleMatch
+   A battle royale between any number of HeadlessGames in one process, each
+   played by an Agent. Every board is dealt the same pieces.
+
+   Each frame runs in two phases. First every live board asks its agent for
+   inputs and steps, in parallel on a WorkerPool; boards share nothing in this
+   phase. Then, on one thread and in player order, lines cleared are turned
+   into attacks: an attack first cancels the attacker's own queued garbage,
+   and what is left goes to a live opponent chosen by the match's own random
+   number generator, with one random hole column per attack. Garbage rises
+   when the target's next piece locks (see HeadlessGame). Because all the
+   choices happen in the second phase, a match plays out identically whatever
+   the number of threads.
+
+   The match is over when at most one player is left. Players who top out on
+   the same frame share the best of the places they cover.
+ */
+class BattleMatch
+{
+public:
+  // All agents start as RandomAgents seeded from seed and the player number.
+  BattleMatch(unsigned players, std::uint32_t seed);
+  ~BattleMatch();
+
+  void setAgent(unsigned player, std::unique_ptr<Agent> agent);
+
+  // Advance every live board one frame and exchange garbage. Returns true if
+  // the match is over.
+  bool step(WorkerPool &);
+  // Step until the match is over or maxFrames have passed. Returns the number
+  // of frames stepped.
+  unsigned run(WorkerPool &, unsigned maxFrames);
+
+  bool isOver() const
+  {
+    return alive<=1;
+  }
+  unsigned getFrame() const
+  {
+    return frame;
+  }
+  unsigned getPlayers() const
+  {
+    return players.size();
+  }
+  unsigned getAlive() const
+  {
+    return alive;
+  }
+  const HeadlessGame& getGame(unsigned player) const;
+  // Finishing place, 1 for the winner; 0 while still playing.
+  unsigned getPlace(unsigned player) const;
+  unsigned getLinesSent(unsigned player) const;
+  unsigned getLinesReceived(unsigned player) const;
+  // A hash of every board and result, for comparing two runs.
+  std::uint64_t checksum() const;
+
+  // Garbage lines sent for clearing lines at once.
+  static unsigned attack(unsigned lines);
+  static constexpr unsigned MAX_INPUTS=8;
+private:
+  struct Player;
+  BattleMatch(const BattleMatch&) = delete; // Uncopyable
+
+  std::vector<std::unique_ptr<Player>> players;
+  std::vector<unsigned> targets;
+  Pcg32 rng;
+  unsigned frame,alive;
+
+  void exchange();
+};
+
+#endif // BATTLEMATCH_HPP
@@ -0,0 +1,206 @@
+#include "BeamSearch.hpp"
+
+#include <algorithm>
+
+#include "Piece.hpp"
+
+typedef std::chrono::steady_clock search_clock;
+
+// Everything a thread needs to expand nodes. Each thread's is allocated
+// separately and padded so that no two share a cache line.
+struct BeamSearch::Scratch
+{
+  Arena<Node> nodes;
+  MoveList moves;
+  std::vector<Node*> children;
+  char padding[64];
+};
+
+BeamSearch::BeamSearch(WorkerPool &pool_, unsigned width_, unsigned depth_,
+		       const Evaluator::Weights &w):
+  pool(pool_),width(std::max(width_,1u)),depth(std::max(depth_,1u)),budget(0),
+  eval(w),rootMoves(),scratch(),beam(),candidates(),timedOut(false),stats()
+{
+  for(unsigned t=0;t<pool.size();++t)
+    {
+      scratch.emplace_back(new Scratch());
+    }
+}
+
+BeamSearch::~BeamSearch()
+{
+}
+
+void BeamSearch::setBudget(std::chrono::microseconds budget_)
+{
+  budget=budget_;
+}
+
+std::size_t BeamSearch::plan(const Bitboard &board, PieceType type, unsigned orientation,
+			     const coord &center, const PieceType *preview,
+			     std::size_t previews, PieceInput *out, std::size_t max)
+{
+  const search_clock::time_point deadline=search_clock::now()+budget;
+  stats.depth=0;
+  stats.nodes=0;
+  stats.timedOut=false;
+  for(auto &s : scratch)
+    {
+      s->nodes.reset();
+      s->children.clear();
+    }
+
+  // The first level, on this thread.
+  rootMoves.generate(board,type,orientation,center);
+  if(0==rootMoves.size())
+    {
+      return 0;
+    }
+  Scratch &mine=*scratch[0];
+  for(std::size_t j=0;j<rootMoves.size();++j)
+    {
+      const Placement &p=rootMoves[j];
+      Bitboard b=board;
+      const int lines=b.place(type,p.orientation,p.x,p.y);
+      if(b.toppedOut())
+	{
+	  continue;
+	}
+      Node *c=mine.nodes.allocate();
+      c->board=b;
+      c->lines=lines;
+      c->landing=p.y+PieceMask::get(type,p.orientation).bottom;
+      c->score=eval.evaluate(b,c->lines,c->landing);
+      c->order=j;
+      c->first=j;
+      mine.children.push_back(c);
+    }
+  if(mine.children.empty())
+    {
+      // Every placement loses; take any.
+      return rootMoves.path(0,out,max);
+    }
+  stats.nodes=mine.children.size();
+  select();
+  stats.depth=1;
+
+  const std::size_t levels=std::min<std::size_t>(depth,previews+1);
+  for(std::size_t d=1;d<levels;++d)
+    {
+      const PieceType next=preview[d-1];
+      timedOut.store(false,std::memory_order_relaxed);
+      pool.runStealing(beam.size(),[&](std::size_t i, unsigned thread)
+		       {
+			 if(budget.count()>0 && search_clock::now()>=deadline)
+			   {
+			     timedOut.store(true,std::memory_order_relaxed);
+			     return;
+			   }
+			 expand(*beam[i],i,next,*scratch[thread]);
+		       });
+      if(timedOut.load(std::memory_order_relaxed))
+	{
+	  stats.timedOut=true;
+	  break;
+	}
+      std::size_t made=0;
+      for(auto &s : scratch)
+	{
+	  made+=s->children.size();
+	}
+      if(0==made)
+	{
+	  // Everything tops out from here; the last level decides.
+	  break;
+	}
+      stats.nodes+=made;
+      select();
+      ++stats.depth;
+    }
+  return rootMoves.path(beam.front()->first,out,max);
+}
+
+std::size_t BeamSearch::plan(const HeadlessGame &game, PieceInput *out, std::size_t max)
+{
+  if(game.isGameOver())
+    {
+      return 0;
+    }
+  PieceType preview[PieceQueue::CAPACITY];
+  const PieceQueue &queue=game.getQueue();
+  for(unsigned i=0;i<queue.size();++i)
+    {
+      preview[i]=queue.peek(i);
+    }
+  const Piece &current=game.getCurrent();
+  return plan(Bitboard::fromField(game.getField()),current.getType(),
+	      current.getOrientation(),current.getCenter(),preview,queue.size(),out,max);
+}
+
+// Add the children of one beam node to the thread's list.
+void BeamSearch::expand(const Node &node, std::uint32_t index, PieceType type, Scratch &s)
+{
+  s.moves.generate(node.board,type,0,Piece::spawn(type));
+  for(std::size_t j=0;j<s.moves.size();++j)
+    {
+      const Placement &p=s.moves[j];
+      Bitboard b=node.board;
+      const int lines=b.place(type,p.orientation,p.x,p.y);
+      if(b.toppedOut())
+	{
+	  continue;
+	}
+      Node *c=s.nodes.allocate();
+      c->board=b;
+      c->lines=node.lines+lines;
+      c->landing=node.landing+p.y+PieceMask::get(type,p.orientation).bottom;
+      c->score=eval.evaluate(b,c->lines,c->landing);
+      c->order=index*MoveList::STATES+j;
+      c->first=node.first;
+      s.children.push_back(c);
+    }
+}
+
+// Gather every thread's children and keep the best width of them, best first.
+void BeamSearch::select()
+{
+  candidates.clear();
+  for(auto &s : scratch)
+    {
+      candidates.insert(candidates.end(),s->children.begin(),s->children.end());
+      s->children.clear();
+    }
+  // Best first; ties go to the lower order.
+  auto order=[](const Node *l, const Node *r)
+    {
+      return l->score>r->score || (l->score==r->score && l->order<r->order);
+    };
+  if(candidates.size()>width)
+    {
+      std::nth_element(candidates.begin(),candidates.begin()+width,candidates.end(),order);
+      candidates.resize(width);
+    }
+  std::sort(candidates.begin(),candidates.end(),order);
+  beam.swap(candidates);
+}
+
+BeamAgent::BeamAgent(WorkerPool &pool, unsigned width, unsigned depth,
+		     std::chrono::microseconds budget):
+  search(pool,width,depth),length(0),sent(0),lastPiece(0)
+{
+  search.setBudget(budget);
+}
+
+std::size_t BeamAgent::act(const HeadlessGame &game, PieceInput *inputs, std::size_t max)
+{
+  if(game.getPieceCount()!=lastPiece)
+    {
+      lastPiece=game.getPieceCount();
+      length=search.plan(game,planned,MoveList::MAX_PATH);
+      sent=0;
+    }
+  const std::size_t n=std::min(max,length-sent);
+  std::copy(planned+sent,planned+sent+n,inputs);
+  sent+=n;
+  return n;
+}
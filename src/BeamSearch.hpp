@@ -0,0 +1,127 @@
+#ifndef BEAMSEARCH_HPP
+#define BEAMSEARCH_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Agent.hpp"
+#include "Arena.hpp"
+#include "Bitboard.hpp"
+#include "Bot.hpp"
+#include "WorkerPool.hpp"
+
+/* BeamSearch
+   Plans the current piece by looking ahead through the preview. The search
+   places one piece per level: every board in the beam is expanded with every
+   placement of that level's piece, each child is scored by the Evaluator
+   (counting the lines and landing heights of every piece placed on the way
+   to it), and the best width children become the next beam. The move chosen
+   is the first placement on the way to the best board of the deepest level
+   finished. Children that top out are dropped.
+
+   Levels are expanded in parallel with WorkerPool::runStealing, one task per
+   board in the beam. Each thread has its own move list, and takes children
+   from its own Arena, which is reset at the start of every plan; nothing is
+   shared between threads during a level except the beam being read.
+
+   With a budget, a level that is not finished when the budget runs out is
+   abandoned and the previous level decides; the first level is always
+   finished. Without one the result depends only on the position, not on the
+   number of threads or their timing.
+
+   The search must not be run from inside a task of its own pool.
+ */
+class BeamSearch
+{
+public:
+  struct Stats
+  {
+    // Levels finished, nodes created, and whether the budget ran out.
+    unsigned depth;
+    unsigned long nodes;
+    bool timedOut;
+  };
+
+  BeamSearch(WorkerPool &, unsigned width=64, unsigned depth=6,
+	     const Evaluator::Weights &w=Evaluator::Weights::defaults());
+  ~BeamSearch();
+
+  // Time allowed per plan; zero means no limit.
+  void setBudget(std::chrono::microseconds budget);
+
+  // Plan for a piece at center, placing the preview pieces after it, as
+  // Bot::plan. Searches at most depth pieces, counting this one.
+  std::size_t plan(const Bitboard &, PieceType type, unsigned orientation,
+		   const coord &center, const PieceType *preview, std::size_t previews,
+		   PieceInput *out, std::size_t max);
+  std::size_t plan(const HeadlessGame &, PieceInput *out, std::size_t max);
+
+  const Stats& getStats() const
+  {
+    return stats;
+  }
+  unsigned getWidth() const
+  {
+    return width;
+  }
+  unsigned getDepth() const
+  {
+    return depth;
+  }
+private:
+  struct Node
+  {
+    Bitboard board;
+    float score;
+    std::int16_t lines,landing;
+    // Position among its level's children, for breaking ties the same way
+    // whatever thread made it.
+    std::uint32_t order;
+    // Index of the first placement on the way here.
+    std::uint8_t first;
+  };
+  struct Scratch;
+  BeamSearch(const BeamSearch&) = delete; // Uncopyable
+
+  WorkerPool &pool;
+  unsigned width,depth;
+  std::chrono::microseconds budget;
+  Evaluator eval;
+  MoveList rootMoves;
+  std::vector<std::unique_ptr<Scratch>> scratch;
+  std::vector<Node*> beam,candidates;
+  std::atomic<bool> timedOut;
+  Stats stats;
+
+  void expand(const Node &, std::uint32_t index, PieceType, Scratch &);
+  void select();
+};
+
+/* BeamAgent
+   A BeamSearch as an Agent, planning once per piece with the game's whole
+   preview. Must not be used in a BattleMatch stepped on the search's own
+   pool.
+ */
+class BeamAgent : public Agent
+{
+public:
+  BeamAgent(WorkerPool &, unsigned width=64, unsigned depth=6,
+	    std::chrono::microseconds budget=std::chrono::microseconds(0));
+
+  std::size_t act(const HeadlessGame &, PieceInput *inputs, std::size_t max);
+  const BeamSearch& getSearch() const
+  {
+    return search;
+  }
+private:
+  BeamSearch search;
+  PieceInput planned[MoveList::MAX_PATH];
+  std::size_t length,sent;
+  unsigned lastPiece;
+};
+
+#endif // BEAMSEARCH_HPP
@@ -0,0 +1,66 @@
+#include "Bitboard.hpp"
+
+#include <algorithm>
+
+#include "Field.hpp"
+#include "FrameSnapshot.hpp"
+#include "Piece.hpp"
+
+// Masks for every type and orientation, generated once from the Piece's
+// shapes so the two always agree.
+struct MaskTable
+{
+  PieceMask masks[7][4];
+
+  MaskTable()
+  {
+    for(int t=0;t<7;++t)
+      {
+	for(unsigned r=0;r<4;++r)
+	  {
+	    const arrayt &blocks=Piece::shape((PieceType)t,r);
+	    PieceMask &m=masks[t][r];
+	    m.left=m.right=blocks[0].x;
+	    m.bottom=m.top=blocks[0].y;
+	    for(const coord &c : blocks)
+	      {
+		m.left=std::min(m.left,c.x);
+		m.right=std::max(m.right,c.x);
+		m.bottom=std::min(m.bottom,c.y);
+		m.top=std::max(m.top,c.y);
+	      }
+	    std::fill(m.rows,m.rows+4,0);
+	    for(const coord &c : blocks)
+	      {
+		m.rows[c.y-m.bottom] |= 1u << (c.x-m.left);
+	      }
+	  }
+      }
+  }
+};
+
+const PieceMask& PieceMask::get(PieceType t, unsigned orientation)
+{
+  static const MaskTable table;
+  return table.masks[t][orientation%4];
+}
+
+Bitboard Bitboard::fromField(const Field &f)
+{
+  Bitboard ret;
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      ret.rows[y]=f.getRow(y);
+    }
+  return ret;
+}
+
+Bitboard Bitboard::fromSnapshot(const FrameSnapshot &snap)
+{
+  Bitboard ret;
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      ret.rows[y]=snap.row(y);
+    }
+  return ret;
+}
@@ -0,0 +1,155 @@
+#ifndef BITBOARD_HPP
+#define BITBOARD_HPP
+
+#include <cstdint>
+#include <cstring>
+
+#include "common.hpp"
+
+class Field;
+struct FrameSnapshot;
+
+/* PieceMask
+   A piece type in one orientation as row bitmasks, for testing and placing
+   it a row at a time. left, right, bottom and top are the extent of its
+   blocks relative to the center. rows[k] holds row bottom+k with bit 0 for
+   column left, so a piece centered at (x,y) covers rows[k] << (x+left) in row
+   y+bottom+k.
+ */
+struct PieceMask
+{
+  int left,right,bottom,top;
+  std::uint16_t rows[4];
+
+  static const PieceMask& get(PieceType t, unsigned orientation);
+};
+
+/* Bitboard
+   A copy of the field as one bitmask per row, as Field::getRow, for code that
+   tries many placements and has to be fast: the bots. A Bitboard is plain
+   data; copying one is cheap and nothing here allocates.
+
+   The rules are the Field's and the Piece's: a piece fits if all of its
+   blocks are inside the field and on empty cells, full rows are removed when
+   a piece is placed, and the game is lost if anything is left in the two rows
+   above the visible field.
+ */
+struct Bitboard
+{
+  static constexpr std::uint16_t FULL=(1u<<FIELD_WIDTH)-1;
+  std::uint16_t rows[FIELD_HEIGHT];
+
+  static Bitboard fromField(const Field &);
+  // The field of a snapshot, without the current piece.
+  static Bitboard fromSnapshot(const FrameSnapshot &);
+
+  void clear()
+  {
+    for(int y=0;y<FIELD_HEIGHT;++y)
+      {
+	rows[y]=0;
+      }
+  }
+  bool get(int x, int y) const
+  {
+    return (rows[y] >> x) & 1;
+  }
+  // Return true if the piece fits with its center at (x,y).
+  bool fits(PieceType t, unsigned orientation, int x, int y) const
+  {
+    const PieceMask &m=PieceMask::get(t,orientation);
+    if(x+m.left<0 || x+m.right>=FIELD_WIDTH || y+m.bottom<0 || y+m.top>=FIELD_HEIGHT)
+      {
+	return false;
+      }
+    const int shift=x+m.left;
+    for(int k=0;k<=m.top-m.bottom;++k)
+      {
+	if(rows[y+m.bottom+k] & (m.rows[k] << shift))
+	  {
+	    return false;
+	  }
+      }
+    return true;
+  }
+  // Where a piece that fits at (x,y) comes to rest if hard dropped: the
+  // lowest y below which it no longer fits.
+  int drop(PieceType t, unsigned orientation, int x, int y) const
+  {
+    while(fits(t,orientation,x,y-1))
+      {
+	--y;
+      }
+    return y;
+  }
+  // Put the piece's blocks in, remove full rows and return how many there
+  // were. The piece must fit.
+  int place(PieceType t, unsigned orientation, int x, int y)
+  {
+    const PieceMask &m=PieceMask::get(t,orientation);
+    const int shift=x+m.left;
+    for(int k=0;k<=m.top-m.bottom;++k)
+      {
+	rows[y+m.bottom+k] |= m.rows[k] << shift;
+      }
+    int lines=0;
+    for(int j=y+m.bottom;j<FIELD_HEIGHT;++j)
+      {
+	if(FULL==rows[j])
+	  {
+	    ++lines;
+	  }
+	else if(lines)
+	  {
+	    rows[j-lines]=rows[j];
+	  }
+      }
+    for(int j=FIELD_HEIGHT-lines;j<FIELD_HEIGHT;++j)
+      {
+	rows[j]=0;
+      }
+    return lines;
+  }
+  // Number of rows up to and including the highest block.
+  int height() const
+  {
+    int y=FIELD_HEIGHT;
+    while(y>0 && 0==rows[y-1])
+      {
+	--y;
+      }
+    return y;
+  }
+  // Return true if a block is above the visible field, which loses the game.
+  bool toppedOut() const
+  {
+    return rows[FIELD_HEIGHT-2] | rows[FIELD_HEIGHT-1];
+  }
+  // A 64 bit hash of the blocks, for transposition tables.
+  std::uint64_t hash() const
+  {
+    std::uint64_t words[(sizeof(rows)+7)/8]={0};
+    std::memcpy(words,rows,sizeof(rows));
+    std::uint64_t h=0x9e3779b97f4a7c15ull;
+    for(std::uint64_t w : words)
+      {
+	h=(h^w)*0xff51afd7ed558ccdull;
+	h^=h>>32;
+      }
+    h*=0xc4ceb9fe1a85ec53ull;
+    return h^(h>>29);
+  }
+  bool operator==(const Bitboard &right) const
+  {
+    for(int y=0;y<FIELD_HEIGHT;++y)
+      {
+	if(rows[y]!=right.rows[y])
+	  {
+	    return false;
+	  }
+      }
+    return true;
+  }
+};
+
+#endif // BITBOARD_HPP
@@ -0,0 +1,299 @@
+#include "Bot.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+#include <limits>
+
+#include "FrameSnapshot.hpp"
+#include "Piece.hpp"
+
+Evaluator::Weights Evaluator::Weights::defaults()
+{
+  Weights ret;
+  std::fill(ret.w,ret.w+FEATURE_COUNT,0.0f);
+  ret.w[LINES]=3.418f;
+  ret.w[LANDING]=-4.500f;
+  ret.w[HOLES]=-7.899f;
+  ret.w[ROW_TRANSITIONS]=-3.218f;
+  ret.w[COLUMN_TRANSITIONS]=-9.349f;
+  ret.w[WELLS]=-3.386f;
+  return ret;
+}
+
+void Evaluator::features(const Bitboard &b, int *out)
+{
+  const int top=b.height();
+  int heights[FIELD_WIDTH]={0},depth[FIELD_WIDTH]={0};
+  unsigned above=0,lastWell=0;
+  int holes=0,rowTransitions=0,columnTransitions=0,wells=0;
+
+  // Top down, so that above holds every block over the current row.
+  for(int y=top-1;y>=0;--y)
+    {
+      const unsigned row=b.rows[y];
+      holes+=__builtin_popcount(above & ~row);
+      for(unsigned fresh=row & ~above;fresh;fresh&=fresh-1)
+	{
+	  heights[__builtin_ctz(fresh)]=y+1;
+	}
+      above|=row;
+
+      // The walls count as filled.
+      const unsigned walled=(row<<1) | 1u | (1u<<(FIELD_WIDTH+1));
+      rowTransitions+=__builtin_popcount((walled ^ (walled>>1)) & ((1u<<(FIELD_WIDTH+1))-1));
+      columnTransitions+=__builtin_popcount(row ^ (y+1<FIELD_HEIGHT ? b.rows[y+1] : 0));
+
+      // Empty cells with both neighbours filled. A well n deep scores 1+2+...+n.
+      const unsigned well=~row & Bitboard::FULL & ((row<<1) | 1u)
+	& ((row>>1) | (1u<<(FIELD_WIDTH-1)));
+      for(unsigned ended=lastWell & ~well;ended;ended&=ended-1)
+	{
+	  depth[__builtin_ctz(ended)]=0;
+	}
+      for(unsigned w=well;w;w&=w-1)
+	{
+	  wells+=++depth[__builtin_ctz(w)];
+	}
+      lastWell=well;
+    }
+  // The floor counts as filled.
+  columnTransitions+=__builtin_popcount(~b.rows[0] & Bitboard::FULL);
+
+  int aggregate=heights[0],bumpiness=0;
+  for(int x=1;x<FIELD_WIDTH;++x)
+    {
+      aggregate+=heights[x];
+      bumpiness+=std::abs(heights[x]-heights[x-1]);
+    }
+  out[LINES]=0;
+  out[LANDING]=0;
+  out[HEIGHT]=aggregate;
+  out[MAX_HEIGHT]=top;
+  out[HOLES]=holes;
+  out[ROW_TRANSITIONS]=rowTransitions;
+  out[COLUMN_TRANSITIONS]=columnTransitions;
+  out[WELLS]=wells;
+  out[BUMPINESS]=bumpiness;
+}
+
+float Evaluator::evaluate(const Bitboard &b, int lines, int landing) const
+{
+  int f[FEATURE_COUNT];
+  features(b,f);
+  f[LINES]=lines;
+  f[LANDING]=landing;
+  float ret=0;
+  for(int i=0;i<FEATURE_COUNT;++i)
+    {
+      ret+=weights.w[i]*f[i];
+    }
+  return ret;
+}
+
+// Search states are orientation and center column, with room for centers up
+// to two columns beyond either wall.
+static inline unsigned state(unsigned orientation, int x)
+{
+  return orientation*(FIELD_WIDTH+4)+(x+2);
+}
+
+void MoveList::generate(const Bitboard &board, PieceType t, unsigned orientation,
+			const coord &center)
+{
+  const int y=center.y;
+  type=t;
+  count=0;
+  orientation%=4;
+  if(!board.fits(t,orientation,center.x,y))
+    {
+      return;
+    }
+  bool seen[STATES]={false};
+  std::uint8_t queue[STATES];
+  unsigned head=0,tail=0;
+  const unsigned root=state(orientation,center.x);
+  seen[root]=true;
+  parent[root]=root;
+  queue[tail++]=root;
+
+  while(head<tail)
+    {
+      const unsigned s=queue[head++];
+      const unsigned o=s/(FIELD_WIDTH+4);
+      const int x=(int)(s%(FIELD_WIDTH+4))-2;
+
+      // Where this state lands, unless another state already lands there.
+      const int rest=board.drop(t,o,x,y);
+      const PieceMask &m=PieceMask::get(t,o);
+      std::uint64_t key=rest+m.bottom;
+      for(int k=0;k<4;++k)
+	{
+	  key|=(std::uint64_t)(m.rows[k] << (x+m.left)) << (5+FIELD_WIDTH*k);
+	}
+      bool duplicate=false;
+      for(std::size_t i=0;i<count && !duplicate;++i)
+	{
+	  duplicate=moves[i].key==key;
+	}
+      if(!duplicate)
+	{
+	  Placement &p=moves[count++];
+	  p.key=key;
+	  p.orientation=o;
+	  p.x=x;
+	  p.y=rest;
+	  p.state=s;
+	}
+
+      const PieceInput step[4]={shift_left,shift_right,rotate_cw,rotate_ccw};
+      const int dx[4]={-1,1,0,0};
+      const unsigned turn[4]={0,0,1,3};
+      for(int i=0;i<4;++i)
+	{
+	  const int nx=x+dx[i];
+	  const unsigned no=(o+turn[i])%4;
+	  if(nx<-2 || nx>FIELD_WIDTH+1)
+	    {
+	      continue;
+	    }
+	  const unsigned n=state(no,nx);
+	  if(!seen[n] && board.fits(t,no,nx,y))
+	    {
+	      seen[n]=true;
+	      parent[n]=s;
+	      input[n]=step[i];
+	      queue[tail++]=n;
+	    }
+	}
+    }
+}
+
+std::size_t MoveList::path(std::size_t i, PieceInput *out, std::size_t max) const
+{
+  std::size_t length=1;
+  for(unsigned s=moves[i].state;parent[s]!=s;s=parent[s])
+    {
+      ++length;
+    }
+  if(length>max)
+    {
+      return 0;
+    }
+  out[length-1]=hard_drop;
+  std::size_t j=length-1;
+  for(unsigned s=moves[i].state;parent[s]!=s;s=parent[s])
+    {
+      out[--j]=(PieceInput)input[s];
+    }
+  return length;
+}
+
+Bot::Bot(const Evaluator::Weights &w, bool preview_):
+  eval(w),preview(preview_),first(),second()
+{
+}
+
+std::size_t Bot::plan(const Bitboard &board, PieceType type, unsigned orientation,
+		      const coord &center, PieceType next, PieceInput *out, std::size_t max)
+{
+  first.generate(board,type,orientation,center);
+  if(0==first.size())
+    {
+      return 0;
+    }
+  std::size_t best=0;
+  float bestScore=std::numeric_limits<float>::lowest();
+  for(std::size_t i=0;i<first.size();++i)
+    {
+      const Placement &p=first[i];
+      Bitboard b=board;
+      const int lines=b.place(type,p.orientation,p.x,p.y);
+      if(b.toppedOut())
+	{
+	  continue;
+	}
+      const float s=score(b,next,lines,p.y+PieceMask::get(type,p.orientation).bottom);
+      if(s>bestScore)
+	{
+	  best=i;
+	  bestScore=s;
+	}
+    }
+  return first.path(best,out,max);
+}
+
+std::size_t Bot::plan(const HeadlessGame &game, PieceInput *out, std::size_t max)
+{
+  if(game.isGameOver())
+    {
+      return 0;
+    }
+  const Piece &current=game.getCurrent();
+  return plan(Bitboard::fromField(game.getField()),current.getType(),
+	      current.getOrientation(),current.getCenter(),game.getNext(),out,max);
+}
+
+std::size_t Bot::plan(const FrameSnapshot &snap, PieceInput *out, std::size_t max)
+{
+  if(!snap.active() || (snap.flags & FrameSnapshot::GAME_OVER))
+    {
+      return 0;
+    }
+  return plan(Bitboard::fromSnapshot(snap),snap.pieceType(),snap.orientation,
+	      snap.center(),(PieceType)snap.next,out,max);
+}
+
+// Score the board left by a placement, looking at the next piece if enabled.
+float Bot::score(const Bitboard &board, PieceType next, int lines, int landing)
+{
+  if(!preview)
+    {
+      return eval.evaluate(board,lines,landing);
+    }
+  // If the next piece cannot be placed without topping out, the game is lost.
+  float best=std::numeric_limits<float>::lowest();
+  second.generate(board,next,0,Piece::spawn(next));
+  for(std::size_t i=0;i<second.size();++i)
+    {
+      const Placement &p=second[i];
+      Bitboard b=board;
+      const int more=b.place(next,p.orientation,p.x,p.y);
+      if(b.toppedOut())
+	{
+	  continue;
+	}
+      best=std::max(best,eval.evaluate(b,lines+more,
+				       landing+p.y+PieceMask::get(next,p.orientation).bottom));
+    }
+  return best;
+}
+
+BotAgent::BotAgent(const Evaluator::Weights &w, unsigned delay_, bool preview):
+  bot(w,preview),length(0),sent(0),delay(delay_),wait(0),lastPiece(0)
+{
+}
+
+std::size_t BotAgent::act(const HeadlessGame &game, PieceInput *inputs, std::size_t max)
+{
+  if(game.getPieceCount()!=lastPiece)
+    {
+      lastPiece=game.getPieceCount();
+      length=bot.plan(game,planned,MoveList::MAX_PATH);
+      sent=0;
+      wait=delay;
+    }
+  if(wait>0)
+    {
+      --wait;
+      return 0;
+    }
+  std::size_t n=std::min(max,length-sent);
+  if(delay>0)
+    {
+      n=std::min<std::size_t>(n,1);
+      wait=delay;
+    }
+  std::copy(planned+sent,planned+sent+n,inputs);
+  sent+=n;
+  return n;
+}
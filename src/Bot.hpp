@@ -0,0 +1,163 @@
+#ifndef BOT_HPP
+#define BOT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "common.hpp"
+#include "Agent.hpp"
+#include "Bitboard.hpp"
+#include "HeadlessGame.hpp"
+
+struct FrameSnapshot;
+
+/* Evaluator
+   Scores a board as a weighted sum of features; higher is better. The board
+   features are measured on the bitboard with whole-row operations: the
+   aggregate and greatest column height, holes (empty cells with a block
+   somewhere above them), row and column transitions (changes between filled
+   and empty along each row and column, counting the walls and floor as
+   filled), cumulative well depth (1+2+...+n for every well n cells deep) and
+   bumpiness (the sum of the height differences between neighbouring
+   columns). The move features are the lines cleared and the height of the
+   lowest block of each piece placed.
+ */
+class Evaluator
+{
+public:
+  enum Feature
+    {
+      LINES,LANDING,HEIGHT,MAX_HEIGHT,HOLES,ROW_TRANSITIONS,COLUMN_TRANSITIONS,
+      WELLS,BUMPINESS,FEATURE_COUNT
+    };
+  struct Weights
+  {
+    float w[FEATURE_COUNT];
+
+    // Pierre Dellacherie's features with El-Tetris's weights.
+    static Weights defaults();
+  };
+
+  explicit Evaluator(const Weights &w=Weights::defaults()):weights(w)
+  {}
+
+  // Measure the board features; out[LINES] and out[LANDING] are set to 0.
+  static void features(const Bitboard &, int *out);
+  float evaluate(const Bitboard &, int lines, int landing) const;
+  const Weights& getWeights() const
+  {
+    return weights;
+  }
+private:
+  Weights weights;
+};
+
+/* Placement
+   Where a piece comes to rest, as the orientation and center it has when
+   hard dropped. key identifies the cells it covers, so placements reached in
+   different orientations that fill the same cells compare equal.
+ */
+struct Placement
+{
+  std::uint64_t key;
+  std::uint8_t orientation;
+  std::int8_t x,y;
+  std::uint8_t state;
+};
+
+/* MoveList
+   Every distinct placement of a piece that can be reached from where it is
+   now. The game has no soft drop and no wall kicks, so a piece can only be
+   rotated and shifted at its current height and then hard dropped; the list
+   is a breadth first search over orientations and columns, and the path to
+   each placement is the shortest.
+ */
+class MoveList
+{
+public:
+  // Number of orientation and column pairs a center can take.
+  static constexpr unsigned STATES=4*(FIELD_WIDTH+4);
+  // Longest path, including the hard drop.
+  static constexpr unsigned MAX_PATH=STATES;
+
+  MoveList():type(I),count(0)
+  {}
+
+  // Replace the list with the placements of a piece at center. The list is
+  // empty if the piece does not fit there.
+  void generate(const Bitboard &, PieceType, unsigned orientation, const coord &center);
+  std::size_t size() const
+  {
+    return count;
+  }
+  const Placement& operator[](std::size_t i) const
+  {
+    return moves[i];
+  }
+  // Write the inputs that take the piece to placement i, ending with a hard
+  // drop, and return how many. Writes nothing if they do not fit in max.
+  std::size_t path(std::size_t i, PieceInput *out, std::size_t max) const;
+private:
+  PieceType type;
+  Placement moves[STATES];
+  std::size_t count;
+  // Breadth first search tree: the state each state was reached from, and
+  // the input that reached it.
+  std::uint8_t parent[STATES],input[STATES];
+};
+
+/* Bot
+   Plays one piece at a time. Every placement of the current piece is scored
+   by the Evaluator; with preview, each is scored by the best placement of the
+   next piece on the board it leaves instead. Placements that top out are
+   taken only if nothing else is possible. There is no hold in this game.
+
+   A Bot keeps its move lists between calls and never allocates, so one Bot
+   must only be used by one thread at a time.
+ */
+class Bot
+{
+public:
+  explicit Bot(const Evaluator::Weights &w=Evaluator::Weights::defaults(),
+	       bool preview=true);
+
+  // Choose a placement for the piece and write the inputs that reach it, as
+  // MoveList::path. Returns 0 if the piece cannot move at all.
+  std::size_t plan(const Bitboard &, PieceType type, unsigned orientation,
+		   const coord &center, PieceType next, PieceInput *out, std::size_t max);
+  std::size_t plan(const HeadlessGame &, PieceInput *out, std::size_t max);
+  // Plan for the current piece of a snapshot, e.g. one published by a
+  // TetrisGame. Returns 0 if no piece is in play.
+  std::size_t plan(const FrameSnapshot &, PieceInput *out, std::size_t max);
+
+  const Evaluator& getEvaluator() const
+  {
+    return eval;
+  }
+private:
+  Evaluator eval;
+  bool preview;
+  MoveList first,second;
+
+  float score(const Bitboard &, PieceType next, int lines, int landing);
+};
+
+/* BotAgent
+   A Bot as an Agent. Plans once per piece and sends the inputs as fast as the
+   game accepts them, or one every delay frames to look like a person.
+ */
+class BotAgent : public Agent
+{
+public:
+  explicit BotAgent(const Evaluator::Weights &w=Evaluator::Weights::defaults(),
+		    unsigned delay=0, bool preview=true);
+
+  std::size_t act(const HeadlessGame &, PieceInput *inputs, std::size_t max);
+private:
+  Bot bot;
+  PieceInput planned[MoveList::MAX_PATH];
+  std::size_t length,sent;
+  unsigned delay,wait,lastPiece;
+};
+
+#endif // BOT_HPP
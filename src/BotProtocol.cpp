@@ -0,0 +1,175 @@
+#include "BotProtocol.hpp"
+
+#include <cstring>
+#include <sstream>
+
+#include "HeadlessGame.hpp"
+
+static const char PIECES[]="IJLOSTZ";
+static const char KEYS[]="RLCAD";
+
+static bool pieceFromLetter(char c, PieceType &out)
+{
+  const char *p=c ? std::strchr(PIECES,c) : nullptr;
+  if(!p)
+    {
+      return false;
+    }
+  out=(PieceType)(p-PIECES);
+  return true;
+}
+
+char BotProtocol::pieceLetter(PieceType t)
+{
+  return PIECES[t];
+}
+
+char BotProtocol::keyLetter(PieceInput i)
+{
+  return KEYS[i];
+}
+
+std::string BotProtocol::hello()
+{
+  std::ostringstream out;
+  out << "hello " << VERSION << ' ' << FIELD_WIDTH << ' ' << FIELD_HEIGHT;
+  return out.str();
+}
+
+std::string BotProtocol::move(std::uint32_t id, const HeadlessGame &game)
+{
+  const Bitboard field=Bitboard::fromField(game.getField());
+  const Piece &current=game.getCurrent();
+  std::ostringstream out;
+  out << "move " << id << ' ' << std::hex;
+  const int height=field.height();
+  for(int y=0;y<height;++y)
+    {
+      out << (y ? "/" : "") << field.rows[y];
+    }
+  if(0==height)
+    {
+      out << '-';
+    }
+  out << std::dec << ' ' << pieceLetter(current.getType()) << ' ' << current.getOrientation()
+      << ' ' << current.getCenter().x << ' ' << current.getCenter().y << ' ';
+  const PieceQueue &queue=game.getQueue();
+  for(unsigned i=0;i<queue.size();++i)
+    {
+      out << pieceLetter(queue.peek(i));
+    }
+  return out.str();
+}
+
+std::string BotProtocol::reply(const Reply &r)
+{
+  std::ostringstream out;
+  out << r.id;
+  if(Reply::PLACE==r.kind)
+    {
+      out << " place " << r.orientation << ' ' << r.x;
+    }
+  else
+    {
+      out << " inputs ";
+      for(std::size_t i=0;i<r.count;++i)
+	{
+	  out << keyLetter(r.keys[i]);
+	}
+      if(0==r.count)
+	{
+	  out << '-';
+	}
+    }
+  return out.str();
+}
+
+bool BotProtocol::parseHello(const std::string &line, std::string &name)
+{
+  std::istringstream in(line);
+  std::string word;
+  if(!(in >> word) || "ok"!=word)
+    {
+      return false;
+    }
+  name.clear();
+  std::getline(in>>std::ws,name);
+  return true;
+}
+
+bool BotProtocol::parseMove(const std::string &line, Move &m)
+{
+  std::istringstream in(line);
+  std::string word,field,queue;
+  char piece;
+  if(!(in >> word >> m.id >> field >> piece >> m.orientation >> m.center.x >> m.center.y)
+     || "move"!=word || !pieceFromLetter(piece,m.piece) || m.orientation>3)
+    {
+      return false;
+    }
+  in >> queue;
+
+  m.field.clear();
+  if("-"!=field)
+    {
+      std::istringstream rows(field);
+      std::string row;
+      int y=0;
+      while(std::getline(rows,row,'/'))
+	{
+	  char *end;
+	  const unsigned long bits=std::strtoul(row.c_str(),&end,16);
+	  if(y>=FIELD_HEIGHT || row.empty() || *end || bits>Bitboard::FULL)
+	    {
+	      return false;
+	    }
+	  m.field.rows[y++]=bits;
+	}
+    }
+  m.queued=0;
+  for(char c : queue)
+    {
+      if(m.queued>=PieceQueue::CAPACITY || !pieceFromLetter(c,m.queue[m.queued++]))
+	{
+	  return false;
+	}
+    }
+  return true;
+}
+
+bool BotProtocol::parseReply(const std::string &line, Reply &r)
+{
+  std::istringstream in(line);
+  std::string word;
+  if(!(in >> r.id >> word))
+    {
+      return false;
+    }
+  if("place"==word)
+    {
+      r.kind=Reply::PLACE;
+      r.count=0;
+      return (bool)(in >> r.orientation >> r.x) && r.orientation<4;
+    }
+  std::string keys;
+  if("inputs"!=word || !(in >> keys))
+    {
+      return false;
+    }
+  r.kind=Reply::INPUTS;
+  r.count=0;
+  if("-"==keys)
+    {
+      return true;
+    }
+  for(char c : keys)
+    {
+      const char *p=c ? std::strchr(KEYS,c) : nullptr;
+      if(!p || r.count>=MAX_KEYS)
+	{
+	  return false;
+	}
+      r.keys[r.count++]=(PieceInput)(p-KEYS);
+    }
+  return true;
+}
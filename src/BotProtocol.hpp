@@ -0,0 +1,82 @@
+#ifndef BOTPROTOCOL_HPP
+#define BOTPROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "common.hpp"
+#include "Bitboard.hpp"
+#include "Randomizer.hpp"
+
+class HeadlessGame;
+
+/* BotProtocol
+   Line format between tetris_host and an external bot running as its child,
+   on the bot's standard input and output. Every line ends with '\n'; a bot
+   must flush after each reply.
+
+   Host to bot:
+     hello VERSION WIDTH HEIGHT
+     move ID FIELD PIECE ORIENTATION X Y QUEUE
+     quit
+   FIELD is the field's rows from the bottom up as hexadecimal bitmasks
+   (bit 0 is the left column) separated by '/', leaving out the empty rows
+   at the top; "-" is an empty field. PIECE is the current piece's letter
+   (IJLOSTZ), which is at ORIENTATION (0 to 3, clockwise) with its center at
+   (X,Y). QUEUE is the letters of the pieces to come, next first.
+
+   Bot to host:
+     ok [NAME]                       the reply to hello
+     ID place ORIENTATION X          hard drop from the current height with
+				     the piece turned and shifted there
+     ID inputs KEYS                  press these keys in order: L and R
+				     shift, C and A rotate clockwise and
+				     anticlockwise, D hard drops; "-" for
+				     none
+   ID is the move's. A reply with an old ID came too late and is ignored.
+ */
+namespace BotProtocol
+{
+  constexpr unsigned VERSION=1;
+  // Most keys an inputs reply may carry, no fewer than MoveList::MAX_PATH.
+  constexpr std::size_t MAX_KEYS=64;
+
+  struct Move
+  {
+    std::uint32_t id;
+    Bitboard field;
+    PieceType piece;
+    unsigned orientation;
+    coord center;
+    PieceType queue[PieceQueue::CAPACITY];
+    std::size_t queued;
+  };
+  struct Reply
+  {
+    enum Kind
+      {
+	PLACE,INPUTS
+      } kind;
+    std::uint32_t id;
+    unsigned orientation;
+    int x;
+    PieceInput keys[MAX_KEYS];
+    std::size_t count;
+  };
+
+  std::string hello();
+  // The move line for the game's current piece, without the newline.
+  std::string move(std::uint32_t id, const HeadlessGame &);
+  std::string reply(const Reply &);
+
+  // Each returns false if the line is not one of its kind.
+  bool parseHello(const std::string &line, std::string &name);
+  bool parseMove(const std::string &line, Move &);
+  bool parseReply(const std::string &line, Reply &);
+
+  char pieceLetter(PieceType);
+  char keyLetter(PieceInput);
+}
+
+#endif // BOTPROTOCOL_HPP
@@ -0,0 +1,504 @@
+#include "Enumerator.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <unistd.h>
+
+
+static_assert(Enumerator::MAX_HEIGHT*FIELD_WIDTH<64,"Packed boards must leave the top bit free!");
+
+static constexpr std::uint64_t PRESENT=(std::uint64_t)1<<63;
+static constexpr std::size_t FIRST_SLOTS=64;
+// Keys a thread collects for a shard before inserting them.
+static constexpr std::size_t BATCH=64;
+
+ShardedSet::ShardedSet():
+  shards(new Shard[SHARDS]),count(0),memory(SHARDS*FIRST_SLOTS*sizeof(std::uint64_t))
+{
+  for(unsigned s=0;s<SHARDS;++s)
+    {
+      shards[s].slots.assign(FIRST_SLOTS,0);
+      shards[s].used=0;
+    }
+}
+
+bool ShardedSet::insertLocked(Shard &shard, std::uint64_t key)
+{
+  const std::uint64_t value=key|PRESENT;
+  std::size_t mask=shard.slots.size()-1, i=hash(key)&mask;
+  while(shard.slots[i])
+    {
+      if(value==shard.slots[i])
+	{
+	  return false;
+	}
+      i=(i+1)&mask;
+    }
+  shard.slots[i]=value;
+  if(2*++shard.used<=shard.slots.size())
+    {
+      return true;
+    }
+
+  std::vector<std::uint64_t> grown(2*shard.slots.size(),0);
+  mask=grown.size()-1;
+  for(std::uint64_t v : shard.slots)
+    {
+      if(v)
+	{
+	  i=hash(v&~PRESENT)&mask;
+	  while(grown[i])
+	    {
+	      i=(i+1)&mask;
+	    }
+	  grown[i]=v;
+	}
+    }
+  memory.fetch_add(shard.slots.size()*sizeof(std::uint64_t),std::memory_order_relaxed);
+  shard.slots.swap(grown);
+  return true;
+}
+
+std::size_t ShardedSet::insert(unsigned s, const std::uint64_t *keys, std::size_t n,
+			       std::vector<std::uint64_t> &fresh)
+{
+  Shard &shard=shards[s];
+  std::size_t added=0;
+  {
+    std::lock_guard<std::mutex> lock(shard.lock);
+    for(std::size_t i=0;i<n;++i)
+      {
+	if(insertLocked(shard,keys[i]))
+	  {
+	    fresh.push_back(keys[i]);
+	    ++added;
+	  }
+      }
+  }
+  count.fetch_add(added,std::memory_order_relaxed);
+  return added;
+}
+
+bool ShardedSet::insert(std::uint64_t key)
+{
+  Shard &sh=shards[shard(key)];
+  std::lock_guard<std::mutex> lock(sh.lock);
+  if(!insertLocked(sh,key))
+    {
+      return false;
+    }
+  count.fetch_add(1,std::memory_order_relaxed);
+  return true;
+}
+
+bool ShardedSet::contains(std::uint64_t key) const
+{
+  const Shard &sh=shards[shard(key)];
+  const std::uint64_t value=key|PRESENT;
+  std::lock_guard<std::mutex> lock(sh.lock);
+  const std::size_t mask=sh.slots.size()-1;
+  for(std::size_t i=hash(key)&mask;sh.slots[i];i=(i+1)&mask)
+    {
+      if(value==sh.slots[i])
+	{
+	  return true;
+	}
+    }
+  return false;
+}
+
+/* Frontier
+   The states of one level, as chunks in memory and, past the memory budget,
+   in a spill file. Chunks are pushed while a level is expanded and popped
+   while the next is: memory first, then the file from its start.
+ */
+class Enumerator::Frontier
+{
+public:
+  explicit Frontier(const std::string &path_):
+    lock(),chunks(),path(path_),file(nullptr),reading(false),bytes(0),spilled(0)
+  {}
+  ~Frontier()
+  {
+    if(file)
+      {
+	std::fclose(file);
+	std::remove(path.c_str());
+      }
+  }
+
+  // Keep a chunk in memory if that leaves the frontier within budget bytes,
+  // and write it to the spill file otherwise. The chunk is left empty.
+  void push(std::vector<std::uint64_t> &chunk, std::size_t budget)
+  {
+    const std::size_t size=chunk.size()*sizeof(std::uint64_t);
+    std::lock_guard<std::mutex> guard(lock);
+    if(bytes+size<=budget)
+      {
+	bytes+=size;
+	chunks.push_back(std::vector<std::uint64_t>());
+	chunks.back().swap(chunk);
+	return;
+      }
+    if(!file && !(file=std::fopen(path.c_str(),"w+b")))
+      {
+	throw SpillError("cannot create "+path+": "+std::strerror(errno));
+      }
+    if(std::fwrite(chunk.data(),sizeof(std::uint64_t),chunk.size(),file)!=chunk.size())
+      {
+	throw SpillError("cannot write "+path+": "+std::strerror(errno));
+      }
+    spilled+=chunk.size();
+    chunk.clear();
+  }
+  // Take a chunk. Returns false once everything has been taken.
+  bool pop(std::vector<std::uint64_t> &chunk)
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    if(!chunks.empty())
+      {
+	chunk.swap(chunks.back());
+	chunks.pop_back();
+	bytes-=chunk.size()*sizeof(std::uint64_t);
+	return true;
+      }
+    if(!file)
+      {
+	return false;
+      }
+    if(!reading)
+      {
+	reading=true;
+	if(std::fflush(file) || std::fseek(file,0,SEEK_SET))
+	  {
+	    throw SpillError("cannot read "+path+": "+std::strerror(errno));
+	  }
+      }
+    chunk.resize(CHUNK);
+    chunk.resize(std::fread(chunk.data(),sizeof(std::uint64_t),CHUNK,file));
+    if(std::ferror(file))
+      {
+	throw SpillError("cannot read "+path+": "+std::strerror(errno));
+      }
+    return !chunk.empty();
+  }
+  std::size_t memoryBytes()
+  {
+    std::lock_guard<std::mutex> guard(lock);
+    return bytes;
+  }
+  std::uint64_t getSpilled() const
+  {
+    return spilled;
+  }
+private:
+  std::mutex lock;
+  std::vector<std::vector<std::uint64_t>> chunks;
+  std::string path;
+  std::FILE *file;
+  bool reading;
+  std::size_t bytes;
+  std::uint64_t spilled;
+};
+
+constexpr unsigned Enumerator::MAX_HEIGHT;
+
+Enumerator::Enumerator(unsigned height_, bool mirror, std::size_t memory_,
+		       const std::string &spillDir_):
+  height(std::min(height_,MAX_HEIGHT)),folded(mirror),memory(memory_),spillDir(spillDir_),set(),
+  levels(),statesByHeight(height+1,0),boardsByHeight(height+1,0),peakFrontier(0),
+  spilledBytes(0),listener()
+{
+}
+
+std::uint64_t Enumerator::pack(const Bitboard &b, unsigned height)
+{
+  std::uint64_t ret=0;
+  for(unsigned y=0;y<height;++y)
+    {
+      ret|=(std::uint64_t)b.rows[y] << (FIELD_WIDTH*y);
+    }
+  return ret;
+}
+
+Bitboard Enumerator::unpack(std::uint64_t packed, unsigned height)
+{
+  Bitboard ret;
+  ret.clear();
+  for(unsigned y=0;y<height;++y)
+    {
+      ret.rows[y]=(packed >> (FIELD_WIDTH*y)) & Bitboard::FULL;
+    }
+  return ret;
+}
+
+// Each row of FIELD_WIDTH bits reversed.
+struct ReversedRows
+{
+  std::uint16_t rows[1<<FIELD_WIDTH];
+
+  ReversedRows()
+  {
+    for(unsigned r=0;r<(1u<<FIELD_WIDTH);++r)
+      {
+	rows[r]=0;
+	for(unsigned x=0;x<FIELD_WIDTH;++x)
+	  {
+	    rows[r]|=((r>>x)&1) << (FIELD_WIDTH-1-x);
+	  }
+      }
+  }
+};
+
+std::uint64_t Enumerator::mirror(std::uint64_t packed, unsigned height)
+{
+  static const ReversedRows reversed;
+  std::uint64_t ret=0;
+  for(unsigned y=0;y<height;++y)
+    {
+      ret|=(std::uint64_t)reversed.rows[(packed >> (FIELD_WIDTH*y)) & Bitboard::FULL]
+	<< (FIELD_WIDTH*y);
+    }
+  return ret;
+}
+
+// Rows up to and including the highest block of a packed board.
+static unsigned packedHeight(std::uint64_t packed)
+{
+  return packed ? (64-__builtin_clzll(packed)+FIELD_WIDTH-1)/FIELD_WIDTH : 0;
+}
+
+static bool sameShape(const PieceMask &a, const PieceMask &b)
+{
+  if(a.right-a.left!=b.right-b.left || a.top-a.bottom!=b.top-b.bottom)
+    {
+      return false;
+    }
+  for(int k=0;k<=a.top-a.bottom;++k)
+    {
+      if(a.rows[k]!=b.rows[k])
+	{
+	  return false;
+	}
+    }
+  return true;
+}
+
+std::size_t Enumerator::place(const Bitboard &board, PieceType type, unsigned height,
+			      Bitboard *out)
+{
+  const int top=board.height();
+  std::size_t n=0;
+  for(unsigned o=0;o<4;++o)
+    {
+      const PieceMask &m=PieceMask::get(type,o);
+      bool seen=false;
+      for(unsigned p=0;p<o && !seen;++p)
+	{
+	  seen=sameShape(PieceMask::get(type,p),m);
+	}
+      if(seen)
+	{
+	  continue;
+	}
+      for(int x=-m.left;x+m.right<FIELD_WIDTH;++x)
+	{
+	  // Resting on the top row, the piece is clear of the stack.
+	  const int y=board.drop(type,o,x,top-m.bottom);
+	  const int low=y+m.bottom, high=std::max(top,y+m.top+1), shift=x+m.left;
+	  int lines=0;
+	  for(int k=0;k<=m.top-m.bottom;++k)
+	    {
+	      lines+=Bitboard::FULL==(board.rows[low+k] | m.rows[k] << shift);
+	    }
+	  if(high-lines>(int)height)
+	    {
+	      continue;
+	    }
+	  Bitboard &b=out[n];
+	  b=board;
+	  for(int k=0;k<=m.top-m.bottom;++k)
+	    {
+	      b.rows[low+k]|=m.rows[k] << shift;
+	    }
+	  // As Bitboard::place, but only over the rows in use.
+	  if(lines)
+	    {
+	      int removed=0;
+	      for(int j=low;j<high;++j)
+		{
+		  if(Bitboard::FULL==b.rows[j])
+		    {
+		      ++removed;
+		    }
+		  else
+		    {
+		      b.rows[j-removed]=b.rows[j];
+		    }
+		}
+	      for(int j=high-removed;j<high;++j)
+		{
+		  b.rows[j]=0;
+		}
+	    }
+	  ++n;
+	}
+    }
+  return n;
+}
+
+void Enumerator::expand(WorkerPool &pool, Frontier &current, Frontier &next, Level &level)
+{
+  std::mutex totals;
+  pool.run(pool.size(),[&](std::size_t)
+	   {
+	     std::vector<std::uint64_t> chunk,fresh;
+	     std::vector<std::vector<std::uint64_t>> pending(ShardedSet::SHARDS);
+	     std::vector<std::uint64_t> states(height+1,0),mirrored(height+1,0);
+	     std::uint64_t successors=0;
+	     Bitboard boards[MAX_PLACEMENTS];
+	     fresh.reserve(CHUNK);
+
+	     // Count what is new and pass it on once there is a chunk of it.
+	     auto flush=[&](bool all)
+	       {
+		 if(fresh.size()<CHUNK && !(all && !fresh.empty()))
+		   {
+		     return;
+		   }
+		 for(std::uint64_t k : fresh)
+		   {
+		     const unsigned h=packedHeight(k);
+		     ++states[h];
+		     mirrored[h]+=folded && mirror(k,height)!=k ? 2 : 1;
+		   }
+		 const std::size_t used=set.bytes();
+		 next.push(fresh,memory>used ? memory-used : 0);
+		 fresh.reserve(CHUNK);
+	       };
+	     auto insert=[&](unsigned s)
+	       {
+		 set.insert(s,pending[s].data(),pending[s].size(),fresh);
+		 pending[s].clear();
+		 flush(false);
+	       };
+
+	     while(current.pop(chunk))
+	       {
+		 for(std::uint64_t k : chunk)
+		   {
+		     const Bitboard board=unpack(k,height);
+		     for(int t=0;t<7;++t)
+		       {
+			 const std::size_t n=place(board,(PieceType)t,height,boards);
+			 successors+=n;
+			 for(std::size_t i=0;i<n;++i)
+			   {
+			     const std::uint64_t s=key(boards[i]);
+			     const unsigned shard=ShardedSet::shard(s);
+			     pending[shard].push_back(s);
+			     if(pending[shard].size()>=BATCH)
+			       {
+				 insert(shard);
+			       }
+			   }
+		       }
+		   }
+	       }
+	     for(unsigned s=0;s<ShardedSet::SHARDS;++s)
+	       {
+		 insert(s);
+	       }
+	     flush(true);
+
+	     std::lock_guard<std::mutex> lock(totals);
+	     level.successors+=successors;
+	     for(unsigned h=0;h<=height;++h)
+	       {
+		 level.states+=states[h];
+		 level.boards+=mirrored[h];
+		 statesByHeight[h]+=states[h];
+		 boardsByHeight[h]+=mirrored[h];
+	       }
+	   });
+}
+
+void Enumerator::run(WorkerPool &pool, unsigned depth)
+{
+  const std::string prefix=spillDir+"/enum."+std::to_string(getpid())+".";
+  Bitboard empty;
+  empty.clear();
+  const std::uint64_t start=key(empty);
+  std::unique_ptr<Frontier> current(new Frontier(prefix+"0"));
+  if(set.insert(start))
+    {
+      const Level first={0,1,1,0,0,0.0};
+      levels.push_back(first);
+      statesByHeight[0]=boardsByHeight[0]=1;
+      if(listener)
+	{
+	  listener(first);
+	}
+      std::vector<std::uint64_t> chunk(1,start);
+      current->push(chunk,memory);
+    }
+
+  for(unsigned d=1;0==depth || d<=depth;++d)
+    {
+      const auto t0=std::chrono::steady_clock::now();
+      std::unique_ptr<Frontier> next(new Frontier(prefix+std::to_string(d)));
+      Level level={d,0,0,0,0,0.0};
+      expand(pool,*current,*next,level);
+      const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+      level.seconds=elapsed.count();
+      level.spilled=next->getSpilled();
+      spilledBytes+=level.spilled*sizeof(std::uint64_t);
+      peakFrontier=std::max(peakFrontier,next->memoryBytes());
+      current=std::move(next);
+      if(0==level.states)
+	{
+	  break;
+	}
+      levels.push_back(level);
+      if(listener)
+	{
+	  listener(level);
+	}
+    }
+}
+
+std::uint64_t Enumerator::getBoards() const
+{
+  std::uint64_t ret=0;
+  for(std::uint64_t b : boardsByHeight)
+    {
+      ret+=b;
+    }
+  return ret;
+}
+
+bool Enumerator::contains(const Bitboard &b) const
+{
+  return b.height()<=(int)height && set.contains(key(b));
+}
+
+void Enumerator::writeStats(std::ostream &out) const
+{
+  out << "height " << height << " mirror " << (folded ? "folded" : "unfolded") << '\n';
+  for(const Level &l : levels)
+    {
+      out << "depth " << l.depth << " states " << l.states << " boards " << l.boards
+	  << " successors " << l.successors
+	  << " spilled " << l.spilled << " seconds " << l.seconds << '\n';
+    }
+  for(unsigned h=0;h<=height;++h)
+    {
+      out << "stack " << h << " states " << statesByHeight[h] << " boards " << boardsByHeight[h] << '\n';
+    }
+  out << "states " << getStates() << " boards " << getBoards() << " table_bytes " << getTableBytes()
+      << " peak_frontier_bytes " << peakFrontier << " spilled_bytes " << spilledBytes << std::endl;
+}
@@ -0,0 +1,231 @@
+#ifndef ENUMERATOR_HPP
+#define ENUMERATOR_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Bitboard.hpp"
+#include "WorkerPool.hpp"
+
+/* ShardedSet
+   A set of 64 bit keys below 2^63 for many threads at once. The keys are
+   split by hash into SHARDS open addressing tables, each with its own lock,
+   which grows by doubling when it is half full. Threads collect keys per
+   shard and insert them a batch at a time, so a lock is taken once per batch
+   and two threads only wait for each other when they fill the same shard at
+   the same moment.
+ */
+class ShardedSet
+{
+public:
+  static constexpr unsigned SHARD_BITS=8;
+  static constexpr unsigned SHARDS=1u<<SHARD_BITS;
+
+  ShardedSet();
+
+  static std::uint64_t hash(std::uint64_t key)
+  {
+    key^=key>>33;
+    key*=0xff51afd7ed558ccdull;
+    key^=key>>33;
+    key*=0xc4ceb9fe1a85ec53ull;
+    return key^(key>>33);
+  }
+  static unsigned shard(std::uint64_t key)
+  {
+    return hash(key)>>(64-SHARD_BITS);
+  }
+  // Insert count keys, all of shard s, and append those that were not in
+  // the set yet to fresh. Returns how many were appended.
+  std::size_t insert(unsigned s, const std::uint64_t *keys, std::size_t count,
+		     std::vector<std::uint64_t> &fresh);
+  bool insert(std::uint64_t key);
+  bool contains(std::uint64_t key) const;
+  std::uint64_t size() const
+  {
+    return count.load(std::memory_order_relaxed);
+  }
+  // Call f with every key, a shard at a time. Not while keys are inserted.
+  template <class F>
+  void forEach(const F &f) const
+  {
+    for(unsigned s=0;s<SHARDS;++s)
+      {
+	for(std::uint64_t v : shards[s].slots)
+	  {
+	    if(v)
+	      {
+		f(v & ~((std::uint64_t)1<<63));
+	      }
+	  }
+      }
+  }
+  // Memory taken by the tables.
+  std::size_t bytes() const
+  {
+    return memory.load(std::memory_order_relaxed);
+  }
+private:
+  ShardedSet(const ShardedSet&) = delete; // Uncopyable
+
+  struct Shard
+  {
+    mutable std::mutex lock;
+    // Keys with the top bit set, 0 for an empty slot.
+    std::vector<std::uint64_t> slots;
+    std::size_t used;
+  };
+  std::unique_ptr<Shard[]> shards;
+  std::atomic<std::uint64_t> count;
+  std::atomic<std::size_t> memory;
+
+  bool insertLocked(Shard &, std::uint64_t key);
+};
+
+/* Enumerator
+   Finds every board of at most height rows that can be reached from the
+   empty field, under every sequence of pieces, without the stack ever
+   growing above height rows; a piece may reach higher as long as the lines
+   it clears bring the stack back down. Pieces are shifted and rotated above
+   the stack and hard dropped. So low a stack is far below where pieces
+   spawn, so every column and orientation can be reached, and placements
+   are made straight from the piece masks rather than searched for as
+   MoveList does; orientations of the same shape are placed once.
+
+   The search is breadth first, a level per piece placed, and each level's
+   boards are expanded in parallel. A board is kept as its rows packed
+   FIELD_WIDTH bits apart into one word, and with mirror folding as the
+   smaller of that word and its mirror image's: a board and its mirror image
+   are reached after the same number of pieces, J for L and S for Z, so only
+   one of them is searched. Every board found is in a ShardedSet, which is
+   never spilled: it must fit in memory, and it grows past the memory budget
+   if it has to.
+
+   The frontier, the boards found at the last level, is kept in memory while
+   the set and the frontier together take less than memory bytes; beyond
+   that it is written in chunks to a file in the spill directory and read
+   back for the next level, so the search goes on, more slowly, when the
+   frontier no longer fits. The budget only limits the frontier: once the
+   set alone takes memory bytes, the whole frontier spills. The file is
+   removed when its level is done. Spill files that cannot be written or
+   read throw SpillError.
+ */
+class Enumerator
+{
+public:
+  static constexpr unsigned MAX_HEIGHT=64/FIELD_WIDTH;
+  // Boards to a frontier chunk.
+  static constexpr std::size_t CHUNK=1<<16;
+  static constexpr unsigned MAX_PLACEMENTS=4*FIELD_WIDTH;
+
+  struct Level
+  {
+    unsigned depth;
+    // Boards first found at this level: one per mirror pair with folding,
+    // and both counted in boards.
+    std::uint64_t states,boards;
+    // Placements from the level before that kept the stack low enough.
+    std::uint64_t successors;
+    // States of this level written to the spill file.
+    std::uint64_t spilled;
+    double seconds;
+  };
+
+  Enumerator(unsigned height, bool mirror, std::size_t memory, const std::string &spillDir);
+
+  // Called with each level as it is finished.
+  void setListener(const std::function<void(const Level&)> &f)
+  {
+    listener=f;
+  }
+  // Search until no new boards are found, or up to depth pieces if depth is
+  // not 0. Call once.
+  void run(WorkerPool &, unsigned depth=0);
+
+  const std::vector<Level>& getLevels() const
+  {
+    return levels;
+  }
+  // States and boards found with each stack height.
+  const std::vector<std::uint64_t>& getStatesByHeight() const
+  {
+    return statesByHeight;
+  }
+  const std::vector<std::uint64_t>& getBoardsByHeight() const
+  {
+    return boardsByHeight;
+  }
+  std::uint64_t getStates() const
+  {
+    return set.size();
+  }
+  std::uint64_t getBoards() const;
+  std::size_t getTableBytes() const
+  {
+    return set.bytes();
+  }
+  // Largest frontier held in memory, and bytes written to spill files.
+  std::size_t getPeakFrontierBytes() const
+  {
+    return peakFrontier;
+  }
+  std::uint64_t getSpilledBytes() const
+  {
+    return spilledBytes;
+  }
+  bool contains(const Bitboard &) const;
+  // Call f with every state found, as its packed key.
+  template <class F>
+  void forEach(const F &f) const
+  {
+    set.forEach(f);
+  }
+  // Write the statistics as text.
+  void writeStats(std::ostream &) const;
+
+  // The bottom rows of a board FIELD_WIDTH bits apart, and back.
+  static std::uint64_t pack(const Bitboard &, unsigned height);
+  static Bitboard unpack(std::uint64_t, unsigned height);
+  // Write the boards left by every placement of a piece on a board of at
+  // most height rows that leaves at most height rows, full rows removed, and
+  // return how many.
+  static std::size_t place(const Bitboard &, PieceType, unsigned height, Bitboard *out);
+  // Every row reversed.
+  static std::uint64_t mirror(std::uint64_t, unsigned height);
+  static std::uint64_t canonical(std::uint64_t packed, unsigned height)
+  {
+    const std::uint64_t m=mirror(packed,height);
+    return m<packed ? m : packed;
+  }
+private:
+  Enumerator(const Enumerator&) = delete; // Uncopyable
+
+  class Frontier;
+
+  unsigned height;
+  bool folded;
+  std::size_t memory;
+  std::string spillDir;
+  ShardedSet set;
+  std::vector<Level> levels;
+  std::vector<std::uint64_t> statesByHeight,boardsByHeight;
+  std::size_t peakFrontier;
+  std::uint64_t spilledBytes;
+  std::function<void(const Level&)> listener;
+
+  std::uint64_t key(const Bitboard &b) const
+  {
+    const std::uint64_t p=pack(b,height);
+    return folded ? canonical(p,height) : p;
+  }
+  void expand(WorkerPool &, Frontier &current, Frontier &next, Level &);
+};
+
+#endif // ENUMERATOR_HPP
@@ -0,0 +1,197 @@
+#include "Expectimax.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "Piece.hpp"
+
+// A board on which the game is lost. Finite, so that it can be averaged.
+static constexpr float LOSS=-1e6f;
+
+// Move lists for every level of the search, and counters, for one thread.
+// Each thread's is allocated separately and padded so that no two share a
+// cache line.
+struct Expectimax::Scratch
+{
+  MoveList moves[MAX_DEPTH+1];
+  Stats stats;
+  char padding[64];
+};
+
+constexpr unsigned Expectimax::MAX_DEPTH;
+
+Expectimax::Expectimax(WorkerPool &pool_, TranspositionTable *table_, unsigned depth_,
+		       unsigned known_, const Evaluator::Weights &w):
+  pool(pool_),table(table_),depth(std::min(depth_,MAX_DEPTH)),known(known_),eval(w),
+  salt(0xcbf29ce484222325ull),rootMoves(),scratch(),values(),knownNow(0),stats(),totals()
+{
+  // Results computed with other weights mean something else.
+  unsigned char bytes[sizeof(w.w)];
+  std::memcpy(bytes,w.w,sizeof(bytes));
+  for(unsigned char c : bytes)
+    {
+      salt=(salt^c)*0x100000001b3ull;
+    }
+  for(unsigned t=0;t<pool.size();++t)
+    {
+      scratch.emplace_back(new Scratch());
+    }
+}
+
+Expectimax::~Expectimax()
+{
+}
+
+std::size_t Expectimax::plan(const Bitboard &board, PieceType type, unsigned orientation,
+			     const coord &center, const PieceType *preview,
+			     std::size_t previews, PieceInput *out, std::size_t max)
+{
+  knownNow=std::min<std::size_t>(std::min(known,depth),previews);
+  std::copy(preview,preview+knownNow,pieces);
+  for(auto &s : scratch)
+    {
+      s->stats=Stats();
+    }
+  if(table)
+    {
+      table->newSearch();
+    }
+
+  rootMoves.generate(board,type,orientation,center);
+  if(0==rootMoves.size())
+    {
+      return 0;
+    }
+  values.assign(rootMoves.size(),std::numeric_limits<float>::lowest());
+  pool.runStealing(rootMoves.size(),[&](std::size_t i, unsigned thread)
+		   {
+		     const Placement &p=rootMoves[i];
+		     Bitboard b=board;
+		     const int lines=b.place(type,p.orientation,p.x,p.y);
+		     if(!b.toppedOut())
+		       {
+			 values[i]=moveTerms(lines,p.y+PieceMask::get(type,p.orientation).bottom)
+			   +after(b,0,*scratch[thread]);
+		       }
+		   });
+
+  stats=Stats();
+  for(auto &s : scratch)
+    {
+      stats.nodes+=s->stats.nodes;
+      stats.probes+=s->stats.probes;
+      stats.hits+=s->stats.hits;
+    }
+  totals.nodes+=stats.nodes;
+  totals.probes+=stats.probes;
+  totals.hits+=stats.hits;
+  return rootMoves.path(std::max_element(values.begin(),values.end())-values.begin(),out,max);
+}
+
+std::size_t Expectimax::plan(const HeadlessGame &game, PieceInput *out, std::size_t max)
+{
+  if(game.isGameOver())
+    {
+      return 0;
+    }
+  PieceType preview[PieceQueue::CAPACITY];
+  const PieceQueue &queue=game.getQueue();
+  for(unsigned i=0;i<queue.size();++i)
+    {
+      preview[i]=queue.peek(i);
+    }
+  const Piece &current=game.getCurrent();
+  return plan(Bitboard::fromField(game.getField()),current.getType(),
+	      current.getOrientation(),current.getCenter(),preview,queue.size(),out,max);
+}
+
+// The value of a board once the current piece and placed more are down.
+float Expectimax::after(const Bitboard &board, unsigned placed, Scratch &s)
+{
+  if(placed>=depth)
+    {
+      ++s.stats.nodes;
+      return eval.evaluate(board,0,0);
+    }
+  if(placed<knownNow)
+    {
+      return best(board,pieces[placed],placed,s);
+    }
+  return chance(board,placed,s);
+}
+
+// The value of the best placement of a piece of the given type.
+float Expectimax::best(const Bitboard &board, PieceType type, unsigned placed, Scratch &s)
+{
+  MoveList &moves=s.moves[placed];
+  float ret=LOSS;
+  moves.generate(board,type,0,Piece::spawn(type));
+  for(std::size_t i=0;i<moves.size();++i)
+    {
+      const Placement &p=moves[i];
+      Bitboard b=board;
+      const int lines=b.place(type,p.orientation,p.x,p.y);
+      if(b.toppedOut())
+	{
+	  continue;
+	}
+      ret=std::max(ret,moveTerms(lines,p.y+PieceMask::get(type,p.orientation).bottom)
+		   +after(b,placed+1,s));
+    }
+  return ret;
+}
+
+// The average value of the best placement of each type of piece.
+float Expectimax::chance(const Bitboard &board, unsigned placed, Scratch &s)
+{
+  const unsigned remaining=depth-placed;
+  const std::uint64_t key=board.hash() ^ salt ^ (remaining*0x9e3779b97f4a7c15ull);
+  float ret;
+  if(table)
+    {
+      ++s.stats.probes;
+      if(table->probe(key,remaining,ret))
+	{
+	  ++s.stats.hits;
+	  return ret;
+	}
+    }
+  ret=0;
+  for(int t=0;t<7;++t)
+    {
+      ret+=best(board,(PieceType)t,placed,s);
+    }
+  ret/=7;
+  if(table)
+    {
+      table->store(key,remaining,ret);
+    }
+  return ret;
+}
+
+float Expectimax::moveTerms(int lines, int landing) const
+{
+  const Evaluator::Weights &w=eval.getWeights();
+  return w.w[Evaluator::LINES]*lines+w.w[Evaluator::LANDING]*landing;
+}
+
+ExpectimaxAgent::ExpectimaxAgent(WorkerPool &pool, TranspositionTable *table,
+				 unsigned depth, unsigned known):
+  search(pool,table,depth,known),length(0),sent(0),lastPiece(0)
+{
+}
+
+std::size_t ExpectimaxAgent::act(const HeadlessGame &game, PieceInput *inputs, std::size_t max)
+{
+  if(game.getPieceCount()!=lastPiece)
+    {
+      lastPiece=game.getPieceCount();
+      length=search.plan(game,planned,MoveList::MAX_PATH);
+      sent=0;
+    }
+  const std::size_t n=std::min(max,length-sent);
+  std::copy(planned+sent,planned+sent+n,inputs);
+  sent+=n;
+  return n;
+}
@@ -0,0 +1,115 @@
+#ifndef EXPECTIMAX_HPP
+#define EXPECTIMAX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "Agent.hpp"
+#include "Bitboard.hpp"
+#include "Bot.hpp"
+#include "TranspositionTable.hpp"
+#include "WorkerPool.hpp"
+
+/* Expectimax
+   Plans the current piece by averaging over the pieces that may follow it.
+   The search places depth more pieces after the current one. The first known
+   of them are taken from the preview, and a placement of a known piece is
+   worth the best of what follows it. Every later piece is a chance node:
+   its value is the average, over the seven piece types, of the best
+   placement of that type, as if each were equally likely. That is exact for
+   a memoryless randomizer and close for a bag over a few pieces.
+
+   A placement is worth the Evaluator's line and landing terms for that piece
+   plus the value of the board it leaves; at the bottom of the search, a
+   board is worth the Evaluator's score for it. Placements that top out are
+   never taken while anything else is possible.
+
+   The value of a chance node depends only on the board, the number of pieces
+   still to place and the weights. It is the same whichever order the pieces
+   above it went in, so chance nodes are cached in a TranspositionTable,
+   keyed by the board's hash mixed with the other two. The table can be
+   shared between searchers and threads, and kept between runs; it makes a
+   search faster but never changes its result. The current piece's
+   placements are searched in parallel on the pool.
+ */
+class Expectimax
+{
+public:
+  struct Stats
+  {
+    unsigned long nodes,probes,hits;
+
+    double hitRate() const
+    {
+      return probes ? (double)hits/probes : 0.0;
+    }
+  };
+  static constexpr unsigned MAX_DEPTH=4;
+
+  // table may be NULL for no caching. depth is clamped to MAX_DEPTH.
+  Expectimax(WorkerPool &, TranspositionTable *table, unsigned depth=2, unsigned known=1,
+	     const Evaluator::Weights &w=Evaluator::Weights::defaults());
+  ~Expectimax();
+
+  // As BeamSearch::plan.
+  std::size_t plan(const Bitboard &, PieceType type, unsigned orientation,
+		   const coord &center, const PieceType *preview, std::size_t previews,
+		   PieceInput *out, std::size_t max);
+  std::size_t plan(const HeadlessGame &, PieceInput *out, std::size_t max);
+
+  // The last plan, and every plan so far.
+  const Stats& getStats() const
+  {
+    return stats;
+  }
+  const Stats& getTotals() const
+  {
+    return totals;
+  }
+private:
+  struct Scratch;
+  Expectimax(const Expectimax&) = delete; // Uncopyable
+
+  WorkerPool &pool;
+  TranspositionTable *table;
+  unsigned depth,known;
+  Evaluator eval;
+  std::uint64_t salt;
+  MoveList rootMoves;
+  std::vector<std::unique_ptr<Scratch>> scratch;
+  std::vector<float> values;
+  // The pieces after the current one; the first knownNow are certain.
+  PieceType pieces[MAX_DEPTH+1];
+  unsigned knownNow;
+  Stats stats,totals;
+
+  float after(const Bitboard &, unsigned placed, Scratch &);
+  float best(const Bitboard &, PieceType, unsigned placed, Scratch &);
+  float chance(const Bitboard &, unsigned placed, Scratch &);
+  float moveTerms(int lines, int landing) const;
+};
+
+/* ExpectimaxAgent
+   An Expectimax as an Agent, planning once per piece. As BeamAgent, it must
+   not be stepped on the search's own pool.
+ */
+class ExpectimaxAgent : public Agent
+{
+public:
+  ExpectimaxAgent(WorkerPool &, TranspositionTable *table, unsigned depth=2, unsigned known=1);
+
+  std::size_t act(const HeadlessGame &, PieceInput *inputs, std::size_t max);
+  const Expectimax& getSearch() const
+  {
+    return search;
+  }
+private:
+  Expectimax search;
+  PieceInput planned[MoveList::MAX_PATH];
+  std::size_t length,sent;
+  unsigned lastPiece;
+};
+
+#endif // EXPECTIMAX_HPP
@@ -53,6 +53,22 @@ bool Field::get(int x, int y) const
 
   return iblocks[x+y*FIELD_WIDTH];
 }
+// Bitmask of row y: bit x is set if there is a block at (x,y).
+unsigned int Field::getRow(int y) const
+{
+  unsigned int row=0;
+  // Check range
+  if(0>y||y>=FIELD_HEIGHT) throw FieldSizeError();
+
+  for(int i=0;i<FIELD_WIDTH;++i)
+    {
+      if(iblocks[i+y*FIELD_WIDTH])
+	{
+	  row|=1u<<i;
+	}
+    }
+  return row;
+}
 // Insert a block at the given co-ordinate. Inserting a block on top of an 
 // existing block is an error.
 void Field::set(int x, int y)
@@ -70,6 +86,38 @@ void Field::set(int x, int y)
   iblocks[x+y*FIELD_WIDTH]=true;
   checkLine(y);
 }
+// Push the stack up and fill the bottom lines with garbage.
+bool Field::insertGarbage(int lines, int hole)
+{
+  bool overflow=false;
+  int i;
+  if(0>hole||hole>=FIELD_WIDTH)
+    {
+      throw FieldSizeError();
+    }
+  if(0>=lines)
+    {
+      return false;
+    }
+  if(lines>FIELD_HEIGHT)
+    {
+      lines=FIELD_HEIGHT;
+    }
+  // Anything in the top lines is lost.
+  for(i=FIELD_WIDTH*(FIELD_HEIGHT-lines);i<FIELD_SIZE;++i)
+    {
+      overflow=overflow||iblocks[i];
+    }
+  for(i=FIELD_SIZE-1;i>=FIELD_WIDTH*lines;--i)
+    {
+      iblocks[i]=iblocks[i-FIELD_WIDTH*lines];
+    }
+  for(/*where we left off*/;i>=0;--i)
+    {
+      iblocks[i]=(i%FIELD_WIDTH!=hole);
+    }
+  return overflow;
+}
 
 // Find the current score
 int Field::readScore() const
@@ -81,6 +129,11 @@ void Field::resetScore()
 {
   score=0;
 }
+// Set the score, e.g. to carry on a saved game
+void Field::setScore(int s)
+{
+  score=s;
+}
 // Set all blocks to false.
 void Field::resetBlocks()
 {
@@ -31,6 +31,8 @@ public:
   bool get(int x, int y) const; //throw (FieldSizeError);
   inline bool get(const coord&c) const //throw(FieldSizeError)
   {return get(c.x,c.y);}
+  // Bitmask of row y: bit x is set if there is a block at (x,y).
+  unsigned int getRow(int y) const; //throw (FieldSizeError);
   // Find the current score
   int readScore() const;
 
@@ -39,8 +41,14 @@ public:
   void set(int x, int y); //throw (FieldSizeError, DuplicateBlockError);
   inline void set(const coord&c) //throw(FieldSizeError,DuplicateBlockError)
   {set(c.x,c.y);}
+  // Push the stack up by the given number of lines and fill the lines at the
+  // bottom with garbage: every column but hole. Returns true if any block was
+  // pushed off the top of the field, which loses the game.
+  bool insertGarbage(int lines, int hole); //throw (FieldSizeError);
   // Set the score to 0
   void resetScore();
+  // Set the score, e.g. to carry on a saved game
+  void setScore(int s);
   // Set all blocks to false.
   void resetBlocks();
 
@@ -0,0 +1,205 @@
+#include "Finesse.hpp"
+
+#include <algorithm>
+#include <cstdint>
+
+#include "Piece.hpp"
+
+static constexpr unsigned STATES=4*Finesse::COLUMNS;
+
+static inline unsigned state(unsigned orientation, int x)
+{
+  return orientation*Finesse::COLUMNS+(x+2);
+}
+static inline unsigned orientationOf(unsigned s)
+{
+  return s/Finesse::COLUMNS;
+}
+static inline int columnOf(unsigned s)
+{
+  return (int)(s%Finesse::COLUMNS)-2;
+}
+
+// Return true if two drops cover the same columns with the same shape, and
+// so land in the same place on any board.
+static bool sameDrop(PieceType t, unsigned a, unsigned b)
+{
+  const PieceMask &ma=PieceMask::get(t,orientationOf(a)), &mb=PieceMask::get(t,orientationOf(b));
+  return columnOf(a)+ma.left==columnOf(b)+mb.left && ma.top-ma.bottom==mb.top-mb.bottom
+    && std::equal(ma.rows,ma.rows+4,mb.rows);
+}
+
+/* A breadth first search over the states a piece can reach from where it
+   spawns by shifting and rotating at that height, as MoveList's. */
+struct Search
+{
+  std::uint8_t order[STATES],parent[STATES],input[STATES];
+  unsigned count;
+
+  Search(const Bitboard &board, PieceType t):count(0)
+  {
+    const coord spawn=Piece::spawn(t);
+    bool seen[STATES]={false};
+    const unsigned root=state(0,spawn.x);
+    if(!board.fits(t,0,spawn.x,spawn.y))
+      {
+	return;
+      }
+    seen[root]=true;
+    parent[root]=root;
+    order[count++]=root;
+    for(unsigned head=0;head<count;++head)
+      {
+	const unsigned s=order[head];
+	const PieceInput step[4]={shift_left,shift_right,rotate_cw,rotate_ccw};
+	const int dx[4]={-1,1,0,0};
+	const unsigned turn[4]={0,0,1,3};
+	for(int i=0;i<4;++i)
+	  {
+	    const int nx=columnOf(s)+dx[i];
+	    const unsigned no=(orientationOf(s)+turn[i])%4;
+	    if(nx<-2 || nx>FIELD_WIDTH+1)
+	      {
+		continue;
+	      }
+	    const unsigned n=state(no,nx);
+	    if(!seen[n] && board.fits(t,no,nx,spawn.y))
+	      {
+		seen[n]=true;
+		parent[n]=s;
+		input[n]=step[i];
+		order[count++]=n;
+	      }
+	  }
+      }
+  }
+
+  // The first state reached that drops like target, or STATES if none does.
+  unsigned nearest(PieceType t, unsigned target) const
+  {
+    for(unsigned i=0;i<count;++i)
+      {
+	if(sameDrop(t,order[i],target))
+	  {
+	    return order[i];
+	  }
+      }
+    return STATES;
+  }
+  std::size_t path(unsigned s, PieceInput *out, std::size_t max) const
+  {
+    std::size_t length=1;
+    for(unsigned k=s;parent[k]!=k;k=parent[k])
+      {
+	++length;
+      }
+    if(length>max)
+      {
+	return 0;
+      }
+    out[length-1]=hard_drop;
+    std::size_t j=length-1;
+    for(unsigned k=s;parent[k]!=k;k=parent[k])
+      {
+	out[--j]=(PieceInput)input[k];
+      }
+    return length;
+  }
+};
+
+// The empty field's paths for every type and state.
+struct FinesseTable
+{
+  std::uint8_t length[7][STATES];
+  PieceInput inputs[7][STATES][Finesse::MAX_INPUTS];
+
+  FinesseTable()
+  {
+    Bitboard empty;
+    empty.clear();
+    for(int t=0;t<7;++t)
+      {
+	const Search search(empty,(PieceType)t);
+	for(unsigned s=0;s<STATES;++s)
+	  {
+	    const unsigned best=search.nearest((PieceType)t,s);
+	    const bool fits=empty.fits((PieceType)t,orientationOf(s),columnOf(s),
+				       Piece::spawn((PieceType)t).y);
+	    length[t][s]=(fits && best<STATES)
+	      ? search.path(best,inputs[t][s],Finesse::MAX_INPUTS) : 0;
+	  }
+      }
+  }
+};
+
+static const FinesseTable& table()
+{
+  static const FinesseTable ret;
+  return ret;
+}
+
+static bool inRange(unsigned orientation, int x)
+{
+  return orientation<4 && x>=-2 && x<FIELD_WIDTH+2;
+}
+
+unsigned Finesse::length(PieceType t, unsigned orientation, int x)
+{
+  return inRange(orientation,x) ? table().length[t][state(orientation,x)] : 0;
+}
+
+std::size_t Finesse::path(PieceType t, unsigned orientation, int x, PieceInput *out,
+			  std::size_t max)
+{
+  const unsigned n=length(t,orientation,x);
+  if(0==n || n>max)
+    {
+      return 0;
+    }
+  const PieceInput *in=table().inputs[t][state(orientation,x)];
+  std::copy(in,in+n,out);
+  return n;
+}
+
+std::size_t Finesse::path(const Bitboard &board, PieceType t, unsigned orientation, int x,
+			  PieceInput *out, std::size_t max)
+{
+  if(!inRange(orientation,x))
+    {
+      return 0;
+    }
+  // Follow the table's path while the piece fits.
+  const unsigned n=length(t,orientation,x);
+  const PieceInput *in=table().inputs[t][state(orientation,x)];
+  const coord spawn=Piece::spawn(t);
+  unsigned o=0;
+  int cx=spawn.x;
+  bool clear=n>0 && board.fits(t,o,cx,spawn.y);
+  for(unsigned i=0;clear && i+1<n;++i)
+    {
+      switch(in[i])
+	{
+	case shift_left:
+	  --cx;
+	  break;
+	case shift_right:
+	  ++cx;
+	  break;
+	case rotate_cw:
+	  o=(o+1)%4;
+	  break;
+	default:
+	  o=(o+3)%4;
+	  break;
+	}
+      clear=board.fits(t,o,cx,spawn.y);
+    }
+  if(clear)
+    {
+      return path(t,orientation,x,out,max);
+    }
+
+  const Search search(board,t);
+  const unsigned best=search.nearest(t,state(orientation,x));
+  return best<STATES ? search.path(best,out,max) : 0;
+}
@@ -0,0 +1,43 @@
+#ifndef FINESSE_HPP
+#define FINESSE_HPP
+
+#include <cstddef>
+
+#include "common.hpp"
+#include "Bitboard.hpp"
+
+/* Finesse
+   The fewest inputs that take a piece from where it spawns to a placement:
+   shifts and rotations, then a hard drop. A placement is named by the
+   orientation and center column the piece is dropped from. Placements whose
+   blocks differ only in height land in the same place, so the shortest way
+   to any of them counts: a vertical S may be dropped from either vertical
+   orientation, whichever is nearer.
+
+   Paths on an empty field are worked out once, for every type, orientation
+   and column, by a breadth first search in the same order as MoveList's. On
+   a board, the table's path is used if the piece fits at every step of it;
+   if the stack is in the way, the board is searched instead.
+ */
+class Finesse
+{
+public:
+  // Center columns a piece can take, from two beyond the left wall.
+  static constexpr unsigned COLUMNS=FIELD_WIDTH+4;
+  // Longest path on an empty field, including the hard drop.
+  static constexpr unsigned MAX_INPUTS=12;
+
+  // Write the shortest inputs, ending with a hard drop, for a piece of type
+  // spawned on an empty field to be dropped from (orientation,x). Returns
+  // their number, or 0 if the piece cannot be there or they do not fit in
+  // max.
+  static std::size_t path(PieceType, unsigned orientation, int x, PieceInput *out,
+			  std::size_t max);
+  // The same for a piece spawned on the board.
+  static std::size_t path(const Bitboard &, PieceType, unsigned orientation, int x,
+			  PieceInput *out, std::size_t max);
+  // Number of inputs path would write on an empty field, or 0.
+  static unsigned length(PieceType, unsigned orientation, int x);
+};
+
+#endif // FINESSE_HPP
@@ -37,12 +37,13 @@ static_assert(sizeof(BGRA) == 4*sizeof(GLfloat),"Struct BGRA is the wrong size!"
 
 Fl_Gl_Tetris::Fl_Gl_Tetris( int x,int y,int w,int h, const char *l):
   Fl_Gl_Window(x,y,w,h,l),
-  gmod(false),cmod(true),running(false),
+  gmod(false),cmod(true),running(false),left(false),right(false),
   squareVBO(0),squareTexID(0),squareIBO(0),VAO(0),
   shaderProgram(0),vertexShader(0),fragShader(0),
   projectionUniform(-1),modelviewUniform(-1),tintUniform(-1),
-  mBuff(),mCB(&mBuff,&DataDoubleBuffer::write),mGame(&mCB)
+  mSlot(),mCB(&mSlot,&Seqlock<FrameSnapshot>::write),mReader(mSlot),mGame()
 {
+  mGame.setPublisher(&mCB);
 }
 Fl_Gl_Tetris::~Fl_Gl_Tetris()
 {
@@ -86,6 +87,8 @@ void Fl_Gl_Tetris::startTetris()
 {
   if(running)
     {
+      // Releases are not queued while paused.
+      releaseKeys();
       mGame.pause();
       Fl::lock();
       Fl::remove_timeout(redraw_cb,this);
@@ -104,12 +107,17 @@ void Fl_Gl_Tetris::startTetris()
 void Fl_Gl_Tetris::reset()
 {
   mGame.~TetrisGame();
-  new(&mGame) TetrisGame(&mCB);
+  new(&mGame) TetrisGame();
   
-  mBuff.~DataDoubleBuffer();
-  new(&mBuff) DataDoubleBuffer();
+  mSlot.~Seqlock<FrameSnapshot>();
+  new(&mSlot) Seqlock<FrameSnapshot>();
+  mReader.~Reader();
+  new(&mReader) Seqlock<FrameSnapshot>::Reader(mSlot);
+
+  mGame.setPublisher(&mCB);
 
   running = false;
+  left=right=false;
 
   Fl::lock();
   Fl::remove_timeout(redraw_cb,this);
@@ -124,9 +132,18 @@ int Fl_Gl_Tetris::handle(int e)
   constexpr int FL_SPACEBAR=32;
   int ret=0;
 
+  // Take focus, so key releases come here.
+  if(FL_FOCUS==e || FL_UNFOCUS==e)
+    {
+      if(FL_UNFOCUS==e)
+	{
+	  releaseKeys();
+	}
+      return 1;
+    }
 
   // Handle keyboard events if running
-  if(running && FL_SHORTCUT==e)
+  if(running && (FL_KEYDOWN==e || FL_SHORTCUT==e))
     {
       if(Fl::event_key('x'))
 	{
@@ -138,9 +155,15 @@ int Fl_Gl_Tetris::handle(int e)
 	  mGame.queueInput(rotate_ccw);
 	  ret=1;
 	}
+      // The game repeats held shift keys itself, so the system's repeats are
+      // not queued.
       if(Fl::event_key('a'))
 	{
-	  mGame.queueInput(shift_left);
+	  if(!left)
+	    {
+	      mGame.queueInput(press_left);
+	      left=true;
+	    }
 	  ret=1;
 	}
       if(Fl::event_key('e'))
@@ -150,7 +173,26 @@ int Fl_Gl_Tetris::handle(int e)
 	}
       if(Fl::event_key('d'))
 	{
-	  mGame.queueInput(shift_right);
+	  if(!right)
+	    {
+	      mGame.queueInput(press_right);
+	      right=true;
+	    }
+	  ret=1;
+	}
+    }
+  if(running && FL_KEYUP==e)
+    {
+      if('a'==Fl::event_key() && left)
+	{
+	  mGame.queueInput(release_left);
+	  left=false;
+	  ret=1;
+	}
+      if('d'==Fl::event_key() && right)
+	{
+	  mGame.queueInput(release_right);
+	  right=false;
 	  ret=1;
 	}
     }
@@ -160,6 +202,19 @@ int Fl_Gl_Tetris::handle(int e)
   return ret;
 }
 
+void Fl_Gl_Tetris::releaseKeys()
+{
+  if(running && left)
+    {
+      mGame.queueInput(release_left);
+    }
+  if(running && right)
+    {
+      mGame.queueInput(release_right);
+    }
+  left=right=false;
+}
+
 // Protected functions
 
 void Fl_Gl_Tetris::draw()
@@ -193,7 +248,7 @@ void Fl_Gl_Tetris::draw()
     }
   //std::cout << "Beginning draw\n";
   //printGlError();
-  const DataBuffer & gameState=mBuff.swap_and_read();
+  const FrameSnapshot & gameState=mReader.read();
 
   std::stack<GLFMatrix4x4> ModelviewStack;
   GLFMatrix4x4 Modelview;
@@ -212,11 +267,12 @@ void Fl_Gl_Tetris::draw()
   //std::cout << "Entering field loop\n";
   //printGlError();
   // Draw blocks set in field
-  for(unsigned i=0;i<FIELD_WIDTH;++i)
+  for(unsigned j=0;j<FIELD_HEIGHT;++j)
     {
-      for(unsigned j=0;j<FIELD_HEIGHT;++j)
+      const unsigned row=gameState.row(j);
+      for(unsigned i=0;row>>i;++i)
 	{
-	  if(gameState.field.get(i,j))
+	  if(row & (1u<<i))
 	    {
 	      Modelview=ModelviewStack.top();
 	      Modelview=Modelview*makeTranslationMatrix( glVec(i,j,0.0f,0.0f) );
@@ -230,11 +286,11 @@ void Fl_Gl_Tetris::draw()
   //std::cout << "Entering current piece loop\n";
   //printGlError();
   // Draw current piece
-  arrayt blocks=gameState.current.getBlocks();
+  arrayt blocks=gameState.blocks();
 
   if(cmod)
     {
-      switch(gameState.current.getType())
+      switch(gameState.pieceType())
 	{
 	case I:
 	  glUniform4fv(tintUniform, 1, I_COLOR.data);
@@ -263,12 +319,15 @@ void Fl_Gl_Tetris::draw()
 	}
     }
 
-  for(auto block : blocks)
+  if(gameState.active())
     {
-      Modelview=ModelviewStack.top();
-      Modelview=Modelview*makeTranslationMatrix( glVec(block.x,block.y,0,0) );
-      glUniformMatrix4fv(modelviewUniform,1,GL_FALSE,Modelview.data);
-      glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,0);
+      for(auto block : blocks)
+	{
+	  Modelview=ModelviewStack.top();
+	  Modelview=Modelview*makeTranslationMatrix( glVec(block.x,block.y,0,0) );
+	  glUniformMatrix4fv(modelviewUniform,1,GL_FALSE,Modelview.data);
+	  glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,0);
+	}
     }
   //std::cout << "Drawing test square\n";
   //printGlError();
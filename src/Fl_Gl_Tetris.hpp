@@ -11,7 +11,8 @@
 #include <FL/Fl.H>
 #include <FL/gl.h>
 #include <FL/Fl_Gl_Window.H>
-#include "DataDoubleBuffer.hpp"
+#include "SeqlockBuffer.hpp"
+#include "FrameSnapshot.hpp"
 
 
 
@@ -36,16 +37,21 @@ protected:
 
 private:
   bool gmod,cmod,running;
+  // The shift keys the game has been told are held.
+  bool left,right;
   GLuint squareVBO,squareTexID,squareIBO,VAO,
     shaderProgram,vertexShader,fragShader;
   GLint projectionUniform,modelviewUniform,tintUniform;
 
-  DataDoubleBuffer mBuff;
-  RenderFunc<DataDoubleBuffer> mCB;
+  Seqlock<FrameSnapshot> mSlot;
+  SnapshotFunc<Seqlock<FrameSnapshot>> mCB;
+  Seqlock<FrameSnapshot>::Reader mReader;
   TetrisGame mGame;
 
   // Throws std::runtime_error if shader loading fails.
   void initGL();
+  // Tell the game the shift keys are no longer held.
+  void releaseKeys();
 
 };
 
@@ -0,0 +1,40 @@
+#include "FrameSnapshot.hpp"
+
+#include <cstring>
+
+FrameSnapshot FrameSnapshot::encode(const Field &field, const Piece &current,
+				    const Piece *hold, PieceType next, unsigned frame)
+{
+  FrameSnapshot ret;
+  std::memset(&ret,0,sizeof(ret));
+
+  for(int j=0;j<FIELD_HEIGHT;++j)
+    {
+      ret.setRow(j,field.getRow(j));
+    }
+  const coord c=current.getCenter();
+  ret.frame=frame;
+  ret.score=field.readScore();
+  ret.type=current.getType();
+  ret.orientation=current.getOrientation();
+  ret.x=c.x;
+  ret.y=c.y;
+  ret.next=next;
+  ret.flags=ACTIVE;
+  if(nullptr!=hold)
+    {
+      ret.hold=hold->getType();
+      ret.flags|=HOLDING;
+    }
+  return ret;
+}
+
+arrayt FrameSnapshot::blocks() const
+{
+  arrayt ret=Piece::shape(pieceType(),orientation);
+  for(int i=0;i<4;++i)
+    {
+      ret[i]+=center();
+    }
+  return ret;
+}
@@ -0,0 +1,83 @@
+#ifndef FRAMESNAPSHOT_HPP
+#define FRAMESNAPSHOT_HPP
+
+#include <cstdint>
+#include <type_traits>
+
+#include "common.hpp"
+#include "Piece.hpp"
+
+/* FrameSnapshot
+   A compact, fixed-size copy of everything a renderer or spectator needs to
+   draw one frame: the field as row bitmasks, the current piece as type,
+   orientation and center, the next and hold piece types, the score and the
+   frame number.
+
+   The snapshot is plain data (48 bytes, under one cache line) so it can be
+   published with a single memcpy-sized copy and decoded without rebuilding a
+   Field or a Piece. Rows are packed three to a word: row y lives in
+   rows[y/3], bits (y%3)*10 to (y%3)*10+9, with bit x set if there is a block
+   at (x,y).
+ */
+struct FrameSnapshot
+{
+  enum Flags
+    {
+      ACTIVE=1,    // current holds a piece in play
+      HOLDING=2,   // hold holds a piece
+      GAME_OVER=4
+    };
+  static constexpr unsigned ROWS_PER_WORD=3, ROW_WORDS=8;
+
+  std::uint32_t rows[ROW_WORDS];
+  std::uint32_t frame;
+  std::int32_t score;
+  std::uint8_t type, orientation;
+  std::int8_t x, y; // center of the current piece
+  std::uint8_t next, hold;
+  std::uint8_t flags;
+  std::uint8_t reserved;
+
+  // Build a snapshot from live game objects. hold may be NULL.
+  static FrameSnapshot encode(const Field &, const Piece &current, const Piece *hold,
+			      PieceType next, unsigned frame);
+
+  // Bitmask of row y, as Field::getRow.
+  unsigned row(int y) const
+  {
+    return (rows[y/ROWS_PER_WORD] >> ((y%ROWS_PER_WORD)*FIELD_WIDTH)) & ((1u<<FIELD_WIDTH)-1);
+  }
+  void setRow(int y, unsigned mask)
+  {
+    const unsigned shift=(y%ROWS_PER_WORD)*FIELD_WIDTH;
+    rows[y/ROWS_PER_WORD] &= ~(((1u<<FIELD_WIDTH)-1) << shift);
+    rows[y/ROWS_PER_WORD] |= (mask & ((1u<<FIELD_WIDTH)-1)) << shift;
+  }
+  // Return true if the field has a block at (x,y). Does not include the
+  // current piece.
+  bool get(int bx, int by) const
+  {
+    return (row(by) >> bx) & 1;
+  }
+  bool active() const
+  {
+    return flags & ACTIVE;
+  }
+  PieceType pieceType() const
+  {
+    return (PieceType)type;
+  }
+  coord center() const
+  {
+    return coord(x,y);
+  }
+  // Absolute co-ordinates of the current piece's blocks.
+  arrayt blocks() const;
+};
+
+static_assert(sizeof(FrameSnapshot) == 48,"FrameSnapshot is the wrong size!");
+static_assert(std::is_trivial<FrameSnapshot>::value,"FrameSnapshot must be plain data!");
+static_assert(FIELD_HEIGHT <= FrameSnapshot::ROWS_PER_WORD*FrameSnapshot::ROW_WORDS,
+	      "FrameSnapshot cannot hold the whole field!");
+
+#endif // FRAMESNAPSHOT_HPP
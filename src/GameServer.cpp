@@ -0,0 +1,620 @@
+#include "GameServer.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+struct GameServer::Peer
+{
+  int fd;
+  std::size_t index; // Position in GameServer::connections or spectators
+  bool isSpectator,closing;
+  NetProtocol::Buffer out;
+  std::size_t outPos;
+
+  Peer(int fd_, std::size_t index_, bool isSpectator_):fd(fd_),index(index_),
+						       isSpectator(isSpectator_),
+						       closing(false),out(),outPos(0)
+  {}
+};
+
+struct GameServer::Connection : public Peer
+{
+  Room *room;
+  HeadlessGame game;
+  PieceInput inputs[MAX_INPUTS];
+  unsigned inputCount;
+  // The last frame sent, which the next FRAME is encoded against.
+  FrameSnapshot sent;
+  bool keyframe;
+  // Shared by everyone watching this game.
+  SpectatorEncoder encoder;
+  std::vector<Spectator*> spectators;
+
+  Connection(int fd_, std::size_t index_):Peer(fd_,index_,false),room(nullptr),
+					  game(),inputCount(0),sent(),keyframe(true),
+					  encoder(),spectators()
+  {
+    out.reserve(4*(NetProtocol::HEADER_SIZE+NetProtocol::MAX_BODY));
+  }
+};
+
+struct GameServer::Spectator : public Peer
+{
+  Connection *watching;
+  bool needKey;
+
+  Spectator(int fd_, std::size_t index_):Peer(fd_,index_,true),watching(nullptr),
+					 needKey(true)
+  {}
+};
+
+struct GameServer::Room
+{
+  unsigned seed;
+  std::size_t index; // Position in GameServer::rooms
+  std::vector<Connection*> players;
+};
+
+static std::string errnoString(const std::string &what)
+{
+  return what+": "+std::strerror(errno);
+}
+
+static std::uint64_t monotonicNow()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+GameServer::GameServer(const std::string &address_, unsigned short port_,
+		       unsigned roomSize_, unsigned tickRate_):
+  address(address_),listenFd(-1),spectatorFd(-1),timerFd(-1),epollFd(-1),
+  port(port_),spectatorPort(0),roomSize(std::max(roomSize_,1u)),
+  tickRate(std::min(std::max(tickRate_,1u),(unsigned)HeadlessGame::MAX_TICK_RATE)),seedCount(0),
+  nextWatched(0),stats(),connections(),spectators(),rooms(),doomed(),unassigned()
+{
+  resetStats();
+  try
+    {
+      listenFd=openListener(port);
+
+      timerFd=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+      if(-1==timerFd)
+	{
+	  throw NetError(errnoString("timerfd_create"));
+	}
+      itimerspec period;
+      period.it_interval.tv_sec=1/tickRate;
+      period.it_interval.tv_nsec=1000000000/tickRate%1000000000;
+      period.it_value=period.it_interval;
+      timerfd_settime(timerFd,0,&period,nullptr);
+
+      epollFd=epoll_create1(EPOLL_CLOEXEC);
+      if(-1==epollFd)
+	{
+	  throw NetError(errnoString("epoll_create1"));
+	}
+      epoll_event ev;
+      ev.events=EPOLLIN|EPOLLET;
+      ev.data.ptr=&listenFd;
+      epoll_ctl(epollFd,EPOLL_CTL_ADD,listenFd,&ev);
+      ev.data.ptr=&timerFd;
+      epoll_ctl(epollFd,EPOLL_CTL_ADD,timerFd,&ev);
+    }
+  catch(...)
+    {
+      for(int fd : {listenFd,timerFd,epollFd})
+	{
+	  if(-1!=fd)
+	    {
+	      ::close(fd);
+	    }
+	}
+      throw;
+    }
+}
+
+GameServer::~GameServer()
+{
+  for(auto &c : connections)
+    {
+      if(!c->closing)
+	{
+	  ::close(c->fd);
+	}
+    }
+  for(auto &s : spectators)
+    {
+      if(!s->closing)
+	{
+	  ::close(s->fd);
+	}
+    }
+  if(-1!=spectatorFd)
+    {
+      ::close(spectatorFd);
+    }
+  ::close(epollFd);
+  ::close(timerFd);
+  ::close(listenFd);
+}
+
+// Create a non-blocking listening socket on address:port. If port is 0 it is
+// set to the port the system chose.
+int GameServer::openListener(unsigned short &port_)
+{
+  sockaddr_in addr;
+  socklen_t addrlen=sizeof(addr);
+  const int one=1;
+  std::memset(&addr,0,sizeof(addr));
+  addr.sin_family=AF_INET;
+  addr.sin_port=htons(port_);
+  if(1!=inet_pton(AF_INET,address.c_str(),&addr.sin_addr))
+    {
+      throw NetError("bad address "+address);
+    }
+
+  const int fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+  if(-1==fd)
+    {
+      throw NetError(errnoString("socket"));
+    }
+  setsockopt(fd,SOL_SOCKET,SO_REUSEADDR,&one,sizeof(one));
+  if(-1==bind(fd,(sockaddr*)&addr,sizeof(addr)) || -1==listen(fd,SOMAXCONN))
+    {
+      const std::string what=errnoString("bind/listen "+address+":"+to_string(port_));
+      ::close(fd);
+      throw NetError(what);
+    }
+  // Find out which port we got if asked for port 0.
+  getsockname(fd,(sockaddr*)&addr,&addrlen);
+  port_=ntohs(addr.sin_port);
+  return fd;
+}
+
+void GameServer::listenSpectators(unsigned short port_)
+{
+  if(-1!=spectatorFd)
+    {
+      throw NetError("already accepting spectators");
+    }
+  spectatorFd=openListener(port_);
+  spectatorPort=port_;
+  epoll_event ev;
+  ev.events=EPOLLIN|EPOLLET;
+  ev.data.ptr=&spectatorFd;
+  epoll_ctl(epollFd,EPOLL_CTL_ADD,spectatorFd,&ev);
+}
+
+void GameServer::resetStats()
+{
+  std::memset(&stats,0,sizeof(stats));
+  stats.connections=connections.size();
+  stats.spectators=spectators.size();
+}
+
+void GameServer::poll(int timeout)
+{
+  constexpr int MAX_EVENTS=256;
+  constexpr std::uint64_t MAX_CATCHUP=4;
+  epoll_event events[MAX_EVENTS];
+
+  const int n=epoll_wait(epollFd,events,MAX_EVENTS,timeout);
+  for(int i=0;i<n;++i)
+    {
+      void *ptr=events[i].data.ptr;
+      if(&listenFd==ptr)
+	{
+	  acceptAll();
+	}
+      else if(&spectatorFd==ptr)
+	{
+	  acceptSpectators();
+	}
+      else if(&timerFd==ptr)
+	{
+	  std::uint64_t expirations=0;
+	  if(sizeof(expirations)==read(timerFd,&expirations,sizeof(expirations)))
+	    {
+	      // If we fell behind, catch up a little rather than stall.
+	      expirations=std::min(expirations,MAX_CATCHUP);
+	      for(std::uint64_t t=0;t<expirations;++t)
+		{
+		  const std::uint64_t t0=monotonicNow();
+		  tick(t0);
+		  const std::uint64_t elapsed=monotonicNow()-t0;
+		  stats.tickTotal+=elapsed;
+		  stats.tickMax=std::max(stats.tickMax,elapsed);
+		  ++stats.ticks;
+		}
+	    }
+	}
+      else
+	{
+	  Peer &p=*static_cast<Peer*>(ptr);
+	  if(p.closing)
+	    {
+	      continue;
+	    }
+	  if(events[i].events & (EPOLLERR|EPOLLHUP))
+	    {
+	      close(p);
+	      continue;
+	    }
+	  if(events[i].events & (EPOLLIN|EPOLLRDHUP))
+	    {
+	      if(p.isSpectator)
+		{
+		  discardAll(static_cast<Spectator&>(p));
+		}
+	      else
+		{
+		  readAll(static_cast<Connection&>(p));
+		}
+	    }
+	  if(!p.closing && (events[i].events & EPOLLOUT))
+	    {
+	      flush(p);
+	    }
+	}
+    }
+  reap();
+}
+
+void GameServer::acceptAll()
+{
+  while(true)
+    {
+      const int fd=accept4(listenFd,nullptr,nullptr,SOCK_NONBLOCK|SOCK_CLOEXEC);
+      if(-1==fd)
+	{
+	  if(EINTR==errno || ECONNABORTED==errno)
+	    {
+	      continue;
+	    }
+	  // EAGAIN: no more pending connections. Anything else (e.g. EMFILE)
+	  // leaves the connection in the backlog.
+	  return;
+	}
+      const int one=1;
+      setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+
+      connections.push_back(std::unique_ptr<Connection>(new Connection(fd,connections.size())));
+      Connection &c=*connections.back();
+      // Join the newest room, or open a new one if it is full.
+      if(rooms.empty() || rooms.back()->players.size()>=roomSize)
+	{
+	  rooms.push_back(std::unique_ptr<Room>(new Room));
+	  rooms.back()->seed=++seedCount;
+	  rooms.back()->index=rooms.size()-1;
+	}
+      c.room=rooms.back().get();
+      c.room->players.push_back(&c);
+      c.game.setTickRate(tickRate);
+      c.game.reset(c.room->seed);
+
+      epoll_event ev;
+      ev.events=EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+      ev.data.ptr=&c;
+      epoll_ctl(epollFd,EPOLL_CTL_ADD,fd,&ev);
+      ++stats.accepted;
+      stats.connections=connections.size();
+    }
+}
+
+void GameServer::acceptSpectators()
+{
+  while(true)
+    {
+      const int fd=accept4(spectatorFd,nullptr,nullptr,SOCK_NONBLOCK|SOCK_CLOEXEC);
+      if(-1==fd)
+	{
+	  if(EINTR==errno || ECONNABORTED==errno)
+	    {
+	      continue;
+	    }
+	  return;
+	}
+      spectators.push_back(std::unique_ptr<Spectator>(new Spectator(fd,spectators.size())));
+      Spectator &s=*spectators.back();
+      unassigned.push_back(&s);
+
+      epoll_event ev;
+      ev.events=EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+      ev.data.ptr=&s;
+      epoll_ctl(epollFd,EPOLL_CTL_ADD,fd,&ev);
+      ++stats.accepted;
+      stats.spectators=spectators.size();
+    }
+}
+
+void GameServer::readAll(Connection &c)
+{
+  char buf[4096];
+  while(true)
+    {
+      const ssize_t n=recv(c.fd,buf,sizeof(buf),0);
+      if(n>0)
+	{
+	  stats.bytesIn+=n;
+	  for(ssize_t i=0;i<n;++i)
+	    {
+	      if(!NetProtocol::isInput(buf[i]))
+		{
+		  close(c);
+		  return;
+		}
+	      if(c.inputCount<MAX_INPUTS)
+		{
+		  c.inputs[c.inputCount++]=(PieceInput)buf[i];
+		}
+	    }
+	}
+      else if(0==n)
+	{
+	  close(c);
+	  return;
+	}
+      else if(EINTR!=errno)
+	{
+	  if(EAGAIN!=errno && EWOULDBLOCK!=errno)
+	    {
+	      close(c);
+	    }
+	  return;
+	}
+    }
+}
+
+// Spectators have nothing to say; read and discard until they hang up.
+void GameServer::discardAll(Spectator &s)
+{
+  char buf[256];
+  while(true)
+    {
+      const ssize_t n=recv(s.fd,buf,sizeof(buf),0);
+      if(0==n)
+	{
+	  close(s);
+	  return;
+	}
+      else if(n<0 && EINTR!=errno)
+	{
+	  if(EAGAIN!=errno && EWOULDBLOCK!=errno)
+	    {
+	      close(s);
+	    }
+	  return;
+	}
+      stats.bytesIn+=std::max<ssize_t>(n,0);
+    }
+}
+
+void GameServer::flush(Peer &c)
+{
+  while(c.outPos<c.out.size())
+    {
+      const ssize_t n=send(c.fd,c.out.data()+c.outPos,c.out.size()-c.outPos,MSG_NOSIGNAL);
+      if(n>0)
+	{
+	  c.outPos+=n;
+	  stats.bytesOut+=n;
+	}
+      else if(EINTR!=errno)
+	{
+	  if(EAGAIN!=errno && EWOULDBLOCK!=errno)
+	    {
+	      close(c);
+	      return;
+	    }
+	  break;
+	}
+    }
+  if(c.outPos==c.out.size())
+    {
+      c.out.clear();
+      c.outPos=0;
+    }
+  else if(c.out.size()-c.outPos>MAX_BACKLOG)
+    {
+      ++stats.dropped;
+      close(c);
+    }
+  else if(c.outPos>c.out.size()/2)
+    {
+      c.out.erase(c.out.begin(),c.out.begin()+c.outPos);
+      c.outPos=0;
+    }
+}
+
+void GameServer::tick(std::uint64_t stamp)
+{
+  assignSpectators();
+  for(auto &room : rooms)
+    {
+      bool allOver=true;
+      for(Connection *c : room->players)
+	{
+	  if(!c->game.isGameOver())
+	    {
+	      c->game.step(c->inputs,c->inputCount);
+	      const FrameSnapshot snap=c->game.snapshot();
+	      NetProtocol::putFrame(c->out,c->sent,snap,stamp,c->keyframe);
+	      if(c->game.isGameOver())
+		{
+		  NetProtocol::putGameOver(c->out,snap.frame,stamp);
+		}
+	      c->sent=snap;
+	      c->keyframe=false;
+	      if(!c->spectators.empty())
+		{
+		  broadcast(*c,snap,stamp);
+		}
+	    }
+	  c->inputCount=0;
+	  allOver=allOver && c->game.isGameOver();
+	}
+      if(allOver)
+	{
+	  restart(*room);
+	}
+    }
+  for(auto &c : connections)
+    {
+      if(!c->closing && c->outPos<c->out.size())
+	{
+	  flush(*c);
+	}
+    }
+  for(auto &s : spectators)
+    {
+      if(!s->closing && s->outPos<s->out.size())
+	{
+	  flush(*s);
+	}
+    }
+}
+
+// Encode one frame of a game and queue it for everyone watching. Spectators
+// who have just arrived get a keyframe instead.
+void GameServer::broadcast(Connection &c, const FrameSnapshot &snap, std::uint64_t stamp)
+{
+  const NetProtocol::Buffer &message=c.encoder.encode(snap,stamp);
+  bool joined=false;
+  for(Spectator *s : c.spectators)
+    {
+      if(s->needKey)
+	{
+	  joined=true;
+	}
+      else
+	{
+	  s->out.insert(s->out.end(),message.begin(),message.end());
+	  stats.bytesSpectated+=message.size();
+	}
+    }
+  if(joined)
+    {
+      // Overwrites message.
+      const NetProtocol::Buffer &key=c.encoder.keyframe();
+      for(Spectator *s : c.spectators)
+	{
+	  if(s->needKey)
+	    {
+	      s->out.insert(s->out.end(),key.begin(),key.end());
+	      stats.bytesSpectated+=key.size();
+	      s->needKey=false;
+	    }
+	}
+    }
+}
+
+// Give each waiting spectator a game, taking the players in turn.
+void GameServer::assignSpectators()
+{
+  if(unassigned.empty() || connections.empty())
+    {
+      return;
+    }
+  for(Spectator *s : unassigned)
+    {
+      for(std::size_t tries=0;tries<connections.size();++tries)
+	{
+	  Connection &c=*connections[nextWatched++%connections.size()];
+	  if(!c.closing)
+	    {
+	      s->watching=&c;
+	      s->needKey=true;
+	      c.spectators.push_back(s);
+	      break;
+	    }
+	}
+    }
+  unassigned.erase(std::remove_if(unassigned.begin(),unassigned.end(),
+				  [](Spectator *s) { return nullptr!=s->watching; }),
+		   unassigned.end());
+}
+
+void GameServer::restart(Room &room)
+{
+  room.seed=++seedCount;
+  for(Connection *c : room.players)
+    {
+      c->game.reset(room.seed);
+      c->keyframe=true;
+      c->encoder.reset();
+    }
+}
+
+void GameServer::close(Peer &c)
+{
+  if(c.closing)
+    {
+      return;
+    }
+  c.closing=true;
+  epoll_ctl(epollFd,EPOLL_CTL_DEL,c.fd,nullptr);
+  ::close(c.fd);
+  doomed.push_back(&c);
+  ++stats.closed;
+}
+
+// Remove closed spectators and connections, and rooms left empty.
+// Spectators go first: one may be watching a connection closed in the same
+// poll, which must still be there to be detached from.
+void GameServer::reap()
+{
+  for(Peer *p : doomed)
+    {
+      if(!p->isSpectator)
+	{
+	  continue;
+	}
+      Spectator *s=static_cast<Spectator*>(p);
+      std::vector<Spectator*> &list=s->watching ? s->watching->spectators : unassigned;
+      list.erase(std::find(list.begin(),list.end(),s));
+      const std::size_t si=s->index;
+      std::swap(spectators[si],spectators.back());
+      spectators[si]->index=si;
+      spectators.pop_back();
+    }
+  for(Peer *p : doomed)
+    {
+      if(p->isSpectator)
+	{
+	  continue;
+	}
+      Connection *c=static_cast<Connection*>(p);
+      for(Spectator *s : c->spectators)
+	{
+	  s->watching=nullptr;
+	  unassigned.push_back(s);
+	}
+      Room &room=*c->room;
+      room.players.erase(std::find(room.players.begin(),room.players.end(),c));
+      if(room.players.empty())
+	{
+	  const std::size_t ri=room.index;
+	  std::swap(rooms[ri],rooms.back());
+	  rooms[ri]->index=ri;
+	  rooms.pop_back();
+	}
+      const std::size_t ci=c->index;
+      std::swap(connections[ci],connections.back());
+      connections[ci]->index=ci;
+      connections.pop_back();
+    }
+  doomed.clear();
+  stats.connections=connections.size();
+  stats.spectators=spectators.size();
+}
@@ -0,0 +1,110 @@
+#ifndef GAMESERVER_HPP
+#define GAMESERVER_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HeadlessGame.hpp"
+#include "NetProtocol.hpp"
+#include "SpectatorStream.hpp"
+
+/* GameServer
+   Hosts many games in one thread. Each TCP connection is one player with
+   its own HeadlessGame. Players are grouped into versus rooms in the order
+   they connect; every game in a room uses the same seed, so the players see
+   the same pieces, and the room restarts once all of its players have lost.
+
+   The server is driven by an edge-triggered epoll loop. A timerfd fires at
+   the tick rate, which the games are played at; each tick steps every game
+   once with the inputs its player sent since the last tick and queues a
+   FRAME message (see NetProtocol) for every player. Output is written
+   without blocking. A player whose unsent output grows beyond a limit is
+   too slow to keep up and is disconnected.
+
+   Spectators connect to a second port, opened with listenSpectators. Each
+   spectator is assigned a game in turn and receives its spectator stream (see
+   SpectatorStream.hpp). A game's stream is encoded once per tick however many
+   spectators it has, and not at all if it has none. When a player leaves,
+   their spectators move on to another game.
+
+   Linux only.
+ */
+struct ServerStats
+{
+  unsigned long ticks,accepted,closed,dropped,bytesIn,bytesOut;
+  unsigned connections,spectators;
+  // Bytes queued for spectators, a subset of bytesOut once sent.
+  unsigned long bytesSpectated;
+  // Time spent stepping and encoding, summed and worst case, in nanoseconds.
+  std::uint64_t tickTotal,tickMax;
+};
+
+class GameServer
+{
+public:
+  // Listen on address:port. Throws NetError.
+  GameServer(const std::string &address, unsigned short port,
+	     unsigned roomSize=2, unsigned tickRate=HeadlessGame::DEFAULT_TICK_RATE);
+  ~GameServer();
+  // Accept spectators on address:port. Throws NetError.
+  void listenSpectators(unsigned short port);
+
+  // Wait up to timeout milliseconds for events and handle them.
+  void poll(int timeout);
+  // Statistics since the last call to resetStats.
+  const ServerStats& getStats() const
+  {
+    return stats;
+  }
+  void resetStats();
+  unsigned short getPort() const
+  {
+    return port;
+  }
+  unsigned short getSpectatorPort() const
+  {
+    return spectatorPort;
+  }
+
+  // Inputs beyond this many in one tick are dropped.
+  static constexpr unsigned MAX_INPUTS=32;
+  // Unsent output beyond this many bytes disconnects the player.
+  static constexpr std::size_t MAX_BACKLOG=64*1024;
+private:
+  struct Peer;
+  struct Connection;
+  struct Spectator;
+  struct Room;
+  GameServer(const GameServer&) = delete; // Uncopyable
+
+  std::string address;
+  int listenFd,spectatorFd,timerFd,epollFd;
+  unsigned short port,spectatorPort;
+  unsigned roomSize,tickRate;
+  unsigned seedCount;
+  std::size_t nextWatched;
+  ServerStats stats;
+  std::vector<std::unique_ptr<Connection>> connections;
+  std::vector<std::unique_ptr<Spectator>> spectators;
+  std::vector<std::unique_ptr<Room>> rooms;
+  std::vector<Peer*> doomed;
+  // Spectators waiting for a game to watch.
+  std::vector<Spectator*> unassigned;
+
+  int openListener(unsigned short &port);
+  void acceptAll();
+  void acceptSpectators();
+  void readAll(Connection &);
+  void discardAll(Spectator &);
+  void flush(Peer &);
+  void tick(std::uint64_t stamp);
+  void broadcast(Connection &, const FrameSnapshot &, std::uint64_t stamp);
+  void assignSpectators();
+  void restart(Room &);
+  void close(Peer &);
+  void reap();
+};
+
+#endif // GAMESERVER_HPP
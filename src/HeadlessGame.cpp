@@ -0,0 +1,365 @@
+#include "HeadlessGame.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+constexpr HeadlessGame::RepeatTime HeadlessGame::DEFAULT_DAS, HeadlessGame::DEFAULT_ARR,
+  HeadlessGame::MAX_REPEAT;
+
+HeadlessGame::HeadlessGame(std::uint64_t seed, RandomizerKind kind, unsigned rate):
+  tickRate(0),tickTime(0),rowTime(0),
+  timeCount(0),frameCount(0),pieceCount(0),
+  das(DEFAULT_DAS),arr(DEFAULT_ARR),repeatTick(0),repeatUnit(0),keys(0),repeatTime(0),
+  over(false),early(false),
+  mField(),current(I,lockdelay,&mField),queue(kind,seed),garbage()
+{
+  setTickRate(rate);
+  newPiece();
+}
+
+static unsigned gcd(unsigned a, unsigned b)
+{
+  while(b)
+    {
+      const unsigned r=a%b;
+      a=b;
+      b=r;
+    }
+  return a;
+}
+
+void HeadlessGame::setTickRate(unsigned rate)
+{
+  if(0==rate || rate>MAX_TICK_RATE)
+    {
+      throw std::invalid_argument("Tick rate out of range");
+    }
+  // A tick is 1/rate seconds and a row gravity::num/gravity::den; in units
+  // of 1/(rate*gravity::den) seconds, both are whole, and smallest divided
+  // by their common factor.
+  const unsigned tick=gravity::den, row=gravity::num*rate, common=gcd(tick,row);
+  if(rowTime)
+    {
+      timeCount=(std::uint64_t)timeCount*(row/common)/rowTime;
+    }
+  tickRate=rate;
+  tickTime=tick/common;
+  rowTime=row/common;
+  // The same for auto-repeat, in units of RepeatTime/rate.
+  const unsigned repeatCommon=gcd(RepeatTime::period::den,rate);
+  if(repeatUnit)
+    {
+      repeatTime=(std::int64_t)repeatTime*(rate/repeatCommon)/repeatUnit;
+    }
+  repeatTick=RepeatTime::period::den/repeatCommon;
+  repeatUnit=rate/repeatCommon;
+}
+
+void HeadlessGame::setAutoRepeat(RepeatTime das_, RepeatTime arr_)
+{
+  if(das_>MAX_REPEAT || arr_>MAX_REPEAT)
+    {
+      throw std::invalid_argument("Auto-repeat out of range");
+    }
+  das=das_;
+  arr=arr_;
+}
+
+void HeadlessGame::reset(std::uint64_t seed)
+{
+  timeCount=0;
+  frameCount=0;
+  pieceCount=0;
+  keys=0;
+  repeatTime=0;
+  over=false;
+  early=false;
+  mField.resetBlocks();
+  mField.resetScore();
+  garbage.clear();
+  queue.reset(seed);
+  newPiece();
+}
+
+bool HeadlessGame::step(const PieceInput *inputs, std::size_t count)
+{
+  // A game lost to early inputs still ends with the frame they belong to.
+  if(over && !early)
+    {
+      return true;
+    }
+  input(inputs,count);
+  early=false;
+  if(!over)
+    {
+      timeStep();
+    }
+  ++frameCount;
+  return over;
+}
+
+bool HeadlessGame::input(const PieceInput *inputs, std::size_t count)
+{
+  early=early || (count && !over);
+  for(std::size_t i=0;i<count && !over;++i)
+    {
+      if(inputs[i]>=press_right)
+	{
+	  handleKey(inputs[i]);
+	}
+      else if(current.handleInput(inputs[i]))
+	{
+	  lockPiece();
+	}
+    }
+  return over;
+}
+
+FrameSnapshot HeadlessGame::snapshot() const
+{
+  FrameSnapshot ret=FrameSnapshot::encode(mField,current,nullptr,getNext(),frameCount);
+  if(over)
+    {
+      ret.flags|=FrameSnapshot::GAME_OVER;
+    }
+  return ret;
+}
+
+void HeadlessGame::save(State &s) const
+{
+  if(garbage.size()>State::GARBAGE)
+    {
+      throw std::length_error("Too much garbage queued to save");
+    }
+  std::memset(&s,0,sizeof(s));
+  s.timeCount=timeCount;
+  s.frame=frameCount;
+  s.pieces=pieceCount;
+  s.score=mField.readScore();
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      s.rows[y]=mField.getRow(y);
+    }
+  s.x=current.getCenter().x;
+  s.y=current.getCenter().y;
+  s.type=current.getType();
+  s.orientation=current.getOrientation();
+  s.lockDelay=current.getLockDelay();
+  s.over=over;
+  s.keys=keys;
+  for(int i=0;i<3;++i)
+    {
+      s.repeatTime[i]=repeatTime>>(8*i);
+    }
+  queue.save(s.queue);
+  s.garbageCount=garbage.size();
+  for(std::size_t i=0;i<garbage.size();++i)
+    {
+      if(garbage[i].first>0xff)
+	{
+	  throw std::length_error("Too much garbage queued to save");
+	}
+      s.garbage[i][0]=garbage[i].first;
+      s.garbage[i][1]=garbage[i].second;
+    }
+}
+
+void HeadlessGame::load(const State &s)
+{
+  timeCount=s.timeCount;
+  frameCount=s.frame;
+  pieceCount=s.pieces;
+  over=s.over;
+  early=false;
+  keys=s.keys;
+  repeatTime=s.repeatTime[0] | s.repeatTime[1]<<8 | s.repeatTime[2]<<16;
+  mField.resetBlocks();
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      for(int x=0;x<FIELD_WIDTH;++x)
+	{
+	  if((s.rows[y]>>x) & 1)
+	    {
+	      mField.set(x,y);
+	    }
+	}
+    }
+  mField.setScore(s.score);
+  queue.load(s.queue);
+  current.~Piece();
+  new(&current) Piece((PieceType)(s.type%7),s.orientation,coord(s.x,s.y),lockdelay,&mField);
+  current.restoreLockDelay(s.lockDelay);
+  garbage.clear();
+  for(unsigned i=0;i<s.garbageCount && i<State::GARBAGE;++i)
+    {
+      addGarbage(s.garbage[i][0],s.garbage[i][1]);
+    }
+}
+
+void HeadlessGame::addGarbage(unsigned lines, unsigned hole)
+{
+  if(lines)
+    {
+      garbage.push_back(std::make_pair(lines,hole%FIELD_WIDTH));
+    }
+}
+
+unsigned HeadlessGame::cancelGarbage(unsigned lines)
+{
+  std::size_t i=0;
+  while(lines && i<garbage.size())
+    {
+      const unsigned n=std::min(lines,garbage[i].first);
+      garbage[i].first-=n;
+      lines-=n;
+      if(0==garbage[i].first)
+	{
+	  ++i;
+	}
+    }
+  garbage.erase(garbage.begin(),garbage.begin()+i);
+  return lines;
+}
+
+unsigned HeadlessGame::getPendingGarbage() const
+{
+  unsigned ret=0;
+  for(const auto &g : garbage)
+    {
+      ret+=g.first;
+    }
+  return ret;
+}
+
+// The current piece has locked: queued garbage rises, then either the game is
+// lost or the next piece enters play.
+void HeadlessGame::lockPiece()
+{
+  bool overflow=false;
+  for(const auto &g : garbage)
+    {
+      overflow=mField.insertGarbage(g.first,g.second) || overflow;
+    }
+  garbage.clear();
+  if(overflow || scanForLoss())
+    {
+      over=true;
+      return;
+    }
+  newPiece();
+}
+
+void HeadlessGame::newPiece()
+{
+  const PieceType t=queue.pop();
+  current.~Piece();
+  new(&current) Piece(t,lockdelay,&mField);
+  ++pieceCount;
+}
+
+bool HeadlessGame::scanForLoss() const
+{
+  for(int i=0; i<FIELD_WIDTH; ++i)
+    {
+      // If one desired greater performance, one would unroll this inner loop.
+      for(int j = 20; j<FIELD_HEIGHT; ++j)
+	{
+	  if(mField.get(i,j))
+	    {
+	      return true;
+	    }
+	}
+    }
+  return false;
+}
+
+void HeadlessGame::handleKey(PieceInput in)
+{
+  const bool right=press_right==in || release_right==in;
+  const unsigned held=right ? RIGHT_HELD : LEFT_HELD;
+  if(press_right==in || press_left==in)
+    {
+      // A key pressed again without a release, as by the system's key
+      // repeat, is still held.
+      if(keys & held)
+	{
+	  return;
+	}
+      keys=right ? keys | held | RIGHT_REPEATS : (keys | held) & ~RIGHT_REPEATS;
+      repeatTime=(int)(das.count()*repeatUnit);
+      shift(right ? shift_right : shift_left);
+      autoRepeat();
+      return;
+    }
+  if(!(keys & held))
+    {
+      return;
+    }
+  const bool repeating=right==(0!=(keys & RIGHT_REPEATS));
+  keys&=~held;
+  if(!repeating)
+    {
+      return;
+    }
+  if(keys & (LEFT_HELD|RIGHT_HELD))
+    {
+      // The other key takes over, from now as if just pressed but without a
+      // shift of its own.
+      keys^=RIGHT_REPEATS;
+      repeatTime=(int)(das.count()*repeatUnit);
+      autoRepeat();
+    }
+  else
+    {
+      keys=0;
+      repeatTime=0;
+    }
+}
+
+bool HeadlessGame::shift(PieceInput in)
+{
+  const int x=current.getCenter().x;
+  current.handleInput(in);
+  return x!=current.getCenter().x;
+}
+
+void HeadlessGame::autoRepeat()
+{
+  const PieceInput in=(keys & RIGHT_REPEATS) ? shift_right : shift_left;
+  while(repeatTime<=0)
+    {
+      if(0==arr.count())
+	{
+	  // Through every cell on the way, so the piece stops at whatever it
+	  // meets first.
+	  while(shift(in))
+	    ;
+	  repeatTime=0;
+	  return;
+	}
+      shift(in);
+      repeatTime+=(int)(arr.count()*repeatUnit);
+    }
+}
+
+void HeadlessGame::timeStep()
+{
+  if(keys & (LEFT_HELD|RIGHT_HELD))
+    {
+      repeatTime-=(int)repeatTick;
+      autoRepeat();
+    }
+  // What is left over carries to the next row, so no time is lost to
+  // rounding: a row falls on the first tick at or after it is due.
+  timeCount+=tickTime;
+  if(timeCount>=rowTime)
+    {
+      const unsigned rows=timeCount/rowTime;
+      timeCount%=rowTime;
+      if(current.timeStep(rows))
+	{
+	  lockPiece();
+	}
+    }
+}
@@ -0,0 +1,211 @@
+#ifndef HEADLESSGAME_HPP
+#define HEADLESSGAME_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ratio>
+#include <vector>
+
+#include "common.hpp"
+#include "Field.hpp"
+#include "Piece.hpp"
+#include "FrameSnapshot.hpp"
+#include "Randomizer.hpp"
+
+/* HeadlessGame
+   The rules of a TetrisGame without a thread, a clock or any callbacks. Each
+   call to step advances the game by exactly one frame: the given inputs are
+   applied in order, then frame-based counters (gravity, lock delay) advance.
+   TetrisGame runs one of these on its own thread; servers, simulations and
+   bots can step any number of them as fast as they like.
+
+   A frame is one tick of the game's tick rate, 60 a second by default.
+   Gravity is defined in seconds and carried from tick to tick exactly, so a
+   piece falls at the same speed at any tick rate, and lock delay, counted in
+   rows of gravity, lasts as long. Only inputs land on a finer grid.
+
+   Holding a shift key is two inputs, a press and a release, rather than one
+   input per repeat. A press shifts the piece at once; once the key has been
+   held for the delayed auto shift (DAS), the piece shifts again every auto
+   repeat rate (ARR), or with an ARR of 0 as far as it can go, on the first
+   tick at or after each is due. Both are RepeatTimes, in which whole
+   milliseconds and whole frames at 60 Hz are exact, and are timed exactly
+   as gravity is. Repeats are tried every tick before gravity, and carry over
+   to the next piece; if both keys are held, the last pressed repeats.
+
+   A HeadlessGame is deterministic: two games created with the same seed and
+   randomizer and stepped with the same inputs are in the same state after
+   every frame.
+
+   Garbage sent by other players is queued and rises from the bottom of the
+   field the next time a piece locks, before the next piece enters play.
+ */
+class HeadlessGame
+{
+public:
+  /* State
+     Everything a game is between two frames, as plain data of a fixed
+     layout: a game loaded from it carries on exactly as the game it was
+     saved from. Replays store these as keyframes.
+   */
+  struct State
+  {
+    // Most entries of queued garbage a state holds.
+    static constexpr unsigned GARBAGE=4;
+
+    std::uint32_t timeCount,frame,pieces;
+    std::int32_t score;
+    std::uint16_t rows[FIELD_HEIGHT];
+    // The current piece.
+    std::int8_t x,y;
+    std::uint8_t type,orientation,lockDelay;
+    std::uint8_t over,garbageCount;
+    // The shift keys held, and the time to the next repeat, in the same
+    // units as the game's (24 bits, lowest byte first).
+    std::uint8_t keys;
+    std::uint8_t queue[PieceQueue::STATE_SIZE];
+    std::uint8_t repeatTime[3];
+    // Lines and hole column of each entry of queued garbage.
+    std::uint8_t garbage[GARBAGE][2];
+  };
+
+  // Ticks per second unless a game is given another rate, and the most it
+  // can be given, such that the repeat time fits in a State.
+  static constexpr unsigned DEFAULT_TICK_RATE=60, MAX_TICK_RATE=5000;
+  // A DAS or ARR, in thirds of a millisecond.
+  typedef std::chrono::duration<unsigned,std::ratio<1,3000>> RepeatTime;
+  // Auto-repeat unless a game is given another, 10 and 2 frames at 60 Hz,
+  // and the longest a DAS or ARR can be, a second.
+  static constexpr RepeatTime DEFAULT_DAS{500}, DEFAULT_ARR{100}, MAX_REPEAT{3000};
+
+  // Throws std::invalid_argument if tickRate is 0 or above MAX_TICK_RATE.
+  explicit HeadlessGame(std::uint64_t seed=1, RandomizerKind kind=BAG7,
+			unsigned tickRate=DEFAULT_TICK_RATE);
+
+  // Advance one frame. Returns true if the game is over. Stepping a game that
+  // is over has no effect.
+  bool step(const PieceInput *inputs, std::size_t count);
+  bool step()
+  {
+    return step(nullptr,0);
+  }
+  // Apply inputs ahead of the next frame, such as when they arrive between
+  // frames. They count as that frame's: applying some early and stepping the
+  // frame with the rest plays exactly as stepping it with them all. Returns
+  // true if the game is over.
+  bool input(const PieceInput *inputs, std::size_t count);
+  // Start a new game with the same randomizer, tick rate and auto-repeat.
+  void reset(std::uint64_t seed);
+  // Change the tick rate. The time since the piece last fell is kept, rounded
+  // down to the new ticks. Throws std::invalid_argument as the constructor.
+  void setTickRate(unsigned tickRate);
+  // Change the auto-repeat, from the next press or repeat on. Throws
+  // std::invalid_argument if either is above MAX_REPEAT.
+  void setAutoRepeat(RepeatTime das, RepeatTime arr);
+
+  // Queue lines of garbage with a hole in the given column.
+  void addGarbage(unsigned lines, unsigned hole);
+  // Cancel up to lines of queued garbage, oldest first. Returns the number of
+  // lines which were not cancelled.
+  unsigned cancelGarbage(unsigned lines);
+  unsigned getPendingGarbage() const;
+
+  const Field& getField() const
+  {
+    return mField;
+  }
+  const Piece& getCurrent() const
+  {
+    return current;
+  }
+  PieceType getNext() const
+  {
+    return queue.peek(0);
+  }
+  // The pieces after the current one, getNext() first.
+  const PieceQueue& getQueue() const
+  {
+    return queue;
+  }
+  // Number of frames stepped since the game started.
+  unsigned getFrame() const
+  {
+    return frameCount;
+  }
+  unsigned getTickRate() const
+  {
+    return tickRate;
+  }
+  RepeatTime getDas() const
+  {
+    return das;
+  }
+  RepeatTime getArr() const
+  {
+    return arr;
+  }
+  // Number of pieces which have entered play since the game started.
+  unsigned getPieceCount() const
+  {
+    return pieceCount;
+  }
+  bool isGameOver() const
+  {
+    return over;
+  }
+  FrameSnapshot snapshot() const;
+
+  // Throws std::length_error if more garbage is queued than a State holds.
+  void save(State &) const;
+  // Carry on from a state saved by a game with the same randomizer, tick
+  // rate and auto-repeat.
+  void load(const State &);
+
+  static constexpr unsigned int lockdelay=5;
+private:
+  HeadlessGame(const HeadlessGame&) = delete; // Uncopyable: current points at mField
+  // Seconds for the piece to fall a row: 31 frames at 60 a second.
+  typedef std::ratio<31,60> gravity;
+
+  // timeCount is the time since the piece last fell, in units of which a
+  // tick is tickTime and a row of gravity rowTime. At 60 Hz a unit is a tick.
+  unsigned int tickRate,tickTime,rowTime;
+  unsigned int timeCount,frameCount,pieceCount;
+  // The shift keys held, as State::keys, and the time until the held key
+  // next repeats, in units of which a tick is repeatTick and a RepeatTime
+  // repeatUnit.
+  enum Keys
+    {
+      LEFT_HELD=1,
+      RIGHT_HELD=2,
+      // The held key that repeats is right: the last pressed of the two.
+      RIGHT_REPEATS=4
+    };
+  RepeatTime das,arr;
+  unsigned int repeatTick,repeatUnit;
+  unsigned int keys;
+  int repeatTime;
+  bool over;
+  // Inputs have been applied since the last frame.
+  bool early;
+  Field mField;
+  Piece current;
+  PieceQueue queue;
+  // Queued garbage: lines and hole column.
+  std::vector<std::pair<unsigned,unsigned>> garbage;
+
+  void lockPiece();
+  void newPiece();
+  bool scanForLoss() const;
+  void timeStep();
+  void handleKey(PieceInput);
+  // Shift the piece, returning whether it moved.
+  bool shift(PieceInput);
+  // Shift the held key's way as many times as are due.
+  void autoRepeat();
+};
+
+static_assert(sizeof(HeadlessGame::State)==120,"The layout of a State is part of the replay format!");
+
+#endif // HEADLESSGAME_HPP
@@ -0,0 +1,112 @@
+#include "NetProtocol.hpp"
+
+#include <cstring>
+
+namespace NetProtocol
+{
+  void putHeader(Buffer &out, const MessageHeader &h)
+  {
+    put(out,h.length,2);
+    put(out,h.type,1);
+    put(out,0,1);
+    put(out,h.frame,4);
+    put(out,h.stamp,8);
+  }
+
+  bool getHeader(const char *in, std::size_t size, MessageHeader &h)
+  {
+    if(size<HEADER_SIZE)
+      {
+	return false;
+      }
+    h.length=get(in,2);
+    h.type=get(in+2,1);
+    h.frame=get(in+4,4);
+    h.stamp=get(in+8,8);
+    return true;
+  }
+
+  void putFrame(Buffer &out, const FrameSnapshot &prev, const FrameSnapshot &cur,
+		std::uint64_t stamp, bool keyframe)
+  {
+    unsigned changed=0,words=0;
+    for(unsigned i=0;i<FrameSnapshot::ROW_WORDS;++i)
+      {
+	if(keyframe || prev.rows[i]!=cur.rows[i])
+	  {
+	    changed|=1u<<i;
+	    ++words;
+	  }
+      }
+    MessageHeader h;
+    h.length=1+4*words+8+4;
+    h.type=FRAME;
+    h.frame=cur.frame;
+    h.stamp=stamp;
+    putHeader(out,h);
+    put(out,changed,1);
+    for(unsigned i=0;i<FrameSnapshot::ROW_WORDS;++i)
+      {
+	if(changed & (1u<<i))
+	  {
+	    put(out,cur.rows[i],4);
+	  }
+      }
+    put(out,cur.type,1);
+    put(out,cur.orientation,1);
+    put(out,(std::uint8_t)cur.x,1);
+    put(out,(std::uint8_t)cur.y,1);
+    put(out,cur.next,1);
+    put(out,cur.hold,1);
+    put(out,cur.flags,1);
+    put(out,0,1);
+    put(out,(std::uint32_t)cur.score,4);
+  }
+
+  void putGameOver(Buffer &out, std::uint32_t frame, std::uint64_t stamp)
+  {
+    MessageHeader h;
+    h.length=0;
+    h.type=GAME_OVER;
+    h.frame=frame;
+    h.stamp=stamp;
+    putHeader(out,h);
+  }
+
+  bool applyFrame(const char *in, std::size_t size, const MessageHeader &h,
+		  FrameSnapshot &state)
+  {
+    if(size<1)
+      {
+	return false;
+      }
+    const unsigned changed=(unsigned char)in[0];
+    std::size_t pos=1;
+    for(unsigned i=0;i<FrameSnapshot::ROW_WORDS;++i)
+      {
+	if(changed & (1u<<i))
+	  {
+	    if(pos+4>size)
+	      {
+		return false;
+	      }
+	    state.rows[i]=get(in+pos,4);
+	    pos+=4;
+	  }
+      }
+    if(pos+12!=size)
+      {
+	return false;
+      }
+    state.type=get(in+pos,1);
+    state.orientation=get(in+pos+1,1);
+    state.x=(std::int8_t)get(in+pos+2,1);
+    state.y=(std::int8_t)get(in+pos+3,1);
+    state.next=get(in+pos+4,1);
+    state.hold=get(in+pos+5,1);
+    state.flags=get(in+pos+6,1);
+    state.score=(std::int32_t)get(in+pos+8,4);
+    state.frame=h.frame;
+    return true;
+  }
+}
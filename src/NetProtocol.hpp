@@ -0,0 +1,86 @@
+#ifndef NETPROTOCOL_HPP
+#define NETPROTOCOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "common.hpp"
+#include "FrameSnapshot.hpp"
+
+/* NetProtocol
+   Wire format between tetris_server and its clients. All integers are
+   little-endian.
+
+   Client to server: a stream of single bytes, each one a PieceInput. Any
+   other byte value is a protocol error and closes the connection.
+
+   Server to client: a stream of messages. Each message is a 16 byte header
+   (body length, message type, frame number and the server's monotonic clock
+   in nanoseconds when the frame was stepped) followed by the body.
+
+   A FRAME body carries the difference between the client's last frame and the
+   new one: a byte with one bit per FrameSnapshot row word, the row words whose
+   bit is set, then the piece bytes and score. The first FRAME a client
+   receives has every bit set. GAME_OVER has no body; the game restarts with a
+   full FRAME when every player in the room has lost.
+ */
+namespace NetProtocol
+{
+  enum MessageType
+    {
+      FRAME=1,
+      GAME_OVER=2,
+      // Spectator stream, see SpectatorStream.hpp
+      SPECTATE_KEY=3,
+      SPECTATE_DELTA=4
+    };
+  struct MessageHeader
+  {
+    std::uint16_t length;
+    std::uint8_t type;
+    std::uint32_t frame;
+    std::uint64_t stamp;
+  };
+  constexpr std::size_t HEADER_SIZE=16;
+  // Largest body, a FRAME with every row word changed.
+  constexpr std::size_t MAX_BODY=1+4*FrameSnapshot::ROW_WORDS+8+4;
+
+  typedef std::vector<char> Buffer;
+
+  // Append or read an unsigned little-endian integer of the given size.
+  inline void put(Buffer &out, std::uint64_t value, unsigned bytes)
+  {
+    for(unsigned i=0;i<bytes;++i)
+      {
+	out.push_back((char)(value>>(8*i)));
+      }
+  }
+  inline std::uint64_t get(const char *in, unsigned bytes)
+  {
+    std::uint64_t ret=0;
+    for(unsigned i=0;i<bytes;++i)
+      {
+	ret|=(std::uint64_t)(unsigned char)in[i] << (8*i);
+      }
+    return ret;
+  }
+
+  inline bool isInput(unsigned char byte)
+  {
+    return byte<=hard_drop;
+  }
+
+  void putHeader(Buffer &, const MessageHeader &);
+  // Returns false if fewer than HEADER_SIZE bytes are available.
+  bool getHeader(const char *, std::size_t, MessageHeader &);
+
+  // Append a FRAME message describing how to get from prev to cur.
+  void putFrame(Buffer &, const FrameSnapshot &prev, const FrameSnapshot &cur,
+		std::uint64_t stamp, bool keyframe);
+  void putGameOver(Buffer &, std::uint32_t frame, std::uint64_t stamp);
+  // Apply a FRAME body to state. Returns false if the body is malformed.
+  bool applyFrame(const char *, std::size_t, const MessageHeader &, FrameSnapshot &state);
+}
+
+#endif // NETPROTOCOL_HPP
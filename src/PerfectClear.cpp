@@ -0,0 +1,379 @@
+#include "PerfectClear.hpp"
+
+#include <algorithm>
+#include <cstdlib>
+
+#include "Field.hpp"
+#include "Finesse.hpp"
+#include "Piece.hpp"
+
+// The bottom MAX_HEIGHT rows as one word, FIELD_WIDTH bits to a row.
+static_assert(PerfectClear::MAX_HEIGHT*FIELD_WIDTH<=40,"The rows to clear must fit in 40 bits!");
+
+static inline std::uint64_t pack(const Bitboard &b)
+{
+  std::uint64_t ret=0;
+  for(unsigned y=0;y<PerfectClear::MAX_HEIGHT;++y)
+    {
+      ret|=(std::uint64_t)b.rows[y] << (FIELD_WIDTH*y);
+    }
+  return ret;
+}
+
+// The cells of the bottom height rows.
+static inline std::uint64_t rowsBelow(unsigned height)
+{
+  return ((std::uint64_t)1 << (FIELD_WIDTH*height))-1;
+}
+
+// The cells of one column in every row.
+static constexpr std::uint64_t column(unsigned x)
+{
+  return (std::uint64_t)1<<x | (std::uint64_t)1<<(x+FIELD_WIDTH)
+    | (std::uint64_t)1<<(x+2*FIELD_WIDTH) | (std::uint64_t)1<<(x+3*FIELD_WIDTH);
+}
+
+// The cells of every other column, from x on.
+static constexpr std::uint64_t everyOther(unsigned x)
+{
+  return x<FIELD_WIDTH ? column(x) | everyOther(x+2) : 0;
+}
+
+// A full row has as many cells in the even columns as in the odd.
+static_assert(FIELD_WIDTH%2==0,"The field must have an even number of columns!");
+static constexpr std::uint64_t EVEN_COLUMNS=everyOther(0);
+
+// Return true if every region of the empty cells has a multiple of four
+// cells. Rows only ever move down whole, as the rows between them clear, so
+// two empty cells can only come to touch if they share a row or a column: a
+// region joins neighbours along a row and every empty cell of its columns.
+// Each region is flood filled a step at a time with shifts; a shift along a
+// row must not wrap into the next.
+static bool fillable(std::uint64_t empty)
+{
+  static constexpr std::uint64_t LEFT=column(0), RIGHT=column(FIELD_WIDTH-1);
+  while(empty)
+    {
+      std::uint64_t region=empty & (0-empty),last=0;
+      while(region!=last)
+	{
+	  last=region;
+	  const std::uint64_t columns=(region | region>>FIELD_WIDTH | region>>(2*FIELD_WIDTH)
+				       | region>>(3*FIELD_WIDTH)) & Bitboard::FULL;
+	  region|=((region<<1) & ~LEFT) | ((region>>1) & ~RIGHT) | columns*column(0);
+	  region&=empty;
+	}
+      if(__builtin_popcountll(region) & 3)
+	{
+	  return false;
+	}
+      empty&=~region;
+    }
+  return true;
+}
+
+// Keys are spread over the table by a multiplicative hash and probed
+// linearly; the table starts at MIN_FAILED slots each solve and doubles
+// before it is half full. A key is never 0, as height is at least 1.
+static constexpr std::size_t MIN_FAILED=1<<12;
+
+static inline std::size_t slot(std::uint64_t key, std::size_t size)
+{
+  return (key*0x9e3779b97f4a7c15ull >> 32) & (size-1);
+}
+
+// The distinct shapes of each piece, in the order of its orientations, as
+// cells of the packed rows with the lowest row and leftmost column at 0.
+struct DropShape
+{
+  std::uint64_t cells;
+  unsigned orientation;
+  int left,bottom,width,height;
+};
+
+struct DropTable
+{
+  DropShape shapes[7][4];
+  unsigned count[7];
+  // The most by which the piece can cover more cells of the even columns
+  // than of the odd, or the other way round.
+  unsigned imbalance[7];
+
+  DropTable()
+  {
+    for(int t=0;t<7;++t)
+      {
+	count[t]=imbalance[t]=0;
+	for(unsigned o=0;o<4;++o)
+	  {
+	    const PieceMask &m=PieceMask::get((PieceType)t,o);
+	    DropShape s={0,o,m.left,m.bottom,m.right-m.left+1,m.top-m.bottom+1};
+	    for(int k=0;k<s.height;++k)
+	      {
+		s.cells|=(std::uint64_t)m.rows[k] << (FIELD_WIDTH*k);
+	      }
+	    bool seen=false;
+	    for(unsigned i=0;i<count[t] && !seen;++i)
+	      {
+		seen=shapes[t][i].cells==s.cells;
+	      }
+	    if(!seen)
+	      {
+		shapes[t][count[t]++]=s;
+	      }
+	    const int even=__builtin_popcountll(s.cells & EVEN_COLUMNS);
+	    imbalance[t]=std::max<unsigned>(imbalance[t],std::abs(2*even-4));
+	  }
+      }
+  }
+};
+
+static const DropTable& drops()
+{
+  static const DropTable table;
+  return table;
+}
+
+PerfectClear::PerfectClear(bool hold_, unsigned long limit_):
+  hold(hold_),gaveUp(false),limit(limit_),nodes(0),found(0),pieces(nullptr),count(0),
+  solution(),failed(),failedCount(0)
+{
+}
+
+PerfectClear::Result PerfectClear::solve(const Field &field, const PieceType *pieces_,
+					 std::size_t count_, unsigned height)
+{
+  return solve(Bitboard::fromField(field),pieces_,count_,height);
+}
+
+PerfectClear::Result PerfectClear::solve(const Bitboard &board, const PieceType *pieces_,
+					 std::size_t count_, unsigned height)
+{
+  pieces=pieces_;
+  count=std::min<std::size_t>(count_,MAX_PIECES);
+  solution.clear();
+  failed.assign(MIN_FAILED,0);
+  failedCount=0;
+  nodes=0;
+  found=0;
+  gaveUp=false;
+  for(int y=MAX_HEIGHT;y<FIELD_HEIGHT;++y)
+    {
+      if(board.rows[y])
+	{
+	  return NONE;
+	}
+    }
+
+  // A position's failure does not depend on the height it was meant to
+  // reach, so what fails for one height is kept for the next.
+  const unsigned filled=__builtin_popcountll(pack(board));
+  const unsigned top=board.height();
+  const unsigned low=height ? height : std::max(top,1u), high=height ? height : MAX_HEIGHT;
+  for(unsigned h=low;h<=high && h<=MAX_HEIGHT;++h)
+    {
+      const unsigned need=FIELD_WIDTH*h-filled;
+      if(h<top || need%4 || need>4*count)
+	{
+	  continue;
+	}
+      if(search(pack(board),h,0,-1))
+	{
+	  // Each step was added as the search unwound, last first.
+	  std::reverse(solution.begin(),solution.end());
+	  found=h;
+	  return FOUND;
+	}
+      if(gaveUp)
+	{
+	  return GAVE_UP;
+	}
+    }
+  return NONE;
+}
+
+bool PerfectClear::hasFailed(std::uint64_t key) const
+{
+  const std::size_t mask=failed.size()-1;
+  for(std::size_t i=slot(key,failed.size());failed[i];i=(i+1) & mask)
+    {
+      if(failed[i]==key)
+	{
+	  return true;
+	}
+    }
+  return false;
+}
+
+void PerfectClear::addFailed(std::uint64_t key)
+{
+  if(2*++failedCount>failed.size())
+    {
+      std::vector<std::uint64_t> old(2*failed.size(),0);
+      old.swap(failed);
+      const std::size_t mask=failed.size()-1;
+      for(std::uint64_t k : old)
+	{
+	  if(k)
+	    {
+	      std::size_t i=slot(k,failed.size());
+	      while(failed[i])
+		{
+		  i=(i+1) & mask;
+		}
+	      failed[i]=k;
+	    }
+	}
+    }
+  const std::size_t mask=failed.size()-1;
+  std::size_t i=slot(key,failed.size());
+  while(failed[i])
+    {
+      i=(i+1) & mask;
+    }
+  failed[i]=key;
+}
+
+// Search from the packed rows with height of them left to clear, pieces
+// from next on still to come, and held in the hold (-1 for nothing).
+bool PerfectClear::search(std::uint64_t cells, unsigned height, std::size_t next, int held)
+{
+  if(0==height)
+    {
+      return true;
+    }
+  if(++nodes>limit && limit)
+    {
+      gaveUp=true;
+      return false;
+    }
+  const std::uint64_t empty=~cells & rowsBelow(height);
+  const unsigned holes=__builtin_popcountll(empty);
+  const std::size_t remaining=count-next+(held>=0);
+  if(holes%4 || holes>4*remaining)
+    {
+      return false;
+    }
+  // Clearing a row takes as many cells from the even columns as from the
+  // odd, so the pieces that fill the holes must make up any difference.
+  const DropTable &table=drops();
+  const std::size_t last=std::min<std::size_t>(count,next+holes/4+hold);
+  unsigned slack=held>=0 ? table.imbalance[held] : 0;
+  for(std::size_t i=next;i<last;++i)
+    {
+      slack+=table.imbalance[pieces[i]];
+    }
+  const int even=__builtin_popcountll(empty & EVEN_COLUMNS);
+  if((unsigned)std::abs(2*even-(int)holes)>slack || !fillable(empty))
+    {
+      return false;
+    }
+  const std::uint64_t key=cells | (std::uint64_t)next<<40 | (std::uint64_t)(held+1)<<48
+    | (std::uint64_t)height<<56;
+  if(hasFailed(key))
+    {
+      return false;
+    }
+
+  if(next<count && tryPiece(cells,height,pieces[next],false,next+1,held))
+    {
+      return true;
+    }
+  if(hold)
+    {
+      if(held<0)
+	{
+	  // Hold this piece and place the one after it.
+	  if(next+1<count && tryPiece(cells,height,pieces[next+1],true,next+2,pieces[next]))
+	    {
+	      return true;
+	    }
+	}
+      else if(next>=count)
+	{
+	  if(tryPiece(cells,height,(PieceType)held,true,next,-1))
+	    {
+	      return true;
+	    }
+	}
+      // Swapping for a piece of the same type changes nothing.
+      else if(held!=pieces[next]
+	      && tryPiece(cells,height,(PieceType)held,true,next+1,pieces[next]))
+	{
+	  return true;
+	}
+    }
+  if(!gaveUp)
+    {
+      addFailed(key);
+    }
+  return false;
+}
+
+// Try every placement of a piece that stays below the rows already cleared.
+// Everything above height is empty, so a piece where it spawns can shift and
+// rotate into any column, and hard dropped from just above the blocks it
+// lands where MoveList would find it. The rows are kept packed throughout.
+bool PerfectClear::tryPiece(std::uint64_t cells, unsigned height, PieceType type, bool usedHold,
+			    std::size_t next, int held)
+{
+  // A piece can only pass down through cells with nothing above them.
+  const DropTable &table=drops();
+  std::uint64_t covered=cells | cells>>FIELD_WIDTH;
+  covered|=covered>>(2*FIELD_WIDTH);
+  const std::uint64_t blocked=~rowsBelow(height) | covered;
+  for(unsigned i=0;i<table.count[type];++i)
+    {
+      const DropShape &s=table.shapes[type][i];
+      if(s.height>(int)height)
+	{
+	  continue;
+	}
+      for(int shift=0;shift+s.width<=FIELD_WIDTH && !gaveUp;++shift)
+	{
+	  // Drop from the highest place it may rest, if it gets that far.
+	  const std::uint64_t piece=s.cells << shift;
+	  int y=height-s.height;
+	  if(piece << (FIELD_WIDTH*y) & blocked)
+	    {
+	      continue;
+	    }
+	  while(y>0 && 0==(piece << (FIELD_WIDTH*(y-1)) & blocked))
+	    {
+	      --y;
+	    }
+	  // Remove full rows from the top down, so those below keep their place.
+	  std::uint64_t b=cells | piece << (FIELD_WIDTH*y);
+	  unsigned lines=0;
+	  for(int j=y+s.height-1;j>=y;--j)
+	    {
+	      if(Bitboard::FULL==(b >> (FIELD_WIDTH*j) & Bitboard::FULL))
+		{
+		  const std::uint64_t below=rowsBelow(j);
+		  b=(b & below) | (b >> FIELD_WIDTH & ~below);
+		  ++lines;
+		}
+	    }
+	  if(search(b,height-lines,next,held))
+	    {
+	      const Step step={type,(std::uint8_t)s.orientation,(std::int8_t)(shift-s.left),
+			       (std::int8_t)(y-s.bottom),usedHold};
+	      solution.push_back(step);
+	      return true;
+	    }
+	}
+    }
+  return false;
+}
+
+std::size_t PerfectClear::path(const Bitboard &board, const Step &step, PieceInput *out,
+			       std::size_t max)
+{
+  const coord spawn=Piece::spawn(step.type);
+  if(!board.fits(step.type,step.orientation,step.x,spawn.y)
+     || board.drop(step.type,step.orientation,step.x,spawn.y)!=step.y)
+    {
+      return 0;
+    }
+  return Finesse::path(board,step.type,step.orientation,step.x,out,max);
+}
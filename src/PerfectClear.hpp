@@ -0,0 +1,105 @@
+#ifndef PERFECTCLEAR_HPP
+#define PERFECTCLEAR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "Bitboard.hpp"
+#include "Bot.hpp"
+
+class Field;
+
+/* PerfectClear
+   Finds a way to place a known sequence of pieces so that every block on
+   the field is cleared. The field may only have blocks in its bottom
+   MAX_HEIGHT rows; a clear of height h fills and clears exactly the bottom h
+   rows, so no piece may reach above the rows still to clear.
+
+   The search is depth first over the placements MoveList would find, so a
+   solution can be played as it stands: pieces are shifted and rotated where
+   they spawn and hard dropped. The bottom rows fit in one 64 bit word, and a
+   position is abandoned as soon as one of these fails:
+     - the empty cells still to fill are a multiple of four and no more than
+       the remaining pieces can fill;
+     - the pieces that fill them can make up the difference between the
+       empty cells of the even columns and of the odd, since a full row has
+       as many of each;
+     - every region of empty cells holds a multiple of four cells, since a
+       piece cannot reach into two regions at once. Cells of one column are
+       in the same region, as the rows between them may clear first.
+   Positions that failed are remembered, so each is searched only once.
+
+   This game has no hold, and by default neither does the solver. With hold,
+   each step may instead place the held piece, or hold the current piece and
+   place the next, as in games that have one; such solutions are for
+   analysis, not for playing here.
+ */
+class PerfectClear
+{
+public:
+  static constexpr unsigned MAX_HEIGHT=4;
+  static constexpr unsigned MAX_PIECES=16;
+
+  enum Result
+    {
+      FOUND,NONE,GAVE_UP
+    };
+  struct Step
+  {
+    PieceType type;
+    std::uint8_t orientation;
+    std::int8_t x,y;
+    // True if this step used the hold.
+    bool hold;
+  };
+
+  // limit is the most positions one solve may visit; 0 means no limit.
+  explicit PerfectClear(bool hold=false, unsigned long limit=0);
+
+  // Look for a clear of height rows using some or all of the pieces, or of
+  // the lowest height possible if height is 0.
+  Result solve(const Bitboard &, const PieceType *pieces, std::size_t count,
+	       unsigned height=0);
+  Result solve(const Field &, const PieceType *pieces, std::size_t count,
+	       unsigned height=0);
+
+  // The placements found by the last solve, in order.
+  const std::vector<Step>& getSolution() const
+  {
+    return solution;
+  }
+  // Height of the clear found.
+  unsigned getHeight() const
+  {
+    return found;
+  }
+  // Positions visited by the last solve.
+  unsigned long getNodes() const
+  {
+    return nodes;
+  }
+
+  // Write the fewest inputs that play a step on the board before it, from
+  // where the piece spawns, as Finesse::path. Returns 0 if the step is not a
+  // placement on that board.
+  static std::size_t path(const Bitboard &, const Step &, PieceInput *out, std::size_t max);
+private:
+  bool hold,gaveUp;
+  unsigned long limit,nodes;
+  unsigned found;
+  const PieceType *pieces;
+  std::size_t count;
+  std::vector<Step> solution;
+  // Keys of the positions that failed, open addressed; 0 is an empty slot.
+  std::vector<std::uint64_t> failed;
+  std::size_t failedCount;
+
+  bool hasFailed(std::uint64_t key) const;
+  void addFailed(std::uint64_t key);
+  bool search(std::uint64_t cells, unsigned height, std::size_t next, int held);
+  bool tryPiece(std::uint64_t cells, unsigned height, PieceType type, bool usedHold,
+		std::size_t next, int held);
+};
+
+#endif // PERFECTCLEAR_HPP
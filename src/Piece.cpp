@@ -37,8 +37,124 @@ inline coord ccw(const coord &a)
   return(coord(-a.y,a.x));
 }
 
+// Rotate an I block's relative co-ordinate. The I block turns about a point
+// between block spaces rather than about one of its blocks.
+static coord rotateI(coord a, bool clockwise)
+{
+  /*
+   *__________*     *__________*
+   *          * 2   *          * 2
+   *          * 1   *   II II  * 1
+   *   IIcI   * 0   *     c    * 0
+   *          * 1   *          * 1
+   *          * 2   *          * 2
+   *5432101234*     *5432101234*
+   1 rotation
+   *__________*     *__________*
+   *          * 2   *    I     * 2
+   *    I     * 1   *    I     * 1
+   *    Ic    * 0   *     c    * 0
+   *    I     * 1   *    I     * 1 
+   *    I     * 2   *    I     * 2
+   *5432101234*     *5432101234*
+   2 rotations
+   *__________*     *__________*
+   *          * 2   *          * 2
+   *          * 1   *          * 1
+   *     c    * 0   *     c    * 0
+   *   IIII   * 1   *   II II  * 1
+   *          * 2   *          * 2
+   *5432101234*     *5432101234*
+   3 rotations
+   *__________*     *__________*  
+   *          * 2   *      I   * 2
+   *     I    * 1   *      I   * 1
+   *     c    * 0   *     c    * 0
+   *     I    * 1   *      I   * 1
+   *     I    * 2   *      I   * 2
+   *5432101234*     *5432101234*
+   */
+  // Shift all nonnegative co-ordinates up by 1
+  if(a.x >= 0)
+    {
+      ++a.x;
+    }
+  if(a.y >= 0)
+    {
+      ++a.y;
+    }
+  // rotate
+  a = clockwise ? cw(a) : ccw(a);
+  // un-shift
+  if(a.x > 0)
+    {
+      --a.x;
+    }
+  if(a.y > 0)
+    {
+      --a.y;
+    }
+  return a;
+}
+
+// Relative blocks for every type and orientation, generated once from the
+// spawn orientations.
+struct ShapeTable
+{
+  arrayt shapes[7][4];
+
+  ShapeTable()
+  {
+    const arrayt *spawn[7]={&relative_I,&relative_J,&relative_L,&relative_O,
+			    &relative_S,&relative_T,&relative_Z};
+    for(int t=0;t<7;++t)
+      {
+	shapes[t][0]=*spawn[t];
+	for(int r=1;r<4;++r)
+	  {
+	    for(int i=0;i<4;++i)
+	      {
+		const coord &prev=shapes[t][r-1][i];
+		switch(t)
+		  {
+		  case I:
+		    shapes[t][r][i]=rotateI(prev,true);
+		    break;
+		  case O:
+		    shapes[t][r][i]=prev;
+		    break;
+		  default:
+		    shapes[t][r][i]=cw(prev);
+		    break;
+		  }
+	      }
+	  }
+      }
+  }
+};
+
+const arrayt& Piece::shape(PieceType t, unsigned int orientation)
+{
+  static const ShapeTable table;
+  return table.shapes[t][orientation%4];
+}
+
+coord Piece::spawn(PieceType t)
+{
+  switch (t)
+    {
+    case I:
+      return originI;
+    case O:
+      return originO;
+    default:
+      return coord(4,20);
+    }
+}
+
 Piece::Piece(PieceType t, unsigned int d, Field *f):
-  type(t),baseDelay(d),lockDelay(d),field(f),center(4,20),lock(false)
+  type(t),baseDelay(d),lockDelay(d),field(f),center(4,20),lock(false),
+  orientation(0)
 {
 
   switch (t)
@@ -71,31 +187,29 @@ Piece::Piece(PieceType t, unsigned int d, Field *f):
     }
 }
 
+Piece::Piece(PieceType t, unsigned int o, const coord &c, unsigned int d, Field *f):
+  type(t),baseDelay(d),lockDelay(d),field(f),center(c),lock(false),
+  orientation(o%4),relative_blocks(shape(t,o))
+{
+}
+
 bool Piece::timeStep(unsigned int g)
 {
   // STUB
   if(lock)
     {throw PieceLockError();}
 
+  // Whether the piece can drop is carried from one row to the next, so a
+  // hard drop tests each row once.
+  bool falling=can_drop();
   for(int i=g;i>0;--i)
     {
-      if(can_drop())
+      if(falling)
 	{
 	  --center.y;
-	  if(!can_drop())
-	    {
-	      if(0==lockDelay)
-		{
-		  invoke_lock();
-		  break;
-		}
-	      else
-		{
-		  --lockDelay;
-		}
-	    }
+	  falling=can_drop();
 	}
-      else
+      if(!falling)
 	{
 	  if(0==lockDelay)
 	    {
@@ -166,19 +280,9 @@ arrayt Piece::getBlocks() const
  */
 bool Piece::can_shift(const coord &displacement) const
 {
-  arrayt blocks=getBlocks();
-  
   for(int i=0;i<4;++i)
     {
-      blocks[i]+=displacement;
-      try
-	{
-	  if( field->get(blocks[i]) ) 
-	    {
-	      return false;
-	    }
-	}
-      catch(FieldSizeError)
+      if(!is_open(relative_blocks[i]+center+displacement))
 	{
 	  return false;
 	}
@@ -192,14 +296,7 @@ bool Piece::can_place(arrayt blocks) const
 {
   for(int i=0;i<4;++i)
     {
-      try
-	{
-	  if(field->get(blocks[i]))
-	    {
-	      return false;
-	    }
-	}
-      catch(FieldSizeError)
+      if(!is_open(blocks[i]))
 	{
 	  return false;
 	}
@@ -210,8 +307,8 @@ bool Piece::can_place(arrayt blocks) const
 // Rotate the relative blocks
 void Piece::rotate(PieceInput in)
 {
-  arrayt rblocks, blocks;
-  int i;
+  arrayt blocks;
+  unsigned int next;
   // Sanity check: this should never happen!
   if( in!=rotate_ccw && in!=rotate_cw)
     {
@@ -222,82 +319,16 @@ void Piece::rotate(PieceInput in)
     {
       return;
     }
-  rblocks=relative_blocks;
-  if(type==I)
+  next = (in==rotate_cw) ? (orientation+1)%4 : (orientation+3)%4;
+  const arrayt &rblocks=shape(type,next);
+  for(int i=0;i<4;++i)
     {
-      /*
-       *__________*     *__________*
-       *          * 2   *          * 2
-       *          * 1   *   II II  * 1
-       *   IIcI   * 0   *     c    * 0
-       *          * 1   *          * 1
-       *          * 2   *          * 2
-       *5432101234*     *5432101234*
-       1 rotation
-       *__________*     *__________*
-       *          * 2   *    I     * 2
-       *    I     * 1   *    I     * 1
-       *    Ic    * 0   *     c    * 0
-       *    I     * 1   *    I     * 1 
-       *    I     * 2   *    I     * 2
-       *5432101234*     *5432101234*
-       2 rotations
-       *__________*     *__________*
-       *          * 2   *          * 2
-       *          * 1   *          * 1
-       *     c    * 0   *     c    * 0
-       *   IIII   * 1   *   II II  * 1
-       *          * 2   *          * 2
-       *5432101234*     *5432101234*
-       3 rotations
-       *__________*     *__________*  
-       *          * 2   *      I   * 2
-       *     I    * 1   *      I   * 1
-       *     c    * 0   *     c    * 0
-       *     I    * 1   *      I   * 1
-       *     I    * 2   *      I   * 2
-       *5432101234*     *5432101234*
-       */
-      for(i-0;i<4;++i)
-	{
-	  // Shift all nonnegative co-ordinates up by 1
-	  if(rblocks[i].x >= 0)
-	    {
-	      ++rblocks[i].x;
-	    }
-	  if(rblocks[i].y >= 0)
-	    {
-	      ++rblocks[i].y;
-	    }
-	  // rotate
-	  rblocks[i]= (in==rotate_cw) ? cw(rblocks[i]) : ccw(rblocks[i]);
-	  // un-shift
-	  if(rblocks[i].x > 0)
-	    {
-	      --rblocks[i].x;
-	    }
-	  if(rblocks[i].y > 0)
-	    {
-	      --rblocks[i].y;
-	    }
-	  blocks[i]=rblocks[i]+center;
-	}
-      if(can_place(blocks))
-	{
-	  relative_blocks=rblocks;
-	}
+      blocks[i]=rblocks[i]+center;
     }
-  else 
+  if(can_place(blocks))
     {
-      for(i=0;i<4;++i)
-	{
-	  rblocks[i]= (in==rotate_cw) ? cw(rblocks[i]) : ccw(rblocks[i]);
-	  blocks[i]=rblocks[i]+center;
-	}
-      if(can_place(blocks))
-	{
-	  relative_blocks=rblocks;
-	}
+      relative_blocks=rblocks;
+      orientation=next;
     }
 }
 
@@ -47,6 +47,10 @@ class Piece
 {
 public:
   Piece(PieceType t, unsigned int d, Field *f);
+  // A piece already in play with the given orientation and center, e.g. one
+  // rebuilt from a FrameSnapshot.
+  Piece(PieceType t, unsigned int orientation, const coord &center,
+	unsigned int d, Field *f);
 
   bool timeStep(unsigned int g); //throw (PieceLockError);
   bool handleInput(PieceInput in); //throw (PieceLockError);
@@ -57,6 +61,26 @@ public:
   {
     return type;
   }
+  // Number of clockwise quarter turns from the spawn orientation (0-3).
+  unsigned int getOrientation() const
+  {
+    return orientation;
+  }
+  // Frames the piece can still rest on the stack before it locks.
+  unsigned int getLockDelay() const
+  {
+    return lockDelay;
+  }
+  // Carry on with a lock delay saved from another piece, at most the delay
+  // the piece was made with.
+  void restoreLockDelay(unsigned int d)
+  {
+    lockDelay=d<baseDelay ? d : baseDelay;
+  }
+  // Blocks relative to the center for a piece type in a given orientation.
+  static const arrayt& shape(PieceType t, unsigned int orientation);
+  // Where a new piece of type t enters play, in the spawn orientation.
+  static coord spawn(PieceType t);
 
 private:
   PieceType type;
@@ -65,6 +89,7 @@ private:
 
   coord center;
   bool lock;
+  unsigned int orientation;
   arrayt relative_blocks;
 
 
@@ -74,6 +99,13 @@ private:
     return can_shift(coord(0,-1));
   }
   bool can_place(arrayt) const;
+  // In the field and empty. Checked here rather than by catching the
+  // FieldSizeError of Field::get, since pieces touch the walls and floor all
+  // the time and exceptions are slow.
+  inline bool is_open(const coord &c) const
+  {
+    return 0<=c.x && c.x<FIELD_WIDTH && 0<=c.y && c.y<FIELD_HEIGHT && !field->get(c);
+  }
   void rotate(PieceInput in); //throw (PieceInput);
 
   void invoke_lock();
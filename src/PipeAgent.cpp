@@ -0,0 +1,272 @@
+#include "PipeAgent.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstring>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+static_assert(BotProtocol::MAX_KEYS>=MoveList::MAX_PATH,"a planned path must fit");
+
+static std::string errnoString(const std::string &what)
+{
+  return what+": "+std::strerror(errno);
+}
+
+// BotProcess
+
+BotProcess::BotProcess(const std::vector<std::string> &command):fd(-1),pid(-1),buffer()
+{
+  if(command.empty())
+    {
+      throw PipeError("no command");
+    }
+  // Everything the child needs is made before the fork, since another thread
+  // may hold the allocator's lock when it happens.
+  std::vector<char*> argv;
+  for(const std::string &arg : command)
+    {
+      argv.push_back(const_cast<char*>(arg.c_str()));
+    }
+  argv.push_back(nullptr);
+
+  // Close on exec, so that bots started by other threads do not hold this
+  // one's socket open.
+  int fds[2];
+  if(socketpair(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0,fds))
+    {
+      throw PipeError(errnoString("socketpair"));
+    }
+  pid=fork();
+  if(pid<0)
+    {
+      const std::string err=errnoString("fork");
+      close(fds[0]);
+      close(fds[1]);
+      throw PipeError(err);
+    }
+  if(0==pid)
+    {
+      dup2(fds[1],STDIN_FILENO);
+      dup2(fds[1],STDOUT_FILENO);
+      execvp(argv[0],argv.data());
+      _exit(127);
+    }
+  close(fds[1]);
+  fd=fds[0];
+}
+
+BotProcess::~BotProcess()
+{
+  try
+    {
+      send("quit");
+    }
+  catch(PipeError &)
+    {
+    }
+  close(fd);
+  kill(pid,SIGKILL);
+  while(waitpid(pid,nullptr,0)<0 && EINTR==errno)
+    {
+    }
+}
+
+void BotProcess::send(const std::string &line)
+{
+  const std::string out=line+'\n';
+  std::size_t pos=0;
+  while(pos<out.size())
+    {
+      const ssize_t n=::send(fd,out.data()+pos,out.size()-pos,MSG_NOSIGNAL);
+      if(n<0)
+	{
+	  if(EINTR==errno)
+	    {
+	      continue;
+	    }
+	  throw PipeError(errnoString("send"));
+	}
+      pos+=n;
+    }
+}
+
+bool BotProcess::receive(std::string &line, std::chrono::steady_clock::time_point deadline)
+{
+  // A bot that never ends a line is broken, not slow.
+  const std::size_t MAX_LINE=1<<16;
+  for(;;)
+    {
+      const std::size_t end=buffer.find('\n');
+      if(std::string::npos!=end)
+	{
+	  line.assign(buffer,0,end);
+	  buffer.erase(0,end+1);
+	  return true;
+	}
+      if(buffer.size()>MAX_LINE)
+	{
+	  throw PipeError("line too long");
+	}
+
+      const auto left=std::chrono::duration_cast<std::chrono::nanoseconds>
+	(deadline-std::chrono::steady_clock::now()).count();
+      if(left<=0)
+	{
+	  return false;
+	}
+      const timespec timeout={(time_t)(left/1000000000),(long)(left%1000000000)};
+      pollfd p={fd,POLLIN,0};
+      const int ready=ppoll(&p,1,&timeout,nullptr);
+      if(ready<0)
+	{
+	  if(EINTR==errno)
+	    {
+	      continue;
+	    }
+	  throw PipeError(errnoString("poll"));
+	}
+      if(0==ready)
+	{
+	  return false;
+	}
+      char chunk[4096];
+      const ssize_t n=read(fd,chunk,sizeof(chunk));
+      if(n<0)
+	{
+	  if(EINTR==errno)
+	    {
+	      continue;
+	    }
+	  throw PipeError(errnoString("read"));
+	}
+      if(0==n)
+	{
+	  throw PipeError("the bot closed its output");
+	}
+      buffer.append(chunk,n);
+    }
+}
+
+// PipeAgent
+
+constexpr std::chrono::seconds PipeAgent::HELLO_TIMEOUT;
+
+PipeAgent::PipeAgent(const std::vector<std::string> &command, std::chrono::microseconds budget_):
+  process(command),budget(budget_),name(),stats(),alive(true),id(0),lastPiece(0),moves(),
+  length(0),sent(0)
+{
+  stats.moves=stats.timeouts=stats.errors=0;
+  process.send(BotProtocol::hello());
+  std::string line;
+  if(!process.receive(line,std::chrono::steady_clock::now()+HELLO_TIMEOUT))
+    {
+      throw PipeError("no answer to hello");
+    }
+  if(!BotProtocol::parseHello(line,name))
+    {
+      throw PipeError("bad answer to hello: "+line);
+    }
+}
+
+std::size_t PipeAgent::act(const HeadlessGame &game, PieceInput *inputs, std::size_t max)
+{
+  if(game.getPieceCount()!=lastPiece)
+    {
+      lastPiece=game.getPieceCount();
+      sent=0;
+      if(!exchange(game))
+	{
+	  planned[0]=hard_drop;
+	  length=1;
+	}
+    }
+  const std::size_t n=std::min(max,length-sent);
+  std::copy(planned+sent,planned+sent+n,inputs);
+  sent+=n;
+  return n;
+}
+
+bool PipeAgent::exchange(const HeadlessGame &game)
+{
+  ++stats.moves;
+  if(!alive)
+    {
+      ++stats.errors;
+      return false;
+    }
+  const std::uint32_t current=++id;
+  BotProtocol::Reply reply;
+  try
+    {
+      const auto start=std::chrono::steady_clock::now();
+      process.send(BotProtocol::move(current,game));
+      std::string line;
+      do
+	{
+	  if(!process.receive(line,start+budget))
+	    {
+	      ++stats.timeouts;
+	      return false;
+	    }
+	  if(!BotProtocol::parseReply(line,reply))
+	    {
+	      ++stats.errors;
+	      return false;
+	    }
+	  // Older ids are answers to moves that timed out.
+	}
+      while(reply.id!=current);
+      stats.latencies.push_back(std::chrono::duration_cast<std::chrono::microseconds>
+				(std::chrono::steady_clock::now()-start).count());
+    }
+  catch(PipeError &)
+    {
+      alive=false;
+      ++stats.errors;
+      return false;
+    }
+  if(!resolve(game,reply))
+    {
+      ++stats.errors;
+      return false;
+    }
+  return true;
+}
+
+bool PipeAgent::resolve(const HeadlessGame &game, const BotProtocol::Reply &reply)
+{
+  if(BotProtocol::Reply::INPUTS==reply.kind)
+    {
+      std::copy(reply.keys,reply.keys+reply.count,planned);
+      length=reply.count;
+      return true;
+    }
+  // Find the placement that leaves the same board as the drop asked for.
+  const Piece &piece=game.getCurrent();
+  const PieceType t=piece.getType();
+  const Bitboard board=Bitboard::fromField(game.getField());
+  const int y=piece.getCenter().y;
+  if(!board.fits(t,reply.orientation,reply.x,y))
+    {
+      return false;
+    }
+  Bitboard target=board;
+  target.place(t,reply.orientation,reply.x,board.drop(t,reply.orientation,reply.x,y));
+  moves.generate(board,t,piece.getOrientation(),piece.getCenter());
+  for(std::size_t i=0;i<moves.size();++i)
+    {
+      Bitboard after=board;
+      after.place(t,moves[i].orientation,moves[i].x,moves[i].y);
+      if(after==target)
+	{
+	  length=moves.path(i,planned,BotProtocol::MAX_KEYS);
+	  return length>0;
+	}
+    }
+  return false;
+}
@@ -0,0 +1,109 @@
+#ifndef PIPEAGENT_HPP
+#define PIPEAGENT_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include <sys/types.h>
+
+#include "Agent.hpp"
+#include "Bot.hpp"
+#include "BotProtocol.hpp"
+
+/* BotProcess
+   A child process connected by a socket pair on its standard input and
+   output, for exchanging lines of BotProtocol. Its standard error is left
+   alone. The process is killed when the BotProcess is destroyed.
+ */
+class BotProcess
+{
+public:
+  // Start command[0] with the arguments that follow, searching PATH.
+  explicit BotProcess(const std::vector<std::string> &command);
+  ~BotProcess();
+
+  // Send a line; the newline is added.
+  void send(const std::string &line);
+  // Read the next line into line, without its newline, waiting until
+  // deadline. Returns false if none came in time. Throws PipeError if the
+  // process has closed its output.
+  bool receive(std::string &line, std::chrono::steady_clock::time_point deadline);
+
+  pid_t getPid() const
+  {
+    return pid;
+  }
+private:
+  BotProcess(const BotProcess&) = delete; // Uncopyable
+  BotProcess& operator=(const BotProcess&) = delete;
+
+  int fd;
+  pid_t pid;
+  std::string buffer;
+};
+
+/* PipeAgent
+   Plays with an external bot through a BotProcess. For every new piece the
+   bot is sent the game and has budget to answer: a placement is played by
+   the shortest inputs that reach it, and inputs are played as given. A late,
+   malformed or impossible answer forfeits the move, and the piece is hard
+   dropped where it is; once the bot has exited every move is forfeit.
+
+   The time taken by each exchange, from sending the move to reading the
+   answer, is recorded. Unlike other agents, a PipeAgent is only as
+   deterministic as its bot and its timing.
+ */
+class PipeAgent : public Agent
+{
+public:
+  // Longest the bot may take to answer hello.
+  static constexpr std::chrono::seconds HELLO_TIMEOUT{5};
+
+  struct Stats
+  {
+    unsigned long moves,timeouts,errors;
+    // Microseconds each answered move took.
+    std::vector<std::uint32_t> latencies;
+  };
+
+  // Start the bot and greet it. Throws PipeError if it does not answer.
+  PipeAgent(const std::vector<std::string> &command, std::chrono::microseconds budget);
+
+  std::size_t act(const HeadlessGame &, PieceInput *inputs, std::size_t max);
+
+  // The name the bot gave, which may be empty.
+  const std::string& getName() const
+  {
+    return name;
+  }
+  const Stats& getStats() const
+  {
+    return stats;
+  }
+  // False once the bot has exited or broken its pipe.
+  bool isAlive() const
+  {
+    return alive;
+  }
+private:
+  BotProcess process;
+  std::chrono::microseconds budget;
+  std::string name;
+  Stats stats;
+  bool alive;
+  std::uint32_t id;
+  unsigned lastPiece;
+  MoveList moves;
+  PieceInput planned[BotProtocol::MAX_KEYS];
+  std::size_t length,sent;
+
+  // Ask the bot about the current piece and fill planned, or return false
+  // if the move is forfeit.
+  bool exchange(const HeadlessGame &);
+  bool resolve(const HeadlessGame &, const BotProtocol::Reply &);
+};
+
+#endif // PIPEAGENT_HPP
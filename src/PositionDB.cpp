@@ -0,0 +1,226 @@
+#include "PositionDB.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Enumerator.hpp"
+
+static_assert(Enumerator::MAX_HEIGHT*FIELD_WIDTH+3<64,"Keys must leave the top bit free!");
+
+static const char MAGIC[8]="UTPOSDB";
+static constexpr std::uint64_t PRESENT=(std::uint64_t)1<<63;
+
+static std::string errnoString(const std::string &what)
+{
+  return what+": "+std::strerror(errno);
+}
+
+std::uint64_t PositionDB::key(const Bitboard &b)
+{
+  if(b.height()>(int)Enumerator::MAX_HEIGHT)
+    {
+      return NONE;
+    }
+  return Enumerator::canonical(Enumerator::pack(b,Enumerator::MAX_HEIGHT),Enumerator::MAX_HEIGHT);
+}
+
+std::uint64_t PositionDB::key(const Bitboard &b, PieceType t)
+{
+  if(b.height()>(int)Enumerator::MAX_HEIGHT)
+    {
+      return NONE;
+    }
+  return Enumerator::pack(b,Enumerator::MAX_HEIGHT)
+    | (std::uint64_t)(t+1) << (FIELD_WIDTH*Enumerator::MAX_HEIGHT);
+}
+
+// Part of the file format: changing it needs a new version.
+std::uint64_t PositionDB::hash(std::uint64_t key)
+{
+  key^=key>>33;
+  key*=0xff51afd7ed558ccdull;
+  key^=key>>33;
+  key*=0xc4ceb9fe1a85ec53ull;
+  return key^(key>>33);
+}
+
+PositionDB::PositionDB(const std::string &path_):
+  path(path_),base(nullptr),bytes(0),table(nullptr),buckets(0),count(0)
+{
+  int fd=open(path.c_str(),O_RDONLY);
+  if(-1==fd)
+    {
+      throw DatabaseError(errnoString("open "+path));
+    }
+  struct stat st;
+  if(-1==fstat(fd,&st))
+    {
+      const std::string err=errnoString("fstat "+path);
+      close(fd);
+      throw DatabaseError(err);
+    }
+  bytes=st.st_size;
+  if(bytes<HEADER_SIZE)
+    {
+      close(fd);
+      throw DatabaseError(path+" is not a position database");
+    }
+  base=mmap(nullptr,bytes,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(MAP_FAILED==base)
+    {
+      throw DatabaseError(errnoString("mmap "+path));
+    }
+
+  const Header *header=static_cast<const Header*>(base);
+  buckets=header->buckets;
+  count=header->count;
+  std::string err;
+  if(std::memcmp(header->magic,MAGIC,sizeof(MAGIC)) || VERSION!=header->version
+     || sizeof(Record)!=header->recordSize)
+    {
+      err=path+" is not a position database of this version";
+    }
+  else if(0==buckets || (buckets & (buckets-1)) || buckets>(bytes-HEADER_SIZE)/sizeof(Record)
+	  || HEADER_SIZE+buckets*WAYS*sizeof(Record)!=bytes || 4*count>3*WAYS*buckets)
+    {
+      err=path+" is damaged";
+    }
+  if(!err.empty())
+    {
+      munmap(base,bytes);
+      throw DatabaseError(err);
+    }
+  table=static_cast<const Record*>(static_cast<const void*>(static_cast<const char*>(base)
+							    +HEADER_SIZE));
+  // Lookups land anywhere; reading ahead would only waste memory.
+  madvise(base,bytes,MADV_RANDOM);
+}
+
+PositionDB::~PositionDB()
+{
+  munmap(base,bytes);
+}
+
+bool PositionDB::find(std::uint64_t key, Result &out) const
+{
+  if(key & PRESENT)
+    {
+      return false;
+    }
+  const std::uint64_t want=key|PRESENT, mask=buckets-1;
+  std::uint64_t b=hash(key) & mask;
+  // A damaged file could have no empty record; give up after every bucket.
+  for(std::uint64_t tried=0;tried<buckets;++tried)
+    {
+      const Record *r=table+b*WAYS;
+      for(unsigned w=0;w<WAYS;++w)
+	{
+	  if(want==r[w].key)
+	    {
+	      out=r[w].result;
+	      return true;
+	    }
+	  if(0==r[w].key)
+	    {
+	      return false;
+	    }
+	}
+      b=(b+1) & mask;
+    }
+  return false;
+}
+
+bool PositionDB::record(std::uint64_t i, std::uint64_t &key, Result &out) const
+{
+  if(i>=WAYS*buckets || 0==table[i].key)
+    {
+      return false;
+    }
+  key=table[i].key & ~PRESENT;
+  out=table[i].result;
+  return true;
+}
+
+void PositionDB::Builder::add(std::uint64_t key, const Result &r)
+{
+  records.push_back(std::make_pair(key,r));
+}
+
+void PositionDB::Builder::write(const std::string &path)
+{
+  // The last result added for a key wins.
+  std::stable_sort(records.begin(),records.end(),
+		   [](const std::pair<std::uint64_t,Result> &a, const std::pair<std::uint64_t,Result> &b)
+		   {
+		     return a.first<b.first;
+		   });
+  std::vector<std::pair<std::uint64_t,Result>> unique;
+  for(std::size_t i=0;i<records.size();++i)
+    {
+      if(records[i].first & PRESENT)
+	{
+	  throw DatabaseError("key out of range");
+	}
+      if(i+1==records.size() || records[i].first!=records[i+1].first)
+	{
+	  unique.push_back(records[i]);
+	}
+    }
+  records.swap(unique);
+
+  std::uint64_t buckets=1;
+  while(3*WAYS*buckets<4*records.size())
+    {
+      buckets*=2;
+    }
+  std::vector<Record> table(buckets*WAYS);
+  std::memset(static_cast<void*>(table.data()),0,table.size()*sizeof(Record));
+  for(const std::pair<std::uint64_t,Result> &p : records)
+    {
+      std::uint64_t i=(hash(p.first) & (buckets-1))*WAYS;
+      while(table[i].key)
+	{
+	  i=(i+1) & (buckets*WAYS-1);
+	}
+      table[i].key=p.first|PRESENT;
+      table[i].result=p.second;
+    }
+
+  char header[HEADER_SIZE]={0};
+  Header h;
+  std::memcpy(h.magic,MAGIC,sizeof(MAGIC));
+  h.version=VERSION;
+  h.recordSize=sizeof(Record);
+  h.buckets=buckets;
+  h.count=records.size();
+  std::memcpy(header,&h,sizeof(h));
+
+  const std::string temp=path+".tmp";
+  std::FILE *file=std::fopen(temp.c_str(),"wb");
+  if(!file)
+    {
+      throw DatabaseError(errnoString("cannot create "+temp));
+    }
+  const bool written=1==std::fwrite(header,sizeof(header),1,file)
+    && table.size()==std::fwrite(table.data(),sizeof(Record),table.size(),file);
+  const bool closed=0==std::fclose(file);
+  if(!written || !closed)
+    {
+      std::remove(temp.c_str());
+      throw DatabaseError("cannot write "+temp);
+    }
+  if(0!=std::rename(temp.c_str(),path.c_str()))
+    {
+      const std::string err=errnoString("cannot rename "+temp);
+      std::remove(temp.c_str());
+      throw DatabaseError(err);
+    }
+}
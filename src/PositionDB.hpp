@@ -0,0 +1,131 @@
+#ifndef POSITIONDB_HPP
+#define POSITIONDB_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "Bitboard.hpp"
+
+/* PositionDB
+   Precomputed results for low boards, such as an opening book's placement
+   for a piece or a position's value, read straight from a file mapped into
+   memory. Opening a database only checks its header; the pages holding the
+   records are read by the system as lookups touch them, so a database of
+   any size opens at once and costs memory only for what is used.
+
+   A key is a board of at most Enumerator::MAX_HEIGHT rows packed as the
+   Enumerator packs it, with the piece to place, if any, in the bits above.
+   A board without a piece is folded with its mirror image, whose results
+   are the same; with a piece the board is kept as it is, since a placement
+   has no simple mirror image.
+
+   The file, in native byte order, is a 64 byte header:
+     "UTPOSDB" and a zero byte, version (u32, 1), record size (u32, 16),
+     bucket count (u64, a power of two), record count (u64),
+   then the buckets, each WAYS records of 16 bytes filling a cache line: the
+   key with its top bit set, or 0 for an empty record, and a Result. A key
+   lives in the bucket picked by the low bits of hash(key) or, if that is
+   full, the next with room, wrapping around. The builder keeps at least a
+   quarter of the records empty, so a lookup stops at the first empty
+   record and usually reads one cache line.
+ */
+class PositionDB
+{
+public:
+  static constexpr unsigned WAYS=4;
+  // The key of a board higher than Enumerator::MAX_HEIGHT, which is never
+  // found.
+  static constexpr std::uint64_t NONE=~(std::uint64_t)0;
+
+  enum Flags
+    {
+      // orientation and x are the placement to make.
+      MOVE=1,
+      // The placement clears the field; without a piece, a perfect clear
+      // can be reached.
+      PERFECT_CLEAR=2
+    };
+  struct Result
+  {
+    float value;
+    std::uint8_t flags,orientation;
+    std::int8_t x;
+    std::uint8_t reserved;
+  };
+
+  static std::uint64_t key(const Bitboard &);
+  static std::uint64_t key(const Bitboard &, PieceType);
+  static std::uint64_t hash(std::uint64_t key);
+
+  // Map a database. Throws DatabaseError.
+  explicit PositionDB(const std::string &path);
+  ~PositionDB();
+
+  bool find(std::uint64_t key, Result &) const;
+  bool find(const Bitboard &b, Result &r) const
+  {
+    return find(key(b),r);
+  }
+  bool find(const Bitboard &b, PieceType t, Result &r) const
+  {
+    return find(key(b,t),r);
+  }
+  std::uint64_t size() const
+  {
+    return count;
+  }
+  std::uint64_t getBuckets() const
+  {
+    return buckets;
+  }
+  // Record i of the buckets' WAYS*getBuckets(). Returns false if it is
+  // empty.
+  bool record(std::uint64_t i, std::uint64_t &key, Result &) const;
+
+  /* Builder
+     Collects results in memory and writes them as a database. Adding a key
+     again replaces its result.
+   */
+  class Builder
+  {
+  public:
+    void add(std::uint64_t key, const Result &);
+    std::size_t size() const
+    {
+      return records.size();
+    }
+    // Write the database through a temporary file renamed into place.
+    // Throws DatabaseError.
+    void write(const std::string &path);
+  private:
+    std::vector<std::pair<std::uint64_t,Result>> records;
+  };
+private:
+  PositionDB(const PositionDB&) = delete; // Uncopyable
+
+  struct Record
+  {
+    std::uint64_t key;
+    Result result;
+  };
+  struct Header
+  {
+    char magic[8];
+    std::uint32_t version,recordSize;
+    std::uint64_t buckets,count;
+  };
+  static_assert(sizeof(Record)==16,"A record must be 16 bytes!");
+  static constexpr std::size_t HEADER_SIZE=64;
+  static constexpr std::uint32_t VERSION=1;
+
+  std::string path;
+  void *base;
+  std::size_t bytes;
+  const Record *table;
+  std::uint64_t buckets,count;
+};
+
+#endif // POSITIONDB_HPP
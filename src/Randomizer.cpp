@@ -0,0 +1,201 @@
+#include "Randomizer.hpp"
+
+#include <algorithm>
+#include <cstring>
+
+static const PieceType ALL_PIECES[7]={I,J,L,O,S,T,Z};
+
+std::unique_ptr<Randomizer> Randomizer::create(RandomizerKind kind, std::uint64_t seed)
+{
+  switch(kind)
+    {
+    case MEMORYLESS:
+      return std::unique_ptr<Randomizer>(new MemorylessRandomizer(seed));
+    case HISTORY:
+      return std::unique_ptr<Randomizer>(new HistoryRandomizer(seed));
+    case BAG7:
+    default:
+      return std::unique_ptr<Randomizer>(new BagRandomizer(seed));
+    }
+}
+
+BagRandomizer::BagRandomizer(std::uint64_t seed):rng(seed),position(7)
+{
+  std::copy(ALL_PIECES,ALL_PIECES+7,bag);
+}
+
+void BagRandomizer::reset(std::uint64_t seed)
+{
+  rng.seed(seed);
+  std::copy(ALL_PIECES,ALL_PIECES+7,bag);
+  position=7;
+}
+
+PieceType BagRandomizer::next()
+{
+  if(7==position)
+    {
+      // Fisher-Yates
+      for(unsigned i=6;i>0;--i)
+	{
+	  std::swap(bag[i],bag[rng.bounded(i+1)]);
+	}
+      position=0;
+    }
+  return bag[position++];
+}
+
+void BagRandomizer::save(std::uint8_t *out) const
+{
+  std::uint64_t g[2];
+  rng.save(g);
+  std::memcpy(out,g,sizeof(g));
+  for(unsigned i=0;i<7;++i)
+    {
+      out[16+i]=bag[i];
+    }
+  out[23]=position;
+}
+
+void BagRandomizer::load(const std::uint8_t *in)
+{
+  std::uint64_t g[2];
+  std::memcpy(g,in,sizeof(g));
+  rng.load(g);
+  for(unsigned i=0;i<7;++i)
+    {
+      bag[i]=(PieceType)(in[16+i]%7);
+    }
+  position=std::min<unsigned>(in[23],7);
+}
+
+MemorylessRandomizer::MemorylessRandomizer(std::uint64_t seed):rng(seed)
+{
+}
+
+void MemorylessRandomizer::reset(std::uint64_t seed)
+{
+  rng.seed(seed);
+}
+
+PieceType MemorylessRandomizer::next()
+{
+  return ALL_PIECES[rng.bounded(7)];
+}
+
+void MemorylessRandomizer::save(std::uint8_t *out) const
+{
+  std::uint64_t g[2];
+  rng.save(g);
+  std::memcpy(out,g,sizeof(g));
+}
+
+void MemorylessRandomizer::load(const std::uint8_t *in)
+{
+  std::uint64_t g[2];
+  std::memcpy(g,in,sizeof(g));
+  rng.load(g);
+}
+
+HistoryRandomizer::HistoryRandomizer(std::uint64_t seed, unsigned tries_):rng(),tries(tries_)
+{
+  reset(seed);
+}
+
+void HistoryRandomizer::reset(std::uint64_t seed)
+{
+  rng.seed(seed);
+  std::fill(history,history+4,Z);
+  first=true;
+}
+
+PieceType HistoryRandomizer::next()
+{
+  PieceType ret;
+  if(first)
+    {
+      static const PieceType openers[4]={I,J,L,T};
+      ret=openers[rng.bounded(4)];
+      first=false;
+    }
+  else
+    {
+      ret=ALL_PIECES[rng.bounded(7)];
+      for(unsigned i=1;i<tries && std::count(history,history+4,ret);++i)
+	{
+	  ret=ALL_PIECES[rng.bounded(7)];
+	}
+    }
+  std::copy(history+1,history+4,history);
+  history[3]=ret;
+  return ret;
+}
+
+void HistoryRandomizer::save(std::uint8_t *out) const
+{
+  std::uint64_t g[2];
+  rng.save(g);
+  std::memcpy(out,g,sizeof(g));
+  for(unsigned i=0;i<4;++i)
+    {
+      out[16+i]=history[i];
+    }
+  out[20]=first;
+}
+
+void HistoryRandomizer::load(const std::uint8_t *in)
+{
+  std::uint64_t g[2];
+  std::memcpy(g,in,sizeof(g));
+  rng.load(g);
+  for(unsigned i=0;i<4;++i)
+    {
+      history[i]=(PieceType)(in[16+i]%7);
+    }
+  first=in[20];
+}
+
+constexpr unsigned PieceQueue::CAPACITY;
+
+PieceQueue::PieceQueue(RandomizerKind kind_, std::uint64_t seed, unsigned preview):
+  kind(kind_),randomizer(Randomizer::create(kind_,seed)),head(0),
+  length(std::min(std::max(preview,1u),CAPACITY))
+{
+  fill();
+}
+
+void PieceQueue::reset(std::uint64_t seed)
+{
+  randomizer->reset(seed);
+  fill();
+}
+
+void PieceQueue::fill()
+{
+  head=0;
+  for(unsigned i=0;i<length;++i)
+    {
+      ring[i]=randomizer->next();
+    }
+}
+
+void PieceQueue::save(std::uint8_t *out) const
+{
+  std::memset(out,0,STATE_SIZE);
+  for(unsigned i=0;i<CAPACITY;++i)
+    {
+      out[i]=ring[i];
+    }
+  out[CAPACITY]=head;
+  randomizer->save(out+CAPACITY+1);
+}
+
+void PieceQueue::load(const std::uint8_t *in)
+{
+  for(unsigned i=0;i<CAPACITY;++i)
+    {
+      ring[i]=(PieceType)(in[i]%7);
+    }
+  head=in[CAPACITY]%CAPACITY;
+  randomizer->load(in+CAPACITY+1);
+}
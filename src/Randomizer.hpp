@@ -0,0 +1,212 @@
+#ifndef RANDOMIZER_HPP
+#define RANDOMIZER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "common.hpp"
+
+/* Pcg32
+   PCG-XSH-RR: 64 bits of state, 32 bits of output, a handful of instructions
+   per number. Meets the standard UniformRandomBitGenerator requirements, so it
+   also works with <random> distributions, but bounded() is both faster and
+   the same on every standard library.
+ */
+class Pcg32
+{
+public:
+  typedef std::uint32_t result_type;
+
+  explicit Pcg32(std::uint64_t seed=0, std::uint64_t stream=0)
+  {
+    this->seed(seed,stream);
+  }
+  void seed(std::uint64_t seed, std::uint64_t stream=0)
+  {
+    state=0;
+    increment=(stream<<1)|1;
+    (*this)();
+    state+=seed;
+    (*this)();
+  }
+  result_type operator()()
+  {
+    const std::uint64_t old=state;
+    state=old*6364136223846793005ull+increment;
+    const std::uint32_t xorshifted=((old>>18)^old)>>27;
+    const std::uint32_t rot=old>>59;
+    return (xorshifted>>rot)|(xorshifted<<((32-rot)&31));
+  }
+  // Uniform in [0,n). n must not be 0.
+  std::uint32_t bounded(std::uint32_t n)
+  {
+    // Lemire's multiply-and-reject: no division in the common case.
+    std::uint64_t m=(std::uint64_t)(*this)()*n;
+    std::uint32_t low=(std::uint32_t)m;
+    if(low<n)
+      {
+	const std::uint32_t threshold=(0u-n)%n;
+	while(low<threshold)
+	  {
+	    m=(std::uint64_t)(*this)()*n;
+	    low=(std::uint32_t)m;
+	  }
+      }
+    return m>>32;
+  }
+  static constexpr result_type min()
+  {
+    return 0;
+  }
+  static constexpr result_type max()
+  {
+    return 0xffffffffu;
+  }
+  // The whole generator, to carry on later from where it is now.
+  void save(std::uint64_t out[2]) const
+  {
+    out[0]=state;
+    out[1]=increment;
+  }
+  void load(const std::uint64_t in[2])
+  {
+    state=in[0];
+    increment=in[1];
+  }
+private:
+  std::uint64_t state,increment;
+};
+
+/* Randomizer
+   Chooses the sequence of pieces. Every randomizer is seeded explicitly and
+   produces the same sequence for the same seed on every platform.
+
+   Bag7        Deals all seven pieces in a random order, then shuffles again.
+	       No drought is longer than twelve pieces.
+   Memoryless  Every piece is independently uniform.
+   History     Rerolls a piece up to a few times while it matches one of the
+	       last four dealt, as the arcade games do. The first piece is
+	       never S, Z or O.
+ */
+enum RandomizerKind
+  {
+    BAG7,
+    MEMORYLESS,
+    HISTORY
+  };
+
+class Randomizer
+{
+public:
+  virtual ~Randomizer()
+  {}
+
+  virtual PieceType next() = 0;
+  // Start the sequence again from a new seed.
+  virtual void reset(std::uint64_t seed) = 0;
+
+  // Most bytes save writes.
+  static constexpr std::size_t STATE_SIZE=32;
+  // Write the whole state; load reads one written by a randomizer of the
+  // same kind, which then carries on the same sequence.
+  virtual void save(std::uint8_t *out) const = 0;
+  virtual void load(const std::uint8_t *in) = 0;
+
+  static std::unique_ptr<Randomizer> create(RandomizerKind, std::uint64_t seed);
+};
+
+class BagRandomizer : public Randomizer
+{
+public:
+  explicit BagRandomizer(std::uint64_t seed);
+  PieceType next();
+  void reset(std::uint64_t seed);
+  void save(std::uint8_t *out) const;
+  void load(const std::uint8_t *in);
+private:
+  Pcg32 rng;
+  PieceType bag[7];
+  unsigned position;
+};
+
+class MemorylessRandomizer : public Randomizer
+{
+public:
+  explicit MemorylessRandomizer(std::uint64_t seed);
+  PieceType next();
+  void reset(std::uint64_t seed);
+  void save(std::uint8_t *out) const;
+  void load(const std::uint8_t *in);
+private:
+  Pcg32 rng;
+};
+
+class HistoryRandomizer : public Randomizer
+{
+public:
+  explicit HistoryRandomizer(std::uint64_t seed, unsigned tries=4);
+  PieceType next();
+  void reset(std::uint64_t seed);
+  void save(std::uint8_t *out) const;
+  void load(const std::uint8_t *in);
+private:
+  Pcg32 rng;
+  PieceType history[4];
+  unsigned tries;
+  bool first;
+};
+
+/* PieceQueue
+   The pieces to come: a fixed-size ring buffer kept full from a Randomizer,
+   so the game can show a preview of the next few pieces without allocating.
+ */
+class PieceQueue
+{
+public:
+  static constexpr unsigned CAPACITY=8;
+
+  // preview is clamped to [1,CAPACITY].
+  PieceQueue(RandomizerKind, std::uint64_t seed, unsigned preview=5);
+
+  // Remove and return the next piece.
+  PieceType pop()
+  {
+    const PieceType ret=ring[head];
+    ring[(head+length)%CAPACITY]=randomizer->next();
+    head=(head+1)%CAPACITY;
+    return ret;
+  }
+  // The i'th piece to come; peek(0) is the next one. i must be below size().
+  PieceType peek(unsigned i) const
+  {
+    return ring[(head+i)%CAPACITY];
+  }
+  unsigned size() const
+  {
+    return length;
+  }
+  RandomizerKind getKind() const
+  {
+    return kind;
+  }
+  void reset(std::uint64_t seed);
+
+  // Bytes save writes: the pieces queued, where they start and the
+  // randomizer.
+  static constexpr std::size_t STATE_SIZE=CAPACITY+1+Randomizer::STATE_SIZE;
+  // Write the whole queue; load reads one written by a queue of the same
+  // kind and length.
+  void save(std::uint8_t *out) const;
+  void load(const std::uint8_t *in);
+private:
+  PieceQueue(const PieceQueue&) = delete; // Uncopyable
+  RandomizerKind kind;
+  std::unique_ptr<Randomizer> randomizer;
+  PieceType ring[CAPACITY];
+  unsigned head,length;
+
+  void fill();
+};
+
+#endif // RANDOMIZER_HPP
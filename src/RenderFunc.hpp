@@ -4,6 +4,7 @@
 
 class Field;
 class Piece;
+struct FrameSnapshot;
 
 // Abstract functor
 struct IRenderFunc
@@ -44,4 +45,27 @@ private:
   renderfuncptr fptr;
 };
 
+// Abstract functor receiving a packed copy of each frame
+struct ISnapshotFunc
+{
+  virtual void operator()(const FrameSnapshot&)=0;
+};
+
+// Template for concrete snapshot functors using member functions
+template <class predicate>
+struct SnapshotFunc : public ISnapshotFunc
+{
+  SnapshotFunc(predicate* pred,
+	       void (predicate::*predmember)(const FrameSnapshot&)
+	       ):fptr(predmember),dptr(pred){}
+
+  virtual void operator()(const FrameSnapshot& snap)
+  {
+    (*dptr.*fptr)(snap);
+  }
+private:
+  void (predicate::*fptr) (const FrameSnapshot&);
+  predicate *dptr;
+};
+
 #endif // RENDERFUNC_HPP
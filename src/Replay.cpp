@@ -0,0 +1,388 @@
+#include "Replay.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char MAGIC[8]={'U','T','R','E','P','L','A','Y'};
+
+static std::string errnoString(const std::string &what)
+{
+  return what+": "+std::strerror(errno);
+}
+
+void ReplayView::configure(HeadlessGame &game) const
+{
+  if(getTickRate()>HeadlessGame::MAX_TICK_RATE || das>HeadlessGame::MAX_REPEAT.count()
+     || arr>HeadlessGame::MAX_REPEAT.count())
+    {
+      throw ReplayError("tick rate or auto-repeat out of range");
+    }
+  game.setTickRate(getTickRate());
+  game.setAutoRepeat(HeadlessGame::RepeatTime(das),HeadlessGame::RepeatTime(arr));
+}
+
+void ReplayView::keyframe(std::uint32_t i, ReplayKeyframe &out) const
+{
+  std::memcpy(&out,keyframeData+(std::size_t)i*sizeof(ReplayKeyframe),sizeof(ReplayKeyframe));
+}
+
+ReplayCursor::ReplayCursor(const ReplayView &r, const ReplayKeyframe &k):
+  p(r.events+k.offset),end(r.events+r.bytes),idle(0)
+{
+  if(0==k.offset || k.offset>r.bytes || !(r.events[k.offset-1] & 0x80)
+     || k.skipped>(r.events[k.offset-1] & 0x7fu))
+    {
+      throw ReplayError("keyframe does not match the events");
+    }
+  idle=(r.events[k.offset-1] & 0x7f)-k.skipped;
+}
+
+Replay::Replay(std::uint64_t seed_, RandomizerKind kind_, std::uint32_t interval_):
+  seed(seed_),kind(kind_),flags(0),frames(0),pieces(0),interval(interval_),tickRate(0),
+  das(0),arr(0),events(),
+  keyframes()
+{
+}
+
+bool Replay::step(HeadlessGame &game, const PieceInput *inputs, std::size_t count)
+{
+  frame(inputs,count);
+  const bool ret=game.step(inputs,count);
+  if(!ret)
+    {
+      keyframe(game);
+    }
+  return ret;
+}
+
+void Replay::keyframe(const HeadlessGame &game)
+{
+  // Keyframes must follow each other without a gap, so none are taken for
+  // a game recorded from part way through.
+  if(interval && 0==game.getFrame()%interval && keyframes.size()+1==game.getFrame()/interval)
+    {
+      ReplayKeyframe k;
+      std::memset(&k,0,sizeof(k));
+      k.frame=game.getFrame();
+      k.offset=events.size();
+      k.skipped=events.back() & 0x7f;
+      try
+	{
+	  game.save(k.state);
+	  keyframes.push_back(k);
+	}
+      catch(std::length_error &)
+	{
+	  // Too much garbage to save: leave a hole of frame 0 in its place,
+	  // so the keyframes after it stay on the grid, and seeking to the
+	  // frames it covers plays on from the keyframe before it.
+	  std::memset(&k,0,sizeof(k));
+	  keyframes.push_back(k);
+	}
+    }
+}
+
+void Replay::frame(const PieceInput *inputs, std::size_t count)
+{
+  if(count>ReplayCursor::MAX_INPUTS)
+    {
+      throw ReplayError("too many inputs in one frame");
+    }
+  // An empty frame extends the run of the frame before it, if it can.
+  if(0==count && !events.empty() && 0x80<=events.back() && 0xff!=events.back())
+    {
+      ++events.back();
+    }
+  else
+    {
+      for(std::size_t i=0;i<count;++i)
+	{
+	  events.push_back(inputs[i]);
+	}
+      events.push_back(0x80);
+    }
+  ++frames;
+}
+
+void Replay::finish(const HeadlessGame &game)
+{
+  frames=game.getFrame();
+  pieces=game.getPieceCount();
+  tickRate=game.getTickRate();
+  das=game.getDas().count();
+  arr=game.getArr().count();
+  flags=game.isGameOver() ? ReplayView::GAME_OVER : 0;
+}
+
+ReplayView Replay::view() const
+{
+  const ReplayView ret={seed,kind,flags,frames,pieces,events.data(),events.size(),interval,
+			(std::uint32_t)keyframes.size(),
+			reinterpret_cast<const std::uint8_t*>(keyframes.data()),tickRate,das,arr};
+  return ret;
+}
+
+ReplayWriter::ReplayWriter(const std::string &path_):
+  path(path_),file(std::fopen(path_.c_str(),"a+b"))
+{
+  if(!file)
+    {
+      throw ReplayError(errnoString("cannot open "+path));
+    }
+  char header[HEADER_SIZE]={0};
+  if(0==std::fseek(file,0,SEEK_END) && 0==std::ftell(file))
+    {
+      std::memcpy(header,MAGIC,sizeof(MAGIC));
+      std::memcpy(header+8,&VERSION,4);
+      if(1!=std::fwrite(header,sizeof(header),1,file))
+	{
+	  std::fclose(file);
+	  throw ReplayError("cannot write "+path);
+	}
+      return;
+    }
+  // Appending: the records must match the header.
+  std::uint32_t version=0;
+  const bool read=0==std::fseek(file,0,SEEK_SET) && 1==std::fread(header,sizeof(header),1,file);
+  std::memcpy(&version,header+8,4);
+  if(!read || std::memcmp(header,MAGIC,sizeof(MAGIC)) || VERSION!=version)
+    {
+      std::fclose(file);
+      throw ReplayError("cannot append to "+path+": not a replay file of this version");
+    }
+}
+
+ReplayWriter::~ReplayWriter()
+{
+  std::fclose(file);
+}
+
+// The record header of a replay.
+static void encodeRecord(const ReplayView &r, std::uint8_t *record)
+{
+  if(r.bytes>0xffffffffu)
+    {
+      throw ReplayError("replay too long");
+    }
+  if(r.tickRate>0xffff)
+    {
+      throw ReplayError("tick rate too high");
+    }
+  const std::uint16_t tickRate=r.tickRate;
+  const std::uint32_t counts[3]={(std::uint32_t)r.bytes,r.frames,r.pieces},
+    keyframes[2]={r.interval,r.keyframes};
+  std::memset(record,0,ReplayWriter::RECORD_SIZE);
+  std::memcpy(record,counts,sizeof(counts));
+  record[12]=r.kind;
+  record[13]=r.flags;
+  std::memcpy(record+14,&tickRate,2);
+  std::memcpy(record+16,&r.seed,8);
+  std::memcpy(record+24,keyframes,sizeof(keyframes));
+  std::memcpy(record+32,&r.das,2);
+  std::memcpy(record+34,&r.arr,2);
+}
+
+void ReplayWriter::write(const ReplayView &r)
+{
+  std::uint8_t record[RECORD_SIZE];
+  encodeRecord(r,record);
+  if(1!=std::fwrite(record,sizeof(record),1,file)
+     || r.bytes!=std::fwrite(r.events,1,r.bytes,file)
+     || r.keyframes!=std::fwrite(r.keyframeData,sizeof(ReplayKeyframe),r.keyframes,file))
+    {
+      throw ReplayError("cannot write "+path);
+    }
+}
+
+std::vector<std::uint8_t> ReplayWriter::encode(const ReplayView &r)
+{
+  const std::size_t keyframeBytes=(std::size_t)r.keyframes*sizeof(ReplayKeyframe);
+  std::vector<std::uint8_t> ret(RECORD_SIZE+r.bytes+keyframeBytes);
+  encodeRecord(r,ret.data());
+  std::copy(r.events,r.events+r.bytes,ret.begin()+RECORD_SIZE);
+  std::copy(r.keyframeData,r.keyframeData+keyframeBytes,ret.begin()+RECORD_SIZE+r.bytes);
+  return ret;
+}
+
+void ReplayWriter::flush()
+{
+  if(0!=std::fflush(file))
+    {
+      throw ReplayError(errnoString("cannot write "+path));
+    }
+}
+
+ReplayFile::ReplayFile(const std::string &path_):
+  path(path_),base(nullptr),bytes(0),recordSize(ReplayWriter::RECORD_SIZE),offsets()
+{
+  int fd=open(path.c_str(),O_RDONLY);
+  if(-1==fd)
+    {
+      throw ReplayError(errnoString("open "+path));
+    }
+  struct stat st;
+  if(-1==fstat(fd,&st))
+    {
+      const std::string err=errnoString("fstat "+path);
+      close(fd);
+      throw ReplayError(err);
+    }
+  bytes=st.st_size;
+  if(bytes<ReplayWriter::HEADER_SIZE)
+    {
+      close(fd);
+      throw ReplayError(path+" is not a replay file");
+    }
+  base=mmap(nullptr,bytes,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(MAP_FAILED==base)
+    {
+      throw ReplayError(errnoString("mmap "+path));
+    }
+
+  const char *data=static_cast<const char*>(base);
+  std::uint32_t version;
+  std::memcpy(&version,data+8,4);
+  std::string err;
+  if(std::memcmp(data,MAGIC,sizeof(MAGIC)) || version<1 || version>ReplayWriter::VERSION)
+    {
+      err=path+" is not a replay file of a known version";
+    }
+  else if(1==version)
+    {
+      recordSize=24;
+    }
+  else if(2==version)
+    {
+      recordSize=32;
+    }
+  // Replays are played in the order they are stored, so read ahead.
+  madvise(base,bytes,MADV_SEQUENTIAL);
+  for(std::size_t at=ReplayWriter::HEADER_SIZE;err.empty() && at<bytes;)
+    {
+      std::uint32_t events,keyframes=0;
+      if(bytes-at<recordSize)
+	{
+	  err=path+" is damaged";
+	  break;
+	}
+      std::memcpy(&events,data+at,4);
+      if(recordSize>24)
+	{
+	  std::memcpy(&keyframes,data+at+28,4);
+	}
+      const std::uint64_t length=events+(std::uint64_t)keyframes*sizeof(ReplayKeyframe);
+      if(bytes-at-recordSize<length || (std::uint8_t)data[at+12]>HISTORY)
+	{
+	  err=path+" is damaged";
+	  break;
+	}
+      offsets.push_back(at);
+      at+=recordSize+length;
+    }
+  if(!err.empty())
+    {
+      munmap(base,bytes);
+      throw ReplayError(err);
+    }
+}
+
+ReplayFile::~ReplayFile()
+{
+  munmap(base,bytes);
+}
+
+ReplayView ReplayFile::get(std::size_t i) const
+{
+  const char *record=static_cast<const char*>(base)+offsets.at(i);
+  std::uint32_t counts[3];
+  std::memcpy(counts,record,sizeof(counts));
+  ReplayView ret;
+  ret.kind=(RandomizerKind)record[12];
+  ret.flags=record[13];
+  std::uint16_t tickRate;
+  std::memcpy(&tickRate,record+14,2);
+  ret.tickRate=tickRate;
+  std::memcpy(&ret.seed,record+16,8);
+  ret.frames=counts[1];
+  ret.pieces=counts[2];
+  ret.events=reinterpret_cast<const std::uint8_t*>(record+recordSize);
+  ret.bytes=counts[0];
+  ret.interval=0;
+  ret.keyframes=0;
+  if(recordSize>24)
+    {
+      std::memcpy(&ret.interval,record+24,4);
+      std::memcpy(&ret.keyframes,record+28,4);
+    }
+  ret.das=0;
+  ret.arr=0;
+  if(recordSize>32)
+    {
+      std::memcpy(&ret.das,record+32,2);
+      std::memcpy(&ret.arr,record+34,2);
+    }
+  ret.keyframeData=ret.events+ret.bytes;
+  return ret;
+}
+
+ReplayPlayer::ReplayPlayer(const ReplayView &r):
+  replay(r),game(r.seed,r.kind),cursor(r)
+{
+  r.configure(game);
+}
+
+void ReplayPlayer::seek(std::uint32_t frame)
+{
+  frame=std::min(frame,replay.frames);
+  std::uint32_t k=replay.interval ? std::min(frame/replay.interval,replay.keyframes) : 0;
+  // Step back over holes, where the game could not be saved.
+  ReplayKeyframe key;
+  while(0<k)
+    {
+      replay.keyframe(k-1,key);
+      if(0!=key.frame)
+	{
+	  break;
+	}
+      --k;
+    }
+  // Play on from here if that is no further than from the keyframe.
+  if(getFrame()>frame || getFrame()<k*replay.interval)
+    {
+      if(0==k)
+	{
+	  game.reset(replay.seed);
+	  cursor=ReplayCursor(replay);
+	}
+      else
+	{
+	  if(key.frame!=k*replay.interval || key.state.frame!=key.frame)
+	    {
+	      throw ReplayError("keyframe out of place");
+	    }
+	  cursor=ReplayCursor(replay,key);
+	  game.load(key.state);
+	}
+    }
+  advance(frame-getFrame());
+}
+
+std::uint32_t ReplayPlayer::advance(std::uint32_t frames)
+{
+  std::uint32_t ret=0;
+  std::size_t count;
+  while(ret<frames && !game.isGameOver() && cursor.next(inputs,count))
+    {
+      game.step(inputs,count);
+      ++ret;
+    }
+  return ret;
+}
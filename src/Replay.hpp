@@ -0,0 +1,291 @@
+#ifndef REPLAY_HPP
+#define REPLAY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "HeadlessGame.hpp"
+
+/* ReplayKeyframe
+   The whole game after frame, and where in the events the frame after it
+   starts: offset is just past the end of frame byte that frame belongs to,
+   and skipped the frames of that byte's run already played.
+ */
+struct ReplayKeyframe
+{
+  std::uint32_t frame,offset,skipped,reserved;
+  HeadlessGame::State state;
+};
+static_assert(sizeof(ReplayKeyframe)==136,"The layout of a keyframe is part of the replay format!");
+
+/* ReplayView
+   One recorded game, wherever its bytes are: the seed and randomizer it
+   started from, how it ended, and its inputs encoded frame by frame. A
+   HeadlessGame made from the seed and randomizer and stepped with the
+   inputs of every frame in turn plays the game again exactly.
+
+   The inputs are a byte per event:
+     0 to 0x7f  an input, one of PieceInput, in the current frame;
+     0x80 + n   the end of the current frame, then n frames without input.
+   A frame without input costs nothing after the first, so a game takes
+   about as many bytes as the inputs it was played with.
+
+   Keyframe i, if there is one, is the game after frame (i+1)*interval, so
+   any frame is at most interval-1 frames from a keyframe or the start.
+   A keyframe of frame 0 is a hole, left where the game had more garbage
+   queued than a State holds; frames after a hole are further from one.
+ */
+struct ReplayView
+{
+  enum Flags
+    {
+      // The game was lost; otherwise recording stopped while it was in play.
+      GAME_OVER=1
+    };
+
+  std::uint64_t seed;
+  RandomizerKind kind;
+  std::uint8_t flags;
+  // Frames stepped and pieces that entered play, as the HeadlessGame
+  // counted them when recording stopped.
+  std::uint32_t frames,pieces;
+  const std::uint8_t *events;
+  std::size_t bytes;
+  // Frames between keyframes, or 0 if there are none.
+  std::uint32_t interval,keyframes;
+  const std::uint8_t *keyframeData;
+  // Frames a second the game was played at, or 0 for
+  // HeadlessGame::DEFAULT_TICK_RATE, as in replays recorded before it could
+  // be changed.
+  std::uint32_t tickRate;
+  // The game's auto-repeat, as counts of HeadlessGame::RepeatTime. Replays
+  // recorded before it was in the game have no key inputs, so it does not
+  // matter to them.
+  std::uint16_t das,arr;
+
+  // Copy keyframe i, which must be below keyframes.
+  void keyframe(std::uint32_t i, ReplayKeyframe &out) const;
+  unsigned getTickRate() const
+  {
+    return tickRate ? tickRate : (unsigned)HeadlessGame::DEFAULT_TICK_RATE;
+  }
+  // Give a game made from the seed and randomizer the replay's tick rate and
+  // auto-repeat. Throws ReplayError if they are out of range.
+  void configure(HeadlessGame &) const;
+};
+
+/* ReplayCursor
+   Decodes the frames of a replay one at a time.
+ */
+class ReplayCursor
+{
+public:
+  // Most inputs a frame can hold.
+  static constexpr std::size_t MAX_INPUTS=255;
+
+  explicit ReplayCursor(const ReplayView &r):
+    p(r.events),end(r.events+r.bytes),idle(0)
+  {}
+  // Start at the frame after a keyframe. Throws ReplayError if the keyframe
+  // does not fit the events.
+  ReplayCursor(const ReplayView &, const ReplayKeyframe &);
+
+  // Write the next frame's inputs, at most MAX_INPUTS, and set count.
+  // Returns false after the last frame. Throws ReplayError if the events are
+  // malformed.
+  bool next(PieceInput *inputs, std::size_t &count)
+  {
+    count=0;
+    if(idle)
+      {
+	--idle;
+	return true;
+      }
+    while(p<end)
+      {
+	const std::uint8_t b=*p++;
+	if(b & 0x80)
+	  {
+	    idle=b & 0x7f;
+	    return true;
+	  }
+	if(b>release_left || MAX_INPUTS==count)
+	  {
+	    throw ReplayError("bad input in frame");
+	  }
+	inputs[count++]=(PieceInput)b;
+      }
+    if(count)
+      {
+	throw ReplayError("last frame not ended");
+      }
+    return false;
+  }
+private:
+  const std::uint8_t *p,*end;
+  unsigned idle;
+};
+
+/* Replay
+   Records a game as it is played: step the game through step, or call frame
+   with the inputs of every frame before stepping the game with them, and
+   finish once the game is over or recording should stop. Only step takes
+   keyframes by itself; a caller stepping the game must call keyframe after
+   every frame that did not lose it.
+ */
+class Replay
+{
+public:
+  // Ten seconds: a keyframe is 136 bytes, and playing the frames from one
+  // to any other takes well under a millisecond.
+  static constexpr std::uint32_t DEFAULT_INTERVAL=600;
+
+  // An interval of 0 takes no keyframes.
+  Replay(std::uint64_t seed, RandomizerKind kind, std::uint32_t interval=DEFAULT_INTERVAL);
+
+  // Record a frame, step the game with it and take a keyframe if one is
+  // due, as HeadlessGame::step. Throws ReplayError as frame.
+  bool step(HeadlessGame &, const PieceInput *inputs, std::size_t count);
+  // Throws ReplayError if there are more than ReplayCursor::MAX_INPUTS.
+  void frame(const PieceInput *inputs, std::size_t count);
+  // Take a keyframe of the game just stepped, if one is due.
+  void keyframe(const HeadlessGame &);
+  // Store the frame and piece counts, the tick rate, the auto-repeat and
+  // whether the game was lost.
+  void finish(const HeadlessGame &);
+
+  ReplayView view() const;
+private:
+  std::uint64_t seed;
+  RandomizerKind kind;
+  std::uint8_t flags;
+  std::uint32_t frames,pieces,interval,tickRate;
+  std::uint16_t das,arr;
+  std::vector<std::uint8_t> events;
+  std::vector<ReplayKeyframe> keyframes;
+};
+
+/* ReplayWriter
+   Appends replays to a replay file, creating it if needed.
+
+   The file, in native byte order, is a 16 byte header:
+     "UTREPLAY", version (u32, 3), zero (u32),
+   then one record per replay, back to back:
+     event bytes (u32), frames (u32), pieces (u32), randomizer (u8),
+     flags (u8), tick rate (u16), seed (u64), keyframe interval (u32),
+     keyframes (u32), DAS (u16), ARR (u16), zero (u32), then the events,
+     then the keyframes. DAS and ARR are in thirds of a millisecond.
+   A tick rate of 0, as in files from before it was recorded, means 60.
+   Files of the same version can be concatenated after the first's header.
+   Older files can still be read: version 2 records are 32 bytes, without
+   the auto-repeat, and version 1 records 24, without the keyframe fields or
+   keyframes either.
+ */
+class ReplayWriter
+{
+public:
+  static constexpr std::size_t HEADER_SIZE=16, RECORD_SIZE=40;
+  static constexpr std::uint32_t VERSION=3;
+
+  // Throws ReplayError, also if the file is of another version.
+  explicit ReplayWriter(const std::string &path);
+  ~ReplayWriter();
+
+  // Throws ReplayError.
+  void write(const ReplayView &);
+  void write(const Replay &r)
+  {
+    write(r.view());
+  }
+  // Write out anything buffered. Throws ReplayError.
+  void flush();
+
+  // A replay's record as write writes it, for appending to a file by other
+  // means. Throws ReplayError.
+  static std::vector<std::uint8_t> encode(const ReplayView &);
+private:
+  ReplayWriter(const ReplayWriter&) = delete; // Uncopyable
+
+  std::string path;
+  std::FILE *file;
+};
+
+/* ReplayFile
+   A replay file mapped into memory. Opening it walks the record headers to
+   find where each replay starts; the events are only read, by the system
+   paging them in, when a replay is played.
+ */
+class ReplayFile
+{
+public:
+  // Throws ReplayError if the file cannot be mapped or is damaged.
+  explicit ReplayFile(const std::string &path);
+  ~ReplayFile();
+
+  std::size_t size() const
+  {
+    return offsets.size();
+  }
+  ReplayView get(std::size_t i) const;
+  const std::string& getPath() const
+  {
+    return path;
+  }
+  std::size_t getBytes() const
+  {
+    return bytes;
+  }
+private:
+  ReplayFile(const ReplayFile&) = delete; // Uncopyable
+
+  std::string path;
+  void *base;
+  std::size_t bytes,recordSize;
+  std::vector<std::size_t> offsets;
+};
+
+/* ReplayPlayer
+   Shows a replay at any frame, on a game of the replay's tick rate and
+   auto-repeat. Seeking loads the nearest keyframe at or before the frame,
+   skipping holes, or starts again, and plays the frames from there; a seek
+   forward that the keyframe would not shorten just plays on.
+ */
+class ReplayPlayer
+{
+public:
+  // Throws ReplayError as ReplayView::configure.
+  explicit ReplayPlayer(const ReplayView &);
+
+  // Go to a frame, at most getFrames(). Throws ReplayError if the replay is
+  // malformed.
+  void seek(std::uint32_t frame);
+  // Play up to frames more frames and return how many were played: fewer
+  // at the end of the replay.
+  std::uint32_t advance(std::uint32_t frames);
+
+  std::uint32_t getFrame() const
+  {
+    return game.getFrame();
+  }
+  std::uint32_t getFrames() const
+  {
+    return replay.frames;
+  }
+  const HeadlessGame& getGame() const
+  {
+    return game;
+  }
+private:
+  ReplayPlayer(const ReplayPlayer&) = delete; // Uncopyable
+
+  ReplayView replay;
+  HeadlessGame game;
+  ReplayCursor cursor;
+  PieceInput inputs[ReplayCursor::MAX_INPUTS];
+};
+
+#endif // REPLAY_HPP
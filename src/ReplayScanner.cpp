@@ -0,0 +1,350 @@
+#include "ReplayScanner.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <ostream>
+
+std::unique_ptr<Aggregate> Aggregate::create(const std::string &name)
+{
+  if("holes"==name)
+    {
+      return std::unique_ptr<Aggregate>(new HoleAggregate);
+    }
+  if("speed"==name)
+    {
+      return std::unique_ptr<Aggregate>(new SpeedAggregate);
+    }
+  if("clears"==name)
+    {
+      return std::unique_ptr<Aggregate>(new ClearAggregate);
+    }
+  if("height"==name)
+    {
+      return std::unique_ptr<Aggregate>(new HeightAggregate);
+    }
+  return std::unique_ptr<Aggregate>();
+}
+
+std::unique_ptr<Aggregate> HoleAggregate::fresh() const
+{
+  return std::unique_ptr<Aggregate>(new HoleAggregate);
+}
+
+void HoleAggregate::merge(const Aggregate &a)
+{
+  const HoleAggregate &other=static_cast<const HoleAggregate&>(a);
+  counts.resize(std::max(counts.size(),other.counts.size()));
+  for(std::size_t i=0;i<other.counts.size();++i)
+    {
+      counts[i]+=other.counts[i];
+    }
+}
+
+void HoleAggregate::write(std::ostream &out) const
+{
+  out << "holes at game over: holes games" << std::endl;
+  for(std::size_t i=0;i<counts.size();++i)
+    {
+      if(counts[i])
+	{
+	  out << i << ' ' << counts[i] << std::endl;
+	}
+    }
+}
+
+void HoleAggregate::end(const HeadlessGame &game, const ReplayView &)
+{
+  if(!game.isGameOver())
+    {
+      return;
+    }
+  // Empty cells with a block somewhere above them.
+  unsigned holes=0,above=0;
+  for(int y=FIELD_HEIGHT-1;y>=0;--y)
+    {
+      const unsigned row=game.getField().getRow(y);
+      holes+=__builtin_popcount(above & ~row);
+      above|=row;
+    }
+  if(holes>=counts.size())
+    {
+      counts.resize(holes+1);
+    }
+  ++counts[holes];
+}
+
+std::unique_ptr<Aggregate> SpeedAggregate::fresh() const
+{
+  return std::unique_ptr<Aggregate>(new SpeedAggregate);
+}
+
+void SpeedAggregate::merge(const Aggregate &a)
+{
+  const SpeedAggregate &other=static_cast<const SpeedAggregate&>(a);
+  levels.resize(std::max(levels.size(),other.levels.size()));
+  for(std::size_t i=0;i<other.levels.size();++i)
+    {
+      levels[i].pieces+=other.levels[i].pieces;
+      for(const auto &f : other.levels[i].frames)
+	{
+	  levels[i].frames[f.first]+=f.second;
+	}
+    }
+}
+
+void SpeedAggregate::write(std::ostream &out) const
+{
+  out << "speed by level: level pieces pieces/s" << std::endl;
+  for(std::size_t i=0;i<levels.size();++i)
+    {
+      double seconds=0;
+      for(const auto &f : levels[i].frames)
+	{
+	  seconds+=(double)f.second/f.first;
+	}
+      if(seconds>0)
+	{
+	  out << i << ' ' << levels[i].pieces << ' ' << levels[i].pieces/seconds << std::endl;
+	}
+    }
+}
+
+void SpeedAggregate::lock(const HeadlessGame &game, unsigned pieces, unsigned)
+{
+  const std::size_t level=game.getField().readScore()/10;
+  if(level>=levels.size())
+    {
+      levels.resize(level+1);
+    }
+  levels[level].pieces+=pieces;
+  levels[level].frames[game.getTickRate()]+=game.getFrame()-lastFrame;
+  lastFrame=game.getFrame();
+}
+
+void SpeedAggregate::end(const HeadlessGame &, const ReplayView &)
+{
+  lastFrame=0;
+}
+
+std::unique_ptr<Aggregate> ClearAggregate::fresh() const
+{
+  return std::unique_ptr<Aggregate>(new ClearAggregate);
+}
+
+void ClearAggregate::merge(const Aggregate &a)
+{
+  const ClearAggregate &other=static_cast<const ClearAggregate&>(a);
+  for(int i=0;i<5;++i)
+    {
+      counts[i]+=other.counts[i];
+    }
+}
+
+void ClearAggregate::write(std::ostream &out) const
+{
+  out << "line clears: lines locks" << std::endl;
+  for(int i=0;i<5;++i)
+    {
+      out << i << ' ' << counts[i] << std::endl;
+    }
+}
+
+void ClearAggregate::lock(const HeadlessGame &, unsigned, unsigned lines)
+{
+  ++counts[std::min(lines,4u)];
+}
+
+std::unique_ptr<Aggregate> HeightAggregate::fresh() const
+{
+  return std::unique_ptr<Aggregate>(new HeightAggregate);
+}
+
+void HeightAggregate::merge(const Aggregate &a)
+{
+  const HeightAggregate &other=static_cast<const HeightAggregate&>(a);
+  for(int i=0;i<=FIELD_HEIGHT;++i)
+    {
+      counts[i]+=other.counts[i];
+    }
+}
+
+void HeightAggregate::write(std::ostream &out) const
+{
+  out << "stack height: height frames" << std::endl;
+  for(int i=0;i<=FIELD_HEIGHT;++i)
+    {
+      if(counts[i])
+	{
+	  out << i << ' ' << counts[i] << std::endl;
+	}
+    }
+}
+
+void HeightAggregate::frame(const HeadlessGame &game)
+{
+  if(measured!=game.getPieceCount() || over!=game.isGameOver())
+    {
+      measured=game.getPieceCount();
+      over=game.isGameOver();
+      height=FIELD_HEIGHT;
+      while(height>0 && 0==game.getField().getRow(height-1))
+	{
+	  --height;
+	}
+    }
+  ++counts[height];
+}
+
+void HeightAggregate::end(const HeadlessGame &, const ReplayView &)
+{
+  measured=0;
+  over=false;
+}
+
+// A thread's share of a scan: its own copy of every aggregate, sorted by
+// the hooks they want.
+struct ScanThread
+{
+  std::vector<std::unique_ptr<Aggregate>> partials;
+  std::vector<Aggregate*> frame,lock,end;
+  ReplayScanner::Stats stats;
+  PieceInput inputs[ReplayCursor::MAX_INPUTS];
+
+  explicit ScanThread(const std::vector<Aggregate*> &aggregates):
+    partials(),frame(),lock(),end(),stats()
+  {
+    for(Aggregate *a : aggregates)
+      {
+	partials.push_back(a->fresh());
+	Aggregate *p=partials.back().get();
+	if(a->hooks() & Aggregate::FRAME)
+	  {
+	    frame.push_back(p);
+	  }
+	if(a->hooks() & Aggregate::LOCK)
+	  {
+	    lock.push_back(p);
+	  }
+	if(a->hooks() & Aggregate::END)
+	  {
+	    end.push_back(p);
+	  }
+      }
+  }
+
+  void play(const ReplayView &r)
+  {
+    HeadlessGame game(r.seed,r.kind);
+    ReplayCursor cursor(r);
+    bool malformed=false;
+    try
+      {
+	r.configure(game);
+	std::size_t count;
+	while(!game.isGameOver() && cursor.next(inputs,count))
+	  {
+	    const unsigned pieces=game.getPieceCount();
+	    const int score=game.getField().readScore();
+	    game.step(inputs,count);
+	    for(Aggregate *a : frame)
+	      {
+		a->frame(game);
+	      }
+	    // The piece that loses the game locks without a new one entering.
+	    const unsigned locked=game.getPieceCount()-pieces+(game.isGameOver() ? 1 : 0);
+	    if(locked)
+	      {
+		for(Aggregate *a : lock)
+		  {
+		    a->lock(game,locked,game.getField().readScore()-score);
+		  }
+	      }
+	  }
+      }
+    catch(ReplayError &)
+      {
+	malformed=true;
+      }
+    for(Aggregate *a : end)
+      {
+	a->end(game,r);
+      }
+    ++stats.replays;
+    stats.frames+=game.getFrame();
+    stats.pieces+=game.getPieceCount();
+    if(malformed || r.frames!=game.getFrame() || r.pieces!=game.getPieceCount()
+       || bool(r.flags & ReplayView::GAME_OVER)!=game.isGameOver())
+      {
+	++stats.desynced;
+      }
+  }
+};
+
+ReplayScanner::ReplayScanner(WorkerPool &p):
+  pool(p),files()
+{
+}
+
+ReplayScanner::~ReplayScanner()
+{
+}
+
+void ReplayScanner::add(const std::string &path)
+{
+  files.push_back(std::unique_ptr<ReplayFile>(new ReplayFile(path)));
+}
+
+std::size_t ReplayScanner::getReplays() const
+{
+  std::size_t ret=0;
+  for(const auto &f : files)
+    {
+      ret+=f->size();
+    }
+  return ret;
+}
+
+ReplayScanner::Stats ReplayScanner::scan(const std::vector<Aggregate*> &aggregates)
+{
+  const auto t0=std::chrono::steady_clock::now();
+  // Blocks never span files: the first block of every file, and one past the
+  // last.
+  std::vector<std::size_t> firstBlock(1,0);
+  for(const auto &f : files)
+    {
+      firstBlock.push_back(firstBlock.back()+(f->size()+BLOCK-1)/BLOCK);
+    }
+
+  std::vector<std::unique_ptr<ScanThread>> threads;
+  for(unsigned t=0;t<pool.size();++t)
+    {
+      threads.push_back(std::unique_ptr<ScanThread>(new ScanThread(aggregates)));
+    }
+  pool.runStealing(firstBlock.back(),[&](std::size_t b, unsigned t)
+		   {
+		     const std::size_t f=std::upper_bound(firstBlock.begin(),firstBlock.end(),b)
+		       -firstBlock.begin()-1;
+		     const ReplayFile &file=*files[f];
+		     const std::size_t begin=(b-firstBlock[f])*BLOCK;
+		     for(std::size_t i=begin;i<std::min(file.size(),begin+BLOCK);++i)
+		       {
+			 threads[t]->play(file.get(i));
+		       }
+		   });
+
+  Stats ret={0,0,0,0,0};
+  for(const auto &t : threads)
+    {
+      for(std::size_t i=0;i<aggregates.size();++i)
+	{
+	  aggregates[i]->merge(*t->partials[i]);
+	}
+      ret.replays+=t->stats.replays;
+      ret.frames+=t->stats.frames;
+      ret.pieces+=t->stats.pieces;
+      ret.desynced+=t->stats.desynced;
+    }
+  const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+  ret.seconds=elapsed.count();
+  return ret;
+}
@@ -0,0 +1,217 @@
+#ifndef REPLAYSCANNER_HPP
+#define REPLAYSCANNER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "HeadlessGame.hpp"
+#include "Replay.hpp"
+#include "WorkerPool.hpp"
+
+/* Aggregate
+   A statistic gathered over many replays, such as a histogram. The scanner
+   gives every thread its own empty copy from fresh(), feeds it the games
+   that thread plays, and merges the copies into the original at the end, so
+   the hooks need no locking and the result does not depend on the number of
+   threads.
+
+   The hooks see the game after the frame has been stepped. Only the hooks
+   named by hooks() are called; calling frame for every frame of every game
+   costs far more than the others.
+ */
+class Aggregate
+{
+public:
+  enum Hooks
+    {
+      FRAME=1,
+      LOCK=2,
+      END=4
+    };
+
+  virtual ~Aggregate()
+  {}
+
+  virtual const char* name() const = 0;
+  virtual unsigned hooks() const = 0;
+  // An empty aggregate of the same kind and settings.
+  virtual std::unique_ptr<Aggregate> fresh() const = 0;
+  // Add another aggregate of the same kind to this one.
+  virtual void merge(const Aggregate &) = 0;
+  virtual void write(std::ostream &) const = 0;
+
+  // After every frame.
+  virtual void frame(const HeadlessGame &)
+  {}
+  // After a frame in which pieces locked, how many and the lines they
+  // cleared.
+  virtual void lock(const HeadlessGame &, unsigned, unsigned)
+  {}
+  // After the last frame of a replay, or the frame that lost the game.
+  virtual void end(const HeadlessGame &, const ReplayView &)
+  {}
+
+  // One of the aggregates below by name: holes, speed, clears or height.
+  // Returns an empty pointer for any other name.
+  static std::unique_ptr<Aggregate> create(const std::string &name);
+};
+
+/* HoleAggregate
+   The number of holes in the field of every game that was lost, as a
+   histogram.
+ */
+class HoleAggregate : public Aggregate
+{
+public:
+  const char* name() const
+  {
+    return "holes";
+  }
+  unsigned hooks() const
+  {
+    return END;
+  }
+  std::unique_ptr<Aggregate> fresh() const;
+  void merge(const Aggregate &);
+  void write(std::ostream &) const;
+  void end(const HeadlessGame &, const ReplayView &);
+
+  const std::vector<std::uint64_t>& getCounts() const
+  {
+    return counts;
+  }
+private:
+  std::vector<std::uint64_t> counts;
+};
+
+/* SpeedAggregate
+   Pieces per second, by level, at each replay's tick rate. The game's
+   gravity never changes, so the level is the lines cleared so far divided
+   by ten, as in most games that have levels. A piece counts at the level it
+   locked at, over the time since the piece before it locked.
+ */
+class SpeedAggregate : public Aggregate
+{
+public:
+  const char* name() const
+  {
+    return "speed";
+  }
+  unsigned hooks() const
+  {
+    return LOCK|END;
+  }
+  std::unique_ptr<Aggregate> fresh() const;
+  void merge(const Aggregate &);
+  void write(std::ostream &) const;
+  void lock(const HeadlessGame &, unsigned pieces, unsigned lines);
+  void end(const HeadlessGame &, const ReplayView &);
+private:
+  // Pieces, and frames by tick rate, at each level. Counts are whole, so
+  // merging them in any order gives the same result; they become seconds
+  // only in write.
+  struct Level
+  {
+    std::uint64_t pieces=0;
+    std::map<unsigned,std::uint64_t> frames;
+  };
+  std::vector<Level> levels;
+  unsigned lastFrame=0;
+};
+
+/* ClearAggregate
+   How many frames locked pieces clearing no lines, a single, a double, a
+   triple and a tetris.
+ */
+class ClearAggregate : public Aggregate
+{
+public:
+  const char* name() const
+  {
+    return "clears";
+  }
+  unsigned hooks() const
+  {
+    return LOCK;
+  }
+  std::unique_ptr<Aggregate> fresh() const;
+  void merge(const Aggregate &);
+  void write(std::ostream &) const;
+  void lock(const HeadlessGame &, unsigned pieces, unsigned lines);
+private:
+  std::uint64_t counts[5]={0,0,0,0,0};
+};
+
+/* HeightAggregate
+   The frames spent at every stack height, as a histogram: a per-frame
+   aggregate. The field only changes when a piece locks, so the height is
+   measured again only then.
+ */
+class HeightAggregate : public Aggregate
+{
+public:
+  const char* name() const
+  {
+    return "height";
+  }
+  unsigned hooks() const
+  {
+    return FRAME|END;
+  }
+  std::unique_ptr<Aggregate> fresh() const;
+  void merge(const Aggregate &);
+  void write(std::ostream &) const;
+  void frame(const HeadlessGame &);
+  void end(const HeadlessGame &, const ReplayView &);
+private:
+  std::uint64_t counts[FIELD_HEIGHT+1]={0};
+  // The height, and the pieces and game over flag it was measured with.
+  int height=0;
+  unsigned measured=0;
+  bool over=false;
+};
+
+/* ReplayScanner
+   Plays every replay in a set of replay files again on a headless game and
+   feeds the games to aggregates. The files are mapped, not read, and the
+   replays are shared out between the pool's threads a block at a time.
+
+   A replay whose game does not end with the frame and piece counts stored
+   with it, or whose events are malformed, is counted as out of sync and
+   still aggregated as far as it went.
+ */
+class ReplayScanner
+{
+public:
+  struct Stats
+  {
+    std::uint64_t replays,frames,pieces,desynced;
+    double seconds;
+  };
+
+  // Replays played by one task.
+  static constexpr std::size_t BLOCK=64;
+
+  explicit ReplayScanner(WorkerPool &);
+  ~ReplayScanner();
+
+  // Map a file. Throws ReplayError.
+  void add(const std::string &path);
+  std::size_t getReplays() const;
+
+  // Play every replay, aggregating into the given aggregates, and return
+  // the totals.
+  Stats scan(const std::vector<Aggregate*> &);
+private:
+  ReplayScanner(const ReplayScanner&) = delete; // Uncopyable
+
+  WorkerPool &pool;
+  std::vector<std::unique_ptr<ReplayFile>> files;
+};
+
+#endif // REPLAYSCANNER_HPP
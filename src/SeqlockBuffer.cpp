@@ -0,0 +1,15 @@
+#include "SeqlockBuffer.hpp"
+
+void SeqlockBuffer::write(const Field &field_, const Piece &cur, const Piece *holdp)
+{
+  DataBuffer frame;
+
+  frame.field=field_;
+  frame.current=cur;
+  if(nullptr!=holdp)
+    {
+      frame.hold=*holdp;
+      frame.holding=true;
+    }
+  Seqlock<DataBuffer>::write(frame);
+}
@@ -0,0 +1,136 @@
+#ifndef SEQLOCKBUFFER_HPP
+#define SEQLOCKBUFFER_HPP
+
+#include <atomic>
+
+#include "DataDoubleBuffer.hpp"
+
+/* Seqlock
+   A single slot written by exactly one thread and read by any number of
+   threads. The writer never waits: it bumps the sequence number to an odd
+   value, copies the new value in, and bumps the sequence back to even.
+
+   Readers never write to the slot. Each reader copies the value out and then
+   re-checks the sequence number; if the writer was active during the copy the
+   read was torn and the reader simply tries again. The number of retries is
+   tracked per Reader, so readers do not contend with each other or with the
+   writer on any shared counter.
+
+   T is copied while the writer may be modifying it, so T must be safe to copy
+   in a torn state (plain data, no owning pointers). Torn copies are always
+   discarded before they are returned.
+ */
+template <class T>
+class Seqlock
+{
+public:
+  Seqlock():sequence(0),data()
+  {}
+
+  // Publish a new value. Only one thread may call write.
+  void write(const T &value)
+  {
+    const unsigned s=sequence.load(std::memory_order_relaxed);
+    sequence.store(s+1,std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    data=value;
+    sequence.store(s+2,std::memory_order_release);
+  }
+  // Number of completed writes.
+  unsigned version() const
+  {
+    return sequence.load(std::memory_order_acquire)/2;
+  }
+  // Attempt a single read. Returns false if the copy may be torn.
+  bool try_read(T &out, unsigned &ver) const
+  {
+    const unsigned s0=sequence.load(std::memory_order_acquire);
+    if(s0 & 1)
+      {
+	return false;
+      }
+    out=data;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const unsigned s1=sequence.load(std::memory_order_relaxed);
+    ver=s0/2;
+    return s0==s1;
+  }
+
+  /* Reader
+     Holds a private copy of the most recent consistent value. A Reader must
+     only be used by one thread; create one Reader per consumer.
+   */
+  class Reader
+  {
+  public:
+    explicit Reader(const Seqlock &s):source(&s),local(),lastVersion(0),
+				      retryCount(0),readCount(0)
+    {}
+
+    // Copy out the most recent value, retrying until the copy is consistent.
+    const T& read()
+    {
+      T scratch;
+      unsigned ver;
+      while(!source->try_read(scratch,ver))
+	{
+	  ++retryCount;
+	}
+      local=scratch;
+      lastVersion=ver;
+      ++readCount;
+      return local;
+    }
+    // Returns true if the writer has published since the last read.
+    bool stale() const
+    {
+      return source->version()!=lastVersion;
+    }
+    // The value returned by the last read.
+    const T& last() const
+    {
+      return local;
+    }
+    unsigned version() const
+    {
+      return lastVersion;
+    }
+    unsigned long retries() const
+    {
+      return retryCount;
+    }
+    unsigned long reads() const
+    {
+      return readCount;
+    }
+  private:
+    const Seqlock *source;
+    T local;
+    unsigned lastVersion;
+    unsigned long retryCount,readCount;
+  };
+
+private:
+  Seqlock(const Seqlock&) = delete; // Uncopyable
+  // Keep the slot off cache lines shared with unrelated data.
+  alignas(64) std::atomic<unsigned> sequence;
+  T data;
+};
+
+/* SeqlockBuffer
+   Drop-in alternative to DataDoubleBuffer for one game thread and many
+   renderers. Use RenderFunc<SeqlockBuffer> with &SeqlockBuffer::write as the
+   game's render callback, and give each rendering thread its own
+   SeqlockBuffer::Reader.
+ */
+class SeqlockBuffer : public Seqlock<DataBuffer>
+{
+public:
+  SeqlockBuffer():Seqlock<DataBuffer>()
+  {}
+
+  using Seqlock<DataBuffer>::write;
+  void write(const Field &, const Piece &, const Piece *);
+};
+
+#endif // SEQLOCKBUFFER_HPP
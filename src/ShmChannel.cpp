@@ -0,0 +1,188 @@
+#include "ShmChannel.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_INT_LOCK_FREE == 2,"Shared memory channel requires lock-free atomics.");
+
+// Size of the header, rounded up so that the slots stay cache line aligned.
+static constexpr std::size_t headerSize=(sizeof(ShmHeader)+alignof(ShmSlot)-1)
+  / alignof(ShmSlot) * alignof(ShmSlot);
+
+static std::string shmPath(const std::string &name)
+{
+  return ('/'==name[0]) ? name : "/"+name;
+}
+
+static std::string errnoString(const std::string &what)
+{
+  return what+": "+std::strerror(errno);
+}
+
+// ShmPublisher
+
+ShmPublisher::ShmPublisher(const std::string &name, unsigned slotCount):
+  path(shmPath(name)),size(headerSize+slotCount*sizeof(ShmSlot)),
+  base(nullptr),header(nullptr),slots(nullptr)
+{
+  if(0==slotCount)
+    {
+      throw ShmError("slot count must be positive");
+    }
+  int fd=shm_open(path.c_str(),O_CREAT|O_RDWR|O_TRUNC,0644);
+  if(-1==fd)
+    {
+      throw ShmError(errnoString("shm_open "+path));
+    }
+  if(-1==ftruncate(fd,size))
+    {
+      const std::string err=errnoString("ftruncate "+path);
+      close(fd);
+      shm_unlink(path.c_str());
+      throw ShmError(err);
+    }
+  base=mmap(nullptr,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if(MAP_FAILED==base)
+    {
+      const std::string err=errnoString("mmap "+path);
+      shm_unlink(path.c_str());
+      throw ShmError(err);
+    }
+
+  header=new(base) ShmHeader;
+  header->version=ShmHeader::VERSION;
+  header->slotCount=slotCount;
+  header->slotSize=sizeof(ShmSlot);
+  header->generation.store(0,std::memory_order_relaxed);
+  slots=static_cast<ShmSlot*>(static_cast<void*>(static_cast<char*>(base)+headerSize));
+  for(unsigned i=0;i<slotCount;++i)
+    {
+      new(&slots[i]) ShmSlot();
+    }
+  // Viewers check the magic number last.
+  std::atomic_thread_fence(std::memory_order_release);
+  header->magic=ShmHeader::MAGIC;
+}
+
+ShmPublisher::~ShmPublisher()
+{
+  munmap(base,size);
+  shm_unlink(path.c_str());
+}
+
+void ShmPublisher::write(const FrameSnapshot &snap)
+{
+  const std::uint32_t gen=header->generation.load(std::memory_order_relaxed);
+  slots[gen%header->slotCount].write(snap);
+  header->generation.store(gen+1,std::memory_order_release);
+}
+
+// ShmViewer
+
+constexpr std::chrono::milliseconds ShmViewer::WRITER_TIMEOUT;
+
+ShmViewer::ShmViewer(const std::string &name):
+  size(0),base(nullptr),header(nullptr),slots(nullptr),retryCount(0),writerStalled(false)
+{
+  const std::string path=shmPath(name);
+  struct stat st;
+  int fd=shm_open(path.c_str(),O_RDONLY,0);
+  if(-1==fd)
+    {
+      throw ShmError(errnoString("shm_open "+path));
+    }
+  if(-1==fstat(fd,&st))
+    {
+      const std::string err=errnoString("fstat "+path);
+      close(fd);
+      throw ShmError(err);
+    }
+  size=st.st_size;
+  if(size<headerSize)
+    {
+      close(fd);
+      throw ShmError(path+" is too small");
+    }
+  base=mmap(nullptr,size,PROT_READ,MAP_SHARED,fd,0);
+  close(fd);
+  if(MAP_FAILED==base)
+    {
+      throw ShmError(errnoString("mmap "+path));
+    }
+
+  header=static_cast<const ShmHeader*>(base);
+  const bool valid=ShmHeader::MAGIC==header->magic;
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if(!valid || ShmHeader::VERSION!=header->version ||
+     sizeof(ShmSlot)!=header->slotSize || 0==header->slotCount ||
+     size<headerSize+header->slotCount*sizeof(ShmSlot))
+    {
+      munmap(const_cast<void*>(base),size);
+      throw ShmError(path+" is not a frame channel");
+    }
+  slots=static_cast<const ShmSlot*>(static_cast<const void*>(static_cast<const char*>(base)+headerSize));
+}
+
+ShmViewer::~ShmViewer()
+{
+  munmap(const_cast<void*>(base),size);
+}
+
+std::uint32_t ShmViewer::generation() const
+{
+  return header->generation.load(std::memory_order_acquire);
+}
+
+bool ShmViewer::readLatest(FrameSnapshot &out)
+{
+  while(true)
+    {
+      const std::uint32_t gen=generation();
+      if(0==gen)
+	{
+	  return false;
+	}
+      if(read(gen-1,out))
+	{
+	  return true;
+	}
+      if(writerStalled)
+	{
+	  return false;
+	}
+      // The writer lapped us between loading the generation and the copy.
+    }
+}
+
+bool ShmViewer::read(std::uint32_t gen, FrameSnapshot &out)
+{
+  const std::uint32_t count=header->slotCount;
+  const ShmSlot &slot=slots[gen%count];
+  unsigned ver;
+
+  if(gen>=generation())
+    {
+      return false;
+    }
+  writerStalled=false;
+  const auto start=std::chrono::steady_clock::now();
+  for(unsigned spins=1;!slot.try_read(out,ver);++spins)
+    {
+      ++retryCount;
+      // Only look at the clock now and then; a write takes far less.
+      if(0==spins%1024 && std::chrono::steady_clock::now()-start>WRITER_TIMEOUT)
+	{
+	  writerStalled=true;
+	  return false;
+	}
+    }
+  // Slot gen%count has been written once for every lap of the ring.
+  return ver==gen/count+1;
+}
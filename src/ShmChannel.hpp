@@ -0,0 +1,99 @@
+#ifndef SHMCHANNEL_HPP
+#define SHMCHANNEL_HPP
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+
+#include "SeqlockBuffer.hpp"
+#include "FrameSnapshot.hpp"
+
+/* Shared memory frame channel
+   A game publishes FrameSnapshots into a POSIX shared memory object so that
+   viewers and recorders in other processes can follow it without sockets and
+   without the game ever waiting on them. A viewer maps the object read-only,
+   so a crashing or misbehaving viewer cannot disturb the game.
+
+   The object holds a ShmHeader followed by a ring of Seqlock slots. Frame
+   number g (counting from zero) is written to slot g%slotCount, and the
+   header's generation counter is then advanced to g+1. A viewer reads the
+   generation, picks the matching slot and copies it out, retrying if the
+   slot's seqlock reports a torn read. A slow viewer that falls more than
+   slotCount frames behind will find its frame overwritten and can skip ahead.
+   A game that dies in the middle of a write leaves its slot torn for good,
+   so a viewer gives up on a slot after WRITER_TIMEOUT and reports it.
+ */
+struct ShmHeader
+{
+  static constexpr std::uint32_t MAGIC=0x54545346; // "FSTT"
+  static constexpr std::uint32_t VERSION=1;
+
+  std::uint32_t magic, version, slotCount, slotSize;
+  // Number of frames published so far.
+  alignas(64) std::atomic<std::uint32_t> generation;
+};
+
+typedef Seqlock<FrameSnapshot> ShmSlot;
+
+class ShmPublisher
+{
+public:
+  // Create (or replace) the shared memory object /name. Throws ShmError.
+  ShmPublisher(const std::string &name, unsigned slots=DEFAULT_SLOTS);
+  // Unmaps and unlinks the object. Attached viewers keep their mapping.
+  ~ShmPublisher();
+
+  // Publish one frame. Never blocks. May be used with SnapshotFunc.
+  void write(const FrameSnapshot &);
+
+  static constexpr unsigned DEFAULT_SLOTS=64;
+private:
+  ShmPublisher(const ShmPublisher&) = delete; // Uncopyable
+  std::string path;
+  std::size_t size;
+  void *base;
+  ShmHeader *header;
+  ShmSlot *slots;
+};
+
+class ShmViewer
+{
+public:
+  // Attach read-only to the object /name. Throws ShmError if it does not
+  // exist or was not created by a compatible ShmPublisher.
+  explicit ShmViewer(const std::string &name);
+  ~ShmViewer();
+
+  // Number of frames published so far.
+  std::uint32_t generation() const;
+  static constexpr std::chrono::milliseconds WRITER_TIMEOUT{100};
+
+  // Copy the most recent frame. Returns false if nothing has been published,
+  // or if the writer stalled.
+  bool readLatest(FrameSnapshot &);
+  // Copy frame number gen. Returns false if it has not been published yet,
+  // has already been overwritten, or stayed torn for WRITER_TIMEOUT.
+  bool read(std::uint32_t gen, FrameSnapshot &);
+  // Whether the last read gave up on a torn slot: the writer died in the
+  // middle of a frame.
+  bool stalled() const
+  {
+    return writerStalled;
+  }
+  // Torn reads retried by this viewer.
+  unsigned long retries() const
+  {
+    return retryCount;
+  }
+private:
+  ShmViewer(const ShmViewer&) = delete; // Uncopyable
+  std::size_t size;
+  const void *base;
+  const ShmHeader *header;
+  const ShmSlot *slots;
+  unsigned long retryCount;
+  bool writerStalled;
+};
+
+#endif // SHMCHANNEL_HPP
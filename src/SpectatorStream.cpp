@@ -0,0 +1,447 @@
+#include "SpectatorStream.hpp"
+
+#include <bitset>
+#include <cstring>
+
+using namespace SpectatorStream;
+using NetProtocol::put;
+using NetProtocol::get;
+
+// The rows of a snapshot after removing the rows in mask, with the rows
+// above falling into their place.
+static void removeRows(const FrameSnapshot &snap, std::uint32_t mask, unsigned rows[FIELD_HEIGHT])
+{
+  int k=0;
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      if(!(mask & (1u<<y)))
+	{
+	  rows[k++]=snap.row(y);
+	}
+    }
+  while(k<FIELD_HEIGHT)
+    {
+      rows[k++]=0;
+    }
+}
+
+static unsigned countChanged(const unsigned rows[FIELD_HEIGHT], const FrameSnapshot &cur)
+{
+  unsigned ret=0;
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      ret+=(rows[y]!=cur.row(y));
+    }
+  return ret;
+}
+
+/* Find the rows of prev which a line clear removed on the way to cur, or 0 if
+   there was no clear. The score counts cleared lines, so its change says how
+   many rows went; a cleared row must have been at most one piece (four
+   blocks) short of full in prev. Of the possible sets of rows, pick the one
+   which leaves the fewest rows to send. Getting this wrong costs bandwidth,
+   never correctness: ROWS fixes up whatever the clear does not explain.
+ */
+static std::uint32_t findClear(const FrameSnapshot &prev, const FrameSnapshot &cur)
+{
+  const int lines=cur.score-prev.score;
+  if(lines<1 || lines>4)
+    {
+      return 0;
+    }
+  int candidates[FIELD_HEIGHT],n=0;
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      if(std::bitset<32>(prev.row(y)).count()+4>=FIELD_WIDTH)
+	{
+	  candidates[n++]=y;
+	}
+    }
+  if(n<lines)
+    {
+      return 0;
+    }
+
+  unsigned rows[FIELD_HEIGHT];
+  std::uint32_t best=0;
+  removeRows(prev,0,rows);
+  unsigned bestCost=countChanged(rows,cur);
+  // Visit every combination of lines candidates in lexicographic order.
+  int idx[4];
+  for(int i=0;i<lines;++i)
+    {
+      idx[i]=i;
+    }
+  while(bestCost>0)
+    {
+      std::uint32_t mask=0;
+      for(int i=0;i<lines;++i)
+	{
+	  mask|=1u<<candidates[idx[i]];
+	}
+      removeRows(prev,mask,rows);
+      const unsigned cost=countChanged(rows,cur);
+      if(cost<bestCost)
+	{
+	  best=mask;
+	  bestCost=cost;
+	}
+      int i=lines-1;
+      while(i>=0 && idx[i]==n-lines+i)
+	{
+	  --i;
+	}
+      if(i<0)
+	{
+	  break;
+	}
+      ++idx[i];
+      for(int j=i+1;j<lines;++j)
+	{
+	  idx[j]=idx[j-1]+1;
+	}
+    }
+  return best;
+}
+
+static void putPiece(NetProtocol::Buffer &out, const FrameSnapshot &snap)
+{
+  put(out,snap.type,1);
+  put(out,snap.orientation,1);
+  put(out,(std::uint8_t)snap.x,1);
+  put(out,(std::uint8_t)snap.y,1);
+}
+
+static void putState(NetProtocol::Buffer &out, const FrameSnapshot &snap)
+{
+  put(out,snap.next,1);
+  put(out,snap.hold,1);
+  put(out,snap.flags,1);
+}
+
+SpectatorEncoder::SpectatorEncoder(unsigned keyInterval_):
+  keyInterval(keyInterval_ ? keyInterval_ : 1),sinceKey(0),started(false),
+  prev(),prevStamp(0),message(),keyCount(0),deltaCount(0)
+{
+  std::memset(&prev,0,sizeof(prev));
+  message.reserve(NetProtocol::HEADER_SIZE+1+4+4+2*FIELD_HEIGHT+1+4+4+3);
+}
+
+void SpectatorEncoder::reset()
+{
+  started=false;
+}
+
+const NetProtocol::Buffer& SpectatorEncoder::encode(const FrameSnapshot &cur, std::uint64_t stamp)
+{
+  if(!started || ++sinceKey>=keyInterval)
+    {
+      putKey(cur,stamp);
+    }
+  else
+    {
+      putDelta(cur,stamp);
+    }
+  prev=cur;
+  prevStamp=stamp;
+  started=true;
+  return message;
+}
+
+const NetProtocol::Buffer& SpectatorEncoder::keyframe()
+{
+  putKey(prev,prevStamp);
+  return message;
+}
+
+void SpectatorEncoder::putKey(const FrameSnapshot &cur, std::uint64_t stamp)
+{
+  NetProtocol::MessageHeader h;
+  h.length=KEY_BODY;
+  h.type=NetProtocol::SPECTATE_KEY;
+  h.frame=cur.frame;
+  h.stamp=stamp;
+  message.clear();
+  NetProtocol::putHeader(message,h);
+  for(unsigned i=0;i<FrameSnapshot::ROW_WORDS;++i)
+    {
+      put(message,cur.rows[i],4);
+    }
+  putPiece(message,cur);
+  putState(message,cur);
+  put(message,0,1);
+  put(message,(std::uint32_t)cur.score,4);
+  sinceKey=0;
+  ++keyCount;
+}
+
+void SpectatorEncoder::putDelta(const FrameSnapshot &cur, std::uint64_t stamp)
+{
+  const std::uint32_t cleared=findClear(prev,cur);
+  unsigned rows[FIELD_HEIGHT];
+  std::uint32_t changed=0;
+  removeRows(prev,cleared,rows);
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      if(rows[y]!=cur.row(y))
+	{
+	  changed|=1u<<y;
+	}
+    }
+  const int dx=cur.x-prev.x, dy=cur.y-prev.y;
+  const bool samePiece=cur.type==prev.type && cur.orientation==prev.orientation;
+  unsigned parts=0;
+  if(cleared)
+    parts|=CLEARED;
+  if(changed)
+    parts|=ROWS;
+  if(samePiece && (dx || dy) && dx>=-8 && dx<=7 && dy>=-8 && dy<=7)
+    parts|=MOVE;
+  else if(!samePiece || dx || dy)
+    parts|=PIECE;
+  if(cur.score!=prev.score)
+    parts|=SCORE;
+  if(cur.next!=prev.next || cur.hold!=prev.hold || cur.flags!=prev.flags)
+    parts|=STATE;
+
+  NetProtocol::MessageHeader h;
+  h.length=0; // patched below
+  h.type=NetProtocol::SPECTATE_DELTA;
+  h.frame=cur.frame;
+  h.stamp=stamp;
+  message.clear();
+  NetProtocol::putHeader(message,h);
+  put(message,parts,1);
+  if(parts & CLEARED)
+    {
+      put(message,cleared,4);
+    }
+  if(parts & ROWS)
+    {
+      put(message,changed,4);
+      for(int y=0;y<FIELD_HEIGHT;++y)
+	{
+	  if(changed & (1u<<y))
+	    {
+	      put(message,cur.row(y),2);
+	    }
+	}
+    }
+  if(parts & MOVE)
+    {
+      put(message,(dx & 0xf) | ((dy & 0xf)<<4),1);
+    }
+  if(parts & PIECE)
+    {
+      putPiece(message,cur);
+    }
+  if(parts & SCORE)
+    {
+      put(message,(std::uint32_t)cur.score,4);
+    }
+  if(parts & STATE)
+    {
+      putState(message,cur);
+    }
+  const std::size_t length=message.size()-NetProtocol::HEADER_SIZE;
+  message[0]=(char)length;
+  message[1]=(char)(length>>8);
+  ++deltaCount;
+}
+
+SpectatorView::SpectatorView():state(),sync(false),fieldDirty(false),field()
+{
+  std::memset(&state,0,sizeof(state));
+}
+
+bool SpectatorView::apply(const NetProtocol::MessageHeader &h, const char *body, std::size_t size)
+{
+  bool ok;
+  if(NetProtocol::SPECTATE_KEY==h.type)
+    {
+      ok=applyKey(body,size);
+    }
+  else if(NetProtocol::SPECTATE_DELTA==h.type)
+    {
+      if(!sync)
+	{
+	  return true;
+	}
+      ok=applyDelta(body,size);
+    }
+  else
+    {
+      return true;
+    }
+  sync=ok;
+  state.frame=h.frame;
+  return ok;
+}
+
+// Both return false, and leave state alone, for a piece type out of range,
+// which would index past the shapes of a Piece made from the view.
+static bool getPiece(const char *in, FrameSnapshot &state)
+{
+  if(get(in,1)>=7)
+    {
+      return false;
+    }
+  state.type=get(in,1);
+  state.orientation=get(in+1,1)%4;
+  state.x=(std::int8_t)get(in+2,1);
+  state.y=(std::int8_t)get(in+3,1);
+  return true;
+}
+
+static bool getState(const char *in, FrameSnapshot &state)
+{
+  if(get(in,1)>=7 || get(in+1,1)>=7)
+    {
+      return false;
+    }
+  state.next=get(in,1);
+  state.hold=get(in+1,1);
+  state.flags=get(in+2,1);
+  return true;
+}
+
+bool SpectatorView::applyKey(const char *in, std::size_t size)
+{
+  if(KEY_BODY!=size)
+    {
+      return false;
+    }
+  const char *tail=in+4*FrameSnapshot::ROW_WORDS;
+  if(!getPiece(tail,state) || !getState(tail+4,state))
+    {
+      return false;
+    }
+  for(unsigned i=0;i<FrameSnapshot::ROW_WORDS;++i)
+    {
+      state.rows[i]=get(in+4*i,4);
+    }
+  state.score=(std::int32_t)get(tail+8,4);
+  fieldDirty=true;
+  return true;
+}
+
+bool SpectatorView::applyDelta(const char *in, std::size_t size)
+{
+  if(size<1)
+    {
+      return false;
+    }
+  const unsigned parts=(unsigned char)in[0];
+  std::size_t pos=1;
+  if(parts & ~(CLEARED|ROWS|MOVE|PIECE|SCORE|STATE))
+    {
+      return false;
+    }
+  if(parts & (CLEARED|ROWS))
+    {
+      fieldDirty=true;
+    }
+  if(parts & CLEARED)
+    {
+      if(pos+4>size)
+	{
+	  return false;
+	}
+      unsigned rows[FIELD_HEIGHT];
+      removeRows(state,get(in+pos,4),rows);
+      for(int y=0;y<FIELD_HEIGHT;++y)
+	{
+	  state.setRow(y,rows[y]);
+	}
+      pos+=4;
+    }
+  if(parts & ROWS)
+    {
+      if(pos+4>size)
+	{
+	  return false;
+	}
+      const std::uint32_t changed=get(in+pos,4);
+      pos+=4;
+      if(changed>>FIELD_HEIGHT)
+	{
+	  return false;
+	}
+      for(int y=0;y<FIELD_HEIGHT;++y)
+	{
+	  if(changed & (1u<<y))
+	    {
+	      if(pos+2>size)
+		{
+		  return false;
+		}
+	      state.setRow(y,get(in+pos,2));
+	      pos+=2;
+	    }
+	}
+    }
+  if(parts & MOVE)
+    {
+      if(pos+1>size)
+	{
+	  return false;
+	}
+      const int move=(unsigned char)in[pos++];
+      // Sign-extend the nibbles.
+      state.x+=((move & 0xf) ^ 0x8)-0x8;
+      state.y+=((move>>4) ^ 0x8)-0x8;
+    }
+  if(parts & PIECE)
+    {
+      if(pos+4>size || !getPiece(in+pos,state))
+	{
+	  return false;
+	}
+      pos+=4;
+    }
+  if(parts & SCORE)
+    {
+      if(pos+4>size)
+	{
+	  return false;
+	}
+      state.score=(std::int32_t)get(in+pos,4);
+      pos+=4;
+    }
+  if(parts & STATE)
+    {
+      if(pos+3>size || !getState(in+pos,state))
+	{
+	  return false;
+	}
+      pos+=3;
+    }
+  return pos==size;
+}
+
+const Field& SpectatorView::getField() const
+{
+  if(fieldDirty)
+    {
+      field.resetBlocks();
+      for(int y=0;y<FIELD_HEIGHT;++y)
+	{
+	  const unsigned row=state.row(y);
+	  for(int x=0;x<FIELD_WIDTH;++x)
+	    {
+	      if(row & (1u<<x))
+		{
+		  field.set(x,y);
+		}
+	    }
+	}
+      fieldDirty=false;
+    }
+  return field;
+}
+
+Piece SpectatorView::getCurrent() const
+{
+  return Piece(state.pieceType(),state.orientation,state.center(),0,
+	       const_cast<Field*>(&getField()));
+}
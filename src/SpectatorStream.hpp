@@ -0,0 +1,122 @@
+#ifndef SPECTATORSTREAM_HPP
+#define SPECTATORSTREAM_HPP
+
+#include <cstdint>
+
+#include "common.hpp"
+#include "Field.hpp"
+#include "Piece.hpp"
+#include "FrameSnapshot.hpp"
+#include "NetProtocol.hpp"
+
+/* Spectator stream
+   One game's frames, encoded once and sent unchanged to every spectator of
+   that game. Messages use the NetProtocol header.
+
+   SPECTATE_KEY carries a whole frame: the FrameSnapshot row words, the piece
+   bytes and the score. The encoder emits one every keyInterval frames and
+   whenever it is reset, and builds one on request for a spectator who joins
+   mid-game.
+
+   SPECTATE_DELTA carries the difference from the previous frame. The body
+   starts with a byte of Parts flags, followed by each part present in flag
+   order:
+     CLEARED  u32 mask of previous rows removed by a line clear; the rows
+	      above fall into their place before ROWS is applied
+     ROWS     u32 mask of rows which differ, then a u16 for each such row
+     MOVE     one byte, the piece's x (low nibble) and y (high nibble)
+	      movement as signed 4 bit values
+     PIECE    type, orientation, x, y of a new or rotated piece
+     SCORE    i32
+     STATE    next, hold, flags
+   A frame where only gravity moved the piece costs two bytes of body.
+ */
+namespace SpectatorStream
+{
+  enum Parts
+    {
+      CLEARED=1,
+      ROWS=2,
+      MOVE=4,
+      PIECE=8,
+      SCORE=16,
+      STATE=32
+    };
+  constexpr unsigned DEFAULT_KEY_INTERVAL=60;
+  constexpr std::size_t KEY_BODY=4*FrameSnapshot::ROW_WORDS+8+4;
+}
+
+class SpectatorEncoder
+{
+public:
+  explicit SpectatorEncoder(unsigned keyInterval=SpectatorStream::DEFAULT_KEY_INTERVAL);
+
+  // Encode the game's next frame. The returned message is valid until the next
+  // call to encode or keyframe, and is meant to be appended unchanged to every
+  // spectator's output.
+  const NetProtocol::Buffer& encode(const FrameSnapshot &, std::uint64_t stamp);
+  // A SPECTATE_KEY for the most recently encoded frame, for spectators who
+  // join now.
+  const NetProtocol::Buffer& keyframe();
+  // Make the next encode a keyframe, e.g. when the game restarts.
+  void reset();
+
+  unsigned long getKeyframes() const
+  {
+    return keyCount;
+  }
+  unsigned long getDeltas() const
+  {
+    return deltaCount;
+  }
+private:
+  unsigned keyInterval,sinceKey;
+  bool started;
+  FrameSnapshot prev;
+  std::uint64_t prevStamp;
+  NetProtocol::Buffer message;
+  unsigned long keyCount,deltaCount;
+
+  void putKey(const FrameSnapshot &, std::uint64_t stamp);
+  void putDelta(const FrameSnapshot &, std::uint64_t stamp);
+};
+
+/* SpectatorView
+   Decodes a spectator stream back into a FrameSnapshot, and from there into a
+   Field and Piece for code which draws those. A view ignores deltas until it
+   has seen a keyframe.
+ */
+class SpectatorView
+{
+public:
+  SpectatorView();
+
+  // Apply one message. Returns false if the body is malformed, after which
+  // the view waits for the next keyframe. Other message types are ignored.
+  bool apply(const NetProtocol::MessageHeader &, const char *body, std::size_t size);
+  // True once a keyframe has been applied.
+  bool synced() const
+  {
+    return sync;
+  }
+  const FrameSnapshot& snapshot() const
+  {
+    return state;
+  }
+  // The field as of the last frame applied, rebuilt when it has changed.
+  const Field& getField() const;
+  // The current piece, placed in getField(). Only meaningful if
+  // snapshot().active().
+  Piece getCurrent() const;
+
+private:
+  FrameSnapshot state;
+  bool sync;
+  mutable bool fieldDirty;
+  mutable Field field;
+
+  bool applyKey(const char *, std::size_t);
+  bool applyDelta(const char *, std::size_t);
+};
+
+#endif // SPECTATORSTREAM_HPP
@@ -1,5 +1,6 @@
 #include "TetrisGame.hpp"
-#include "Piece.hpp"
+#include "HeadlessGame.hpp"
+#include "Replay.hpp"
 #include "compat.h"
 
 #ifdef HAVE_STDCXX_SYNCH
@@ -11,14 +12,13 @@
 
 typedef std::chrono::system_clock g_clock;
 constexpr unsigned frame_err=32;
-constexpr unsigned FPS=60;
-typedef std::chrono::duration<g_clock::rep,std::ratio<1,FPS*frame_err>> sleep_time;
 #else // HAVE_STDCXX_SYNCH
 #error NYI
 #endif // HAVE_STDCXX_SYNCH
 
-#ifdef HAVE_STDCXX_0X
 #include <random>
+
+#ifdef HAVE_STDCXX_0X
 #include <algorithm>
 #else // HAVE_STDCXX_0X
 #define nullptr 0
@@ -31,36 +31,46 @@ typedef std::chrono::duration<g_clock::rep,std::ratio<1,FPS*frame_err>> sleep_ti
 struct TetrisGame_impl
 {
   IRenderFunc *cb;
+  ISnapshotFunc *pub;
   // Tetris members
-  static constexpr unsigned int lockdelay=5,minBuffer=8;
-  typedef std::ratio<1,30> gravity;
-  unsigned int timeCount;
-  Field mField;
-  Piece current, ghost;
+  static constexpr unsigned int minBuffer=8;
+  const std::uint64_t seed;
+  HeadlessGame game;
   std::vector<PieceInput> inputBuffer;
-  // Randomized generation
-  std::default_random_engine re;
-  std::uniform_int_distribution<> pieces;
+  AsyncWriter::Stream *recorder;
+  std::unique_ptr<Replay> replay;
+  // Inputs applied between frames, which count as the next frame's.
+  std::vector<PieceInput> early;
+  bool immediate;
+  // The length of a frame at the game's tick rate.
+  g_clock::duration frameTime;
 
   // Threading members
   std::atomic_bool isPaused,isContinuing;
   std::mutex pauseMutex,cbMutex,inputMutex;
   std::unique_lock<std::mutex> pauseLock;
-  std::condition_variable pauseCondition;
+  std::condition_variable pauseCondition,inputCondition;
   std::thread runner;
 
-  TetrisGame_impl(IRenderFunc *cb_):cb(cb_), timeCount(0),
-				    mField(),current(I,lockdelay,&mField),
-				    ghost(I,lockdelay,&mField),inputBuffer(),
-				    re(),pieces(shift_right,hard_drop),
+  TetrisGame_impl(IRenderFunc *cb_):cb(cb_),pub(nullptr),
+				    seed(std::random_device()()),game(seed),inputBuffer(),
+				    recorder(nullptr),replay(),early(),immediate(false),
+				    frameTime(frameLength(game.getTickRate())),
 				    isPaused(true),isContinuing(false),
 				    pauseMutex(),cbMutex(),
 				    pauseLock(pauseMutex),
-				    pauseCondition(),
+				    pauseCondition(),inputCondition(),
 				    runner()
   {
     pauseLock.unlock();
     inputBuffer.reserve(minBuffer);
+    early.reserve(minBuffer);
+  }
+
+  static g_clock::duration frameLength(unsigned tickRate)
+  {
+    return std::chrono::duration_cast<g_clock::duration>
+      (std::chrono::nanoseconds(1000000000/tickRate));
   }
 
   ~TetrisGame_impl()
@@ -69,14 +79,17 @@ struct TetrisGame_impl
       {
 	gameOver();
 	pauseCondition.notify_all();
+	inputCondition.notify_all();
 	runner.join();
       }
+    record();
   }
 
   void gameOver()
   {
     cbMutex.lock();
     cb=nullptr;
+    pub=nullptr;
     cbMutex.unlock();
     isContinuing=false;
     isPaused=false;
@@ -94,83 +107,125 @@ struct TetrisGame_impl
 	  }
 	auto t0=g_clock::now();
 	//
-	consumeInput();
-	//
-	timeStep();
-	// Render
-	cbMutex.lock();
-	if(nullptr!=cb)
+	if(consumeInput())
 	  {
-	    (*cb)(mField,current,nullptr);
+	    publish();
+	    record();
+	    gameOver();
+	    break;
 	  }
-	cbMutex.unlock();
+	render();
+	publish();
 	// Cap game speed
-	while(std::chrono::duration_cast<sleep_time>(g_clock::now()-t0).count() < frame_err)
+	if(immediate)
+	  {
+	    waitForInput(t0+frameTime);
+	  }
+	while(g_clock::now()-t0 < frameTime)
 	  {
-	    std::this_thread::sleep_for(sleep_time(1));
+	    std::this_thread::sleep_for(frameTime/frame_err);
 	  }
       }
 
   }
 
-  void consumeInput()
+  // Until the deadline, apply inputs as soon as they are queued and show the
+  // result, without moving the game on a frame: gravity and lock delay stay
+  // on the frame grid. Stops if an input loses the game; the loss is
+  // published when the frame ends, as usual.
+  void waitForInput(const g_clock::time_point &deadline)
+  {
+    std::unique_lock<std::mutex> lock(inputMutex);
+    while(isContinuing && g_clock::now()<deadline)
+      {
+	if(inputBuffer.empty())
+	  {
+	    inputCondition.wait_until(lock,deadline);
+	    continue;
+	  }
+	std::vector<PieceInput> input(std::move(inputBuffer));
+	inputBuffer.clear();
+	inputBuffer.reserve(minBuffer);
+	lock.unlock();
+	early.insert(early.end(),input.begin(),input.end());
+	if(game.input(input.data(),input.size()))
+	  {
+	    return;
+	  }
+	render();
+	publish();
+	lock.lock();
+      }
+  }
+
+  // Step the game one frame with every input queued since the last frame.
+  // Returns true if the game is over.
+  bool consumeInput()
   {
     inputMutex.lock();
     std::vector<PieceInput> input(std::move(inputBuffer));
     inputBuffer.clear();
     inputBuffer.reserve(minBuffer);
     inputMutex.unlock();
-    for(auto itor = input.begin(); itor != input.end(); ++itor)
+    game.input(input.data(),input.size());
+    if(replay)
       {
-	if(current.handleInput(*itor))
+	early.insert(early.end(),input.begin(),input.end());
+	try
+	  {
+	    replay->frame(early.data(),early.size());
+	  }
+	catch(ReplayError &)
 	  {
-	    if(scanForLoss())
-	      {
-		gameOver();
-		return;
-	      }
-	    // 'else' redundant
-	    newPiece();
+	    // More inputs in one frame than a replay holds: stop recording.
+	    replay.reset();
 	  }
       }
+    early.clear();
+    const bool over=game.step();
+    if(replay && !over)
+      {
+	replay->keyframe(game);
+      }
+    return over;
   }
 
-  void newPiece()
+  void render()
   {
-    PieceType t=(PieceType)pieces(re);
-    current.~Piece();
-    new(&current) Piece(t,lockdelay,&mField);
+    std::lock_guard<std::mutex> lg(cbMutex);
+    if(nullptr!=cb)
+      {
+	(*cb)(game.getField(),game.getCurrent(),nullptr);
+      }
   }
 
-  bool scanForLoss()
+  // Append the replay, if there is one, to the recorder. Only the game thread
+  // calls this while it runs.
+  void record()
   {
-    for(int i=0; i<FIELD_WIDTH; ++i)
+    if(!replay || 0==game.getFrame())
       {
-	// If one desired greater performance, one would unroll this inner loop.
-	for(int j = 20; j<FIELD_HEIGHT; ++j)
-	  {
-	    if(mField.get(i,j))
-	      {
-		return true;
-	      }
-	  }
+	return;
       }
-    return false;
+    replay->finish(game);
+    try
+      {
+	const std::vector<std::uint8_t> bytes=ReplayWriter::encode(replay->view());
+	recorder->append(bytes.data(),bytes.size());
+      }
+    catch(std::exception &)
+      {
+	// Too big for the stream: dropped, as if it were full.
+      }
+    replay.reset();
   }
 
-  void timeStep()
+  void publish()
   {
-    if( (timeCount * gravity::num) / gravity::den > 0)
-      {
-	if(current.timeStep(1))
-	  {
-	    newPiece();
-	  }
-	timeCount=0;
-      }
-    else
+    std::lock_guard<std::mutex> lg(cbMutex);
+    if(nullptr!=pub)
       {
-	++timeCount;
+	(*pub)(game.snapshot());
       }
   }
 
@@ -179,8 +234,6 @@ struct TetrisGame_impl
     isPaused=false;
     if(!runner.joinable()) // Thread not yet initialized
       {
-	timeCount=0;
-	newPiece();
 	isContinuing=true;
 	runner = std::thread( &TetrisGame_impl::threadFunc, this);
       }
@@ -231,6 +284,56 @@ void TetrisGame::setRenderer(IRenderFunc *callback)
   me->cb=callback;
   me->cbMutex.unlock();
 }
+// Snapshot callback. Calling during run is an error.
+void TetrisGame::setPublisher(ISnapshotFunc *callback)
+{
+  if(!me->isPaused)
+    {
+      throw GameRunningError();
+    }
+
+  me->cbMutex.lock();
+  me->pub=callback;
+  me->cbMutex.unlock();
+}
+// Recorder. Calling during run, or after the game has run, is an error.
+void TetrisGame::setRecorder(AsyncWriter::Stream *stream)
+{
+  if(!me->isPaused || me->runner.joinable())
+    {
+      throw GameRunningError();
+    }
+  me->recorder=stream;
+  me->replay.reset(stream ? new Replay(me->seed,BAG7) : nullptr);
+}
+// Input handling. Calling during run is an error.
+void TetrisGame::setImmediateInput(bool immediate)
+{
+  if(!me->isPaused)
+    {
+      throw GameRunningError();
+    }
+  me->immediate=immediate;
+}
+// Tick rate. Calling during run, or after the game has run, is an error.
+void TetrisGame::setTickRate(unsigned tickRate)
+{
+  if(!me->isPaused || me->runner.joinable())
+    {
+      throw GameRunningError();
+    }
+  me->game.setTickRate(tickRate);
+  me->frameTime=TetrisGame_impl::frameLength(tickRate);
+}
+// Auto-repeat. Calling during run is an error.
+void TetrisGame::setAutoRepeat(HeadlessGame::RepeatTime das, HeadlessGame::RepeatTime arr)
+{
+  if(!me->isPaused)
+    {
+      throw GameRunningError();
+    }
+  me->game.setAutoRepeat(das,arr);
+}
 // Control functions. May be called asyncronously.
 void TetrisGame::queueInput(PieceInput in)
 {
@@ -241,6 +344,10 @@ void TetrisGame::queueInput(PieceInput in)
   me->inputMutex.lock();
   me->inputBuffer.push_back(in);
   me->inputMutex.unlock();
+  if(me->immediate)
+    {
+      me->inputCondition.notify_one();
+    }
 }
 
 bool TetrisGame::isGameOver() const
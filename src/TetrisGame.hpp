@@ -3,15 +3,24 @@
 
 #include "RenderFunc.hpp"
 #include "common.hpp"
+#include "AsyncWriter.hpp"
+#include "HeadlessGame.hpp"
 #include <memory>
 /* TetrisGame
    A tetris game, running on its own thread. Attepts to execute the core loop once each 
-   1/60th of a second.
+   tick: each 1/60th of a second, unless setTickRate has set another rate.
 
    The core loop will read and execute all available input before incrementing 
    frame-based counters (e.g. gravity, lock delay). At the end of each loop, the 
    callback set by setRenderer will be called with read-only references to the Field, 
-   current Piece, and hold Piece.
+   current Piece, and hold Piece. If a publisher has been set with setPublisher, it
+   will then be called with a FrameSnapshot of the same state, including the next
+   piece and the frame number.
+
+   If a recorder has been set with setRecorder, the game is recorded as a replay (see
+   Replay.hpp) and, once it is lost or the TetrisGame is destroyed, its record is
+   appended to the recorder's stream. Appending never waits for the disk; a replay
+   too big for the stream, or arriving while it is full, is dropped.
 
    Neither TetrisGame nor the templated implementation of IRenderFunc synchronize with
    other threads - the callback will be executed from the TetrisGame's thread and it is
@@ -35,9 +44,30 @@ public:
   // Piece reference is the current piece, the piece pointer is the "hold" piece
   // The "hold" piece will be NULL if there is no "hold" piece.
   void setRenderer( IRenderFunc* callback ); // throw (GameRunningError);
+  // Snapshot callback, called after the render callback. Calling during run is an
+  // error. When the game is lost, a final snapshot flagged GAME_OVER is published.
+  void setPublisher( ISnapshotFunc* callback ); // throw (GameRunningError);
+  // Record the game to stream. Calling once the game has run is an error, as the
+  // replay must start from the first frame. The stream must outlive the game.
+  void setRecorder( AsyncWriter::Stream* stream ); // throw (GameRunningError);
+  // With immediate input, the thread wakes as soon as input is queued rather than at
+  // the next frame, applies it, and calls the render callback and publisher again
+  // with the same frame number. Gravity and lock delay still only advance once a
+  // frame, and the game plays exactly as if the input had waited for the frame.
+  // Calling during run is an error.
+  void setImmediateInput( bool immediate ); // throw (GameRunningError);
+  // Frames a second, from 1 to HeadlessGame::MAX_TICK_RATE; 60 unless set. Pieces fall
+  // as fast at any rate, but inputs land on a finer grid. Calling once the game has
+  // run is an error.
+  void setTickRate( unsigned tickRate ); // throw (GameRunningError, std::invalid_argument);
+  // Delayed auto shift and auto repeat rate of held shift keys (see HeadlessGame);
+  // 10 and 2 frames at 60 Hz unless set. Calling during run is an error.
+  void setAutoRepeat( HeadlessGame::RepeatTime das, HeadlessGame::RepeatTime arr ); // throw (GameRunningError, std::invalid_argument);
   // May be called only while the game is running. The internal thread will aquire a 
-  // lock and consume the entire queue once each frame, processing each input in the
-  // order it was recieved. 
+  // lock and consume the entire queue once each frame, or at once with immediate
+  // input, processing each input in the order it was recieved. A held shift key is
+  // best queued as press_left or press_right and its release, once each, and left
+  // to the game to repeat.
   void queueInput(PieceInput in); //throw (GameNotRunningError);
   // Read whether the game has ended. If the game is over, there will be no
   // further callbacks.
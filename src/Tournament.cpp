@@ -0,0 +1,286 @@
+#include "Tournament.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <sstream>
+
+#include "BattleMatch.hpp"
+#include "Tuner.hpp"
+
+bool Tournament::Entrant::parse(const std::string &line)
+{
+  std::istringstream in(line);
+  std::string word;
+  if(!(in >> name))
+    {
+      return false;
+    }
+  weights=Evaluator::Weights::defaults();
+  delay=0;
+  preview=true;
+  while(in >> word)
+    {
+      if("preview"==word || "nopreview"==word)
+	{
+	  preview="preview"==word;
+	  continue;
+	}
+      if("delay"==word)
+	{
+	  if(!(in >> delay))
+	    {
+	      return false;
+	    }
+	  continue;
+	}
+      unsigned f=0;
+      while(f<Evaluator::FEATURE_COUNT && word!=Tuner::featureName(f))
+	{
+	  ++f;
+	}
+      if(f==Evaluator::FEATURE_COUNT || !(in >> weights.w[f]))
+	{
+	  return false;
+	}
+    }
+  return true;
+}
+
+Tournament::Tournament(const std::vector<Entrant> &e, std::uint64_t seed_, unsigned maxFrames_):
+  entrants(e),seed(seed_),maxFrames(maxFrames_),round(0),matches(),points(e.size(),0.0),
+  listener(),listenerMutex()
+{
+}
+
+void Tournament::play(const Entrant &a, const Entrant &b, unsigned maxFrames, Match &m)
+{
+  // The match runs on the calling thread; matches are what run in parallel.
+  WorkerPool solo(1);
+  BattleMatch match(2,m.seed);
+  match.setAgent(0,std::unique_ptr<Agent>(new BotAgent(a.weights,a.delay,a.preview)));
+  match.setAgent(1,std::unique_ptr<Agent>(new BotAgent(b.weights,b.delay,b.preview)));
+  match.run(solo,maxFrames);
+  if(!match.isOver() || match.getPlace(0)==match.getPlace(1))
+    {
+      m.score=0.5;
+    }
+  else
+    {
+      m.score=1==match.getPlace(0) ? 1 : 0;
+    }
+  m.frames=match.getFrame();
+  m.sentA=match.getLinesSent(0);
+  m.sentB=match.getLinesSent(1);
+  m.checksum=match.checksum();
+}
+
+void Tournament::schedule(std::vector<Match> &list, unsigned a, unsigned b, unsigned games)
+{
+  std::uint32_t pairSeed=0;
+  for(unsigned g=0;g<games+games%2;++g)
+    {
+      Match m;
+      m.number=matches.size()+list.size();
+      m.round=round;
+      // Each pair of games shares the seed of its first.
+      if(0==g%2)
+	{
+	  pairSeed=Pcg32(seed,m.number)();
+	}
+      m.seed=pairSeed;
+      m.a=g%2 ? b : a;
+      m.b=g%2 ? a : b;
+      m.score=0;
+      m.frames=m.sentA=m.sentB=0;
+      m.checksum=0;
+      list.push_back(m);
+    }
+}
+
+void Tournament::playAll(WorkerPool &pool, std::vector<Match> &list)
+{
+  pool.run(list.size(),[&](std::size_t i)
+	   {
+	     Match &m=list[i];
+	     play(entrants[m.a],entrants[m.b],maxFrames,m);
+	     if(listener)
+	       {
+		 std::lock_guard<std::mutex> lock(listenerMutex);
+		 listener(m);
+	       }
+	   });
+  for(const Match &m : list)
+    {
+      points[m.a]+=m.score;
+      points[m.b]+=1-m.score;
+    }
+  matches.insert(matches.end(),list.begin(),list.end());
+  ++round;
+}
+
+void Tournament::playRoundRobin(WorkerPool &pool, unsigned games)
+{
+  std::vector<Match> list;
+  for(unsigned a=0;a<entrants.size();++a)
+    {
+      for(unsigned b=a+1;b<entrants.size();++b)
+	{
+	  schedule(list,a,b,games);
+	}
+    }
+  playAll(pool,list);
+}
+
+void Tournament::playSwiss(WorkerPool &pool, unsigned rounds, unsigned games)
+{
+  const unsigned count=entrants.size();
+  std::vector<unsigned> byes(count,0);
+  for(unsigned r=0;r<rounds;++r)
+    {
+      std::vector<std::vector<bool>> met(count,std::vector<bool>(count,false));
+      for(const Match &m : matches)
+	{
+	  met[m.a][m.b]=met[m.b][m.a]=true;
+	}
+      // Standings: most points first, then entrant order.
+      std::vector<unsigned> order(count);
+      for(unsigned i=0;i<count;++i)
+	{
+	  order[i]=i;
+	}
+      std::stable_sort(order.begin(),order.end(),[this](unsigned x, unsigned y)
+		       {
+			 return points[x]>points[y];
+		       });
+      if(count%2)
+	{
+	  // The lowest placed of those who have sat out least.
+	  auto bye=order.end()-1;
+	  for(auto it=order.end();it!=order.begin();)
+	    {
+	      --it;
+	      if(byes[*it]<byes[*bye])
+		{
+		  bye=it;
+		}
+	    }
+	  ++byes[*bye];
+	  points[*bye]+=games+games%2;
+	  order.erase(bye);
+	}
+
+      std::vector<Match> list;
+      while(!order.empty())
+	{
+	  const unsigned a=order[0];
+	  std::size_t j=1;
+	  while(j<order.size() && met[a][order[j]])
+	    {
+	      ++j;
+	    }
+	  // Everyone left has been met: play the nearest again.
+	  if(j==order.size())
+	    {
+	      j=1;
+	    }
+	  schedule(list,a,order[j],games);
+	  order.erase(order.begin()+j);
+	  order.erase(order.begin());
+	}
+      playAll(pool,list);
+    }
+}
+
+std::vector<double> Tournament::fit(unsigned count, const std::vector<Match> &list)
+{
+  std::vector<double> wins(count,0.0),gamma(count,1.0),next(count);
+  std::vector<std::vector<unsigned>> games(count,std::vector<unsigned>(count,0));
+  for(const Match &m : list)
+    {
+      wins[m.a]+=m.score;
+      wins[m.b]+=1-m.score;
+      ++games[m.a][m.b];
+      ++games[m.b][m.a];
+    }
+  // Hunter's minorization-maximization, with one virtual draw each against a
+  // player of strength 1: half a win and half a loss, twice.
+  for(unsigned iteration=0;iteration<10000;++iteration)
+    {
+      double change=0;
+      for(unsigned i=0;i<count;++i)
+	{
+	  double sum=2/(gamma[i]+1);
+	  for(unsigned j=0;j<count;++j)
+	    {
+	      sum+=games[i][j]/(gamma[i]+gamma[j]);
+	    }
+	  next[i]=(wins[i]+1)/sum;
+	  change=std::max(change,std::fabs(std::log(next[i]/gamma[i])));
+	}
+      gamma.swap(next);
+      if(change<1e-9)
+	{
+	  break;
+	}
+    }
+  std::vector<double> elo(count);
+  double mean=0;
+  for(unsigned i=0;i<count;++i)
+    {
+      elo[i]=400*std::log10(gamma[i]);
+      mean+=elo[i]/count;
+    }
+  for(double &e : elo)
+    {
+      e-=mean;
+    }
+  return elo;
+}
+
+std::vector<Tournament::Rating> Tournament::ratings(unsigned resamples, double confidence) const
+{
+  const unsigned count=entrants.size();
+  const std::vector<double> elo=fit(count,matches);
+  std::vector<Rating> ret(count);
+  for(unsigned i=0;i<count;++i)
+    {
+      ret[i].elo=ret[i].low=ret[i].high=elo[i];
+      ret[i].points=0;
+      ret[i].games=0;
+    }
+  for(const Match &m : matches)
+    {
+      ret[m.a].points+=m.score;
+      ret[m.b].points+=1-m.score;
+      ++ret[m.a].games;
+      ++ret[m.b].games;
+    }
+  if(matches.empty() || 0==resamples)
+    {
+      return ret;
+    }
+
+  Pcg32 rng(seed,0xb007);
+  std::vector<std::vector<double>> samples(count);
+  std::vector<Match> resampled(matches.size());
+  for(unsigned r=0;r<resamples;++r)
+    {
+      for(Match &m : resampled)
+	{
+	  m=matches[rng.bounded(matches.size())];
+	}
+      const std::vector<double> e=fit(count,resampled);
+      for(unsigned i=0;i<count;++i)
+	{
+	  samples[i].push_back(e[i]);
+	}
+    }
+  const double tail=(1-confidence)/2;
+  for(unsigned i=0;i<count;++i)
+    {
+      std::sort(samples[i].begin(),samples[i].end());
+      ret[i].low=samples[i][(std::size_t)(tail*(resamples-1)+0.5)];
+      ret[i].high=samples[i][(std::size_t)((1-tail)*(resamples-1)+0.5)];
+    }
+  return ret;
+}
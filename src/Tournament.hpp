@@ -0,0 +1,126 @@
+#ifndef TOURNAMENT_HPP
+#define TOURNAMENT_HPP
+
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "Bot.hpp"
+#include "WorkerPool.hpp"
+
+/* Tournament
+   Versus matches between bot configurations, for comparing evaluators. A
+   match is a two player BattleMatch between BotAgents, with garbage, played
+   to the end or to a frame limit, which is a draw. Both boards are dealt the
+   same pieces, and games are played in pairs from the same seed with the
+   sides swapped, so neither bot is luckier with its pieces than the other.
+
+   Round robin plays every pair of entrants the same number of games. Swiss
+   plays rounds in which entrants are paired with the nearest in points they
+   have not met yet; with an odd number one sits out the round, scoring a
+   win. Matches in a round run in parallel, each on one thread.
+
+   A match's seed comes from the tournament's seed and the match number, and
+   pairings depend only on earlier results, so a tournament is the same
+   whatever the number of threads, and any match can be played again alone
+   from its seed and entrants.
+
+   Ratings are Elo, from a Bradley-Terry fit to all the games with draws as
+   half a win and one virtual draw against an average player per entrant,
+   which keeps an unbeaten record finite. Confidence intervals come from
+   refitting to games resampled with replacement.
+ */
+class Tournament
+{
+public:
+  struct Entrant
+  {
+    std::string name;
+    Evaluator::Weights weights;
+    unsigned delay;
+    bool preview;
+
+    Entrant():name(),weights(Evaluator::Weights::defaults()),delay(0),preview(true)
+    {}
+    /* Read an entrant from a line of the form
+	 NAME [preview|nopreview] [delay N] [FEATURE WEIGHT]...
+       where FEATURE is one of Tuner::featureName's; weights left out keep
+       their defaults, so the weights line printed by tetris_tune can be
+       pasted after a name. Returns false if the line cannot be read. */
+    bool parse(const std::string &line);
+  };
+  struct Match
+  {
+    unsigned number,round;
+    // Entrant indices; a plays the first board.
+    unsigned a,b;
+    std::uint32_t seed;
+    // a's result: 1 for a win, 0.5 for a draw, 0 for a loss.
+    double score;
+    unsigned frames,sentA,sentB;
+    std::uint64_t checksum;
+  };
+  struct Rating
+  {
+    double elo,low,high;
+    double points;
+    unsigned games;
+  };
+
+  // maxFrames limits each match.
+  Tournament(const std::vector<Entrant> &, std::uint64_t seed, unsigned maxFrames);
+
+  // Called with each match as it finishes, one at a time, in any order.
+  void setListener(const std::function<void(const Match&)> &f)
+  {
+    listener=f;
+  }
+  // Play every pair games times, rounded up to an even number.
+  void playRoundRobin(WorkerPool &, unsigned games);
+  // Play rounds of Swiss pairings, games per pairing, rounded up to an even
+  // number.
+  void playSwiss(WorkerPool &, unsigned rounds, unsigned games);
+
+  const std::vector<Entrant>& getEntrants() const
+  {
+    return entrants;
+  }
+  // Every match played, in match number order.
+  const std::vector<Match>& getMatches() const
+  {
+    return matches;
+  }
+  // Points per entrant, counting Swiss byes.
+  const std::vector<double>& getPoints() const
+  {
+    return points;
+  }
+  // Ratings per entrant with interval of confidence level, from resamples
+  // resamplings drawn with the tournament's seed.
+  std::vector<Rating> ratings(unsigned resamples=200, double confidence=0.95) const;
+
+  // Play one match between two entrants: the same seed always gives the same
+  // result and checksum.
+  static void play(const Entrant &a, const Entrant &b, unsigned maxFrames, Match &);
+  // Fit Elo ratings, averaging 0, to a list of matches between count
+  // entrants.
+  static std::vector<double> fit(unsigned count, const std::vector<Match> &);
+private:
+  Tournament(const Tournament&) = delete; // Uncopyable
+
+  std::vector<Entrant> entrants;
+  std::uint64_t seed;
+  unsigned maxFrames,round;
+  std::vector<Match> matches;
+  std::vector<double> points;
+  std::function<void(const Match&)> listener;
+  std::mutex listenerMutex;
+
+  // Add games between a and b to a schedule, sides swapped in turn.
+  void schedule(std::vector<Match> &, unsigned a, unsigned b, unsigned games);
+  void playAll(WorkerPool &, std::vector<Match> &);
+};
+
+#endif // TOURNAMENT_HPP
@@ -0,0 +1,216 @@
+#include "TranspositionTable.hpp"
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static_assert(ATOMIC_LLONG_LOCK_FREE == 2,"Transposition table requires lock-free atomics.");
+static_assert(ATOMIC_CHAR_LOCK_FREE == 2,"The generation is shared through the file.");
+
+// An entry's data word: the value's bits, then the depth and generation. The
+// top bit marks the entry as used, so no stored data word is zero.
+static constexpr std::uint64_t USED=std::uint64_t(1)<<63;
+
+static inline std::uint64_t pack(float value, unsigned depth, std::uint8_t generation)
+{
+  std::uint32_t bits;
+  std::memcpy(&bits,&value,sizeof(bits));
+  return USED | bits | (std::uint64_t)(depth & 0xff)<<32 | (std::uint64_t)generation<<40;
+}
+static inline float valueOf(std::uint64_t data)
+{
+  const std::uint32_t bits=data;
+  float ret;
+  std::memcpy(&ret,&bits,sizeof(ret));
+  return ret;
+}
+static inline unsigned depthOf(std::uint64_t data)
+{
+  return (data>>32) & 0xff;
+}
+static inline std::uint8_t generationOf(std::uint64_t data)
+{
+  return data>>40;
+}
+
+static std::string errnoString(const std::string &what)
+{
+  return what+": "+std::strerror(errno);
+}
+
+std::size_t TranspositionTable::bucketsFor(std::size_t bytes)
+{
+  std::size_t ret=1;
+  while(ret*2*sizeof(Bucket)<=bytes)
+    {
+      ret*=2;
+    }
+  return ret;
+}
+
+TranspositionTable::TranspositionTable(std::size_t bytes):
+  path(),buckets(bucketsFor(bytes)),size(HEADER_SIZE+buckets*sizeof(Bucket)),
+  base(nullptr),header(nullptr),table(nullptr),generation(0)
+{
+  // Anonymous memory is zeroed, which is an empty table.
+  base=mmap(nullptr,size,PROT_READ|PROT_WRITE,MAP_PRIVATE|MAP_ANONYMOUS,-1,0);
+  if(MAP_FAILED==base)
+    {
+      throw std::bad_alloc();
+    }
+  attach();
+}
+
+TranspositionTable::TranspositionTable(const std::string &path_, std::size_t bytes):
+  path(path_),buckets(bucketsFor(bytes)),size(HEADER_SIZE+buckets*sizeof(Bucket)),
+  base(nullptr),header(nullptr),table(nullptr),generation(0)
+{
+  int fd=open(path.c_str(),O_CREAT|O_RDWR,0644);
+  if(-1==fd)
+    {
+      throw ShmError(errnoString("open "+path));
+    }
+  struct stat st;
+  if(-1==fstat(fd,&st))
+    {
+      const std::string err=errnoString("fstat "+path);
+      close(fd);
+      throw ShmError(err);
+    }
+  // A file of any other size is not this table; empty it.
+  if((std::size_t)st.st_size!=size && (-1==ftruncate(fd,0) || -1==ftruncate(fd,size)))
+    {
+      const std::string err=errnoString("ftruncate "+path);
+      close(fd);
+      throw ShmError(err);
+    }
+  base=mmap(nullptr,size,PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  if(MAP_FAILED==base)
+    {
+      throw ShmError(errnoString("mmap "+path));
+    }
+  attach();
+}
+
+TranspositionTable::~TranspositionTable()
+{
+  munmap(base,size);
+}
+
+// Point into the mapping, and start the table over unless it already holds
+// a table of this size.
+void TranspositionTable::attach()
+{
+  header=static_cast<Header*>(base);
+  table=static_cast<Bucket*>(static_cast<void*>(static_cast<char*>(base)+HEADER_SIZE));
+  if(MAGIC!=header->magic || VERSION!=header->version || buckets!=header->buckets)
+    {
+      clear();
+      header->version=VERSION;
+      header->buckets=buckets;
+      header->generation.store(0,std::memory_order_relaxed);
+      header->magic=MAGIC;
+    }
+  newSearch();
+}
+
+void TranspositionTable::newSearch()
+{
+  std::uint8_t next=header->generation.load(std::memory_order_relaxed)+1;
+  if(0==next)
+    {
+      for(std::size_t i=0;i<buckets;++i)
+	{
+	  for(Entry &e : table[i].ways)
+	    {
+	      const std::uint64_t data=e.data.load(std::memory_order_relaxed);
+	      if(data)
+		{
+		  const std::uint64_t aged=data & ~((std::uint64_t)0xff<<40);
+		  e.data.store(aged,std::memory_order_relaxed);
+		  e.check.store(e.check.load(std::memory_order_relaxed)^data^aged,
+				std::memory_order_relaxed);
+		}
+	    }
+	}
+      next=1;
+    }
+  header->generation.store(next,std::memory_order_relaxed);
+  generation.store(next,std::memory_order_relaxed);
+}
+
+void TranspositionTable::clear()
+{
+  std::memset(static_cast<void*>(table),0,buckets*sizeof(Bucket));
+}
+
+bool TranspositionTable::probe(std::uint64_t key, unsigned depth, float &value) const
+{
+  const Bucket &b=table[key & (buckets-1)];
+  for(unsigned w=0;w<WAYS;++w)
+    {
+      const std::uint64_t data=b.ways[w].data.load(std::memory_order_relaxed);
+      const std::uint64_t check=b.ways[w].check.load(std::memory_order_relaxed);
+      if(data && (check^data)==key)
+	{
+	  if(depthOf(data)<depth)
+	    {
+	      return false;
+	    }
+	  value=valueOf(data);
+	  return true;
+	}
+    }
+  return false;
+}
+
+void TranspositionTable::store(std::uint64_t key, unsigned depth, float value)
+{
+  Bucket &b=table[key & (buckets-1)];
+  const std::uint8_t now=generation.load(std::memory_order_relaxed);
+  unsigned victim=0,worst=~0u;
+  for(unsigned w=0;w<WAYS;++w)
+    {
+      const std::uint64_t data=b.ways[w].data.load(std::memory_order_relaxed);
+      const std::uint64_t check=b.ways[w].check.load(std::memory_order_relaxed);
+      if(data && (check^data)==key)
+	{
+	  // Keep a deeper result from this search.
+	  if(depthOf(data)>depth && generationOf(data)==now)
+	    {
+	      return;
+	    }
+	  victim=w;
+	  break;
+	}
+      // Empty ways first, then older generations, then the shallowest.
+      const unsigned priority=!data ? 0 : 1+depthOf(data)+(generationOf(data)==now ? 256 : 0);
+      if(priority<worst)
+	{
+	  victim=w;
+	  worst=priority;
+	}
+    }
+  const std::uint64_t data=pack(value,depth,now);
+  b.ways[victim].data.store(data,std::memory_order_relaxed);
+  b.ways[victim].check.store(key^data,std::memory_order_relaxed);
+}
+
+std::size_t TranspositionTable::used() const
+{
+  std::size_t ret=0;
+  for(std::size_t i=0;i<buckets;++i)
+    {
+      for(unsigned w=0;w<WAYS;++w)
+	{
+	  ret+=0!=table[i].ways[w].data.load(std::memory_order_relaxed);
+	}
+    }
+  return ret;
+}
@@ -0,0 +1,106 @@
+#ifndef TRANSPOSITIONTABLE_HPP
+#define TRANSPOSITIONTABLE_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "common.hpp"
+
+/* TranspositionTable
+   A fixed-size cache of search results, keyed by a 64 bit hash of the
+   position, shared by the threads of one search without locks. Only one
+   thread may call newSearch, between searches.
+
+   The table is an array of buckets of WAYS entries, one bucket to a cache
+   line; a key can only live in the bucket its low bits select. An entry is
+   two words, the data (value, depth and generation) and the key xor the
+   data, each written with a single relaxed store. A reader recomputes
+   key^data and so rejects an entry that another thread was writing at the
+   same time, as well as one that belongs to another key; nothing ever waits.
+
+   Replacement prefers depth. Storing a key that is already in the bucket
+   overwrites it unless the old result was searched deeper in the current
+   generation. Otherwise the new entry goes in an empty way or replaces the
+   entry from an older generation, or failing that the shallowest. newSearch
+   starts a new generation, so stale results give way first but still count
+   while they last. Generations are 8 bits: when the counter wraps, every
+   entry is aged to generation 0, which no search uses, so a result from
+   256 searches ago never passes for a current one.
+
+   A table may be backed by a file, which keeps it warm between runs. The
+   file holds a small header followed by the buckets; a file of the wrong
+   size or version is cleared. Results are only meaningful to searches that
+   agree on what the values mean, so searchers should fold anything their
+   values depend on (such as evaluation weights) into the key.
+ */
+class TranspositionTable
+{
+public:
+  static constexpr unsigned WAYS=4;
+
+  // A table in anonymous memory whose entries take at most bytes bytes (at
+  // least one bucket).
+  explicit TranspositionTable(std::size_t bytes);
+  // A table mapped from the file at path, created or cleared if it is not a
+  // table of this size. Throws ShmError.
+  TranspositionTable(const std::string &path, std::size_t bytes);
+  ~TranspositionTable();
+
+  // Look up key. Returns true, with the value, if it was stored by a search
+  // at least depth deep.
+  bool probe(std::uint64_t key, unsigned depth, float &value) const;
+  void store(std::uint64_t key, unsigned depth, float value);
+
+  // Start a new generation. Only one thread may call it, and not while
+  // others store: once in 255 calls it walks the table.
+  void newSearch();
+  // Empty every entry.
+  void clear();
+  // Number of entries.
+  std::size_t capacity() const
+  {
+    return buckets*WAYS;
+  }
+  // Number of entries in use, counted by scanning the table.
+  std::size_t used() const;
+  bool isMapped() const
+  {
+    return !path.empty();
+  }
+private:
+  struct Entry
+  {
+    std::atomic<std::uint64_t> check,data;
+  };
+  struct Bucket
+  {
+    Entry ways[WAYS];
+  };
+  static_assert(sizeof(Bucket)==64,"A bucket must be one cache line!");
+  struct Header
+  {
+    std::uint32_t magic,version;
+    std::uint64_t buckets;
+    std::atomic<std::uint8_t> generation;
+  };
+  static constexpr std::uint32_t MAGIC=0x54545454; // "TTTT"
+  static constexpr std::uint32_t VERSION=1;
+  // The header occupies the first cache line.
+  static constexpr std::size_t HEADER_SIZE=64;
+  TranspositionTable(const TranspositionTable&) = delete; // Uncopyable
+
+  std::string path;
+  std::size_t buckets,size;
+  void *base;
+  Header *header;
+  Bucket *table;
+  // Read by store on every thread, so atomic, but only newSearch writes it.
+  std::atomic<std::uint8_t> generation;
+
+  static std::size_t bucketsFor(std::size_t bytes);
+  void attach();
+};
+
+#endif // TRANSPOSITIONTABLE_HPP
@@ -0,0 +1,258 @@
+#include "Tuner.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#include "Randomizer.hpp"
+
+static const char CHECKPOINT_MAGIC[]="tetris_tune";
+static constexpr unsigned CHECKPOINT_VERSION=1;
+
+static const char *const FEATURE_NAMES[Evaluator::FEATURE_COUNT]=
+  {
+    "lines","landing","height","max_height","holes","row_transitions",
+    "column_transitions","wells","bumpiness"
+  };
+
+// Uniform in (0,1], from 53 random bits.
+static double uniform(Pcg32 &rng)
+{
+  const std::uint64_t a=rng()>>5, b=rng()>>6;
+  return ((a<<26)+b+1)*(1.0/9007199254740992.0);
+}
+
+// Standard normal, by Box and Muller. <random>'s distributions differ between
+// standard libraries; this does not.
+static double normal(Pcg32 &rng)
+{
+  const double r=std::sqrt(-2*std::log(uniform(rng)));
+  return r*std::cos(6.283185307179586*uniform(rng));
+}
+
+bool Tuner::Settings::operator==(const Settings &o) const
+{
+  return population==o.population && elite==o.elite && games==o.games
+    && pieces==o.pieces && seed==o.seed && sigma==o.sigma && noise==o.noise
+    && preview==o.preview;
+}
+
+Tuner::Tuner(WorkerPool &pool_, const Settings &s):
+  pool(pool_),settings(s),generation(0),gamesPlayed(0),mean(),sigma(),
+  candidates(),seeds(),scores(),last()
+{
+  settings.population=std::max(settings.population,1u);
+  settings.elite=std::max(std::min(settings.elite,settings.population),1u);
+  settings.games=std::max(settings.games,1u);
+  const Evaluator::Weights start=Evaluator::Weights::defaults();
+  mean.assign(start.w,start.w+Evaluator::FEATURE_COUNT);
+  sigma.assign(Evaluator::FEATURE_COUNT,settings.sigma);
+  last.number=0;
+  last.meanScore=last.eliteScore=last.bestScore=0;
+  last.best=start;
+}
+
+// Draw this generation's candidates and game seeds, from streams of their
+// own so that neither depends on the size of the other.
+void Tuner::sample()
+{
+  Pcg32 draw(settings.seed,2*(std::uint64_t)generation),deal(settings.seed,2*(std::uint64_t)generation+1);
+  candidates.resize(settings.population);
+  for(Evaluator::Weights &c : candidates)
+    {
+      for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+	{
+	  c.w[f]=mean[f]+sigma[f]*normal(draw);
+	}
+    }
+  seeds.resize(settings.games);
+  for(std::uint64_t &s : seeds)
+    {
+      s=(std::uint64_t)deal()<<32 | deal();
+    }
+}
+
+const Tuner::Generation& Tuner::step()
+{
+  sample();
+  const unsigned games=settings.games;
+  scores.assign((std::size_t)settings.population*games,0.0);
+  pool.run(scores.size(),[&](std::size_t i)
+	   {
+	     scores[i]=play(candidates[i/games],seeds[i%games],settings.pieces,settings.preview);
+	   });
+
+  // Sum in a fixed order, so that the totals are the same whichever thread
+  // played which game.
+  std::vector<double> totals(settings.population,0.0);
+  std::vector<unsigned> order(settings.population);
+  double all=0;
+  for(unsigned c=0;c<settings.population;++c)
+    {
+      for(unsigned g=0;g<games;++g)
+	{
+	  totals[c]+=scores[(std::size_t)c*games+g];
+	}
+      all+=totals[c];
+      order[c]=c;
+    }
+  std::stable_sort(order.begin(),order.end(),[&](unsigned a, unsigned b)
+		   {
+		     return totals[a]>totals[b];
+		   });
+
+  const unsigned elite=settings.elite;
+  const double noise=settings.noise/(generation+1);
+  double eliteTotal=0;
+  for(unsigned e=0;e<elite;++e)
+    {
+      eliteTotal+=totals[order[e]];
+    }
+  for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+    {
+      double m=0,v=0;
+      for(unsigned e=0;e<elite;++e)
+	{
+	  m+=candidates[order[e]].w[f];
+	}
+      m/=elite;
+      for(unsigned e=0;e<elite;++e)
+	{
+	  const double d=candidates[order[e]].w[f]-m;
+	  v+=d*d;
+	}
+      mean[f]=m;
+      sigma[f]=std::sqrt(v/elite)+noise;
+    }
+
+  ++generation;
+  gamesPlayed+=scores.size();
+  last.number=generation;
+  last.meanScore=all/scores.size();
+  last.eliteScore=eliteTotal/((double)elite*games);
+  last.bestScore=totals[order[0]]/games;
+  last.best=candidates[order[0]];
+  return last;
+}
+
+Evaluator::Weights Tuner::getMean() const
+{
+  Evaluator::Weights ret;
+  std::copy(mean.begin(),mean.end(),ret.w);
+  return ret;
+}
+
+double Tuner::play(const Evaluator::Weights &w, std::uint64_t seed, unsigned pieces, bool preview)
+{
+  HeadlessGame game(seed);
+  Bot bot(w,preview);
+  PieceInput inputs[MoveList::MAX_PATH];
+  unsigned long height=0;
+  unsigned placed=0;
+  while(placed<pieces && !game.isGameOver())
+    {
+      game.step(inputs,bot.plan(game,inputs,MoveList::MAX_PATH));
+      height+=Bitboard::fromField(game.getField()).height();
+      ++placed;
+    }
+  return game.getField().readScore()-(placed ? (double)height/placed : 0.0);
+}
+
+const char* Tuner::featureName(unsigned feature)
+{
+  return feature<Evaluator::FEATURE_COUNT ? FEATURE_NAMES[feature] : "unknown";
+}
+
+void Tuner::save(const std::string &path) const
+{
+  const std::string temp=path+".tmp";
+  {
+    std::ofstream out(temp.c_str(),std::ios::trunc);
+    out.precision(std::numeric_limits<double>::max_digits10);
+    out << CHECKPOINT_MAGIC << ' ' << CHECKPOINT_VERSION << '\n'
+	<< "settings " << settings.population << ' ' << settings.elite << ' '
+	<< settings.games << ' ' << settings.pieces << ' ' << settings.seed << ' '
+	<< settings.sigma << ' ' << settings.noise << ' ' << settings.preview << '\n'
+	<< "generation " << generation << ' ' << gamesPlayed << '\n';
+    for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+      {
+	out << FEATURE_NAMES[f] << ' ' << mean[f] << ' ' << sigma[f] << '\n';
+      }
+    out << "end" << std::endl;
+    if(!out)
+      {
+	throw CheckpointError("cannot write "+temp);
+      }
+  }
+  // rename replaces the old checkpoint in one step, so a run killed while
+  // saving leaves the previous one intact.
+  if(0!=std::rename(temp.c_str(),path.c_str()))
+    {
+      throw CheckpointError("cannot rename "+temp+": "+std::strerror(errno));
+    }
+}
+
+bool Tuner::load(const std::string &path)
+{
+  std::ifstream in(path.c_str());
+  if(!in)
+    {
+      if(ENOENT==errno)
+	{
+	  return false;
+	}
+      throw CheckpointError("cannot read "+path+": "+std::strerror(errno));
+    }
+  std::string word;
+  unsigned version=0;
+  Settings s;
+  unsigned g=0;
+  unsigned long played=0;
+  std::vector<double> m(Evaluator::FEATURE_COUNT),sd(Evaluator::FEATURE_COUNT);
+  in >> word >> version;
+  if(!in || CHECKPOINT_MAGIC!=word || CHECKPOINT_VERSION!=version)
+    {
+      throw CheckpointError(path+" is not a checkpoint of this version");
+    }
+  in >> word >> s.population >> s.elite >> s.games >> s.pieces >> s.seed
+     >> s.sigma >> s.noise >> s.preview;
+  if(!in || "settings"!=word)
+    {
+      throw CheckpointError(path+" is damaged");
+    }
+  if(!(s==settings))
+    {
+      throw CheckpointError(path+" was made with other settings");
+    }
+  in >> word >> g >> played;
+  if(!in || "generation"!=word)
+    {
+      throw CheckpointError(path+" is damaged");
+    }
+  for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+    {
+      in >> word >> m[f] >> sd[f];
+      if(!in || FEATURE_NAMES[f]!=word)
+	{
+	  throw CheckpointError(path+" is damaged");
+	}
+    }
+  in >> word;
+  if(!in || "end"!=word)
+    {
+      throw CheckpointError(path+" is damaged");
+    }
+
+  generation=g;
+  gamesPlayed=played;
+  mean=m;
+  sigma=sd;
+  last.number=g;
+  last.meanScore=last.eliteScore=last.bestScore=0;
+  last.best=getMean();
+  return true;
+}
@@ -0,0 +1,111 @@
+#ifndef TUNER_HPP
+#define TUNER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Bot.hpp"
+#include "WorkerPool.hpp"
+
+/* Tuner
+   Tunes Evaluator weights with the cross-entropy method. Every weight has a
+   normal distribution, starting at the default weights. Each generation
+   draws population weight vectors from the distributions, plays the same
+   games with each, and refits the distributions to the elite best: their
+   mean, and their standard deviation plus some noise that fades over the
+   generations, which keeps the search from settling too early.
+
+   A candidate plays games of at most pieces pieces with a Bot, without the
+   preview unless asked, since a weaker player separates the weights better
+   and runs much faster. A game scores the lines it cleared less its average
+   stack height; a game lost early clears fewer lines, and among games that
+   last the lower stack is the better one.
+
+   Every game of every candidate is a separate task on the pool. The
+   candidates and game seeds of a generation depend only on the seed, the
+   generation number and the distributions, and the scores are gathered in
+   candidate order, so a run gives the same weights whatever the number of
+   threads, and a run resumed from a checkpoint carries on exactly as if it
+   had never stopped.
+ */
+class Tuner
+{
+public:
+  struct Settings
+  {
+    unsigned population,elite,games,pieces;
+    std::uint64_t seed;
+    // Starting standard deviation, and noise added to it in the first
+    // generation; the noise falls as 1/(generation+1).
+    double sigma,noise;
+    bool preview;
+
+    Settings():population(100),elite(10),games(10),pieces(2000),seed(1),
+	       sigma(2.0),noise(1.0),preview(false)
+    {}
+    bool operator==(const Settings &) const;
+  };
+  struct Generation
+  {
+    // Generations finished, counting this one.
+    unsigned number;
+    // Scores per game: over every candidate, over the elite, and the best.
+    double meanScore,eliteScore,bestScore;
+    Evaluator::Weights best;
+  };
+
+  Tuner(WorkerPool &, const Settings &s=Settings());
+
+  // Play one generation and refit the distributions.
+  const Generation& step();
+
+  // The mean of the distributions, which is the tuner's answer.
+  Evaluator::Weights getMean() const;
+  const std::vector<double>& getSigma() const
+  {
+    return sigma;
+  }
+  unsigned getGeneration() const
+  {
+    return generation;
+  }
+  const Settings& getSettings() const
+  {
+    return settings;
+  }
+  // Games played so far, counting those before a resume.
+  unsigned long getGamesPlayed() const
+  {
+    return gamesPlayed;
+  }
+
+  // Write the state to path, replacing it only once the new state is
+  // complete. Throws CheckpointError.
+  void save(const std::string &path) const;
+  // Restore the state from path. Returns false if there is no such file.
+  // Throws CheckpointError if the file is not a checkpoint or was made with
+  // other settings.
+  bool load(const std::string &path);
+
+  // The score of one game with the given weights, as described above.
+  static double play(const Evaluator::Weights &, std::uint64_t seed, unsigned pieces,
+		     bool preview=false);
+  static const char* featureName(unsigned feature);
+private:
+  Tuner(const Tuner&) = delete; // Uncopyable
+
+  WorkerPool &pool;
+  Settings settings;
+  unsigned generation;
+  unsigned long gamesPlayed;
+  std::vector<double> mean,sigma;
+  std::vector<Evaluator::Weights> candidates;
+  std::vector<std::uint64_t> seeds;
+  std::vector<double> scores;
+  Generation last;
+
+  void sample();
+};
+
+#endif // TUNER_HPP
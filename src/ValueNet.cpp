@@ -0,0 +1,464 @@
+#include "ValueNet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <limits>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define VALUENET_X86 1
+#include <immintrin.h>
+#endif
+
+#include "Randomizer.hpp"
+
+static const char MAGIC[4]={'U','T','V','N'};
+static constexpr std::uint32_t VERSION=1;
+// More would be a corrupt file, not a small net.
+static constexpr std::uint32_t MAX_LAYERS=16,MAX_UNITS=1u<<16;
+
+constexpr unsigned ValueNet::INPUTS;
+constexpr std::size_t ValueNet::STRIDE;
+
+static std::size_t padded(unsigned n)
+{
+  return (n+7)/8*8;
+}
+
+// Layer kernels: dst gets count rows of dstStride, the layer's outs
+// followed by zeros.
+
+static void forwardScalar(const float *w, const float *bias, unsigned outs, std::size_t stride,
+			  const float *in, std::size_t count, float *dst,
+			  std::size_t dstStride, bool relu)
+{
+  for(std::size_t r=0;r<count;++r)
+    {
+      const float *x=in+r*stride;
+      float *y=dst+r*dstStride;
+      for(unsigned j=0;j<outs;++j)
+	{
+	  const float *row=w+j*stride;
+	  float s=bias[j];
+	  for(std::size_t k=0;k<stride;++k)
+	    {
+	      s+=row[k]*x[k];
+	    }
+	  y[j]=(relu && s<0) ? 0 : s;
+	}
+      std::fill(y+outs,y+dstStride,0.0f);
+    }
+}
+
+#ifdef VALUENET_X86
+__attribute__((target("avx2,fma")))
+static inline float sum8(__m256 v)
+{
+  __m128 s=_mm_add_ps(_mm256_castps256_ps128(v),_mm256_extractf128_ps(v,1));
+  s=_mm_hadd_ps(s,s);
+  s=_mm_hadd_ps(s,s);
+  return _mm_cvtss_f32(s);
+}
+
+/* R rows by C outputs at a time: each weight vector loaded serves R rows and
+   each input vector C outputs, with R*C accumulators in registers. */
+template <int R, int C>
+__attribute__((target("avx2,fma")))
+static inline void blockAvx2(const float *w, const float *bias, std::size_t stride,
+			     const float *x, float *y, std::size_t dstStride, bool relu)
+{
+  __m256 acc[R][C];
+  for(int r=0;r<R;++r)
+    {
+      for(int c=0;c<C;++c)
+	{
+	  acc[r][c]=_mm256_setzero_ps();
+	}
+    }
+  for(std::size_t k=0;k<stride;k+=8)
+    {
+      __m256 xv[R];
+      for(int r=0;r<R;++r)
+	{
+	  xv[r]=_mm256_loadu_ps(x+r*stride+k);
+	}
+      for(int c=0;c<C;++c)
+	{
+	  const __m256 wv=_mm256_loadu_ps(w+c*stride+k);
+	  for(int r=0;r<R;++r)
+	    {
+	      acc[r][c]=_mm256_fmadd_ps(wv,xv[r],acc[r][c]);
+	    }
+	}
+    }
+  for(int r=0;r<R;++r)
+    {
+      for(int c=0;c<C;++c)
+	{
+	  const float s=sum8(acc[r][c])+bias[c];
+	  y[r*dstStride+c]=(relu && s<0) ? 0 : s;
+	}
+    }
+}
+
+template <int R>
+__attribute__((target("avx2,fma")))
+static void rowsAvx2(const float *w, const float *bias, unsigned outs, std::size_t stride,
+		     const float *x, float *y, std::size_t dstStride, bool relu)
+{
+  unsigned j=0;
+  for(;j+4<=outs;j+=4)
+    {
+      blockAvx2<R,4>(w+j*stride,bias+j,stride,x,y+j,dstStride,relu);
+    }
+  for(;j<outs;++j)
+    {
+      blockAvx2<R,1>(w+j*stride,bias+j,stride,x,y+j,dstStride,relu);
+    }
+  for(int r=0;r<R;++r)
+    {
+      std::fill(y+r*dstStride+outs,y+(r+1)*dstStride,0.0f);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void forwardAvx2(const float *w, const float *bias, unsigned outs, std::size_t stride,
+			const float *in, std::size_t count, float *dst,
+			std::size_t dstStride, bool relu)
+{
+  std::size_t r=0;
+  for(;r+2<=count;r+=2)
+    {
+      rowsAvx2<2>(w,bias,outs,stride,in+r*stride,dst+r*dstStride,dstStride,relu);
+    }
+  if(r<count)
+    {
+      rowsAvx2<1>(w,bias,outs,stride,in+r*stride,dst+r*dstStride,dstStride,relu);
+    }
+}
+#endif // VALUENET_X86
+
+bool ValueNet::haveAvx2()
+{
+#ifdef VALUENET_X86
+  return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+#else
+  return false;
+#endif
+}
+
+void ValueNet::setKernel(Kernel k)
+{
+  kernel=(AVX2==k && haveAvx2()) ? AVX2 : SCALAR;
+}
+
+void ValueNet::build(const std::vector<unsigned> &s)
+{
+  if(s.size()<2 || s.size()>MAX_LAYERS+1 || INPUTS!=s.front() || 1!=s.back())
+    {
+      throw ModelError("layers must run from "+std::to_string(INPUTS)+" inputs to 1 output");
+    }
+  sizes=s;
+  layers.resize(s.size()-1);
+  for(std::size_t l=0;l<layers.size();++l)
+    {
+      Layer &layer=layers[l];
+      if(0==s[l+1] || s[l+1]>MAX_UNITS)
+	{
+	  throw ModelError("bad layer size "+std::to_string(s[l+1]));
+	}
+      layer.in=s[l];
+      layer.out=s[l+1];
+      layer.stride=padded(layer.in);
+      layer.weights.assign(layer.out*layer.stride,0.0f);
+      layer.bias.assign(layer.out,0.0f);
+    }
+  setKernel(AVX2);
+}
+
+ValueNet::ValueNet(const std::vector<unsigned> &hidden, std::uint64_t seed):
+  sizes(),layers(),kernel(SCALAR),scratch()
+{
+  std::vector<unsigned> s(1,INPUTS);
+  s.insert(s.end(),hidden.begin(),hidden.end());
+  s.push_back(1);
+  build(s);
+  // Glorot's uniform initialization.
+  Pcg32 rng(seed,3);
+  for(Layer &layer : layers)
+    {
+      const float limit=std::sqrt(6.0f/(layer.in+layer.out));
+      for(unsigned j=0;j<layer.out;++j)
+	{
+	  for(unsigned k=0;k<layer.in;++k)
+	    {
+	      layer.weights[j*layer.stride+k]=limit*(rng()*(2.0f/4294967296.0f)-1);
+	    }
+	}
+    }
+}
+
+ValueNet ValueNet::linear(const Evaluator::Weights &w, const std::vector<unsigned> &hidden)
+{
+  ValueNet ret(hidden,0);
+  std::vector<Layer> &layers=ret.layers;
+  for(std::size_t l=0;l<layers.size();++l)
+    {
+      if(l+1<layers.size() && layers[l].out<2)
+	{
+	  throw ModelError("a linear net needs two units in every hidden layer");
+	}
+      std::fill(layers[l].weights.begin(),layers[l].weights.end(),0.0f);
+    }
+  Layer &first=layers.front();
+  for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+    {
+      first.weights[FIELD_SIZE+f]=w.w[f];
+      if(layers.size()>1)
+	{
+	  first.weights[first.stride+FIELD_SIZE+f]=-w.w[f];
+	}
+    }
+  // relu(s)-relu(-s) is s.
+  for(std::size_t l=1;l+1<layers.size();++l)
+    {
+      layers[l].weights[0]=1;
+      layers[l].weights[layers[l].stride+1]=1;
+    }
+  if(layers.size()>1)
+    {
+      layers.back().weights[0]=1;
+      layers.back().weights[1]=-1;
+    }
+  return ret;
+}
+
+static std::uint32_t readU32(std::istream &in)
+{
+  unsigned char b[4]={0,0,0,0};
+  in.read(reinterpret_cast<char*>(b),4);
+  return b[0] | (std::uint32_t)b[1]<<8 | (std::uint32_t)b[2]<<16 | (std::uint32_t)b[3]<<24;
+}
+
+static void writeU32(std::ostream &out, std::uint32_t v)
+{
+  const unsigned char b[4]={(unsigned char)v,(unsigned char)(v>>8),(unsigned char)(v>>16),
+			    (unsigned char)(v>>24)};
+  out.write(reinterpret_cast<const char*>(b),4);
+}
+
+static float readF32(std::istream &in)
+{
+  const std::uint32_t bits=readU32(in);
+  float ret;
+  std::memcpy(&ret,&bits,4);
+  return ret;
+}
+
+static void writeF32(std::ostream &out, float v)
+{
+  std::uint32_t bits;
+  std::memcpy(&bits,&v,4);
+  writeU32(out,bits);
+}
+
+ValueNet::ValueNet(const std::string &path):sizes(),layers(),kernel(SCALAR),scratch()
+{
+  std::ifstream in(path.c_str(),std::ios::binary);
+  if(!in)
+    {
+      throw ModelError("cannot read "+path);
+    }
+  char magic[4];
+  in.read(magic,4);
+  if(!in || !std::equal(magic,magic+4,MAGIC))
+    {
+      throw ModelError(path+" is not a value net");
+    }
+  if(VERSION!=readU32(in))
+    {
+      throw ModelError(path+" has an unknown version");
+    }
+  const std::uint32_t count=readU32(in);
+  if(!in || 0==count || count>MAX_LAYERS)
+    {
+      throw ModelError(path+" has a bad layer count");
+    }
+  std::vector<unsigned> s(count+1);
+  for(unsigned &n : s)
+    {
+      n=readU32(in);
+    }
+  if(!in)
+    {
+      throw ModelError(path+" is truncated");
+    }
+  // Every weight and bias is stored, so a file that is too short for
+  // its layer sizes is rejected here rather than after build() has
+  // allocated them.
+  const std::streampos start=in.tellg();
+  in.seekg(0,std::ios::end);
+  const std::uint64_t floats=(std::uint64_t)(in.tellg()-start)/4;
+  in.seekg(start);
+  std::uint64_t needed=0;
+  for(std::size_t l=0;l+1<s.size();++l)
+    {
+      const std::uint64_t layer=(std::uint64_t)s[l]*s[l+1]+s[l+1];
+      if(!in || layer>floats-needed)
+	{
+	  throw ModelError(path+" is truncated");
+	}
+      needed+=layer;
+    }
+  build(s);
+  for(Layer &layer : layers)
+    {
+      for(unsigned j=0;j<layer.out;++j)
+	{
+	  for(unsigned k=0;k<layer.in;++k)
+	    {
+	      layer.weights[j*layer.stride+k]=readF32(in);
+	    }
+	}
+      for(float &b : layer.bias)
+	{
+	  b=readF32(in);
+	}
+    }
+  if(!in)
+    {
+      throw ModelError(path+" is truncated");
+    }
+}
+
+void ValueNet::save(const std::string &path) const
+{
+  std::ofstream out(path.c_str(),std::ios::binary | std::ios::trunc);
+  out.write(MAGIC,4);
+  writeU32(out,VERSION);
+  writeU32(out,layers.size());
+  for(unsigned n : sizes)
+    {
+      writeU32(out,n);
+    }
+  for(const Layer &layer : layers)
+    {
+      for(unsigned j=0;j<layer.out;++j)
+	{
+	  for(unsigned k=0;k<layer.in;++k)
+	    {
+	      writeF32(out,layer.weights[j*layer.stride+k]);
+	    }
+	}
+      for(float b : layer.bias)
+	{
+	  writeF32(out,b);
+	}
+    }
+  out.close();
+  if(!out)
+    {
+      throw ModelError("cannot write "+path);
+    }
+}
+
+void ValueNet::encode(const Bitboard &b, int lines, int landing, float *row)
+{
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      for(int x=0;x<FIELD_WIDTH;++x)
+	{
+	  row[y*FIELD_WIDTH+x]=(b.rows[y]>>x) & 1;
+	}
+    }
+  int f[Evaluator::FEATURE_COUNT];
+  Evaluator::features(b,f);
+  f[Evaluator::LINES]=lines;
+  f[Evaluator::LANDING]=landing;
+  std::copy(f,f+Evaluator::FEATURE_COUNT,row+FIELD_SIZE);
+  std::fill(row+INPUTS,row+STRIDE,0.0f);
+}
+
+void ValueNet::evaluate(const float *rows, std::size_t count, float *out)
+{
+  const float *in=rows;
+  for(std::size_t l=0;l<layers.size();++l)
+    {
+      const Layer &layer=layers[l];
+      const bool last=l+1==layers.size();
+      const std::size_t dstStride=last ? 1 : layers[l+1].stride;
+      float *dst=out;
+      if(!last)
+	{
+	  scratch[l%2].resize(count*dstStride);
+	  dst=scratch[l%2].data();
+	}
+#ifdef VALUENET_X86
+      if(AVX2==kernel)
+	{
+	  forwardAvx2(layer.weights.data(),layer.bias.data(),layer.out,layer.stride,in,count,
+		      dst,dstStride,!last);
+	}
+      else
+#endif
+	{
+	  forwardScalar(layer.weights.data(),layer.bias.data(),layer.out,layer.stride,in,count,
+			dst,dstStride,!last);
+	}
+      in=dst;
+    }
+}
+
+// NetBot
+
+NetBot::NetBot(ValueNet &n):net(n),moves(),batch(),scores()
+{
+}
+
+std::size_t NetBot::plan(const Bitboard &board, PieceType type, unsigned orientation,
+			 const coord &center, PieceInput *out, std::size_t max)
+{
+  moves.generate(board,type,orientation,center);
+  const std::size_t count=moves.size();
+  if(0==count)
+    {
+      return 0;
+    }
+  batch.resize(count*ValueNet::STRIDE);
+  scores.resize(count);
+  bool topped[MoveList::STATES];
+  for(std::size_t i=0;i<count;++i)
+    {
+      const Placement &p=moves[i];
+      Bitboard b=board;
+      const int lines=b.place(type,p.orientation,p.x,p.y);
+      topped[i]=b.toppedOut();
+      ValueNet::encode(b,lines,p.y+PieceMask::get(type,p.orientation).bottom,
+		       &batch[i*ValueNet::STRIDE]);
+    }
+  net.evaluate(batch.data(),count,scores.data());
+
+  std::size_t best=0;
+  float bestScore=std::numeric_limits<float>::lowest();
+  for(std::size_t i=0;i<count;++i)
+    {
+      if(!topped[i] && scores[i]>bestScore)
+	{
+	  best=i;
+	  bestScore=scores[i];
+	}
+    }
+  return moves.path(best,out,max);
+}
+
+std::size_t NetBot::plan(const HeadlessGame &game, PieceInput *out, std::size_t max)
+{
+  if(game.isGameOver())
+    {
+      return 0;
+    }
+  const Piece &current=game.getCurrent();
+  return plan(Bitboard::fromField(game.getField()),current.getType(),
+	      current.getOrientation(),current.getCenter(),out,max);
+}
@@ -0,0 +1,108 @@
+#ifndef VALUENET_HPP
+#define VALUENET_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Bot.hpp"
+
+/* ValueNet
+   A small multilayer perceptron that scores the board left by a placement:
+   fully connected layers with ReLU between them and one linear output,
+   higher being better. Its input row is the board's cells, row by row from
+   the bottom, 1 for a block and 0 for none, followed by the Evaluator's
+   features with the placement's lines and landing height.
+
+   evaluate takes a whole batch of rows at once, layer by layer, so every
+   weight is loaded once per batch row rather than per call. The kernels are
+   float dot products: AVX2 with FMA where the processor has them, chosen
+   when the net is made, and plain C++ otherwise. Both give the same scores
+   up to rounding.
+
+   Weight files are little endian:
+     "UTVN", version (u32, 1), layer count L (u32),
+     L+1 sizes (u32), the first INPUTS and the last 1,
+     then for each layer its weights (f32), a row of inputs per output, and
+     its biases (f32), one per output.
+ */
+class ValueNet
+{
+public:
+  static constexpr unsigned INPUTS=FIELD_SIZE+Evaluator::FEATURE_COUNT;
+  enum Kernel
+    {
+      SCALAR,AVX2
+    };
+
+  // Random weights with these hidden layer sizes.
+  ValueNet(const std::vector<unsigned> &hidden, std::uint64_t seed);
+  // Load a weight file. Throws ModelError.
+  explicit ValueNet(const std::string &path);
+  // A net that scores exactly as the evaluator does, up to rounding: two
+  // units of every hidden layer carry the positive and negative parts of the
+  // evaluator's sum, and the rest are zero. Every hidden layer needs at least
+  // two units. A start for training that plays well from the first step.
+  static ValueNet linear(const Evaluator::Weights &, const std::vector<unsigned> &hidden);
+
+  // Write the weight file. Throws ModelError.
+  void save(const std::string &path) const;
+
+  // Floats per input row: INPUTS rounded up for the kernels.
+  static constexpr std::size_t STRIDE=(INPUTS+7)/8*8;
+  // Fill a row for a board with the placement's lines and landing height.
+  static void encode(const Bitboard &, int lines, int landing, float *row);
+  // Score count rows, STRIDE floats apart.
+  void evaluate(const float *rows, std::size_t count, float *out);
+
+  Kernel getKernel() const
+  {
+    return kernel;
+  }
+  // Use a kernel; AVX2 falls back to SCALAR where it is not available.
+  void setKernel(Kernel);
+  static bool haveAvx2();
+  const std::vector<unsigned>& getSizes() const
+  {
+    return sizes;
+  }
+private:
+  struct Layer
+  {
+    unsigned in,out;
+    // Row stride of weights and of the layer's input: in rounded up to 8.
+    std::size_t stride;
+    // out rows of stride, zero padded.
+    std::vector<float> weights;
+    std::vector<float> bias;
+  };
+  std::vector<unsigned> sizes;
+  std::vector<Layer> layers;
+  Kernel kernel;
+  std::vector<float> scratch[2];
+
+  void build(const std::vector<unsigned> &sizes);
+};
+
+/* NetBot
+   Plays one piece at a time with a ValueNet: every placement from the
+   MoveList is encoded into one batch, scored in one call, and the best taken.
+   Placements that top out are taken only if nothing else is possible. Like
+   a Bot, a NetBot is for one thread at a time.
+ */
+class NetBot
+{
+public:
+  explicit NetBot(ValueNet &);
+
+  std::size_t plan(const Bitboard &, PieceType type, unsigned orientation,
+		   const coord &center, PieceInput *out, std::size_t max);
+  std::size_t plan(const HeadlessGame &, PieceInput *out, std::size_t max);
+private:
+  ValueNet &net;
+  MoveList moves;
+  std::vector<float> batch,scores;
+};
+
+#endif // VALUENET_HPP
@@ -0,0 +1,202 @@
+#include "WorkerPool.hpp"
+
+#include <algorithm>
+#include <stdexcept>
+
+static inline std::uint64_t span(std::uint64_t begin, std::uint64_t end)
+{
+  return begin | (end<<32);
+}
+
+WorkerPool::WorkerPool(unsigned threads):workers(),ranges(),guard(),wake(),done(),
+					 func(nullptr),context(nullptr),count(0),
+					 stealing(false),generation(0),busy(0),
+					 stopping(false),failure(),nextIndex(0),steals(0)
+{
+  if(0==threads)
+    {
+      threads=std::max(1u,std::thread::hardware_concurrency());
+    }
+  ranges.reset(new Range[threads]);
+  for(unsigned i=0;i<threads;++i)
+    {
+      ranges[i].span.store(0,std::memory_order_relaxed);
+    }
+  for(unsigned i=1;i<threads;++i)
+    {
+      workers.push_back(std::thread(&WorkerPool::workerLoop,this,i));
+    }
+}
+
+WorkerPool::~WorkerPool()
+{
+  {
+    std::lock_guard<std::mutex> lock(guard);
+    stopping=true;
+  }
+  wake.notify_all();
+  for(auto &t : workers)
+    {
+      t.join();
+    }
+}
+
+void WorkerPool::runErased(std::size_t count_, taskfunc func_, void *context_,
+			   bool stealing_)
+{
+  if(0==count_)
+    {
+      return;
+    }
+  if(stealing_ && count_>=(std::size_t(1)<<32))
+    {
+      throw std::length_error("WorkerPool::runStealing: too many tasks");
+    }
+  {
+    std::lock_guard<std::mutex> lock(guard);
+    func=func_;
+    context=context_;
+    count=count_;
+    stealing=stealing_;
+    nextIndex.store(0,std::memory_order_relaxed);
+    steals.store(0,std::memory_order_relaxed);
+    if(stealing)
+      {
+	const std::size_t n=size();
+	for(std::size_t t=0;t<n;++t)
+	  {
+	    ranges[t].span.store(span(count*t/n,count*(t+1)/n),std::memory_order_relaxed);
+	  }
+      }
+    failure=nullptr;
+    busy=workers.size();
+    ++generation;
+  }
+  wake.notify_all();
+  work(0);
+
+  std::unique_lock<std::mutex> lock(guard);
+  done.wait(lock,[this] { return 0==busy; });
+  if(failure)
+    {
+      std::rethrow_exception(failure);
+    }
+}
+
+void WorkerPool::call(std::size_t i, unsigned thread)
+{
+  try
+    {
+      func(context,i,thread);
+    }
+  catch(...)
+    {
+      std::lock_guard<std::mutex> lock(guard);
+      if(!failure)
+	{
+	  failure=std::current_exception();
+	}
+    }
+}
+
+// Take indices until there are none left.
+void WorkerPool::work(unsigned thread)
+{
+  std::size_t i;
+  if(!stealing)
+    {
+      while((i=nextIndex.fetch_add(1,std::memory_order_relaxed))<count)
+	{
+	  call(i,thread);
+	}
+      return;
+    }
+  do
+    {
+      while(take(thread,i))
+	{
+	  call(i,thread);
+	}
+    }
+  while(steal(thread));
+}
+
+// Take the first index of the thread's own range. Thieves may shrink the
+// range from the back at the same time.
+bool WorkerPool::take(unsigned thread, std::size_t &i)
+{
+  std::atomic<std::uint64_t> &mine=ranges[thread].span;
+  std::uint64_t s=mine.load(std::memory_order_relaxed);
+  while(true)
+    {
+      const std::uint64_t begin=s & 0xffffffffu, end=s>>32;
+      if(begin>=end)
+	{
+	  return false;
+	}
+      if(mine.compare_exchange_weak(s,span(begin+1,end),std::memory_order_relaxed))
+	{
+	  i=begin;
+	  return true;
+	}
+    }
+}
+
+// Move the back half of the largest range left into the thread's own, which
+// is empty. Returns false if every range is empty.
+bool WorkerPool::steal(unsigned thread)
+{
+  const unsigned n=size();
+  while(true)
+    {
+      unsigned victim=n;
+      std::uint64_t s=0,most=0;
+      for(unsigned k=1;k<n;++k)
+	{
+	  const unsigned t=(thread+k)%n;
+	  const std::uint64_t v=ranges[t].span.load(std::memory_order_relaxed);
+	  const std::uint64_t left=(v>>32)-std::min(v>>32,v & 0xffffffffu);
+	  if(left>most)
+	    {
+	      victim=t;
+	      s=v;
+	      most=left;
+	    }
+	}
+      if(n==victim)
+	{
+	  return false;
+	}
+      const std::uint64_t begin=s & 0xffffffffu, end=s>>32;
+      const std::uint64_t middle=begin+(end-begin)/2;
+      if(ranges[victim].span.compare_exchange_strong(s,span(begin,middle),
+						     std::memory_order_relaxed))
+	{
+	  ranges[thread].span.store(span(middle,end),std::memory_order_relaxed);
+	  steals.fetch_add(1,std::memory_order_relaxed);
+	  return true;
+	}
+    }
+}
+
+void WorkerPool::workerLoop(unsigned thread)
+{
+  unsigned long seen=0;
+  std::unique_lock<std::mutex> lock(guard);
+  while(true)
+    {
+      wake.wait(lock,[this,seen] { return stopping || generation!=seen; });
+      if(stopping)
+	{
+	  return;
+	}
+      seen=generation;
+      lock.unlock();
+      work(thread);
+      lock.lock();
+      if(0==--busy)
+	{
+	  done.notify_one();
+	}
+    }
+}
@@ -0,0 +1,110 @@
+#ifndef WORKERPOOL_HPP
+#define WORKERPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/* WorkerPool
+   A fixed set of threads for data-parallel loops. run(count,task) calls
+   task(i) once for every i in [0,count) and returns when all calls have
+   finished; the calling thread does its share of the work. Indices are
+   handed out one at a time, so uneven tasks balance themselves, but which
+   thread runs which index is not defined: tasks must not depend on each
+   other or on the order they run in.
+
+   runStealing(count,task) calls task(i,thread) instead, where thread is the
+   number of the thread running the call, from 0 (the caller) to size()-1, so
+   tasks can use per-thread scratch space without locking. The indices are
+   dealt out as one contiguous range per thread up front. Each thread works
+   through its own range in order, and a thread that runs out steals the back
+   half of the largest range left. Threads mostly stay on their own indices
+   and touch no shared counter, which suits many small tasks. count must be
+   below 2^32.
+
+   The threads sleep between calls. Only one thread may call run or
+   runStealing at a time, and not from inside a task. If a task throws, the
+   first exception is rethrown once every other task has finished.
+ */
+class WorkerPool
+{
+public:
+  // threads counts the caller; 0 means one per hardware thread.
+  explicit WorkerPool(unsigned threads=0);
+  ~WorkerPool();
+
+  unsigned size() const
+  {
+    return workers.size()+1;
+  }
+
+  template <class F>
+  void run(std::size_t count, const F &task)
+  {
+    runErased(count,&invoke<F>,const_cast<F*>(&task),false);
+  }
+  template <class F>
+  void runStealing(std::size_t count, const F &task)
+  {
+    runErased(count,&invokeStealing<F>,const_cast<F*>(&task),true);
+  }
+  // Ranges stolen during the last call to runStealing.
+  unsigned long getSteals() const
+  {
+    return steals.load(std::memory_order_relaxed);
+  }
+private:
+  WorkerPool(const WorkerPool&) = delete; // Uncopyable
+  typedef void (*taskfunc)(void*, std::size_t, unsigned);
+
+  template <class F>
+  static void invoke(void *task, std::size_t i, unsigned)
+  {
+    (*static_cast<const F*>(task))(i);
+  }
+  template <class F>
+  static void invokeStealing(void *task, std::size_t i, unsigned thread)
+  {
+    (*static_cast<const F*>(task))(i,thread);
+  }
+
+  // The indices a thread has left, begin in the low and end in the high 32
+  // bits, so that both change in one compare and swap. Padded so that no two
+  // threads' ranges share a cache line.
+  struct Range
+  {
+    std::atomic<std::uint64_t> span;
+    char padding[64-sizeof(std::atomic<std::uint64_t>)];
+  };
+
+  std::vector<std::thread> workers;
+  std::unique_ptr<Range[]> ranges;
+  std::mutex guard;
+  std::condition_variable wake,done;
+  // The current job; changed only while no worker is busy.
+  taskfunc func;
+  void *context;
+  std::size_t count;
+  bool stealing;
+  unsigned long generation;
+  unsigned busy;
+  bool stopping;
+  std::exception_ptr failure;
+  std::atomic<std::size_t> nextIndex;
+  std::atomic<unsigned long> steals;
+
+  void runErased(std::size_t count, taskfunc, void *context, bool stealing);
+  void call(std::size_t i, unsigned thread);
+  void work(unsigned thread);
+  bool take(unsigned thread, std::size_t &i);
+  bool steal(unsigned thread);
+  void workerLoop(unsigned thread);
+};
+
+#endif // WORKERPOOL_HPP
@@ -73,13 +73,20 @@ enum PieceType
   {
     I,J,L,O,S,T,Z
   };
+// The first five act on a piece at once. The rest are the state of the shift
+// keys: a game shifts the piece when one is pressed, and again while it is
+// held, as its auto-repeat says (see HeadlessGame).
 enum PieceInput
   {
     shift_right,
     shift_left,
     rotate_cw,
     rotate_ccw,
-    hard_drop
+    hard_drop,
+    press_right,
+    press_left,
+    release_right,
+    release_left
   };
 
 class FieldSizeError : public std::out_of_range
@@ -122,6 +129,78 @@ public:
   }
 };
 
+class ShmError: public std::runtime_error
+{
+public:
+  ShmError(const std::string &what) : std::runtime_error("Shared memory error: "+what)
+  {
+  }
+};
+
+class NetError: public std::runtime_error
+{
+public:
+  NetError(const std::string &what) : std::runtime_error("Network error: "+what)
+  {
+  }
+};
+
+class PipeError: public std::runtime_error
+{
+public:
+  PipeError(const std::string &what) : std::runtime_error("Pipe error: "+what)
+  {
+  }
+};
+
+class CheckpointError: public std::runtime_error
+{
+public:
+  CheckpointError(const std::string &what) : std::runtime_error("Checkpoint error: "+what)
+  {
+  }
+};
+
+class ModelError: public std::runtime_error
+{
+public:
+  ModelError(const std::string &what) : std::runtime_error("Model error: "+what)
+  {
+  }
+};
+
+class SpillError: public std::runtime_error
+{
+public:
+  SpillError(const std::string &what) : std::runtime_error("Spill error: "+what)
+  {
+  }
+};
+
+class DatabaseError: public std::runtime_error
+{
+public:
+  DatabaseError(const std::string &what) : std::runtime_error("Database error: "+what)
+  {
+  }
+};
+
+class ReplayError: public std::runtime_error
+{
+public:
+  ReplayError(const std::string &what) : std::runtime_error("Replay error: "+what)
+  {
+  }
+};
+
+class WriterError: public std::runtime_error
+{
+public:
+  WriterError(const std::string &what) : std::runtime_error("Writer error: "+what)
+  {
+  }
+};
+
 // Why is this not in the STL?
 template <class T>
 inline std::string to_string (const T& t)
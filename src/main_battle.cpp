@@ -0,0 +1,94 @@
+/* tetris_battle
+   Runs battle royale matches between random agents, and optionally some bots,
+   as fast as the machine allows, and reports how long they took and how they
+   ended. The checksum identifies the outcome: the same seed gives the same
+   checksum with any number of threads.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "BattleMatch.hpp"
+#include "Bot.hpp"
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--players N] [--bots N] [--seed N] [--threads N] [--matches N]"
+    " [--frames N]\n";
+  unsigned players=99,bots=0,seed=1,threads=0,matches=1,frames=60*60*60;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--players"))
+	{
+	  players=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--bots"))
+	{
+	  bots=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--matches"))
+	{
+	  matches=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--frames"))
+	{
+	  frames=std::atoi(argv[++i]);
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+
+  WorkerPool pool(threads);
+  unsigned long boardFrames=0;
+  double total=0;
+  std::cout << "threads " << pool.size() << std::endl;
+  for(unsigned m=0;m<matches;++m)
+    {
+      BattleMatch match(players,seed+m);
+      // The first players are bots, moving as often as the random agents; the
+      // rest play at random.
+      for(unsigned i=0;i<bots && i<players;++i)
+	{
+	  match.setAgent(i,std::unique_ptr<Agent>(new BotAgent(Evaluator::Weights::defaults(),2)));
+	}
+      const auto t0=std::chrono::steady_clock::now();
+      match.run(pool,frames);
+      const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+      total+=elapsed.count();
+
+      unsigned winner=0,sent=0,lines=0;
+      for(unsigned i=0;i<match.getPlayers();++i)
+	{
+	  boardFrames+=match.getGame(i).getFrame();
+	  sent+=match.getLinesSent(i);
+	  lines+=match.getGame(i).getField().readScore();
+	  if(1==match.getPlace(i))
+	    {
+	      winner=i;
+	    }
+	}
+      std::cout << "match " << m << " seed " << seed+m
+		<< " frames " << match.getFrame()
+		<< " (" << match.getFrame()/60.0 << " s of play)"
+		<< " alive " << match.getAlive()
+		<< " winner " << (match.isOver() && match.getAlive() ? (int)winner : -1)
+		<< " lines " << lines << " garbage " << sent
+		<< " time " << elapsed.count() << " s"
+		<< " checksum " << std::hex << match.checksum() << std::dec << std::endl;
+    }
+  std::cout << "board frames/s " << (total>0 ? boardFrames/total : 0.0) << std::endl;
+  return 0;
+}
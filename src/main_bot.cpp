@@ -0,0 +1,359 @@
+/* tetris_bot
+   Plays headless games with one of the built-in bots, as fast as it can
+   think, and reports how well and how quickly it played. Every input for a
+   piece is sent in one frame, so thinking time is the only cost. Comparing
+   runs with a fixed --budget and different --threads shows how much a
+   search gains from more cores. With --table, expectimax keeps its
+   transposition table in a file, warm for the next run. With --net, a
+   ValueNet scores the placements instead of the evaluator. With --db, a
+   placement stored in a PositionDB for the board and piece is played
+   without thinking, as from an opening book.
+
+   With --pipe it is instead a bot for tetris_host: the one piece bot,
+   answering BotProtocol on its standard input and output.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include "BeamSearch.hpp"
+#include "Bot.hpp"
+#include "BotProtocol.hpp"
+#include "Expectimax.hpp"
+#include "Finesse.hpp"
+#include "PositionDB.hpp"
+#include "ValueNet.hpp"
+
+// The length of the shortest path to where a plan for the game's current
+// piece drops it, or n if the plan does not end in a drop.
+static unsigned shortestPath(const HeadlessGame &game, const PieceInput *inputs, std::size_t n)
+{
+  const Piece &current=game.getCurrent();
+  unsigned o=current.getOrientation();
+  int x=current.getCenter().x;
+  for(std::size_t i=0;i+1<n;++i)
+    {
+      x+=(shift_right==inputs[i])-(shift_left==inputs[i]);
+      o=(o+(rotate_cw==inputs[i])+3*(rotate_ccw==inputs[i]))%4;
+    }
+  if(0==n || hard_drop!=inputs[n-1])
+    {
+      return n;
+    }
+  PieceInput path[MoveList::MAX_PATH];
+  const std::size_t ret=Finesse::path(Bitboard::fromField(game.getField()),current.getType(),
+				      o,x,path,MoveList::MAX_PATH);
+  return ret ? ret : n;
+}
+
+// Write the inputs for the placement the database holds for the game's
+// board and current piece. Returns 0 if it holds none.
+static std::size_t bookMove(const PositionDB &db, const HeadlessGame &game, PieceInput *out,
+			    std::size_t max)
+{
+  const Bitboard board=Bitboard::fromField(game.getField());
+  const PieceType type=game.getCurrent().getType();
+  PositionDB::Result r;
+  if(!db.find(board,type,r) || !(r.flags & PositionDB::MOVE))
+    {
+      return 0;
+    }
+  return Finesse::path(board,type,r.orientation,r.x,out,max);
+}
+
+// Answer tetris_host until it says quit or closes the pipe.
+static int pipeMain()
+{
+  Bot bot;
+  std::string line;
+  while(std::getline(std::cin,line))
+    {
+      BotProtocol::Move move;
+      BotProtocol::Reply reply;
+      if(0==line.compare(0,6,"hello "))
+	{
+	  std::cout << "ok tetris_bot" << std::endl;
+	}
+      else if(BotProtocol::parseMove(line,move))
+	{
+	  reply.kind=BotProtocol::Reply::INPUTS;
+	  reply.id=move.id;
+	  reply.count=bot.plan(move.field,move.piece,move.orientation,move.center,
+			       move.queued ? move.queue[0] : move.piece,reply.keys,
+			       BotProtocol::MAX_KEYS);
+	  std::cout << BotProtocol::reply(reply) << std::endl;
+	}
+      else if("quit"==line)
+	{
+	  break;
+	}
+      else
+	{
+	  std::cerr << "tetris_bot: cannot read \"" << line << "\"" << std::endl;
+	}
+    }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--games N] [--pieces N] [--seed N] [--greedy | --expectimax]"
+    " [--width N] [--depth N] [--budget MS] [--known N] [--table FILE] [--table-mb N]"
+    " [--threads N] [--net FILE] [--db FILE] | --pipe | --write-net FILE\n"
+    "  --greedy      the one piece bot, looking at the next piece\n"
+    "  --expectimax  expectimax instead of beam search\n"
+    "  --width N     beam width (default 64)\n"
+    "  --depth N     pieces searched, counting the current one (default 6 for\n"
+    "                beam search, 3 for expectimax)\n"
+    "  --budget MS   beam search thinking time per piece; 0 means unlimited\n"
+    "  --known N     preview pieces expectimax takes as given (default 1)\n"
+    "  --table FILE  map expectimax's transposition table from FILE\n"
+    "  --table-mb N  size of the transposition table (default 64)\n"
+    "  --net FILE    score placements with the value net in FILE\n"
+    "  --db FILE     play the placements the position database in FILE holds\n"
+    "  --pipe        play for tetris_host on standard input and output\n"
+    "  --write-net FILE  write a value net that scores as the evaluator does\n";
+  enum {BEAM,GREEDY,EXPECTIMAX,NET} mode=BEAM;
+  unsigned games=1,pieces=1000,seed=1,width=64,depth=0,threads=0,known=1,tableMB=64;
+  double budget=0;
+  const char *tableFile=nullptr,*netFile=nullptr,*dbFile=nullptr;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--games"))
+	{
+	  games=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--pieces"))
+	{
+	  pieces=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(0==std::strcmp(argv[i],"--greedy"))
+	{
+	  mode=GREEDY;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--net"))
+	{
+	  mode=NET;
+	  netFile=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--db"))
+	{
+	  dbFile=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--write-net"))
+	{
+	  try
+	    {
+	      ValueNet::linear(Evaluator::Weights::defaults(),{64,32}).save(argv[++i]);
+	    }
+	  catch(ModelError &e)
+	    {
+	      std::cerr << e.what() << std::endl;
+	      return -1;
+	    }
+	  return 0;
+	}
+      else if(0==std::strcmp(argv[i],"--pipe"))
+	{
+	  return pipeMain();
+	}
+      else if(0==std::strcmp(argv[i],"--expectimax"))
+	{
+	  mode=EXPECTIMAX;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--known"))
+	{
+	  known=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--table"))
+	{
+	  tableFile=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--table-mb"))
+	{
+	  tableMB=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--width"))
+	{
+	  width=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--depth"))
+	{
+	  depth=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--budget"))
+	{
+	  budget=std::atof(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+
+  if(0==depth)
+    {
+      depth=(EXPECTIMAX==mode) ? 3 : 6;
+    }
+  WorkerPool pool((GREEDY==mode || NET==mode) ? 1 : threads);
+  std::unique_ptr<TranspositionTable> table;
+  try
+    {
+      const std::size_t bytes=(std::size_t)tableMB<<20;
+      table.reset(tableFile ? new TranspositionTable(tableFile,bytes)
+		  : new TranspositionTable(bytes));
+    }
+  catch(ShmError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  std::unique_ptr<ValueNet> net;
+  try
+    {
+      if(netFile)
+	{
+	  net.reset(new ValueNet(std::string(netFile)));
+	}
+    }
+  catch(ModelError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  std::unique_ptr<PositionDB> db;
+  try
+    {
+      if(dbFile)
+	{
+	  db.reset(new PositionDB(dbFile));
+	}
+    }
+  catch(DatabaseError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  Bot bot;
+  std::unique_ptr<NetBot> netBot(net ? new NetBot(*net) : nullptr);
+  BeamSearch beam(pool,width,depth);
+  beam.setBudget(std::chrono::microseconds((long)(budget*1000)));
+  Expectimax expectimax(pool,table.get(),depth-1,known);
+  if(BEAM==mode)
+    {
+      std::cout << "threads " << pool.size() << " width " << width
+		<< " depth " << depth << " budget " << budget << " ms" << std::endl;
+    }
+  else if(EXPECTIMAX==mode)
+    {
+      std::cout << "threads " << pool.size() << " depth " << depth << " known " << known
+		<< " table " << table->capacity() << " entries, "
+		<< table->used() << " in use" << std::endl;
+    }
+  else if(NET==mode)
+    {
+      std::cout << "net";
+      for(unsigned n : net->getSizes())
+	{
+	  std::cout << ' ' << n;
+	}
+      std::cout << " kernel " << (ValueNet::AVX2==net->getKernel() ? "avx2" : "scalar")
+		<< std::endl;
+    }
+
+  // The average stack height says more about the quality of play than lines
+  // cleared, which cannot exceed 0.4 per piece.
+  unsigned long totalPieces=0,totalLines=0,totalHeight=0,nodes=0,levels=0,timeouts=0;
+  // Paths longer than Finesse's shortest, and by how many inputs.
+  unsigned long longer=0,extra=0;
+  unsigned long bookMoves=0;
+  unsigned lost=0;
+  double thinking=0;
+  for(unsigned g=0;g<games;++g)
+    {
+      HeadlessGame game(seed+g);
+      PieceInput inputs[MoveList::MAX_PATH];
+      unsigned placed=0;
+      while(placed<pieces && !game.isGameOver())
+	{
+	  const auto t0=std::chrono::steady_clock::now();
+	  std::size_t n=0;
+	  if(db && (n=bookMove(*db,game,inputs,MoveList::MAX_PATH)))
+	    {
+	      ++bookMoves;
+	    }
+	  else if(GREEDY==mode)
+	    {
+	      n=bot.plan(game,inputs,MoveList::MAX_PATH);
+	    }
+	  else if(NET==mode)
+	    {
+	      n=netBot->plan(game,inputs,MoveList::MAX_PATH);
+	    }
+	  else if(EXPECTIMAX==mode)
+	    {
+	      n=expectimax.plan(game,inputs,MoveList::MAX_PATH);
+	    }
+	  else
+	    {
+	      n=beam.plan(game,inputs,MoveList::MAX_PATH);
+	      nodes+=beam.getStats().nodes;
+	      levels+=beam.getStats().depth;
+	      timeouts+=beam.getStats().timedOut;
+	    }
+	  const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+	  thinking+=elapsed.count();
+	  const unsigned shortest=shortestPath(game,inputs,n);
+	  if(n>shortest)
+	    {
+	      ++longer;
+	      extra+=n-shortest;
+	    }
+	  game.step(inputs,n);
+	  totalHeight+=Bitboard::fromField(game.getField()).height();
+	  ++placed;
+	}
+      lost+=game.isGameOver();
+      totalPieces+=placed;
+      totalLines+=game.getField().readScore();
+      std::cout << "game " << g << " seed " << seed+g << " pieces " << placed
+		<< " lines " << game.getField().readScore()
+		<< (game.isGameOver() ? " lost" : "") << std::endl;
+    }
+  std::cout << "pieces " << totalPieces << " lines " << totalLines << " lost " << lost
+	    << " lines/piece " << (totalPieces ? (double)totalLines/totalPieces : 0.0)
+	    << " height " << (totalPieces ? (double)totalHeight/totalPieces : 0.0)
+	    << " ms/piece " << (totalPieces ? 1000*thinking/totalPieces : 0.0) << std::endl;
+  std::cout << "paths longer than the shortest " << longer << " of " << totalPieces
+	    << ", " << extra << " extra inputs" << std::endl;
+  if(db)
+    {
+      std::cout << "database moves " << bookMoves << " of " << totalPieces << std::endl;
+    }
+  if(EXPECTIMAX==mode && totalPieces)
+    {
+      const Expectimax::Stats &t=expectimax.getTotals();
+      std::cout << "table hits " << t.hits << " of " << t.probes
+		<< " (" << 100*t.hitRate() << "%), " << table->used() << " entries in use"
+		<< " nodes/s " << (thinking>0 ? t.nodes/thinking : 0.0) << std::endl;
+    }
+  if(BEAM==mode && totalPieces)
+    {
+      std::cout << "depth " << (double)levels/totalPieces
+		<< " timeouts " << timeouts
+		<< " nodes/s " << (thinking>0 ? nodes/thinking : 0.0) << std::endl;
+    }
+  return 0;
+}
@@ -0,0 +1,230 @@
+/* tetris_db
+   Builds and queries position databases (src/PositionDB.hpp).
+
+   --build enumerates every board of a few rows that pieces can build, as
+   tetris_enum does, and stores for each board and piece the placement the
+   evaluator likes best, preferring one that clears the field, with its
+   score; and for each board alone the average over the pieces of those
+   scores. --query opens a database and times lookups of keys it holds and
+   of keys it does not.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+
+#include "Bot.hpp"
+#include "Enumerator.hpp"
+#include "Piece.hpp"
+#include "PositionDB.hpp"
+#include "Randomizer.hpp"
+
+// The evaluator's favourite placement of a piece on a board, and its score.
+static PositionDB::Result best(const Evaluator &eval, MoveList &moves, const Bitboard &board,
+			       PieceType type)
+{
+  PositionDB::Result ret={std::numeric_limits<float>::lowest(),0,0,0,0};
+  moves.generate(board,type,0,Piece::spawn(type));
+  for(std::size_t i=0;i<moves.size();++i)
+    {
+      const Placement &p=moves[i];
+      Bitboard b=board;
+      const int lines=b.place(type,p.orientation,p.x,p.y);
+      if(b.toppedOut())
+	{
+	  continue;
+	}
+      const bool clear=0==b.height();
+      const float s=eval.evaluate(b,lines,p.y+PieceMask::get(type,p.orientation).bottom);
+      if((clear && !(ret.flags & PositionDB::PERFECT_CLEAR))
+	 || (clear==bool(ret.flags & PositionDB::PERFECT_CLEAR) && s>ret.value))
+	{
+	  ret.value=s;
+	  ret.flags=PositionDB::MOVE | (clear ? PositionDB::PERFECT_CLEAR : 0);
+	  ret.orientation=p.orientation;
+	  ret.x=p.x;
+	}
+    }
+  return ret;
+}
+
+static int build(const char *path, unsigned height, unsigned depth, unsigned threads)
+{
+  const auto t0=std::chrono::steady_clock::now();
+  WorkerPool pool(threads);
+  Enumerator enumerator(height,true,(std::size_t)1<<30,".");
+  enumerator.run(pool,depth);
+  std::vector<std::uint64_t> states;
+  states.reserve(enumerator.getStates());
+  enumerator.forEach([&](std::uint64_t k)
+		     {
+		       states.push_back(k);
+		     });
+  std::cout << "boards " << enumerator.getBoards() << " states " << states.size() << std::endl;
+
+  // A block of states per task, each with its own results.
+  const std::size_t BLOCK=4096, blocks=(states.size()+BLOCK-1)/BLOCK;
+  std::vector<std::vector<std::pair<std::uint64_t,PositionDB::Result>>> results(blocks);
+  pool.run(blocks,[&](std::size_t i)
+	   {
+	     const Evaluator eval;
+	     MoveList moves;
+	     for(std::size_t s=i*BLOCK;s<std::min(states.size(),(i+1)*BLOCK);++s)
+	       {
+		 const std::uint64_t m=Enumerator::mirror(states[s],height);
+		 PositionDB::Result alone={0,0,0,0,0};
+		 for(std::uint64_t packed : {states[s],m})
+		   {
+		     const Bitboard board=Enumerator::unpack(packed,height);
+		     for(int t=0;t<7;++t)
+		       {
+			 const PositionDB::Result r=best(eval,moves,board,(PieceType)t);
+			 results[i].push_back(std::make_pair(PositionDB::key(board,(PieceType)t),r));
+			 if(packed==states[s])
+			   {
+			     alone.value+=r.value/7;
+			     alone.flags|=r.flags & PositionDB::PERFECT_CLEAR;
+			   }
+		       }
+		     if(m==states[s])
+		       {
+			 break;
+		       }
+		   }
+		 results[i].push_back(std::make_pair(PositionDB::key(Enumerator::unpack(states[s],height)),
+						     alone));
+	       }
+	   });
+
+  PositionDB::Builder builder;
+  for(const auto &block : results)
+    {
+      for(const auto &r : block)
+	{
+	  builder.add(r.first,r.second);
+	}
+    }
+  try
+    {
+      builder.write(path);
+    }
+  catch(DatabaseError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+  std::cout << "records " << builder.size() << " written to " << path << " in "
+	    << elapsed.count() << " s" << std::endl;
+  return 0;
+}
+
+static int query(const char *path, unsigned lookups, unsigned seed)
+{
+  const auto t0=std::chrono::steady_clock::now();
+  std::unique_ptr<PositionDB> db;
+  try
+    {
+      db.reset(new PositionDB(path));
+    }
+  catch(DatabaseError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  const std::chrono::duration<double> open=std::chrono::steady_clock::now()-t0;
+  const std::uint64_t slots=db->getBuckets()*PositionDB::WAYS;
+  std::cout << "records " << db->size() << " buckets " << db->getBuckets() << " load "
+	    << (double)db->size()/slots << " opened in " << 1e6*open.count() << " us" << std::endl;
+  if(0==db->size() || 0==lookups)
+    {
+      return 0;
+    }
+
+  // Keys the database holds and random boards it mostly does not, in turn.
+  Pcg32 rng(seed,0);
+  std::vector<std::uint64_t> keys;
+  PositionDB::Result r;
+  while(keys.size()<lookups)
+    {
+      std::uint64_t k=(std::uint64_t)rng()<<32 | rng();
+      if(keys.size()%2)
+	{
+	  keys.push_back(k & (((std::uint64_t)1<<(FIELD_WIDTH*Enumerator::MAX_HEIGHT))-1));
+	}
+      else if(db->record(k%slots,k,r))
+	{
+	  keys.push_back(k);
+	}
+    }
+  for(int pass=0;pass<2;++pass)
+    {
+      unsigned long found=0;
+      const auto t1=std::chrono::steady_clock::now();
+      for(std::uint64_t k : keys)
+	{
+	  found+=db->find(k,r);
+	}
+      const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t1;
+      std::cout << (pass ? "warm" : "cold") << " lookups " << keys.size() << " found " << found
+		<< " ns/lookup " << 1e9*elapsed.count()/keys.size() << std::endl;
+    }
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" --build FILE [--height N] [--depth N] [--threads N]"
+    " | --query FILE [--lookups N] [--seed N]\n"
+    "  --height N   highest stack stored, at most 6 (default 2)\n"
+    "  --depth N    boards reached within N pieces; 0 means all (default 0)\n"
+    "  --lookups N  keys to look up, half of them held (default 1000000)\n";
+  const char *buildFile=nullptr,*queryFile=nullptr;
+  unsigned height=2,depth=0,threads=0,lookups=1000000,seed=1;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--build"))
+	{
+	  buildFile=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--query"))
+	{
+	  queryFile=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--height"))
+	{
+	  height=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--depth"))
+	{
+	  depth=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--lookups"))
+	{
+	  lookups=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+  if(!buildFile==!queryFile || height<1 || height>Enumerator::MAX_HEIGHT)
+    {
+      std::cerr << "Usage: " << argv[0] << USAGE;
+      return -1;
+    }
+  return buildFile ? build(buildFile,height,depth,threads) : query(queryFile,lookups,seed);
+}
@@ -0,0 +1,108 @@
+/* tetris_enum
+   Enumerates every board of a few rows that pieces can build from an empty
+   field, a level per piece placed, and reports how many boards each level
+   found. With --stats the statistics are also written to a file.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "Enumerator.hpp"
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--height N] [--depth N] [--threads N] [--memory MB] [--spill DIR]"
+    " [--unfolded] [--stats FILE]\n"
+    "  --height N   highest stack, at most 6 (default 4)\n"
+    "  --depth N    stop after N pieces; 0 means when nothing new is found (default 0)\n"
+    "  --memory MB  memory for boards before the frontier spills to disk (default 1024);\n"
+    "               the table of boards found is never spilled and may take more\n"
+    "  --spill DIR  directory for spilled frontiers (default .)\n"
+    "  --unfolded   count a board and its mirror image apart\n";
+  unsigned height=4,depth=0,threads=0;
+  std::size_t memory=1024;
+  std::string spill=".",stats;
+  bool mirror=true;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--height"))
+	{
+	  height=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--depth"))
+	{
+	  depth=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--memory"))
+	{
+	  memory=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--spill"))
+	{
+	  spill=argv[++i];
+	}
+      else if(0==std::strcmp(argv[i],"--unfolded"))
+	{
+	  mirror=false;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--stats"))
+	{
+	  stats=argv[++i];
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+  if(height<1 || height>Enumerator::MAX_HEIGHT)
+    {
+      std::cerr << "--height must be from 1 to " << Enumerator::MAX_HEIGHT << std::endl;
+      return -1;
+    }
+
+  WorkerPool pool(threads);
+  Enumerator enumerator(height,mirror,memory<<20,spill);
+  std::cout << "height " << height << " threads " << pool.size() << " memory " << memory
+	    << " MB" << std::endl;
+  enumerator.setListener([&](const Enumerator::Level &l)
+			 {
+			   std::cout << "depth " << l.depth << " new " << l.states << " boards "
+				     << l.boards << " total " << enumerator.getStates()
+				     << " table " << (enumerator.getTableBytes()>>20) << " MB";
+			   if(l.spilled)
+			     {
+			       std::cout << " spilled " << l.spilled;
+			     }
+			   std::cout << " s " << l.seconds << " placements/s "
+				     << (l.seconds>0 ? l.successors/l.seconds : 0.0) << std::endl;
+			 });
+  try
+    {
+      enumerator.run(pool,depth);
+    }
+  catch(SpillError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+
+  enumerator.writeStats(std::cout);
+  if(!stats.empty())
+    {
+      std::ofstream out(stats.c_str());
+      enumerator.writeStats(out);
+      if(!out)
+	{
+	  std::cerr << "Cannot write " << stats << std::endl;
+	  return -1;
+	}
+    }
+  return 0;
+}
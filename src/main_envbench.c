@@ -0,0 +1,136 @@
+/* tetris_envbench
+   Steps a batch of games through libunittestris's C interface, with a
+   random legal action for every game, and reports how many pieces a second
+   the batch places, in total and per thread. Written in C, as a check that
+   the library needs nothing from C++ to be used.
+ */
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "unittestris.h"
+
+static double now(void)
+{
+  struct timespec t;
+  clock_gettime(CLOCK_MONOTONIC,&t);
+  return t.tv_sec+t.tv_nsec*1e-9;
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--games N] [--steps N] [--threads N] [--seed N]\n";
+  size_t games=1024,i,a;
+  unsigned long steps=1000,s,dones=0;
+  unsigned threads=0;
+  uint64_t seed=1;
+  int ret=0;
+
+  for(i=1;i<(size_t)argc;++i)
+    {
+      if(i+1<(size_t)argc && 0==strcmp(argv[i],"--games"))
+	{
+	  games=strtoul(argv[++i],NULL,0);
+	}
+      else if(i+1<(size_t)argc && 0==strcmp(argv[i],"--steps"))
+	{
+	  steps=strtoul(argv[++i],NULL,0);
+	}
+      else if(i+1<(size_t)argc && 0==strcmp(argv[i],"--threads"))
+	{
+	  threads=strtoul(argv[++i],NULL,0);
+	}
+      else if(i+1<(size_t)argc && 0==strcmp(argv[i],"--seed"))
+	{
+	  seed=strtoull(argv[++i],NULL,0);
+	}
+      else
+	{
+	  fprintf(stderr,"Usage: %s%s",argv[0],USAGE);
+	  return -1;
+	}
+    }
+
+  ut_batch *batch=ut_batch_create(games,threads);
+  if(!batch)
+    {
+      fprintf(stderr,"Cannot create a batch of %lu games\n",(unsigned long)games);
+      return -1;
+    }
+  const size_t actionCount=ut_action_count();
+  float *observations=malloc(games*ut_observation_size()*sizeof(float));
+  uint8_t *masks=malloc(games*actionCount);
+  float *rewards=malloc(games*sizeof(float));
+  uint8_t *done=malloc(games);
+  uint64_t *seeds=malloc(games*sizeof(uint64_t));
+  int32_t *actions=malloc(games*sizeof(int32_t));
+  double lines=0;
+  uint64_t rng=seed*0x9e3779b97f4a7c15ull+1;
+
+  for(i=0;i<games;++i)
+    {
+      seeds[i]=seed+i;
+    }
+  if(!observations || !masks || !rewards || !done || !seeds || !actions
+     || ut_batch_set_buffers(batch,observations,masks,rewards,done)
+     || ut_batch_reset(batch,seeds))
+    {
+      fprintf(stderr,"Cannot start the batch: %s\n",ut_batch_error(batch));
+      ret=-1;
+      steps=0;
+    }
+
+  double elapsed=0;
+  for(s=0;s<steps;++s)
+    {
+      /* A random legal action: the first legal one at or after a random
+	 start. */
+      for(i=0;i<games;++i)
+	{
+	  const uint8_t *mask=masks+i*actionCount;
+	  rng=rng*6364136223846793005ull+1442695040888963407ull;
+	  size_t start=(rng>>33)%actionCount;
+	  actions[i]=-1;
+	  for(a=0;a<actionCount;++a)
+	    {
+	      if(mask[(start+a)%actionCount])
+		{
+		  actions[i]=(start+a)%actionCount;
+		  break;
+		}
+	    }
+	}
+      const double t0=now();
+      if(ut_batch_step(batch,actions))
+	{
+	  fprintf(stderr,"Step failed: %s\n",ut_batch_error(batch));
+	  ret=-1;
+	  break;
+	}
+      elapsed+=now()-t0;
+      for(i=0;i<games;++i)
+	{
+	  lines+=rewards[i];
+	  dones+=done[i];
+	}
+    }
+
+  if(0==ret)
+    {
+      const double rate=elapsed>0 ? games*steps/elapsed : 0.0;
+      printf("games %lu steps %lu threads %u games lost %lu lines/piece %g\n",
+	     (unsigned long)games,steps,ut_batch_threads(batch),dones,
+	     steps ? lines/(games*steps) : 0.0);
+      printf("pieces/s %g per thread %g\n",rate,rate/ut_batch_threads(batch));
+    }
+  ut_batch_destroy(batch);
+  free(observations);
+  free(masks);
+  free(rewards);
+  free(done);
+  free(seeds);
+  free(actions);
+  return ret;
+}
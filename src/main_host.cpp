@@ -0,0 +1,168 @@
+/* tetris_host
+   Plays headless games with an external bot, one process per game, over
+   BotProtocol on its standard input and output. Games run in parallel, so
+   many copies of a bot can be measured at once. Reports how each game went
+   and how long the bot took to answer, against the --budget it was given.
+   The bot command follows "--", e.g.
+
+     tetris_host --games 8 --budget 50 -- ./tetris_bot --pipe
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "PipeAgent.hpp"
+#include "WorkerPool.hpp"
+
+struct GameResult
+{
+  unsigned placed,lines;
+  bool lost;
+  std::string name,error;
+  PipeAgent::Stats stats;
+};
+
+// The q'th quantile of sorted latencies, in milliseconds.
+static double quantile(const std::vector<std::uint32_t> &sorted, double q)
+{
+  if(sorted.empty())
+    {
+      return 0;
+    }
+  const std::size_t i=std::min(sorted.size()-1,(std::size_t)(q*sorted.size()));
+  return sorted[i]/1000.0;
+}
+
+static void printLatency(std::vector<std::uint32_t> latencies)
+{
+  std::sort(latencies.begin(),latencies.end());
+  double sum=0;
+  for(std::uint32_t l : latencies)
+    {
+      sum+=l;
+    }
+  std::cout << " ms mean " << (latencies.empty() ? 0.0 : sum/latencies.size()/1000)
+	    << " p50 " << quantile(latencies,0.5) << " p99 " << quantile(latencies,0.99)
+	    << " max " << quantile(latencies,1);
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--games N] [--pieces N] [--seed N] [--budget MS] [--threads N]"
+    " -- COMMAND [ARGS]\n"
+    "  --budget MS   time the bot has to answer each move (default 100)\n";
+  unsigned games=1,pieces=1000,seed=1,threads=0;
+  double budget=100;
+  std::vector<std::string> command;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--games"))
+	{
+	  games=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--pieces"))
+	{
+	  pieces=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--budget"))
+	{
+	  budget=std::atof(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(0==std::strcmp(argv[i],"--"))
+	{
+	  command.assign(argv+i+1,argv+argc);
+	  break;
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+  if(command.empty())
+    {
+      std::cerr << "Usage: " << argv[0] << USAGE;
+      return -1;
+    }
+
+  // The threads mostly wait for their bots, so there may be more of them
+  // than cores; the bots are what need the cores.
+  WorkerPool pool(threads);
+  std::vector<GameResult> results(games);
+  const std::chrono::microseconds perMove((long)(budget*1000));
+  std::cout << "threads " << pool.size() << " budget " << budget << " ms" << std::endl;
+  const auto t0=std::chrono::steady_clock::now();
+  pool.run(games,[&](std::size_t g)
+	   {
+	     GameResult &r=results[g];
+	     r.placed=r.lines=0;
+	     r.lost=false;
+	     try
+	       {
+		 PipeAgent agent(command,perMove);
+		 r.name=agent.getName();
+		 HeadlessGame game(seed+g);
+		 PieceInput inputs[BotProtocol::MAX_KEYS];
+		 while(r.placed<pieces && !game.isGameOver())
+		   {
+		     const unsigned piece=game.getPieceCount();
+		     while(piece==game.getPieceCount() && !game.isGameOver())
+		       {
+			 game.step(inputs,agent.act(game,inputs,BotProtocol::MAX_KEYS));
+		       }
+		     ++r.placed;
+		   }
+		 r.lost=game.isGameOver();
+		 r.lines=game.getField().readScore();
+		 r.stats=agent.getStats();
+	       }
+	     catch(PipeError &e)
+	       {
+		 r.error=e.what();
+	       }
+	   });
+  const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+
+  unsigned long placed=0,lines=0,timeouts=0,errors=0,lost=0,failed=0;
+  std::vector<std::uint32_t> all;
+  for(unsigned g=0;g<games;++g)
+    {
+      const GameResult &r=results[g];
+      std::cout << "game " << g << " seed " << seed+g;
+      if(!r.error.empty())
+	{
+	  std::cout << " " << r.error << std::endl;
+	  ++failed;
+	  continue;
+	}
+      std::cout << " bot " << (r.name.empty() ? "?" : r.name) << " pieces " << r.placed
+		<< " lines " << r.lines << (r.lost ? " lost" : "")
+		<< " timeouts " << r.stats.timeouts << " errors " << r.stats.errors;
+      printLatency(r.stats.latencies);
+      std::cout << std::endl;
+      placed+=r.placed;
+      lines+=r.lines;
+      lost+=r.lost;
+      timeouts+=r.stats.timeouts;
+      errors+=r.stats.errors;
+      all.insert(all.end(),r.stats.latencies.begin(),r.stats.latencies.end());
+    }
+  std::cout << "pieces " << placed << " lines " << lines << " lost " << lost
+	    << " timeouts " << timeouts << " errors " << errors;
+  printLatency(all);
+  std::cout << " time " << elapsed.count() << " s" << std::endl;
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,387 @@
+/* tetris_loadgen
+   Opens many simulated players against a tetris_server over loopback (or any
+   address), sends random inputs at a fixed rate and measures how long each
+   FRAME takes to arrive after the server stepped it. The server stamps every
+   frame with its monotonic clock, so the measurement is only meaningful when
+   both run on the same machine.
+
+   With --spectate, also opens spectator connections, decodes their streams
+   and reports what each spectated frame cost on the wire.
+ */
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "NetProtocol.hpp"
+#include "SpectatorStream.hpp"
+#include "DataDoubleBuffer.hpp"
+
+struct options
+{
+  std::string address;
+  unsigned port,clients,threads,seconds;
+  unsigned spectatePort,spectators;
+  double rate; // inputs per second per client
+};
+
+// Latency histogram with 10us buckets up to 100ms.
+struct loadstats
+{
+  static constexpr unsigned BUCKET_NS=10000, BUCKETS=10000;
+  std::vector<unsigned long> histogram;
+  unsigned long connected,failed,closed,frames,gameOvers,badFrames,inputs,bytesIn;
+  unsigned long watchers,spectated,spectateBytes;
+  std::uint64_t maxLatency;
+
+  loadstats():histogram(BUCKETS+1,0),connected(0),failed(0),closed(0),frames(0),
+	      gameOvers(0),badFrames(0),inputs(0),bytesIn(0),watchers(0),spectated(0),
+	      spectateBytes(0),maxLatency(0)
+  {}
+
+  void record(std::uint64_t ns)
+  {
+    histogram[std::min<std::uint64_t>(ns/BUCKET_NS,BUCKETS)]++;
+    maxLatency=std::max(maxLatency,ns);
+  }
+  void merge(const loadstats &o)
+  {
+    for(unsigned i=0;i<=BUCKETS;++i)
+      {
+	histogram[i]+=o.histogram[i];
+      }
+    connected+=o.connected;
+    failed+=o.failed;
+    closed+=o.closed;
+    frames+=o.frames;
+    gameOvers+=o.gameOvers;
+    badFrames+=o.badFrames;
+    inputs+=o.inputs;
+    bytesIn+=o.bytesIn;
+    watchers+=o.watchers;
+    spectated+=o.spectated;
+    spectateBytes+=o.spectateBytes;
+    maxLatency=std::max(maxLatency,o.maxLatency);
+  }
+  // Upper bound of the bucket holding the given fraction of samples, in us.
+  double percentile(double p) const
+  {
+    unsigned long total=0,seen=0;
+    for(auto n : histogram)
+      {
+	total+=n;
+      }
+    for(unsigned i=0;i<=BUCKETS;++i)
+      {
+	seen+=histogram[i];
+	if(total && seen>=p*total)
+	  {
+	    return (i+1)*(BUCKET_NS/1000.0);
+	  }
+      }
+    return 0;
+  }
+};
+
+struct client
+{
+  int fd;
+  bool connected,spectator;
+  NetProtocol::Buffer in;
+  FrameSnapshot state;
+  SpectatorView view;
+};
+
+static std::uint64_t monotonic_now()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>
+    (std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Parse every complete message in c.in.
+static void consume(client &c, loadstats &stats)
+{
+  std::size_t pos=0;
+  NetProtocol::MessageHeader h;
+  const std::uint64_t now=monotonic_now();
+  while(NetProtocol::getHeader(c.in.data()+pos,c.in.size()-pos,h) &&
+	c.in.size()-pos>=NetProtocol::HEADER_SIZE+h.length)
+    {
+      const char *body=c.in.data()+pos+NetProtocol::HEADER_SIZE;
+      if(c.spectator)
+	{
+	  if(c.view.apply(h,body,h.length))
+	    {
+	      stats.spectated+=c.view.synced();
+	      stats.spectateBytes+=NetProtocol::HEADER_SIZE+h.length;
+	    }
+	  else
+	    {
+	      ++stats.badFrames;
+	    }
+	}
+      else if(NetProtocol::FRAME==h.type)
+	{
+	  if(NetProtocol::applyFrame(body,h.length,h,c.state))
+	    {
+	      ++stats.frames;
+	      stats.record(now>h.stamp ? now-h.stamp : 0);
+	    }
+	  else
+	    {
+	      ++stats.badFrames;
+	    }
+	}
+      else if(NetProtocol::GAME_OVER==h.type)
+	{
+	  ++stats.gameOvers;
+	}
+      pos+=NetProtocol::HEADER_SIZE+h.length;
+    }
+  c.in.erase(c.in.begin(),c.in.begin()+pos);
+}
+
+static void run_thread(const options &opt, unsigned count, unsigned watchers,
+		       unsigned seed, const std::atomic_bool &stop, loadstats &stats)
+{
+  constexpr unsigned INPUT_HZ=60;
+  std::vector<client> clients(count+watchers);
+  const int epfd=epoll_create1(EPOLL_CLOEXEC);
+  const int timer=timerfd_create(CLOCK_MONOTONIC,TFD_NONBLOCK|TFD_CLOEXEC);
+  std::uint32_t rng=seed*2654435761u+1;
+  sockaddr_in addr;
+
+  std::memset(&addr,0,sizeof(addr));
+  addr.sin_family=AF_INET;
+  addr.sin_port=htons(opt.port);
+  inet_pton(AF_INET,opt.address.c_str(),&addr.sin_addr);
+  sockaddr_in spectateAddr=addr;
+  spectateAddr.sin_port=htons(opt.spectatePort);
+
+  itimerspec period;
+  period.it_interval.tv_sec=0;
+  period.it_interval.tv_nsec=1000000000/INPUT_HZ;
+  period.it_value=period.it_interval;
+  timerfd_settime(timer,0,&period,nullptr);
+  epoll_event ev;
+  ev.events=EPOLLIN|EPOLLET;
+  ev.data.ptr=nullptr;
+  epoll_ctl(epfd,EPOLL_CTL_ADD,timer,&ev);
+
+  for(std::size_t i=0;i<clients.size();++i)
+    {
+      client &c=clients[i];
+      const sockaddr_in &to=i<count ? addr : spectateAddr;
+      c.connected=false;
+      c.spectator=i>=count;
+      std::memset(&c.state,0,sizeof(c.state));
+      c.fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+      if(-1==c.fd || (-1==connect(c.fd,(sockaddr*)&to,sizeof(to)) && EINPROGRESS!=errno))
+	{
+	  ++stats.failed;
+	  if(-1!=c.fd)
+	    {
+	      close(c.fd);
+	    }
+	  c.fd=-1;
+	  continue;
+	}
+      const int one=1;
+      setsockopt(c.fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+      ev.events=EPOLLIN|EPOLLOUT|EPOLLRDHUP|EPOLLET;
+      ev.data.ptr=&c;
+      epoll_ctl(epfd,EPOLL_CTL_ADD,c.fd,&ev);
+    }
+
+  // Probability of sending an input on each timer tick, out of 2^32.
+  const std::uint64_t threshold=std::min(1.0,opt.rate/INPUT_HZ)*4294967295.0;
+  epoll_event events[256];
+  char buf[4096];
+  while(!stop)
+    {
+      const int n=epoll_wait(epfd,events,256,100);
+      for(int i=0;i<n;++i)
+	{
+	  if(nullptr==events[i].data.ptr)
+	    {
+	      std::uint64_t expirations;
+	      if(sizeof(expirations)!=read(timer,&expirations,sizeof(expirations)))
+		{
+		  continue;
+		}
+	      for(auto &c : clients)
+		{
+		  rng^=rng<<13;
+		  rng^=rng>>17;
+		  rng^=rng<<5;
+		  if(c.connected && !c.spectator && rng<threshold)
+		    {
+		      const char input=(char)((rng>>8)%(hard_drop+1));
+		      if(1==send(c.fd,&input,1,MSG_NOSIGNAL))
+			{
+			  ++stats.inputs;
+			}
+		    }
+		}
+	      continue;
+	    }
+	  client &c=*static_cast<client*>(events[i].data.ptr);
+	  if(-1==c.fd)
+	    {
+	      continue;
+	    }
+	  if(!c.connected && (events[i].events & EPOLLOUT))
+	    {
+	      int err=0;
+	      socklen_t len=sizeof(err);
+	      getsockopt(c.fd,SOL_SOCKET,SO_ERROR,&err,&len);
+	      if(0==err)
+		{
+		  c.connected=true;
+		  ++stats.connected;
+		  stats.watchers+=c.spectator;
+		}
+	    }
+	  if(events[i].events & (EPOLLIN|EPOLLRDHUP|EPOLLERR|EPOLLHUP))
+	    {
+	      ssize_t r;
+	      while((r=recv(c.fd,buf,sizeof(buf),0))>0)
+		{
+		  stats.bytesIn+=r;
+		  c.in.insert(c.in.end(),buf,buf+r);
+		}
+	      consume(c,stats);
+	      if(0==r || (r<0 && EAGAIN!=errno && EWOULDBLOCK!=errno && EINTR!=errno))
+		{
+		  if(c.connected)
+		    {
+		      ++stats.closed;
+		    }
+		  else
+		    {
+		      ++stats.failed;
+		    }
+		  close(c.fd);
+		  c.fd=-1;
+		}
+	    }
+	}
+    }
+  for(auto &c : clients)
+    {
+      if(-1!=c.fd)
+	{
+	  close(c.fd);
+	}
+    }
+  close(timer);
+  close(epfd);
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--address ADDRESS] [--port PORT] [--clients N] [--threads N]"
+    " [--seconds N] [--rate INPUTS_PER_SECOND] [--spectate PORT] [--spectators N]\n";
+  options opt;
+  opt.address="127.0.0.1";
+  opt.port=7777;
+  opt.clients=1000;
+  opt.threads=1;
+  opt.seconds=10;
+  opt.rate=4.0;
+  opt.spectatePort=0;
+  opt.spectators=0;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1>=argc)
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+      else if(0==std::strcmp(argv[i],"--address"))
+	opt.address=argv[++i];
+      else if(0==std::strcmp(argv[i],"--port"))
+	opt.port=std::atoi(argv[++i]);
+      else if(0==std::strcmp(argv[i],"--clients"))
+	opt.clients=std::atoi(argv[++i]);
+      else if(0==std::strcmp(argv[i],"--threads"))
+	opt.threads=std::max(1,std::atoi(argv[++i]));
+      else if(0==std::strcmp(argv[i],"--seconds"))
+	opt.seconds=std::atoi(argv[++i]);
+      else if(0==std::strcmp(argv[i],"--rate"))
+	opt.rate=std::atof(argv[++i]);
+      else if(0==std::strcmp(argv[i],"--spectate"))
+	opt.spectatePort=std::atoi(argv[++i]);
+      else if(0==std::strcmp(argv[i],"--spectators"))
+	opt.spectators=std::atoi(argv[++i]);
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+
+  rlimit lim;
+  if(0==getrlimit(RLIMIT_NOFILE,&lim))
+    {
+      lim.rlim_cur=lim.rlim_max;
+      setrlimit(RLIMIT_NOFILE,&lim);
+    }
+
+  std::atomic_bool stop(false);
+  std::vector<loadstats> stats(opt.threads);
+  std::vector<std::thread> threads;
+  for(unsigned t=0;t<opt.threads;++t)
+    {
+      const unsigned count=opt.clients/opt.threads+(t<opt.clients%opt.threads ? 1 : 0);
+      const unsigned watchers=opt.spectatePort ?
+	opt.spectators/opt.threads+(t<opt.spectators%opt.threads ? 1 : 0) : 0;
+      threads.push_back(std::thread(run_thread,std::cref(opt),count,watchers,t+1,
+				    std::cref(stop),std::ref(stats[t])));
+    }
+  std::this_thread::sleep_for(std::chrono::seconds(opt.seconds));
+  stop=true;
+  loadstats total;
+  for(unsigned t=0;t<opt.threads;++t)
+    {
+      threads[t].join();
+      total.merge(stats[t]);
+    }
+
+  std::cout << "clients " << opt.clients+(opt.spectatePort ? opt.spectators : 0)
+	    << " connected " << total.connected
+	    << " failed " << total.failed << " closed " << total.closed << '\n'
+	    << "inputs " << total.inputs << " frames " << total.frames
+	    << " game_overs " << total.gameOvers << " bad_frames " << total.badFrames << '\n'
+	    << "frames/s/client "
+	    << (total.connected>total.watchers ?
+		total.frames/(double)opt.seconds/(total.connected-total.watchers) : 0.0)
+	    << " bytes/s " << total.bytesIn/(double)opt.seconds << '\n'
+	    << "latency_us p50 " << total.percentile(0.5)
+	    << " p90 " << total.percentile(0.9)
+	    << " p99 " << total.percentile(0.99)
+	    << " max " << total.maxLatency/1000.0 << std::endl;
+  if(opt.spectatePort)
+    {
+      std::cout << "spectated_frames " << total.spectated << " bytes/frame "
+		<< (total.spectated ? total.spectateBytes/(double)total.spectated : 0.0)
+		<< " (DataBuffer " << sizeof(DataBuffer) << ")" << std::endl;
+    }
+  return total.badFrames ? 1 : 0;
+}
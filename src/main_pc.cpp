@@ -0,0 +1,117 @@
+/* tetris_pc
+   Looks for a perfect clear from an empty field in the opening pieces of
+   seeded games, and reports how often one exists and how long the search
+   took. With --show the placements found are printed.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "PerfectClear.hpp"
+#include "Randomizer.hpp"
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--games N] [--seed N] [--pieces N] [--height N] [--hold]"
+    " [--limit N] [--show]\n"
+    "  --pieces N  pieces of each game the clear may use (default 11)\n"
+    "  --height N  rows to clear; 0 tries the lowest possible first (default 0)\n"
+    "  --hold      allow a hold, which this game does not have\n"
+    "  --limit N   give up after N positions; 0 means never (default 0)\n";
+  const char NAMES[]="IJLOSTZ";
+  unsigned games=100,seed=1,pieces=11,height=0;
+  unsigned long limit=0;
+  bool hold=false,show=false;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--games"))
+	{
+	  games=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--pieces"))
+	{
+	  pieces=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--height"))
+	{
+	  height=std::atoi(argv[++i]);
+	}
+      else if(0==std::strcmp(argv[i],"--hold"))
+	{
+	  hold=true;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--limit"))
+	{
+	  limit=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(0==std::strcmp(argv[i],"--show"))
+	{
+	  show=true;
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+  if(pieces>PerfectClear::MAX_PIECES)
+    {
+      pieces=PerfectClear::MAX_PIECES;
+    }
+
+  PerfectClear solver(hold,limit);
+  Bitboard empty;
+  empty.clear();
+  unsigned found=0,gaveUp=0;
+  unsigned long nodes=0;
+  double total=0,slowest=0;
+  for(unsigned g=0;g<games;++g)
+    {
+      // The pieces a game started with this seed deals, current piece first.
+      PieceQueue queue(BAG7,seed+g);
+      PieceType sequence[PerfectClear::MAX_PIECES];
+      for(unsigned i=0;i<pieces;++i)
+	{
+	  sequence[i]=queue.pop();
+	}
+      const auto t0=std::chrono::steady_clock::now();
+      const PerfectClear::Result result=solver.solve(empty,sequence,pieces,height);
+      const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+      total+=elapsed.count();
+      slowest=std::max(slowest,elapsed.count());
+      nodes+=solver.getNodes();
+      found+=PerfectClear::FOUND==result;
+      gaveUp+=PerfectClear::GAVE_UP==result;
+
+      std::cout << "game " << g << " seed " << seed+g << ' ';
+      for(unsigned i=0;i<pieces;++i)
+	{
+	  std::cout << NAMES[sequence[i]];
+	}
+      std::cout << (PerfectClear::FOUND==result ? " found" : PerfectClear::NONE==result ? " none" : " gave up");
+      if(PerfectClear::FOUND==result)
+	{
+	  std::cout << " height " << solver.getHeight() << " pieces " << solver.getSolution().size();
+	}
+      std::cout << " ms " << 1000*elapsed.count() << " positions " << solver.getNodes() << std::endl;
+      if(show && PerfectClear::FOUND==result)
+	{
+	  for(const PerfectClear::Step &s : solver.getSolution())
+	    {
+	      std::cout << "  " << NAMES[s.type] << (s.hold ? " (hold)" : "")
+			<< " orientation " << (int)s.orientation << " at " << (int)s.x
+			<< ',' << (int)s.y << std::endl;
+	    }
+	}
+    }
+  std::cout << "found " << found << " of " << games << " gave up " << gaveUp
+	    << " ms/query " << (games ? 1000*total/games : 0.0) << " slowest " << 1000*slowest
+	    << " ms positions/s " << (total>0 ? nodes/total : 0.0) << std::endl;
+  return 0;
+}
@@ -0,0 +1,248 @@
+/* tetris_scan
+   Answers questions about a corpus of replays (src/Replay.hpp) by playing
+   every game again, headless, on all cores and aggregating what happens:
+   the holes left when games are lost, pieces per second by level, line
+   clears and the time spent at each stack height.
+
+   --generate records games played by bots, or by random agents, to make a
+   corpus to scan. --seek times seeks to random frames of the replays, as a
+   replay viewer makes them.
+ */
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <sstream>
+
+#include "Bot.hpp"
+#include "ReplayScanner.hpp"
+
+// Record games seeded seed to seed+games-1, a pool's worth at a time, and
+// append them to the file in that order.
+static int generate(WorkerPool &pool, const char *path, unsigned games, unsigned pieces,
+		    unsigned delay, bool random, unsigned seed, unsigned interval)
+{
+  const auto t0=std::chrono::steady_clock::now();
+  try
+    {
+      ReplayWriter writer(path);
+      const unsigned BATCH=16*pool.size();
+      unsigned long frames=0,placed=0;
+      for(unsigned first=0;first<games;first+=BATCH)
+	{
+	  std::vector<std::unique_ptr<Replay>> replays(std::min(BATCH,games-first));
+	  pool.run(replays.size(),[&](std::size_t i)
+		   {
+		     const std::uint64_t s=seed+first+i;
+		     std::unique_ptr<Agent> agent;
+		     if(random)
+		       {
+			 agent.reset(new RandomAgent(s,delay,2));
+		       }
+		     else
+		       {
+			 agent.reset(new BotAgent(Evaluator::Weights::defaults(),delay,false));
+		       }
+		     HeadlessGame game(s);
+		     replays[i].reset(new Replay(s,BAG7,interval));
+		     PieceInput inputs[ReplayCursor::MAX_INPUTS];
+		     while(!game.isGameOver() && (0==pieces || game.getPieceCount()<=pieces))
+		       {
+			 const std::size_t n=agent->act(game,inputs,ReplayCursor::MAX_INPUTS);
+			 replays[i]->step(game,inputs,n);
+		       }
+		     replays[i]->finish(game);
+		   });
+	  for(const auto &r : replays)
+	    {
+	      writer.write(*r);
+	      frames+=r->view().frames;
+	      placed+=r->view().pieces;
+	    }
+	}
+      writer.flush();
+      const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+      std::cout << "games " << games << " frames " << frames << " pieces " << placed
+		<< " written to " << path << " in " << elapsed.count() << " s" << std::endl;
+    }
+  catch(ReplayError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  return 0;
+}
+
+// Seek to random frames of every replay, one after another as a viewer
+// scrubbing back and forth would, and report the mean and slowest seek.
+static int seek(const std::vector<std::string> &paths, unsigned seeks, unsigned seed)
+{
+  Pcg32 rng(seed,0);
+  double total=0,slowest=0;
+  unsigned long count=0,frames=0;
+  try
+    {
+      for(const std::string &path : paths)
+	{
+	  ReplayFile file(path);
+	  for(std::size_t i=0;i<file.size();++i)
+	    {
+	      const ReplayView r=file.get(i);
+	      ReplayPlayer player(r);
+	      for(unsigned k=0;k<seeks;++k)
+		{
+		  const std::uint32_t frame=rng.bounded(r.frames+1);
+		  const auto t0=std::chrono::steady_clock::now();
+		  player.seek(frame);
+		  const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+		  total+=elapsed.count();
+		  slowest=std::max(slowest,elapsed.count());
+		  ++count;
+		}
+	      frames=std::max<unsigned long>(frames,r.frames);
+	    }
+	}
+    }
+  catch(ReplayError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  std::cout << "seeks " << count << " longest replay " << frames << " frames mean "
+	    << (count ? 1e6*total/count : 0.0) << " us slowest " << 1e6*slowest << " us" << std::endl;
+  return 0;
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--threads N] [--aggregate LIST] FILE...\n"
+    "       --generate FILE [--games N] [--pieces N] [--delay N] [--random] [--seed N]"
+    " [--threads N] [--interval N]\n"
+    "       --seek [--seeks N] [--seed N] FILE...\n"
+    "  --aggregate LIST  comma separated: holes, speed, clears, height"
+    " (default holes,speed,clears)\n"
+    "  --pieces N        stop recording a game after N pieces; 0 means never"
+    " (default 1000)\n"
+    "  --delay N         frames between an agent's inputs (default 2)\n"
+    "  --interval N      frames between keyframes; 0 means none (default 600)\n"
+    "  --seeks N         seeks per replay (default 100)\n";
+  const char *generateFile=nullptr;
+  std::string list="holes,speed,clears";
+  std::vector<std::string> paths;
+  unsigned threads=0,games=1000,pieces=1000,delay=2,seed=1,interval=Replay::DEFAULT_INTERVAL,
+    seeks=100;
+  bool random=false,seeking=false;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--aggregate"))
+	{
+	  list=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--generate"))
+	{
+	  generateFile=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--games"))
+	{
+	  games=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--pieces"))
+	{
+	  pieces=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--delay"))
+	{
+	  delay=std::atoi(argv[++i]);
+	}
+      else if(0==std::strcmp(argv[i],"--random"))
+	{
+	  random=true;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--interval"))
+	{
+	  interval=std::atoi(argv[++i]);
+	}
+      else if(0==std::strcmp(argv[i],"--seek"))
+	{
+	  seeking=true;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seeks"))
+	{
+	  seeks=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if('-'!=argv[i][0])
+	{
+	  paths.push_back(argv[i]);
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+
+  if(seeking && !paths.empty())
+    {
+      return seek(paths,seeks,seed);
+    }
+  WorkerPool pool(threads);
+  if(generateFile)
+    {
+      return generate(pool,generateFile,games,pieces,delay,random,seed,interval);
+    }
+
+  std::vector<std::unique_ptr<Aggregate>> owned;
+  std::vector<Aggregate*> aggregates;
+  std::istringstream names(list);
+  std::string name;
+  while(std::getline(names,name,','))
+    {
+      owned.push_back(Aggregate::create(name));
+      if(!owned.back())
+	{
+	  std::cerr << "Unknown aggregate " << name << std::endl;
+	  return -1;
+	}
+      aggregates.push_back(owned.back().get());
+    }
+  if(paths.empty())
+    {
+      std::cerr << "Usage: " << argv[0] << USAGE;
+      return -1;
+    }
+
+  ReplayScanner scanner(pool);
+  try
+    {
+      for(const std::string &p : paths)
+	{
+	  scanner.add(p);
+	}
+    }
+  catch(ReplayError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  const ReplayScanner::Stats stats=scanner.scan(aggregates);
+  for(const Aggregate *a : aggregates)
+    {
+      a->write(std::cout);
+    }
+  std::cout << "threads " << pool.size() << " replays " << stats.replays << " frames "
+	    << stats.frames << " pieces " << stats.pieces << " out of sync " << stats.desynced
+	    << " s " << stats.seconds << " pieces/min "
+	    << (stats.seconds>0 ? 60*stats.pieces/stats.seconds : 0.0) << std::endl;
+  return 0;
+}
@@ -6,8 +6,17 @@
 #include <GL/gl.h>
 
 #include <iostream>
-
-#include "DataDoubleBuffer.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+#include "SeqlockBuffer.hpp"
+#include "Bot.hpp"
+#include "FrameSnapshot.hpp"
+#include "AsyncWriter.hpp"
+#include "Replay.hpp"
+#include "ShmChannel.hpp"
 #include "glutil.hpp"
 #include "GLMatrix.h"
 #include "music.hpp"
@@ -22,22 +31,88 @@ struct glstate
 
 } GL_STATE;
 
+// Set by --record; every game played is appended to a replay file from the
+// game thread without waiting for the disk. Declared before GAME_STATE so the
+// last game is recorded before the writer finishes at exit.
+std::unique_ptr<AsyncWriter> RECORDER;
+
 struct tetrisstate
 {
-  DataDoubleBuffer buffer;
-  RenderFunc<DataDoubleBuffer> rfunc;
+  Seqlock<FrameSnapshot> slot;
+  // Set by --publish; lets other processes view the game.
+  std::unique_ptr<ShmPublisher> shm;
+  // Set by --bot; the bot plays instead of the keyboard.
+  std::unique_ptr<Bot> bot;
+  std::uint32_t botFrame;
+  // RECORDER's stream, given to every game.
+  AsyncWriter::Stream *recorder;
+  // Set by --immediate; every game applies input as soon as it is queued.
+  bool immediate;
+  // Set by --tick; every game's frames a second.
+  unsigned tickRate;
+  // Set by --das and --arr; every game's auto-repeat.
+  HeadlessGame::RepeatTime das,arr;
+  SnapshotFunc<tetrisstate> pfunc;
+  Seqlock<FrameSnapshot>::Reader reader;
   TetrisGame game;
 
   bool running;
 
-  tetrisstate():buffer(),rfunc(&buffer,&DataDoubleBuffer::write),game(&rfunc),
-		running(false)
-  {}
+  tetrisstate():slot(),shm(),bot(),botFrame(0),recorder(nullptr),immediate(false),
+		tickRate(HeadlessGame::DEFAULT_TICK_RATE),das(HeadlessGame::DEFAULT_DAS),
+		arr(HeadlessGame::DEFAULT_ARR),pfunc(this,&tetrisstate::publish),reader(slot),
+		game(),running(false)
+  {
+    game.setPublisher(&pfunc);
+  }
+
+  // Called from the game thread once per frame.
+  void publish(const FrameSnapshot &snap)
+  {
+    slot.write(snap);
+    if(shm)
+      {
+	shm->write(snap);
+      }
+    if(bot)
+      {
+	play(snap);
+      }
+  }
+
+  // Called from the game thread. Inputs queued now are consumed by the next
+  // frame, so plan again only once a frame after the last plan is published.
+  void play(const FrameSnapshot &snap)
+  {
+    PieceInput inputs[MoveList::MAX_PATH];
+    if(snap.frame<=botFrame)
+      {
+	return;
+      }
+    const std::size_t n=bot->plan(snap,inputs,MoveList::MAX_PATH);
+    try
+      {
+	for(std::size_t i=0;i<n;++i)
+	  {
+	    game.queueInput(inputs[i]);
+	  }
+      }
+    catch(GameNotRunningError &)
+      {
+	// Paused during the frame; plan again once running.
+	return;
+      }
+    botFrame=snap.frame;
+  }
 
   void toggle_pause()
   {
     if(running)
       {
+	// Key releases are not queued while paused, so let go of the shift
+	// keys now; the releases are applied when the game runs again.
+	game.queueInput(release_left);
+	game.queueInput(release_right);
 	game.pause();
       }
     else
@@ -50,11 +125,19 @@ struct tetrisstate
   void reset()
   {
     game.~TetrisGame();
-    new(&game) TetrisGame(&rfunc);
-
-    buffer.~DataDoubleBuffer();
-    new(&buffer) DataDoubleBuffer();
-
+    new(&game) TetrisGame();
+
+    slot.~Seqlock<FrameSnapshot>();
+    new(&slot) Seqlock<FrameSnapshot>();
+    reader.~Reader();
+    new(&reader) Seqlock<FrameSnapshot>::Reader(slot);
+
+    botFrame=0;
+    game.setPublisher(&pfunc);
+    game.setRecorder(recorder);
+    game.setImmediateInput(immediate);
+    game.setTickRate(tickRate);
+    game.setAutoRepeat(das,arr);
     running = false;
   }
 
@@ -68,21 +151,111 @@ struct tetrisstate
   }
 } GAME_STATE;
 
+// Set by --view; frames come from another process instead of GAME_STATE.
+std::unique_ptr<ShmViewer> VIEWER;
+
+// Set by --replay; frames come from a recorded game instead of GAME_STATE.
+// Playback runs at a multiple of real time and can be scrubbed: every seek
+// loads the nearest keyframe and plays at most a keyframe interval, well
+// under a frame even for a game hours long.
+struct replaystate
+{
+  static constexpr unsigned SPEEDS[]={1,2,5,10,20,50,100};
+  std::unique_ptr<ReplayFile> file;
+  ReplayPlayer player;
+  // Where playback is, in frames, and how many frames it moves per frame of
+  // real time.
+  double position;
+  unsigned speed;
+  bool paused;
+  Uint32 ticks;
+  FrameSnapshot shown;
+  std::string caption;
+
+  replaystate(ReplayFile *f, std::size_t game):
+    file(f),player(f->get(game)),position(0),speed(0),paused(false),ticks(SDL_GetTicks()),
+    shown(player.getGame().snapshot()),caption()
+  {}
+
+  void seek(double frame)
+  {
+    position=std::max(0.0,std::min(frame,(double)player.getFrames()));
+    try
+      {
+	player.seek((std::uint32_t)position);
+      }
+    catch(ReplayError &e)
+      {
+	// Show the game as far as it goes.
+	position=player.getFrame();
+	paused=true;
+      }
+    shown=player.getGame().snapshot();
+  }
+  // Frames of the replay a second.
+  double rate() const
+  {
+    return player.getGame().getTickRate();
+  }
+  void toggle_pause()
+  {
+    paused=!paused;
+  }
+  void faster(int steps)
+  {
+    const int n=sizeof(SPEEDS)/sizeof(SPEEDS[0]);
+    speed=std::max(0,std::min((int)speed+steps,n-1));
+  }
+
+  // Called once per rendered frame.
+  const FrameSnapshot& update()
+  {
+    const Uint32 now=SDL_GetTicks();
+    if(!paused)
+      {
+	seek(position+(now-ticks)*rate()/1000*SPEEDS[speed]);
+	paused=position>=player.getFrames();
+      }
+    ticks=now;
+    char text[128];
+    const unsigned seconds=player.getFrame()/rate(),total=player.getFrames()/rate();
+    std::snprintf(text,sizeof(text),"%u:%02u / %u:%02u  %ux%s",seconds/60,seconds%60,
+		  total/60,total%60,SPEEDS[speed],paused ? "  paused" : "");
+    if(caption!=text)
+      {
+	caption=text;
+	SDL_WM_SetCaption(text,nullptr);
+      }
+    return shown;
+  }
+};
+constexpr unsigned replaystate::SPEEDS[];
+std::unique_ptr<replaystate> REPLAY;
+
 bool init_gl();
 bool init_sdl_context();
 
 void keyboard_event(const SDL_KeyboardEvent &ev);
+void replay_key(const SDL_KeyboardEvent &ev);
+void replay_mouse(int x);
 
 void process_events();
 
-void render_gl();
+const FrameSnapshot& current_frame();
+void render_gl(const FrameSnapshot &gameState);
 
 void terminate_gl();
 void terminate_program(int ec);
 
-int main()
+bool parse_args(int argc, char **argv);
+
+int main(int argc, char **argv)
 {
   int retcode;
+  if(!parse_args(argc,argv))
+    {
+      return -1;
+    }
   retcode=SDL_Init(SDL_INIT_VIDEO);
   if(-1==retcode)
     {
@@ -102,12 +275,15 @@ int main()
       return -1;
     }
 
-  init_music();
+  if(!VIEWER && !REPLAY)
+    {
+      init_music();
+    }
 
   while(true)
     {
       process_events();
-      render_gl();
+      render_gl(current_frame());
     }
   terminate_music();
   terminate_gl();
@@ -116,6 +292,120 @@ int main()
   return 0;
 }
 
+bool parse_args(int argc, char **argv)
+{
+  const char USAGE[]=" [--bot] [--immediate] [--tick HZ] [--das MS] [--arr MS] [--record FILE]"
+    " [--publish NAME | --view NAME | --replay FILE [--game N]]\n"
+    "  --bot           let the computer play\n"
+    "  --immediate     show input at once instead of at the next frame\n"
+    "  --tick HZ       run the game at HZ frames a second (default 60); pieces\n"
+    "                  fall as fast at any rate\n"
+    "  --das MS        hold a shift key MS milliseconds before it repeats\n"
+    "                  (default 10 frames at 60 Hz)\n"
+    "  --arr MS        then repeat every MS milliseconds; 0 moves to the wall\n"
+    "                  (default 2 frames at 60 Hz)\n"
+    "  --record FILE   append every game played to replay file FILE\n"
+    "  --publish NAME  play, and publish frames to shared memory object NAME\n"
+    "  --view NAME     watch a game published by another tetris_sdl\n"
+    "  --replay FILE   watch replay N (default 0) of a replay file: space pauses,\n"
+    "                  + and - change speed, left and right skip 5 s, page up and\n"
+    "                  down 1 min, comma and period step a frame, and clicking or\n"
+    "                  dragging across the window seeks\n";
+  const char *replayPath=nullptr;
+  std::size_t replayGame=0;
+  try
+    {
+      for(int i=1;i<argc;++i)
+	{
+	  if(0==std::strcmp(argv[i],"--bot") && !VIEWER && !replayPath)
+	    {
+	      GAME_STATE.bot.reset(new Bot());
+	    }
+	  else if(0==std::strcmp(argv[i],"--publish") && i+1<argc && !VIEWER && !replayPath)
+	    {
+	      GAME_STATE.shm.reset(new ShmPublisher(argv[++i]));
+	    }
+	  else if(0==std::strcmp(argv[i],"--view") && i+1<argc && !GAME_STATE.shm && !GAME_STATE.bot
+		  && !RECORDER && !replayPath)
+	    {
+	      VIEWER.reset(new ShmViewer(argv[++i]));
+	    }
+	  else if(0==std::strcmp(argv[i],"--replay") && i+1<argc && !GAME_STATE.shm
+		  && !GAME_STATE.bot && !RECORDER && !VIEWER)
+	    {
+	      replayPath=argv[++i];
+	    }
+	  else if(0==std::strcmp(argv[i],"--immediate") && !VIEWER && !replayPath)
+	    {
+	      GAME_STATE.immediate=true;
+	      GAME_STATE.game.setImmediateInput(true);
+	    }
+	  else if(0==std::strcmp(argv[i],"--tick") && i+1<argc && !VIEWER && !replayPath)
+	    {
+	      GAME_STATE.tickRate=std::strtoul(argv[++i],nullptr,0);
+	      GAME_STATE.game.setTickRate(GAME_STATE.tickRate);
+	    }
+	  else if((0==std::strcmp(argv[i],"--das") || 0==std::strcmp(argv[i],"--arr")) && i+1<argc
+		  && !VIEWER && !replayPath)
+	    {
+	      HeadlessGame::RepeatTime &time='d'==argv[i][2] ? GAME_STATE.das : GAME_STATE.arr;
+	      // Anything over a second is refused, without wrapping first.
+	      time=std::chrono::milliseconds(std::min(std::strtoul(argv[++i],nullptr,0),1001ul));
+	      GAME_STATE.game.setAutoRepeat(GAME_STATE.das,GAME_STATE.arr);
+	    }
+	  else if(0==std::strcmp(argv[i],"--record") && i+1<argc && !VIEWER && !replayPath)
+	    {
+	      // Write the file's header, or check it, before appending to it.
+	      const char *path=argv[++i];
+	      ReplayWriter(path).flush();
+	      RECORDER.reset(new AsyncWriter(path));
+	      GAME_STATE.recorder=RECORDER->open();
+	      GAME_STATE.game.setRecorder(GAME_STATE.recorder);
+	    }
+	  else if(0==std::strcmp(argv[i],"--game") && i+1<argc)
+	    {
+	      replayGame=std::strtoul(argv[++i],nullptr,0);
+	    }
+	  else
+	    {
+	      std::cerr << "Usage: " << argv[0] << USAGE;
+	      return false;
+	    }
+	}
+      if(replayPath)
+	{
+	  std::unique_ptr<ReplayFile> file(new ReplayFile(replayPath));
+	  if(replayGame>=file->size())
+	    {
+	      std::cerr << replayPath << " holds " << file->size() << " replays" << std::endl;
+	      return false;
+	    }
+	  REPLAY.reset(new replaystate(file.release(),replayGame));
+	}
+    }
+  catch(ShmError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+  catch(ReplayError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+  catch(WriterError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+  catch(std::invalid_argument &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+  return true;
+}
+
 bool init_sdl_context()
 {
 
@@ -318,8 +608,21 @@ void process_events()
 	case SDL_QUIT:
 	  terminate_program(0);// never returns
 	case SDL_KEYDOWN:
+	case SDL_KEYUP:
 	  keyboard_event(ev.key);
 	  break;
+	case SDL_MOUSEBUTTONDOWN:
+	  if(SDL_BUTTON_LEFT==ev.button.button)
+	    {
+	      replay_mouse(ev.button.x);
+	    }
+	  break;
+	case SDL_MOUSEMOTION:
+	  if(ev.motion.state & SDL_BUTTON(SDL_BUTTON_LEFT))
+	    {
+	      replay_mouse(ev.motion.x);
+	    }
+	  break;
 	default:
 	  break;
 	}
@@ -328,6 +631,42 @@ void process_events()
 
 void keyboard_event(const SDL_KeyboardEvent &ev)
 {
+  // Only the shift keys are held; the rest act when pressed.
+  if(SDL_KEYUP==ev.type)
+    {
+      if(REPLAY || VIEWER || !GAME_STATE.running)
+	{
+	  return;
+	}
+      switch(ev.keysym.sym)
+	{
+	case SDLK_a:
+	case SDLK_LEFT:
+	  GAME_STATE.game.queueInput(release_left);
+	  break;
+	case SDLK_d:
+	case SDLK_RIGHT:
+	  GAME_STATE.game.queueInput(release_right);
+	  break;
+	default:
+	  break;
+	}
+      return;
+    }
+  if(REPLAY)
+    {
+      replay_key(ev);
+      return;
+    }
+  // Viewers can only quit.
+  if(VIEWER)
+    {
+      if(SDLK_ESCAPE==ev.keysym.sym)
+	{
+	  terminate_program(0);// never returns
+	}
+      return;
+    }
   switch(ev.keysym.sym)
     {
     case SDLK_ESCAPE:
@@ -353,7 +692,7 @@ void keyboard_event(const SDL_KeyboardEvent &ev)
     case SDLK_LEFT:
       if(GAME_STATE.running)
 	{
-	  GAME_STATE.game.queueInput(shift_left);
+	  GAME_STATE.game.queueInput(press_left);
 	}
       break;
     case SDLK_e:
@@ -366,7 +705,7 @@ void keyboard_event(const SDL_KeyboardEvent &ev)
     case SDLK_RIGHT:
       if(GAME_STATE.running)
 	{
-	  GAME_STATE.game.queueInput(shift_right);
+	  GAME_STATE.game.queueInput(press_right);
 	}
       break;
     case SDLK_x:
@@ -382,7 +721,88 @@ void keyboard_event(const SDL_KeyboardEvent &ev)
   GAME_STATE.checkGameOver();
 }
 
-void render_gl()
+void replay_key(const SDL_KeyboardEvent &ev)
+{
+  const double SECOND=REPLAY->rate();
+  switch(ev.keysym.sym)
+    {
+    case SDLK_ESCAPE:
+      terminate_program(0);// never returns
+    case SDLK_SPACE:
+    case SDLK_PAUSE:
+    case SDLK_p:
+      REPLAY->toggle_pause();
+      break;
+    case SDLK_PLUS:
+    case SDLK_EQUALS:
+      REPLAY->faster(1);
+      break;
+    case SDLK_MINUS:
+      REPLAY->faster(-1);
+      break;
+    case SDLK_LEFT:
+      REPLAY->seek(REPLAY->position-5*SECOND);
+      break;
+    case SDLK_RIGHT:
+      REPLAY->seek(REPLAY->position+5*SECOND);
+      break;
+    case SDLK_PAGEUP:
+      REPLAY->seek(REPLAY->position-60*SECOND);
+      break;
+    case SDLK_PAGEDOWN:
+      REPLAY->seek(REPLAY->position+60*SECOND);
+      break;
+    case SDLK_HOME:
+      REPLAY->seek(0);
+      break;
+    case SDLK_END:
+      REPLAY->seek(REPLAY->player.getFrames());
+      break;
+    case SDLK_COMMA:
+      REPLAY->paused=true;
+      REPLAY->seek(REPLAY->player.getFrame()-1.0);
+      break;
+    case SDLK_PERIOD:
+      REPLAY->paused=true;
+      REPLAY->seek(REPLAY->player.getFrame()+1.0);
+      break;
+    default:
+      break;
+    }
+}
+
+// Scrub: the window's width is the whole game.
+void replay_mouse(int x)
+{
+  if(REPLAY)
+    {
+      REPLAY->seek((double)x/WIDTH*REPLAY->player.getFrames());
+    }
+}
+
+const FrameSnapshot& current_frame()
+{
+  if(REPLAY)
+    {
+      return REPLAY->update();
+    }
+  static FrameSnapshot viewed=FrameSnapshot();
+  static bool stalled=false;
+  if(VIEWER)
+    {
+      // Keep showing the last frame if the game has not published, and
+      // stop reading once it has died in the middle of one.
+      if(!stalled && !VIEWER->readLatest(viewed) && VIEWER->stalled())
+	{
+	  std::cerr << "The game stopped in the middle of a frame" << std::endl;
+	  stalled=true;
+	}
+      return viewed;
+    }
+  return GAME_STATE.reader.read();
+}
+
+void render_gl(const FrameSnapshot &gameState)
 {
   const glVec WHITE_COLOR(1.0f,1.0f,1.0f,1.0f);
   const glVec GREY_COLOR(0.6f,0.6f,0.6f,0.6f);
@@ -394,8 +814,6 @@ void render_gl()
   const glVec T_COLOR(0.0f,1.0f,1.0f,1.0f);
   const glVec Z_COLOR(0.5f,1.0f,0.5f,1.0f);
 
-  const DataBuffer &gameState=GAME_STATE.buffer.swap_and_read();
-
   SDL_GL_SwapBuffers();
   printGlError();
 
@@ -404,11 +822,12 @@ void render_gl()
 
   // Draw blocks set in field
   glUniform4fv(GL_STATE.tintUniform, 1, GREY_COLOR.data);
-  for(unsigned i=0;i<FIELD_WIDTH;++i)
+  for(unsigned j=0;j<FIELD_VIEW_HEIGHT;++j)
     {
-      for(unsigned j=0;j<FIELD_VIEW_HEIGHT;++j)
+      const unsigned row=gameState.row(j);
+      for(unsigned i=0;row>>i;++i)
 	{
-	  if(gameState.field.get(i,j))
+	  if(row & (1u<<i))
 	    {
 	      glUniform2f(GL_STATE.offsetUniform,(GLfloat)i,(GLfloat)j);
 	      glDrawElements(GL_TRIANGLES,6,GL_UNSIGNED_SHORT,0);
@@ -417,8 +836,12 @@ void render_gl()
     }
   
   // Draw current piece
-  arrayt blocks=gameState.current.getBlocks();
-  switch(gameState.current.getType())
+  if(!gameState.active())
+    {
+      return;
+    }
+  arrayt blocks=gameState.blocks();
+  switch(gameState.pieceType())
     {
     case I:
       glUniform4fv(GL_STATE.tintUniform, 1, I_COLOR.data);
@@ -456,7 +879,10 @@ void render_gl()
 
 void terminate_program(int ec)
 {
-  terminate_music();
+  if(!VIEWER && !REPLAY)
+    {
+      terminate_music();
+    }
   terminate_gl();
   SDL_Quit();
   exit(ec);
@@ -0,0 +1,107 @@
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include <sys/resource.h>
+
+#include "GameServer.hpp"
+
+static volatile std::sig_atomic_t STOP=0;
+
+static void on_signal(int)
+{
+  STOP=1;
+}
+
+// Allow as many connections as the hard limit permits.
+static void raise_fd_limit()
+{
+  rlimit lim;
+  if(0==getrlimit(RLIMIT_NOFILE,&lim))
+    {
+      lim.rlim_cur=lim.rlim_max;
+      setrlimit(RLIMIT_NOFILE,&lim);
+    }
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--bind ADDRESS] [--port PORT] [--room PLAYERS] [--tick HZ]"
+    " [--spectate PORT]\n";
+  std::string address="127.0.0.1";
+  unsigned port=7777,room=2,tick=60;
+  int spectate=-1;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--bind"))
+	{
+	  address=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--port"))
+	{
+	  port=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--room"))
+	{
+	  room=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--tick"))
+	{
+	  tick=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--spectate"))
+	{
+	  spectate=std::atoi(argv[++i]);
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+
+  raise_fd_limit();
+  std::signal(SIGINT,on_signal);
+  std::signal(SIGTERM,on_signal);
+  try
+    {
+      GameServer server(address,port,room,tick);
+      std::cout << "Listening on " << address << ':' << server.getPort() << std::endl;
+      if(spectate>=0)
+	{
+	  server.listenSpectators(spectate);
+	  std::cout << "Spectators on " << address << ':' << server.getSpectatorPort() << std::endl;
+	}
+      // Report once a second.
+      auto report=std::chrono::steady_clock::now()+std::chrono::seconds(1);
+      while(!STOP)
+	{
+	  server.poll(100);
+	  if(std::chrono::steady_clock::now()<report)
+	    {
+	      continue;
+	    }
+	  report+=std::chrono::seconds(1);
+	  const ServerStats &s=server.getStats();
+	  const double avg=s.ticks ? s.tickTotal/1000.0/s.ticks : 0.0;
+	  std::cout << "connections " << s.connections
+		    << " spectators " << s.spectators
+		    << " accepted " << s.accepted << " closed " << s.closed
+		    << " dropped " << s.dropped
+		    << " ticks " << s.ticks
+		    << " tick_us avg " << avg << " max " << s.tickMax/1000.0
+		    << " in_B " << s.bytesIn << " out_B " << s.bytesOut
+		    << " spectated_B " << s.bytesSpectated << std::endl;
+	  server.resetStats();
+	}
+    }
+  catch(NetError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  return 0;
+}
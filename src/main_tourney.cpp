@@ -0,0 +1,221 @@
+/* tetris_tourney
+   Plays versus matches between the bot configurations listed in a file, one
+   per line as Tournament::Entrant::parse reads them, on every core, and
+   prints their ratings. Each match is written to --results as it finishes.
+   A match can be played again alone with --match and the seed and entrant
+   names from its line, to see which change altered its result.
+ */
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+
+#include "Tournament.hpp"
+
+static bool readEntrants(const char *path, std::vector<Tournament::Entrant> &out)
+{
+  std::ifstream in(path);
+  if(!in)
+    {
+      std::cerr << "cannot read " << path << std::endl;
+      return false;
+    }
+  std::string line;
+  for(unsigned number=1;std::getline(in,line);++number)
+    {
+      const std::size_t start=line.find_first_not_of(" \t");
+      if(std::string::npos==start || '#'==line[start])
+	{
+	  continue;
+	}
+      Tournament::Entrant e;
+      if(!e.parse(line))
+	{
+	  std::cerr << path << ":" << number << ": cannot read \"" << line << "\"" << std::endl;
+	  return false;
+	}
+      out.push_back(e);
+    }
+  return true;
+}
+
+static int findEntrant(const std::vector<Tournament::Entrant> &entrants, const char *name)
+{
+  for(unsigned i=0;i<entrants.size();++i)
+    {
+      if(entrants[i].name==name)
+	{
+	  return i;
+	}
+    }
+  std::cerr << "no entrant " << name << std::endl;
+  return -1;
+}
+
+static void writeMatch(std::ostream &out, const std::vector<Tournament::Entrant> &entrants,
+		       const Tournament::Match &m)
+{
+  out << "match " << m.number << " round " << m.round << " seed " << m.seed << ' '
+      << entrants[m.a].name << ' ' << entrants[m.b].name << ' ' << m.score
+      << " frames " << m.frames << " sent " << m.sentA << ' ' << m.sentB
+      << " checksum " << std::hex << m.checksum << std::dec << '\n';
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" --bots FILE [--swiss ROUNDS] [--games N] [--seed N] [--frames N]"
+    " [--threads N] [--results FILE] [--resamples N] [--match SEED A B]\n"
+    "  --bots FILE      one entrant per line: NAME [preview|nopreview] [delay N]\n"
+    "                   [FEATURE WEIGHT]...\n"
+    "  --swiss ROUNDS   Swiss rounds instead of a round robin\n"
+    "  --games N        games per pairing, rounded up to even (default 2)\n"
+    "  --frames N       frames before a match is a draw (default 7200)\n"
+    "  --results FILE   write every match, and the ratings, to FILE\n"
+    "  --resamples N    resamplings for the confidence intervals (default 200)\n"
+    "  --match SEED A B play one match between entrants A and B\n";
+  unsigned rounds=0,games=2,frames=60*60*2,threads=0,resamples=200;
+  std::uint64_t seed=1;
+  const char *bots=nullptr,*results=nullptr,*replayA=nullptr,*replayB=nullptr;
+  std::uint32_t replaySeed=0;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--bots"))
+	{
+	  bots=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--swiss"))
+	{
+	  rounds=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--games"))
+	{
+	  games=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  seed=std::strtoull(argv[++i],nullptr,0);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--frames"))
+	{
+	  frames=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--results"))
+	{
+	  results=argv[++i];
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--resamples"))
+	{
+	  resamples=std::atoi(argv[++i]);
+	}
+      else if(i+3<argc && 0==std::strcmp(argv[i],"--match"))
+	{
+	  replaySeed=std::strtoul(argv[++i],nullptr,0);
+	  replayA=argv[++i];
+	  replayB=argv[++i];
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+  std::vector<Tournament::Entrant> entrants;
+  if(!bots)
+    {
+      std::cerr << "Usage: " << argv[0] << USAGE;
+      return -1;
+    }
+  if(!readEntrants(bots,entrants))
+    {
+      return -1;
+    }
+
+  if(replayA)
+    {
+      const int a=findEntrant(entrants,replayA),b=findEntrant(entrants,replayB);
+      if(a<0 || b<0)
+	{
+	  return -1;
+	}
+      Tournament::Match m;
+      m.number=m.round=0;
+      m.a=a;
+      m.b=b;
+      m.seed=replaySeed;
+      Tournament::play(entrants[a],entrants[b],frames,m);
+      writeMatch(std::cout,entrants,m);
+      return 0;
+    }
+  if(entrants.size()<2)
+    {
+      std::cerr << bots << " needs at least two entrants" << std::endl;
+      return -1;
+    }
+
+  std::ofstream out;
+  if(results)
+    {
+      out.open(results,std::ios::trunc);
+      if(!out)
+	{
+	  std::cerr << "cannot write " << results << std::endl;
+	  return -1;
+	}
+      out << "# tetris_tourney seed " << seed << " games " << games << " frames " << frames
+	  << (rounds ? " swiss" : " round robin");
+      if(rounds)
+	{
+	  out << ' ' << rounds;
+	}
+      out << '\n';
+    }
+
+  WorkerPool pool(threads);
+  Tournament tournament(entrants,seed,frames);
+  unsigned long done=0;
+  tournament.setListener([&](const Tournament::Match &m)
+			 {
+			   ++done;
+			   if(results)
+			     {
+			       writeMatch(out,entrants,m);
+			       out.flush();
+			     }
+			 });
+  std::cout << "threads " << pool.size() << " entrants " << entrants.size() << std::endl;
+  if(rounds)
+    {
+      tournament.playSwiss(pool,rounds,games);
+    }
+  else
+    {
+      tournament.playRoundRobin(pool,games);
+    }
+
+  const std::vector<Tournament::Rating> ratings=tournament.ratings(resamples);
+  std::cout << "matches " << done << "\n"
+	    << std::left << std::setw(16) << "entrant" << std::right << std::setw(8) << "elo"
+	    << std::setw(16) << "95% interval" << std::setw(9) << "points"
+	    << std::setw(7) << "games" << std::endl;
+  for(unsigned i=0;i<entrants.size();++i)
+    {
+      const Tournament::Rating &r=ratings[i];
+      std::cout << std::left << std::setw(16) << entrants[i].name << std::right
+		<< std::fixed << std::setprecision(0) << std::setw(8) << r.elo
+		<< std::setw(8) << r.low << std::setw(8) << r.high
+		<< std::setprecision(1) << std::setw(9) << tournament.getPoints()[i]
+		<< std::setw(7) << r.games << std::endl;
+      if(results)
+	{
+	  out << "rating " << entrants[i].name << ' ' << r.elo << ' ' << r.low << ' ' << r.high
+	      << ' ' << tournament.getPoints()[i] << ' ' << r.games << '\n';
+	}
+    }
+  return 0;
+}
@@ -0,0 +1,138 @@
+/* tetris_tune
+   Tunes the bot's evaluation weights by playing seeded headless games on
+   every core (see src/Tuner.hpp), and prints the weights found. With
+   --checkpoint, the state is saved after every generation, and a run started
+   with the same file and settings carries on where the last one stopped.
+ */
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#include "Tuner.hpp"
+
+static void printWeights(const char *label, const Evaluator::Weights &w)
+{
+  std::cout << label;
+  for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+    {
+      std::cout << ' ' << Tuner::featureName(f) << ' ' << w.w[f];
+    }
+  std::cout << std::endl;
+}
+
+int main(int argc, char **argv)
+{
+  const char USAGE[]=" [--generations N] [--population N] [--elite N] [--games N]"
+    " [--pieces N] [--seed N] [--sigma X] [--noise X] [--preview] [--threads N]"
+    " [--checkpoint FILE]\n"
+    "  --generations N  generations to reach, counting resumed ones (default 20)\n"
+    "  --population N   weight vectors tried per generation (default 100)\n"
+    "  --elite N        best vectors the next generation is drawn around (default 10)\n"
+    "  --games N        games per vector (default 10)\n"
+    "  --pieces N       pieces per game (default 2000)\n"
+    "  --sigma X        starting spread of every weight (default 2)\n"
+    "  --noise X        spread added to the first generation, falling after (default 1)\n"
+    "  --preview        let the bot see the next piece (slower)\n";
+  Tuner::Settings settings;
+  unsigned generations=20,threads=0;
+  const char *checkpoint=nullptr;
+
+  for(int i=1;i<argc;++i)
+    {
+      if(i+1<argc && 0==std::strcmp(argv[i],"--generations"))
+	{
+	  generations=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--population"))
+	{
+	  settings.population=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--elite"))
+	{
+	  settings.elite=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--games"))
+	{
+	  settings.games=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--pieces"))
+	{
+	  settings.pieces=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--seed"))
+	{
+	  settings.seed=std::strtoul(argv[++i],nullptr,0);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--sigma"))
+	{
+	  settings.sigma=std::atof(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--noise"))
+	{
+	  settings.noise=std::atof(argv[++i]);
+	}
+      else if(0==std::strcmp(argv[i],"--preview"))
+	{
+	  settings.preview=true;
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--threads"))
+	{
+	  threads=std::atoi(argv[++i]);
+	}
+      else if(i+1<argc && 0==std::strcmp(argv[i],"--checkpoint"))
+	{
+	  checkpoint=argv[++i];
+	}
+      else
+	{
+	  std::cerr << "Usage: " << argv[0] << USAGE;
+	  return -1;
+	}
+    }
+
+  WorkerPool pool(threads);
+  Tuner tuner(pool,settings);
+  try
+    {
+      if(checkpoint && tuner.load(checkpoint))
+	{
+	  std::cout << "resuming " << checkpoint << " at generation "
+		    << tuner.getGeneration() << std::endl;
+	}
+    }
+  catch(CheckpointError &e)
+    {
+      std::cerr << e.what() << std::endl;
+      return -1;
+    }
+  std::cout << "threads " << pool.size() << " population " << tuner.getSettings().population
+	    << " elite " << tuner.getSettings().elite << " games " << tuner.getSettings().games
+	    << " pieces " << tuner.getSettings().pieces << std::endl;
+
+  while(tuner.getGeneration()<generations)
+    {
+      const auto t0=std::chrono::steady_clock::now();
+      const Tuner::Generation &g=tuner.step();
+      const std::chrono::duration<double> elapsed=std::chrono::steady_clock::now()-t0;
+      std::cout << "generation " << g.number << " mean " << g.meanScore
+		<< " elite " << g.eliteScore << " best " << g.bestScore
+		<< " games/s " << tuner.getSettings().population*tuner.getSettings().games/elapsed.count()
+		<< std::endl;
+      if(checkpoint)
+	{
+	  try
+	    {
+	      tuner.save(checkpoint);
+	    }
+	  catch(CheckpointError &e)
+	    {
+	      std::cerr << e.what() << std::endl;
+	      return -1;
+	    }
+	}
+    }
+  printWeights("weights",tuner.getMean());
+  std::cout << "games played " << tuner.getGamesPlayed() << std::endl;
+  return 0;
+}
@@ -0,0 +1,129 @@
+/* unittestris.cpp
+   The C interface over BatchEnv. No exception may cross into C, so every
+   call that can throw catches and records it.
+ */
+#include "unittestris.h"
+
+#include <exception>
+#include <memory>
+#include <stdexcept>
+#include <string>
+
+#include "BatchEnv.hpp"
+
+struct ut_batch
+{
+  WorkerPool pool;
+  BatchEnv env;
+  std::string error;
+
+  ut_batch(std::size_t games, unsigned threads):pool(threads),env(pool,games),error()
+  {}
+};
+
+template <class F>
+static int guarded(ut_batch *batch, const F &call)
+{
+  if(!batch)
+    {
+      return -1;
+    }
+  try
+    {
+      call();
+      return 0;
+    }
+  catch(std::exception &e)
+    {
+      batch->error=e.what();
+    }
+  catch(...)
+    {
+      batch->error="Unknown error.";
+    }
+  return -1;
+}
+
+size_t ut_observation_size(void)
+{
+  return BatchEnv::OBSERVATION_SIZE;
+}
+
+size_t ut_action_count(void)
+{
+  return BatchEnv::ACTIONS;
+}
+
+ut_batch* ut_batch_create(size_t games, unsigned threads)
+{
+  if(0==games)
+    {
+      return nullptr;
+    }
+  try
+    {
+      return new ut_batch(games,threads);
+    }
+  catch(...)
+    {
+      return nullptr;
+    }
+}
+
+void ut_batch_destroy(ut_batch *batch)
+{
+  delete batch;
+}
+
+size_t ut_batch_size(const ut_batch *batch)
+{
+  return batch ? batch->env.size() : 0;
+}
+
+unsigned ut_batch_threads(const ut_batch *batch)
+{
+  return batch ? batch->pool.size() : 0;
+}
+
+int ut_batch_set_buffers(ut_batch *batch, float *observations, uint8_t *masks,
+			 float *rewards, uint8_t *dones)
+{
+  return guarded(batch,[&]()
+		 {
+		   BatchEnv::Buffers b;
+		   b.observations=observations;
+		   b.masks=masks;
+		   b.rewards=rewards;
+		   b.dones=dones;
+		   batch->env.setBuffers(b);
+		 });
+}
+
+int ut_batch_reset(ut_batch *batch, const uint64_t *seeds)
+{
+  return guarded(batch,[&]()
+		 {
+		   if(!seeds)
+		     {
+		       throw std::invalid_argument("No seeds.");
+		     }
+		   batch->env.reset(seeds);
+		 });
+}
+
+int ut_batch_step(ut_batch *batch, const int32_t *actions)
+{
+  return guarded(batch,[&]()
+		 {
+		   if(!actions)
+		     {
+		       throw std::invalid_argument("No actions.");
+		     }
+		   batch->env.step(actions);
+		 });
+}
+
+const char* ut_batch_error(const ut_batch *batch)
+{
+  return batch ? batch->error.c_str() : "No batch.";
+}
@@ -0,0 +1,57 @@
+/* unittestris.h
+   The C interface of libunittestris: batches of headless games for training
+   loops, usable from any language that can call C. See src/BatchEnv.hpp for
+   the meaning of actions and the layout of the buffers.
+
+   Functions that can fail return 0 on success and -1 on failure, with a
+   message from ut_batch_error. A batch must not be used from more than one
+   thread at a time; it steps its games on threads of its own.
+ */
+#ifndef UNITTESTRIS_H
+#define UNITTESTRIS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__GNUC__)
+#define UT_API __attribute__((visibility("default")))
+#else
+#define UT_API
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct ut_batch ut_batch;
+
+/* Floats per game in the observations, and actions per game in the masks. */
+UT_API size_t ut_observation_size(void);
+UT_API size_t ut_action_count(void);
+
+/* A batch of games stepped on threads threads, counting the caller; 0 means
+   one per hardware thread. Returns NULL if games is 0 or on failure. */
+UT_API ut_batch* ut_batch_create(size_t games, unsigned threads);
+UT_API void ut_batch_destroy(ut_batch *batch);
+UT_API size_t ut_batch_size(const ut_batch *batch);
+/* Threads stepping the batch, counting the caller. */
+UT_API unsigned ut_batch_threads(const ut_batch *batch);
+
+/* The buffers every later call writes into, each holding ut_batch_size
+   entries of its kind. Any may be NULL. The batch keeps the pointers; the
+   memory stays the caller's. */
+UT_API int ut_batch_set_buffers(ut_batch *batch, float *observations, uint8_t *masks,
+				float *rewards, uint8_t *dones);
+/* Start game i with seeds[i]. */
+UT_API int ut_batch_reset(ut_batch *batch, const uint64_t *seeds);
+/* Place every game's current piece by actions[i]. */
+UT_API int ut_batch_step(ut_batch *batch, const int32_t *actions);
+
+/* The message for the last failure on batch. */
+UT_API const char* ut_batch_error(const ut_batch *batch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* UNITTESTRIS_H */
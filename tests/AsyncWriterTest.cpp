@@ -0,0 +1,194 @@
+#include "AsyncWriterTest.hpp"
+#include "AsyncWriter.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <thread>
+#include <unistd.h>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( AsyncWriterTest );
+
+static std::string tempPath()
+{
+  return "/tmp/AsyncWriterTest."+std::to_string(getpid())+".log";
+}
+
+// A record that says what it is: its length, stream and number, then bytes
+// made from those.
+static std::vector<std::uint8_t> makeRecord(std::uint32_t stream, std::uint32_t seq,
+					    std::size_t bytes)
+{
+  std::vector<std::uint8_t> ret(std::max<std::size_t>(bytes,12));
+  const std::uint32_t header[3]={(std::uint32_t)ret.size(),stream,seq};
+  std::memcpy(ret.data(),header,sizeof(header));
+  for(std::size_t i=12;i<ret.size();++i)
+    {
+      ret[i]=stream*31+seq+i;
+    }
+  return ret;
+}
+
+// Check that the file is whole records, in order within each stream, and
+// return how many there are of each stream. Without gaps, every number of
+// a stream must be there.
+static std::vector<std::uint32_t> readRecords(const std::string &path, std::size_t streams,
+					      bool gaps)
+{
+  std::ifstream in(path,std::ios::binary);
+  const std::vector<std::uint8_t> data((std::istreambuf_iterator<char>(in)),
+				       std::istreambuf_iterator<char>());
+  std::vector<std::uint32_t> counts(streams,0),next(streams,0);
+  std::size_t at=0;
+  while(at<data.size())
+    {
+      CPPUNIT_ASSERT( at+12<=data.size() );
+      std::uint32_t header[3];
+      std::memcpy(header,&data[at],sizeof(header));
+      CPPUNIT_ASSERT( header[1]<streams );
+      CPPUNIT_ASSERT( gaps ? header[2]>=next[header[1]] : header[2]==next[header[1]] );
+      CPPUNIT_ASSERT( at+header[0]<=data.size() );
+      const std::vector<std::uint8_t> expect=makeRecord(header[1],header[2],header[0]);
+      CPPUNIT_ASSERT( std::equal(expect.begin(),expect.end(),data.begin()+at) );
+      next[header[1]]=header[2]+1;
+      ++counts[header[1]];
+      at+=header[0];
+    }
+  return counts;
+}
+
+void AsyncWriterTest::setUp()
+{
+  unlink(tempPath().c_str());
+}
+
+void AsyncWriterTest::tearDown()
+{
+  unlink(tempPath().c_str());
+}
+
+void AsyncWriterTest::testStreams()
+{
+  const unsigned THREADS=4,RECORDS=2000;
+  for(int uring=0;uring<2;++uring)
+    {
+      unlink(tempPath().c_str());
+      AsyncWriterStats stats;
+      {
+	// Small batches, so records are split between them and the buffers
+	// run out.
+	AsyncWriter writer(tempPath(),4096,uring);
+	if(!uring)
+	  {
+	    CPPUNIT_ASSERT( std::string("pwrite")==writer.getBackend() );
+	  }
+	std::vector<AsyncWriter::Stream*> streams;
+	for(unsigned t=0;t<THREADS;++t)
+	  {
+	    streams.push_back(writer.open(1<<16));
+	  }
+	std::vector<std::thread> threads;
+	for(unsigned t=0;t<THREADS;++t)
+	  {
+	    threads.push_back(std::thread([&,t]()
+					  {
+					    for(std::uint32_t i=0;i<RECORDS;++i)
+					      {
+						const std::vector<std::uint8_t> r=
+						  makeRecord(t,i,i%50 ? 12+i%300 : 10000);
+						// Never drop: wait for room.
+						while(!streams[t]->append(r.data(),r.size()))
+						  {
+						    std::this_thread::yield();
+						  }
+					      }
+					  }));
+	  }
+	for(std::thread &t : threads)
+	  {
+	    t.join();
+	  }
+	writer.flush();
+	stats=writer.getStats();
+	CPPUNIT_ASSERT( THREADS*RECORDS==stats.records );
+	CPPUNIT_ASSERT( stats.bytes==stats.written );
+	CPPUNIT_ASSERT( stats.writes>1 );
+	CPPUNIT_ASSERT( stats.highWater<=stats.highWaterCapacity );
+	CPPUNIT_ASSERT( (1u<<16)==stats.highWaterCapacity );
+	// More appended after a flush is written by the destructor.
+	const std::vector<std::uint8_t> r=makeRecord(0,RECORDS,100);
+	CPPUNIT_ASSERT( streams[0]->append(r.data(),r.size()) );
+      }
+      const std::vector<std::uint32_t> counts=readRecords(tempPath(),THREADS,false);
+      CPPUNIT_ASSERT( RECORDS+1==counts[0] );
+      for(unsigned t=1;t<THREADS;++t)
+	{
+	  CPPUNIT_ASSERT( RECORDS==counts[t] );
+	}
+    }
+}
+
+void AsyncWriterTest::testBackpressure()
+{
+  const unsigned RECORDS=100000;
+  AsyncWriter writer(tempPath());
+  AsyncWriter::Stream *s=writer.open(256);
+  CPPUNIT_ASSERT( 256==s->getCapacity() );
+  unsigned appended=0;
+  for(std::uint32_t i=0;i<RECORDS;++i)
+    {
+      const std::vector<std::uint8_t> r=makeRecord(0,i,100);
+      appended+=s->append(r.data(),r.size());
+    }
+  writer.flush();
+  const AsyncWriterStats stats=writer.getStats();
+  CPPUNIT_ASSERT( appended==stats.records );
+  CPPUNIT_ASSERT( RECORDS==stats.records+stats.dropped );
+  CPPUNIT_ASSERT( 100*stats.dropped==stats.droppedBytes );
+  CPPUNIT_ASSERT( 100*stats.records==stats.written );
+  CPPUNIT_ASSERT( stats.highWater<=256 );
+  CPPUNIT_ASSERT( appended==readRecords(tempPath(),1,true)[0] );
+}
+
+void AsyncWriterTest::testClose()
+{
+  {
+    AsyncWriter writer(tempPath());
+    for(std::uint32_t t=0;t<3;++t)
+      {
+	AsyncWriter::Stream *s=writer.open();
+	for(std::uint32_t i=0;i<10;++i)
+	  {
+	    const std::vector<std::uint8_t> r=makeRecord(t,i,50);
+	    CPPUNIT_ASSERT( s->append(r.data(),r.size()) );
+	  }
+	writer.close(s);
+      }
+    writer.flush();
+    const AsyncWriterStats stats=writer.getStats();
+    CPPUNIT_ASSERT( 30==stats.records );
+    CPPUNIT_ASSERT( 1500==stats.written );
+  }
+  const std::vector<std::uint32_t> counts=readRecords(tempPath(),3,false);
+  CPPUNIT_ASSERT( 10==counts[0] && 10==counts[1] && 10==counts[2] );
+
+  // A second writer appends to the file.
+  {
+    AsyncWriter writer(tempPath());
+    const std::vector<std::uint8_t> r=makeRecord(0,10,50);
+    CPPUNIT_ASSERT( writer.open()->append(r.data(),r.size()) );
+  }
+  CPPUNIT_ASSERT( 11==readRecords(tempPath(),3,false)[0] );
+}
+
+void AsyncWriterTest::testErrors()
+{
+  CPPUNIT_ASSERT_THROW( AsyncWriter("/nonexistent/AsyncWriterTest.log"), WriterError );
+  AsyncWriter writer(tempPath());
+  AsyncWriter::Stream *s=writer.open(64);
+  const std::vector<std::uint8_t> big(61);
+  CPPUNIT_ASSERT_THROW( s->append(big.data(),big.size()), std::length_error );
+  CPPUNIT_ASSERT( s->append(big.data(),60) );
+}
@@ -0,0 +1,31 @@
+#ifndef ASYNCWRITERTEST_HPP
+#define ASYNCWRITERTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class AsyncWriterTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( AsyncWriterTest );
+  CPPUNIT_TEST( testStreams );
+  CPPUNIT_TEST( testBackpressure );
+  CPPUNIT_TEST( testClose );
+  CPPUNIT_TEST( testErrors );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Records appended by several threads at once reach the file whole and
+  // in order, with either backend, including records bigger than a batch.
+  void testStreams();
+  // A full stream drops records instead of waiting, and the statistics
+  // account for every record.
+  void testBackpressure();
+  // A closed stream is still written out and its counts kept.
+  void testClose();
+  // Bad paths and oversized records throw.
+  void testErrors();
+};
+
+#endif // ASYNCWRITERTEST_HPP
@@ -0,0 +1,218 @@
+#include "BatchEnvTest.hpp"
+#include "BatchEnv.hpp"
+#include "unittestris.h"
+
+#include <algorithm>
+#include <numeric>
+#include <string>
+#include <vector>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( BatchEnvTest );
+
+// Buffers for a batch of games.
+struct Arrays
+{
+  std::vector<float> observations,rewards;
+  std::vector<std::uint8_t> masks,dones;
+
+  explicit Arrays(std::size_t games):
+    observations(games*BatchEnv::OBSERVATION_SIZE,-1.0f),rewards(games,-1.0f),
+    masks(games*BatchEnv::ACTIONS,2),dones(games,2)
+  {}
+  BatchEnv::Buffers buffers()
+  {
+    BatchEnv::Buffers ret={observations.data(),masks.data(),rewards.data(),dones.data()};
+    return ret;
+  }
+};
+
+// Whether an observed board has a block in column x.
+static bool column(const float *observation, int x)
+{
+  for(int y=0;y<FIELD_HEIGHT;++y)
+    {
+      if(observation[y*FIELD_WIDTH+x])
+	{
+	  return true;
+	}
+    }
+  return false;
+}
+
+// The legal actions of game i, in order.
+static std::vector<std::int32_t> legal(const Arrays &a, std::size_t i)
+{
+  std::vector<std::int32_t> ret;
+  for(unsigned k=0;k<BatchEnv::ACTIONS;++k)
+    {
+      if(a.masks[i*BatchEnv::ACTIONS+k])
+	{
+	  ret.push_back(k);
+	}
+    }
+  return ret;
+}
+
+void BatchEnvTest::setUp()
+{
+}
+
+void BatchEnvTest::tearDown()
+{
+}
+
+void BatchEnvTest::testObservations()
+{
+  WorkerPool pool(2);
+  BatchEnv env(pool,3);
+  Arrays a(3);
+  const std::uint64_t seeds[3]={7,8,7};
+
+  CPPUNIT_ASSERT( 3==env.size() );
+  env.setBuffers(a.buffers());
+  env.reset(seeds);
+  for(std::size_t i=0;i<3;++i)
+    {
+      const HeadlessGame &game=env.getGame(i);
+      const float *obs=&a.observations[i*BatchEnv::OBSERVATION_SIZE];
+      CPPUNIT_ASSERT( std::all_of(obs,obs+FIELD_SIZE,[](float f){ return 0.0f==f; }) );
+      for(unsigned p=0;p<=BatchEnv::PREVIEW;++p)
+	{
+	  const float *hot=obs+FIELD_SIZE+7*p;
+	  const PieceType t=p ? game.getQueue().peek(p-1) : game.getCurrent().getType();
+	  CPPUNIT_ASSERT( 1.0f==std::accumulate(hot,hot+7,0.0f) );
+	  CPPUNIT_ASSERT( 1.0f==hot[t] );
+	}
+      // Every column an upright piece can reach on an empty board, at least.
+      const std::size_t n=legal(a,i).size();
+      CPPUNIT_ASSERT( n>=9 && n<=4*FIELD_WIDTH );
+    }
+  CPPUNIT_ASSERT( std::equal(a.observations.begin(),
+			     a.observations.begin()+BatchEnv::OBSERVATION_SIZE,
+			     a.observations.begin()+2*BatchEnv::OBSERVATION_SIZE) );
+  // Rewards and dones are only written by a step.
+  CPPUNIT_ASSERT( -1.0f==a.rewards[0] && 2==a.dones[0] );
+}
+
+void BatchEnvTest::testStep()
+{
+  WorkerPool pool(1);
+  BatchEnv env(pool,2);
+  Arrays a(2);
+  const std::uint64_t seeds[2]={3,3};
+
+  env.setBuffers(a.buffers());
+  env.reset(seeds);
+  const std::vector<std::int32_t> moves=legal(a,0);
+  // The leftmost and rightmost spawn orientation placements.
+  const std::int32_t left=moves.front();
+  const std::int32_t right=*(std::lower_bound(moves.begin(),moves.end(),FIELD_WIDTH+4)-1);
+  const std::int32_t actions[2]={left,right};
+  env.step(actions);
+  CPPUNIT_ASSERT( 0.0f==a.rewards[0] && 0==a.dones[0] );
+  CPPUNIT_ASSERT( 2==env.getGame(0).getPieceCount() );
+  CPPUNIT_ASSERT( column(&a.observations[0],0) && !column(&a.observations[0],FIELD_WIDTH-1) );
+  const float *second=&a.observations[BatchEnv::OBSERVATION_SIZE];
+  CPPUNIT_ASSERT( !column(second,0) && column(second,FIELD_WIDTH-1) );
+  CPPUNIT_ASSERT( 4.0f==std::accumulate(second,second+FIELD_SIZE,0.0f) );
+
+  // Illegal actions drop the piece where it is.
+  const std::int32_t wrong[2]={-5,(std::int32_t)BatchEnv::ACTIONS};
+  env.step(wrong);
+  CPPUNIT_ASSERT( 3==env.getGame(0).getPieceCount() && 3==env.getGame(1).getPieceCount() );
+  CPPUNIT_ASSERT( 8.0f==std::accumulate(second,second+FIELD_SIZE,0.0f) );
+  CPPUNIT_ASSERT( 2*2==env.getSteps() );
+}
+
+void BatchEnvTest::testDone()
+{
+  WorkerPool pool(1);
+  BatchEnv env(pool,4);
+  Arrays a(4);
+  const std::uint64_t seeds[4]={1,2,3,4};
+  const std::int32_t drop[4]={-1,-1,-1,-1};
+  unsigned steps=0,lost=0;
+
+  env.setBuffers(a.buffers());
+  env.reset(seeds);
+  // Stacking every piece in the middle loses within a few dozen pieces.
+  while(0==lost && steps<100)
+    {
+      env.step(drop);
+      lost=std::count(a.dones.begin(),a.dones.end(),1);
+      ++steps;
+    }
+  CPPUNIT_ASSERT( lost>0 && steps<100 );
+  for(std::size_t i=0;i<4;++i)
+    {
+      if(a.dones[i])
+	{
+	  const float *obs=&a.observations[i*BatchEnv::OBSERVATION_SIZE];
+	  CPPUNIT_ASSERT( 0.0f==std::accumulate(obs,obs+FIELD_SIZE,0.0f) );
+	  CPPUNIT_ASSERT( 1==env.getGame(i).getPieceCount() );
+	  CPPUNIT_ASSERT( !env.getGame(i).isGameOver() );
+	}
+    }
+}
+
+void BatchEnvTest::testThreads()
+{
+  const std::size_t games=37;
+  WorkerPool one(1),three(3);
+  BatchEnv a(one,games),b(three,games);
+  Arrays ba(games),bb(games);
+  std::vector<std::uint64_t> seeds(games);
+  std::vector<std::int32_t> actions(games);
+  unsigned step,s=1;
+
+  for(std::size_t i=0;i<games;++i)
+    {
+      seeds[i]=100+i;
+    }
+  a.setBuffers(ba.buffers());
+  b.setBuffers(bb.buffers());
+  a.reset(seeds.data());
+  b.reset(seeds.data());
+  for(step=0;step<200;++step)
+    {
+      for(std::size_t i=0;i<games;++i)
+	{
+	  const std::vector<std::int32_t> moves=legal(ba,i);
+	  s=s*1103515245+12345;
+	  actions[i]=moves.empty() ? 0 : moves[(s>>16)%moves.size()];
+	}
+      a.step(actions.data());
+      b.step(actions.data());
+      CPPUNIT_ASSERT( ba.observations==bb.observations );
+      CPPUNIT_ASSERT( ba.masks==bb.masks );
+      CPPUNIT_ASSERT( ba.rewards==bb.rewards );
+      CPPUNIT_ASSERT( ba.dones==bb.dones );
+    }
+}
+
+void BatchEnvTest::testCInterface()
+{
+  CPPUNIT_ASSERT( BatchEnv::OBSERVATION_SIZE==ut_observation_size() );
+  CPPUNIT_ASSERT( BatchEnv::ACTIONS==ut_action_count() );
+  CPPUNIT_ASSERT( !ut_batch_create(0,1) );
+  CPPUNIT_ASSERT( -1==ut_batch_step(nullptr,nullptr) );
+  CPPUNIT_ASSERT( 0==ut_batch_size(nullptr) );
+
+  ut_batch *batch=ut_batch_create(5,2);
+  CPPUNIT_ASSERT( batch );
+  CPPUNIT_ASSERT( 5==ut_batch_size(batch) && 2==ut_batch_threads(batch) );
+  Arrays a(5);
+  const std::uint64_t seeds[5]={1,2,3,4,5};
+  const std::int32_t actions[5]={0,0,0,0,0};
+  CPPUNIT_ASSERT( 0==ut_batch_set_buffers(batch,a.observations.data(),nullptr,
+					  a.rewards.data(),a.dones.data()) );
+  CPPUNIT_ASSERT( -1==ut_batch_reset(batch,nullptr) );
+  CPPUNIT_ASSERT( std::string("No seeds.")==ut_batch_error(batch) );
+  CPPUNIT_ASSERT( 0==ut_batch_reset(batch,seeds) );
+  CPPUNIT_ASSERT( 0==ut_batch_step(batch,actions) );
+  CPPUNIT_ASSERT( 0==a.dones[4] );
+  // Masks were not asked for.
+  CPPUNIT_ASSERT( 2==a.masks[0] );
+  ut_batch_destroy(batch);
+}
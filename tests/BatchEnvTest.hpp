@@ -0,0 +1,32 @@
+#ifndef BATCHENVTEST_HPP
+#define BATCHENVTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BatchEnvTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( BatchEnvTest );
+  CPPUNIT_TEST( testObservations );
+  CPPUNIT_TEST( testStep );
+  CPPUNIT_TEST( testDone );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST( testCInterface );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // After a reset the buffers describe each game's first piece.
+  void testObservations();
+  // An action places the piece it names, and anything else drops it.
+  void testStep();
+  // A lost game is reported once and starts again.
+  void testDone();
+  // The buffers are the same with any number of threads.
+  void testThreads();
+  // The C interface reports failures instead of throwing.
+  void testCInterface();
+};
+
+#endif // BATCHENVTEST_HPP
@@ -0,0 +1,99 @@
+#include "BattleMatchTest.hpp"
+#include "BattleMatch.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( BattleMatchTest );
+
+// Does nothing at all; gravity does the rest.
+class IdleAgent : public Agent
+{
+public:
+  std::size_t act(const HeadlessGame &, PieceInput *, std::size_t)
+  {
+    return 0;
+  }
+};
+
+void BattleMatchTest::setUp()
+{
+}
+
+void BattleMatchTest::tearDown()
+{
+}
+
+void BattleMatchTest::testAttack()
+{
+  CPPUNIT_ASSERT( 0==BattleMatch::attack(0) );
+  CPPUNIT_ASSERT( 0==BattleMatch::attack(1) );
+  CPPUNIT_ASSERT( 1==BattleMatch::attack(2) );
+  CPPUNIT_ASSERT( 2==BattleMatch::attack(3) );
+  CPPUNIT_ASSERT( 4==BattleMatch::attack(4) );
+}
+
+void BattleMatchTest::testThreads()
+{
+  WorkerPool one(1), four(4);
+  BattleMatch a(99,17), b(99,17);
+  unsigned i;
+
+  for(i=0;i<200;++i)
+    {
+      a.step(one);
+      b.step(four);
+      CPPUNIT_ASSERT( a.checksum()==b.checksum() );
+    }
+  a.run(one,60*60*10);
+  b.run(four,60*60*10);
+  CPPUNIT_ASSERT( a.isOver() && b.isOver() );
+  CPPUNIT_ASSERT( a.getFrame()==b.getFrame() );
+  CPPUNIT_ASSERT( a.checksum()==b.checksum() );
+}
+
+void BattleMatchTest::testPlaces()
+{
+  WorkerPool pool(2);
+  BattleMatch match(40,3);
+  unsigned i,j;
+
+  CPPUNIT_ASSERT( 40==match.getAlive() );
+  CPPUNIT_ASSERT( 0==match.getPlace(0) );
+  match.run(pool,60*60*10);
+  CPPUNIT_ASSERT( match.isOver() );
+  CPPUNIT_ASSERT( match.step(pool) );
+  for(i=0;i<match.getPlayers();++i)
+    {
+      const unsigned place=match.getPlace(i);
+      unsigned ahead=0;
+      CPPUNIT_ASSERT( 0<place && place<=40 );
+      for(j=0;j<match.getPlayers();++j)
+	{
+	  ahead+=match.getPlace(j)<place;
+	}
+      CPPUNIT_ASSERT( place-1==ahead );
+      // Only the winner can still be playing.
+      CPPUNIT_ASSERT( match.getGame(i).isGameOver() || 1==place );
+    }
+
+  BattleMatch solo(1,3);
+  CPPUNIT_ASSERT( solo.isOver() );
+  CPPUNIT_ASSERT( 1==solo.getPlace(0) );
+}
+
+void BattleMatchTest::testAgent()
+{
+  WorkerPool pool(2);
+  BattleMatch match(3,9);
+  unsigned i;
+
+  match.setAgent(1,std::unique_ptr<Agent>(new IdleAgent));
+  for(i=0;i<100;++i)
+    {
+      match.step(pool);
+    }
+  // Left alone, the first piece falls under gravity and has not yet landed.
+  CPPUNIT_ASSERT( 1==match.getGame(1).getPieceCount() );
+  CPPUNIT_ASSERT( 1<match.getGame(0).getPieceCount() );
+  CPPUNIT_ASSERT_THROW( match.setAgent(3,std::unique_ptr<Agent>(new IdleAgent)),
+			std::out_of_range );
+}
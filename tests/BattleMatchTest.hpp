@@ -0,0 +1,29 @@
+#ifndef BATTLEMATCHTEST_HPP
+#define BATTLEMATCHTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BattleMatchTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( BattleMatchTest );
+  CPPUNIT_TEST( testAttack );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST( testPlaces );
+  CPPUNIT_TEST( testAgent );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Singles send nothing; a tetris sends four.
+  void testAttack();
+  // A 99 player match ends the same way on one thread or four.
+  void testThreads();
+  // Every player finishes with a place, ties sharing the best one.
+  void testPlaces();
+  // Each player's agent can be replaced.
+  void testAgent();
+};
+
+#endif // BATTLEMATCHTEST_HPP
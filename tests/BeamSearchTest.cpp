@@ -0,0 +1,95 @@
+#include "BeamSearchTest.hpp"
+#include "BeamSearch.hpp"
+
+#include <algorithm>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( BeamSearchTest );
+
+void BeamSearchTest::setUp()
+{
+}
+
+void BeamSearchTest::tearDown()
+{
+}
+
+void BeamSearchTest::testArena()
+{
+  Arena<unsigned,64> arena;
+  std::vector<unsigned*> given;
+  unsigned i;
+
+  for(i=0;i<1000;++i)
+    {
+      given.push_back(arena.allocate());
+      *given.back()=i;
+    }
+  CPPUNIT_ASSERT( 1000==arena.size() );
+  CPPUNIT_ASSERT( 1024==arena.capacity() );
+  for(i=0;i<1000;++i)
+    {
+      CPPUNIT_ASSERT( i==*given[i] );
+    }
+  arena.reset();
+  CPPUNIT_ASSERT( 0==arena.size() );
+  for(i=0;i<1000;++i)
+    {
+      CPPUNIT_ASSERT( given[i]==arena.allocate() );
+    }
+  CPPUNIT_ASSERT( 1024==arena.capacity() );
+}
+
+void BeamSearchTest::testThreads()
+{
+  WorkerPool one(1), four(4);
+  BeamSearch a(one,16,4), b(four,16,4);
+  HeadlessGame game(21);
+  PieceInput pa[MoveList::MAX_PATH],pb[MoveList::MAX_PATH];
+  unsigned i;
+
+  for(i=0;i<150 && !game.isGameOver();++i)
+    {
+      const std::size_t n=a.plan(game,pa,MoveList::MAX_PATH);
+      CPPUNIT_ASSERT( n>0 );
+      CPPUNIT_ASSERT( n==b.plan(game,pb,MoveList::MAX_PATH) );
+      CPPUNIT_ASSERT( std::equal(pa,pa+n,pb) );
+      CPPUNIT_ASSERT( a.getStats().nodes==b.getStats().nodes );
+      CPPUNIT_ASSERT( 4==a.getStats().depth && 4==b.getStats().depth );
+      game.step(pa,n);
+    }
+  CPPUNIT_ASSERT( 150==i );
+}
+
+void BeamSearchTest::testBudget()
+{
+  WorkerPool pool(2);
+  BeamSearch search(pool,64,6);
+  HeadlessGame game(4);
+  PieceInput path[MoveList::MAX_PATH];
+
+  CPPUNIT_ASSERT( search.plan(game,path,MoveList::MAX_PATH)>0 );
+  CPPUNIT_ASSERT( 6==search.getStats().depth );
+  CPPUNIT_ASSERT( !search.getStats().timedOut );
+
+  search.setBudget(std::chrono::microseconds(1));
+  CPPUNIT_ASSERT( search.plan(game,path,MoveList::MAX_PATH)>0 );
+  CPPUNIT_ASSERT( search.getStats().depth>=1 && search.getStats().depth<6 );
+  CPPUNIT_ASSERT( search.getStats().timedOut );
+}
+
+void BeamSearchTest::testPlay()
+{
+  WorkerPool pool(2);
+  BeamAgent agent(pool,16,3);
+  HeadlessGame game(8);
+  PieceInput inputs[8];
+
+  while(game.getPieceCount()<=300 && !game.isGameOver())
+    {
+      game.step(inputs,agent.act(game,inputs,8));
+    }
+  CPPUNIT_ASSERT( !game.isGameOver() );
+  CPPUNIT_ASSERT( game.getField().readScore() >= 100 );
+  CPPUNIT_ASSERT( 3==agent.getSearch().getStats().depth );
+}
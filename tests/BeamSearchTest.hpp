@@ -0,0 +1,29 @@
+#ifndef BEAMSEARCHTEST_HPP
+#define BEAMSEARCHTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BeamSearchTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( BeamSearchTest );
+  CPPUNIT_TEST( testArena );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST( testBudget );
+  CPPUNIT_TEST( testPlay );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Arena objects keep their addresses, and reset reuses the same memory.
+  void testArena();
+  // Without a budget, any number of threads makes the same plans.
+  void testThreads();
+  // A budget cuts the search short, but there is always a plan.
+  void testBudget();
+  // The search plays a long game without losing.
+  void testPlay();
+};
+
+#endif // BEAMSEARCHTEST_HPP
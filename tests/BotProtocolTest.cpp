@@ -0,0 +1,188 @@
+#include "BotProtocolTest.hpp"
+#include "BotProtocol.hpp"
+
+#include "HeadlessGame.hpp"
+#include "PipeAgent.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( BotProtocolTest );
+
+// A bot in a shell script: answers hello, then runs reply for every move
+// with $id set, and stops at quit.
+static std::vector<std::string> script(const std::string &reply)
+{
+  return {"/bin/sh","-c","while read cmd id rest; do case $cmd in"
+      " hello) echo ok script;; move) "+reply+";; quit) exit;; esac; done"};
+}
+
+// Step the game until its current piece is placed.
+static void playPiece(HeadlessGame &game, Agent &agent)
+{
+  PieceInput inputs[BotProtocol::MAX_KEYS];
+  const unsigned piece=game.getPieceCount();
+  while(piece==game.getPieceCount() && !game.isGameOver())
+    {
+      game.step(inputs,agent.act(game,inputs,BotProtocol::MAX_KEYS));
+    }
+}
+
+// The board after the current piece is dropped from (orientation,x).
+static Bitboard dropped(const HeadlessGame &game, unsigned orientation, int x)
+{
+  const Piece &piece=game.getCurrent();
+  Bitboard board=Bitboard::fromField(game.getField());
+  const int y=board.drop(piece.getType(),orientation,x,piece.getCenter().y);
+  board.place(piece.getType(),orientation,x,y);
+  return board;
+}
+
+void BotProtocolTest::setUp()
+{
+}
+
+void BotProtocolTest::tearDown()
+{
+}
+
+void BotProtocolTest::testLines()
+{
+  HeadlessGame game(5);
+  BotProtocol::Move move;
+  CPPUNIT_ASSERT( BotProtocol::parseMove(BotProtocol::move(1,game),move) );
+  CPPUNIT_ASSERT( 0==move.field.height() );
+  const PieceInput drop=hard_drop;
+  for(int i=0;i<4;++i)
+    {
+      const unsigned piece=game.getPieceCount();
+      while(piece==game.getPieceCount())
+	{
+	  game.step(&drop,1);
+	}
+    }
+
+  const std::string line=BotProtocol::move(42,game);
+  CPPUNIT_ASSERT( BotProtocol::parseMove(line,move) );
+  CPPUNIT_ASSERT( 42==move.id );
+  CPPUNIT_ASSERT( Bitboard::fromField(game.getField())==move.field );
+  CPPUNIT_ASSERT( move.field.height()>0 );
+  CPPUNIT_ASSERT( game.getCurrent().getType()==move.piece );
+  CPPUNIT_ASSERT( game.getCurrent().getOrientation()==move.orientation );
+  CPPUNIT_ASSERT( game.getCurrent().getCenter()==move.center );
+  CPPUNIT_ASSERT( game.getQueue().size()==move.queued );
+  for(unsigned i=0;i<move.queued;++i)
+    {
+      CPPUNIT_ASSERT( game.getQueue().peek(i)==move.queue[i] );
+    }
+
+  BotProtocol::Reply reply,back;
+  reply.kind=BotProtocol::Reply::PLACE;
+  reply.id=7;
+  reply.orientation=3;
+  reply.x=-1;
+  CPPUNIT_ASSERT( "7 place 3 -1"==BotProtocol::reply(reply) );
+  CPPUNIT_ASSERT( BotProtocol::parseReply(BotProtocol::reply(reply),back) );
+  CPPUNIT_ASSERT( BotProtocol::Reply::PLACE==back.kind && 7==back.id );
+  CPPUNIT_ASSERT( 3==back.orientation && -1==back.x );
+  reply.kind=BotProtocol::Reply::INPUTS;
+  reply.id=8;
+  reply.count=3;
+  reply.keys[0]=shift_left;
+  reply.keys[1]=rotate_ccw;
+  reply.keys[2]=hard_drop;
+  CPPUNIT_ASSERT( "8 inputs LAD"==BotProtocol::reply(reply) );
+  CPPUNIT_ASSERT( BotProtocol::parseReply(BotProtocol::reply(reply),back) );
+  CPPUNIT_ASSERT( BotProtocol::Reply::INPUTS==back.kind && 8==back.id && 3==back.count );
+  CPPUNIT_ASSERT( shift_left==back.keys[0] && rotate_ccw==back.keys[1] && hard_drop==back.keys[2] );
+  CPPUNIT_ASSERT( BotProtocol::parseReply("9 inputs -",back) && 0==back.count );
+
+  std::string name;
+  CPPUNIT_ASSERT( BotProtocol::parseHello("ok my bot",name) && "my bot"==name );
+  CPPUNIT_ASSERT( BotProtocol::parseHello("ok",name) && name.empty() );
+  CPPUNIT_ASSERT( !BotProtocol::parseHello("hello",name) );
+  CPPUNIT_ASSERT( !BotProtocol::parseReply("",back) );
+  CPPUNIT_ASSERT( !BotProtocol::parseReply("1 place 4 0",back) );
+  CPPUNIT_ASSERT( !BotProtocol::parseReply("1 place 0",back) );
+  CPPUNIT_ASSERT( !BotProtocol::parseReply("1 inputs LXD",back) );
+  CPPUNIT_ASSERT( !BotProtocol::parseReply("1 jump",back) );
+  CPPUNIT_ASSERT( !BotProtocol::parseMove("move 1 - Q 0 4 20 IJ",move) );
+  CPPUNIT_ASSERT( !BotProtocol::parseMove("move 1 fffff T 0 4 20 IJ",move) );
+  CPPUNIT_ASSERT( !BotProtocol::parseMove("move 1 1/zz T 0 4 20 IJ",move) );
+  CPPUNIT_ASSERT( BotProtocol::parseMove("move 1 1/200 T 0 4 20 IJ",move) );
+  CPPUNIT_ASSERT( 1==move.field.rows[0] && 0x200==move.field.rows[1] && 2==move.queued );
+}
+
+void BotProtocolTest::testPlace()
+{
+  const std::chrono::microseconds budget=std::chrono::seconds(2);
+  HeadlessGame game(3);
+  PipeAgent placer(script("echo \"$id place 0 4\""),budget);
+  CPPUNIT_ASSERT( "script"==placer.getName() );
+  for(int i=0;i<3;++i)
+    {
+      const Bitboard expected=dropped(game,0,4);
+      playPiece(game,placer);
+      CPPUNIT_ASSERT( expected==Bitboard::fromField(game.getField()) );
+    }
+
+  // Inputs are played as given.
+  PipeAgent shifter(script("echo \"$id inputs LLD\""),budget);
+  for(int i=0;i<2;++i)
+    {
+      const Bitboard expected=dropped(game,0,game.getCurrent().getCenter().x-2);
+      playPiece(game,shifter);
+      CPPUNIT_ASSERT( expected==Bitboard::fromField(game.getField()) );
+    }
+
+  const PipeAgent::Stats &stats=placer.getStats();
+  CPPUNIT_ASSERT( 3==stats.moves && 0==stats.timeouts && 0==stats.errors );
+  CPPUNIT_ASSERT( 3==stats.latencies.size() );
+  CPPUNIT_ASSERT( 2==shifter.getStats().latencies.size() && 0==shifter.getStats().errors );
+  CPPUNIT_ASSERT( placer.isAlive() && shifter.isAlive() );
+}
+
+void BotProtocolTest::testTimeout()
+{
+  // The first answer takes longer than the budget; the next is on time, and
+  // comes after the late one.
+  PipeAgent slow(script("n=$((n+1)); [ $n = 1 ] && sleep 0.6; echo \"$id place 0 4\""),
+		 std::chrono::milliseconds(400));
+  HeadlessGame game(3);
+  Bitboard expected=dropped(game,0,game.getCurrent().getCenter().x);
+  playPiece(game,slow);
+  CPPUNIT_ASSERT( expected==Bitboard::fromField(game.getField()) );
+  expected=dropped(game,0,4);
+  playPiece(game,slow);
+  CPPUNIT_ASSERT( expected==Bitboard::fromField(game.getField()) );
+
+  const PipeAgent::Stats &stats=slow.getStats();
+  CPPUNIT_ASSERT( 2==stats.moves && 1==stats.timeouts && 0==stats.errors );
+  CPPUNIT_ASSERT( 1==stats.latencies.size() && stats.latencies[0]<400000 );
+}
+
+void BotProtocolTest::testBroken()
+{
+  const std::chrono::microseconds budget=std::chrono::seconds(2);
+  HeadlessGame game(3);
+
+  // Garbage forfeits the move, and so does a placement off the field.
+  PipeAgent garbage(script("echo \"$id what\""),budget);
+  Bitboard expected=dropped(game,0,game.getCurrent().getCenter().x);
+  playPiece(game,garbage);
+  CPPUNIT_ASSERT( expected==Bitboard::fromField(game.getField()) );
+  CPPUNIT_ASSERT( 1==garbage.getStats().errors && garbage.isAlive() );
+  PipeAgent outside(script("echo \"$id place 0 -5\""),budget);
+  playPiece(game,outside);
+  CPPUNIT_ASSERT( 1==outside.getStats().errors && outside.isAlive() );
+
+  PipeAgent quitter({"/bin/sh","-c","read line; echo ok"},budget);
+  CPPUNIT_ASSERT( quitter.isAlive() );
+  expected=dropped(game,0,game.getCurrent().getCenter().x);
+  playPiece(game,quitter);
+  CPPUNIT_ASSERT( expected==Bitboard::fromField(game.getField()) );
+  playPiece(game,quitter);
+  CPPUNIT_ASSERT( !quitter.isAlive() );
+  CPPUNIT_ASSERT( 2==quitter.getStats().moves && 2==quitter.getStats().errors );
+
+  CPPUNIT_ASSERT_THROW( PipeAgent({"/nonexistent/bot"},budget), PipeError );
+  CPPUNIT_ASSERT_THROW( PipeAgent({"/bin/sh","-c","echo hi"},budget), PipeError );
+}
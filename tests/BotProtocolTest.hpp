@@ -0,0 +1,31 @@
+#ifndef BOTPROTOCOLTEST_HPP
+#define BOTPROTOCOLTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BotProtocolTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( BotProtocolTest );
+  CPPUNIT_TEST( testLines );
+  CPPUNIT_TEST( testPlace );
+  CPPUNIT_TEST( testTimeout );
+  CPPUNIT_TEST( testBroken );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // A move line reads back as the game it was made from, replies read back
+  // as written, and malformed lines are refused.
+  void testLines();
+  // A bot's placements are played where it asked, and every exchange is
+  // timed.
+  void testPlace();
+  // A slow answer forfeits its move and is ignored when it comes.
+  void testTimeout();
+  // Garbage, a bot that exits and a command that does not exist.
+  void testBroken();
+};
+
+#endif // BOTPROTOCOLTEST_HPP
@@ -0,0 +1,197 @@
+#include "BotTest.hpp"
+#include "Bot.hpp"
+#include "FrameSnapshot.hpp"
+#include "Piece.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( BotTest );
+
+void BotTest::setUp()
+{
+}
+
+void BotTest::tearDown()
+{
+}
+
+void BotTest::testBitboard()
+{
+  HeadlessGame game(5);
+  Pcg32 rng(5,0);
+  PieceInput inputs[8];
+  const PieceInput moves[4]={shift_left,shift_right,rotate_cw,rotate_ccw};
+  unsigned i,j,pieces=0;
+
+  while(pieces<400)
+    {
+      if(game.isGameOver())
+	{
+	  game.reset(rng());
+	}
+      // Move the piece about, then check that it lands where the bitboard says.
+      const unsigned n=rng.bounded(8);
+      for(i=0;i<n;++i)
+	{
+	  inputs[i]=moves[rng.bounded(4)];
+	}
+      game.step(inputs,n);
+      if(game.isGameOver())
+	{
+	  continue;
+	}
+      const Piece &p=game.getCurrent();
+      Bitboard b=Bitboard::fromField(game.getField());
+      for(j=0;j<FIELD_HEIGHT;++j)
+	{
+	  CPPUNIT_ASSERT( b.rows[j]==game.getField().getRow(j) );
+	}
+      CPPUNIT_ASSERT( b.fits(p.getType(),p.getOrientation(),p.getCenter().x,p.getCenter().y) );
+      const int y=b.drop(p.getType(),p.getOrientation(),p.getCenter().x,p.getCenter().y);
+      const int lines=b.place(p.getType(),p.getOrientation(),p.getCenter().x,y);
+      const int score=game.getField().readScore();
+      inputs[0]=hard_drop;
+      game.step(inputs,1);
+      CPPUNIT_ASSERT( b==Bitboard::fromField(game.getField()) );
+      CPPUNIT_ASSERT( lines==game.getField().readScore()-score );
+      ++pieces;
+    }
+
+  // Four lines at once.
+  Bitboard b;
+  b.clear();
+  for(j=0;j<4;++j)
+    {
+      b.rows[j]=Bitboard::FULL & ~(1u<<9);
+    }
+  b.rows[4]=1;
+  CPPUNIT_ASSERT( !b.fits(I,1,9,1) );
+  CPPUNIT_ASSERT( b.fits(I,1,9,2) );
+  CPPUNIT_ASSERT( 2==b.drop(I,1,9,10) );
+  CPPUNIT_ASSERT( 4==b.place(I,1,9,2) );
+  CPPUNIT_ASSERT( 1==b.rows[0] );
+  CPPUNIT_ASSERT( 1==b.height() );
+  CPPUNIT_ASSERT( !b.toppedOut() );
+}
+
+void BotTest::testMoves()
+{
+  const unsigned expected[7]={17,34,34,9,17,34,17}; // I,J,L,O,S,T,Z
+  Bitboard empty;
+  MoveList list;
+  PieceInput path[MoveList::MAX_PATH];
+  unsigned i,j;
+
+  empty.clear();
+  for(int t=0;t<7;++t)
+    {
+      const PieceType type=(PieceType)t;
+      list.generate(empty,type,0,Piece::spawn(type));
+      CPPUNIT_ASSERT( expected[t]==list.size() );
+      for(i=0;i<list.size();++i)
+	{
+	  for(j=0;j<i;++j)
+	    {
+	      CPPUNIT_ASSERT( list[i].key!=list[j].key );
+	    }
+	  Bitboard b=empty;
+	  b.place(type,list[i].orientation,list[i].x,list[i].y);
+
+	  // Play the path with a real piece.
+	  Field f;
+	  Piece p(type,5,&f);
+	  const std::size_t n=list.path(i,path,MoveList::MAX_PATH);
+	  CPPUNIT_ASSERT( n>0 && hard_drop==path[n-1] );
+	  for(j=0;j+1<n;++j)
+	    {
+	      CPPUNIT_ASSERT( !p.handleInput(path[j]) );
+	    }
+	  CPPUNIT_ASSERT( p.handleInput(hard_drop) );
+	  CPPUNIT_ASSERT( b==Bitboard::fromField(f) );
+	  CPPUNIT_ASSERT( 0==list.path(i,path,n-1) );
+	}
+    }
+
+  // A piece that does not fit has no moves; one walled in has only one.
+  Bitboard full=empty;
+  for(j=0;j<=20;++j)
+    {
+      full.rows[j]=Bitboard::FULL;
+    }
+  list.generate(full,T,0,Piece::spawn(T));
+  CPPUNIT_ASSERT( 0==list.size() );
+  full.rows[20]=Bitboard::FULL & ~(7u<<3);
+  full.rows[21]=Bitboard::FULL & ~(1u<<4);
+  list.generate(full,T,0,Piece::spawn(T));
+  CPPUNIT_ASSERT( 1==list.size() );
+}
+
+void BotTest::testFeatures()
+{
+  Bitboard b;
+  int f[Evaluator::FEATURE_COUNT];
+
+  b.clear();
+  b.rows[0]=0x1FF; // every column but the last
+  b.rows[1]=0x5;   // columns 0 and 2
+  b.rows[2]=0x2;   // column 1, over a hole
+  Evaluator::features(b,f);
+  CPPUNIT_ASSERT( 0==f[Evaluator::LINES] );
+  CPPUNIT_ASSERT( 0==f[Evaluator::LANDING] );
+  CPPUNIT_ASSERT( 13==f[Evaluator::HEIGHT] );
+  CPPUNIT_ASSERT( 3==f[Evaluator::MAX_HEIGHT] );
+  CPPUNIT_ASSERT( 1==f[Evaluator::HOLES] );
+  CPPUNIT_ASSERT( 10==f[Evaluator::ROW_TRANSITIONS] );
+  CPPUNIT_ASSERT( 12==f[Evaluator::COLUMN_TRANSITIONS] );
+  CPPUNIT_ASSERT( 3==f[Evaluator::WELLS] );
+  CPPUNIT_ASSERT( 4==f[Evaluator::BUMPINESS] );
+
+  // A three deep well scores 1+2+3.
+  b.clear();
+  for(int y=0;y<3;++y)
+    {
+      b.rows[y]=Bitboard::FULL & ~(1u<<4);
+    }
+  Evaluator::features(b,f);
+  CPPUNIT_ASSERT( 6==f[Evaluator::WELLS] );
+  CPPUNIT_ASSERT( 0==f[Evaluator::HOLES] );
+
+  Evaluator::Weights w;
+  for(int i=0;i<Evaluator::FEATURE_COUNT;++i)
+    {
+      w.w[i]=i;
+    }
+  Evaluator eval(w);
+  float sum=0*7+1*2;
+  for(int i=2;i<Evaluator::FEATURE_COUNT;++i)
+    {
+      sum+=i*f[i];
+    }
+  CPPUNIT_ASSERT( sum==eval.evaluate(b,7,2) );
+}
+
+void BotTest::testPlay()
+{
+  HeadlessGame game(11);
+  BotAgent agent;
+  Bot bot;
+  PieceInput inputs[8],a[MoveList::MAX_PATH],b[MoveList::MAX_PATH];
+  unsigned lastPiece=0;
+
+  while(game.getPieceCount()<=500 && !game.isGameOver())
+    {
+      if(game.getPieceCount()!=lastPiece)
+	{
+	  // Planning from a snapshot gives the same moves.
+	  lastPiece=game.getPieceCount();
+	  const std::size_t n=bot.plan(game,a,MoveList::MAX_PATH);
+	  CPPUNIT_ASSERT( n>0 );
+	  CPPUNIT_ASSERT( n==bot.plan(game.snapshot(),b,MoveList::MAX_PATH) );
+	  CPPUNIT_ASSERT( std::equal(a,a+n,b) );
+	}
+      const std::size_t n=agent.act(game,inputs,8);
+      CPPUNIT_ASSERT( n<=8 );
+      game.step(inputs,n);
+    }
+  CPPUNIT_ASSERT( !game.isGameOver() );
+  CPPUNIT_ASSERT( game.getField().readScore() >= 150 );
+}
@@ -0,0 +1,29 @@
+#ifndef BOTTEST_HPP
+#define BOTTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class BotTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( BotTest );
+  CPPUNIT_TEST( testBitboard );
+  CPPUNIT_TEST( testMoves );
+  CPPUNIT_TEST( testFeatures );
+  CPPUNIT_TEST( testPlay );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Bitboard placements and line clears agree with Piece and Field.
+  void testBitboard();
+  // Every distinct placement is found once, and its path leads there.
+  void testMoves();
+  // Features of a board built by hand.
+  void testFeatures();
+  // The bot plays a long game without losing and clears lines.
+  void testPlay();
+};
+
+#endif // BOTTEST_HPP
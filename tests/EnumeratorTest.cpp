@@ -0,0 +1,200 @@
+#include "EnumeratorTest.hpp"
+#include "Enumerator.hpp"
+
+#include <set>
+#include <unistd.h>
+
+#include "Bot.hpp"
+#include "Piece.hpp"
+#include "Randomizer.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( EnumeratorTest );
+
+// A board of random rows, none of them full, up to height.
+static Bitboard randomBoard(Pcg32 &rng, unsigned height)
+{
+  Bitboard b;
+  b.clear();
+  const unsigned rows=rng.bounded(height+1);
+  for(unsigned y=0;y<rows;++y)
+    {
+      b.rows[y]=rng() & Bitboard::FULL;
+      if(Bitboard::FULL==b.rows[y])
+	{
+	  b.rows[y]^=1u<<rng.bounded(FIELD_WIDTH);
+	}
+    }
+  return b;
+}
+
+void EnumeratorTest::setUp()
+{
+}
+
+void EnumeratorTest::tearDown()
+{
+}
+
+void EnumeratorTest::testPack()
+{
+  Pcg32 rng(3,0);
+  for(int i=0;i<1000;++i)
+    {
+      const Bitboard b=randomBoard(rng,Enumerator::MAX_HEIGHT);
+      const std::uint64_t p=Enumerator::pack(b,Enumerator::MAX_HEIGHT);
+      CPPUNIT_ASSERT( p<(std::uint64_t)1<<63 );
+      CPPUNIT_ASSERT( b==Enumerator::unpack(p,Enumerator::MAX_HEIGHT) );
+      const std::uint64_t m=Enumerator::mirror(p,Enumerator::MAX_HEIGHT);
+      CPPUNIT_ASSERT( p==Enumerator::mirror(m,Enumerator::MAX_HEIGHT) );
+      CPPUNIT_ASSERT( Enumerator::canonical(p,Enumerator::MAX_HEIGHT)
+		      ==Enumerator::canonical(m,Enumerator::MAX_HEIGHT) );
+    }
+  // The left column is the right column of the mirror image.
+  Bitboard b;
+  b.clear();
+  b.rows[0]=1;
+  b.rows[1]=3;
+  const Bitboard m=Enumerator::unpack(Enumerator::mirror(Enumerator::pack(b,2),2),2);
+  CPPUNIT_ASSERT( m.get(FIELD_WIDTH-1,0) && !m.get(FIELD_WIDTH-2,0) );
+  CPPUNIT_ASSERT( m.get(FIELD_WIDTH-1,1) && m.get(FIELD_WIDTH-2,1) && !m.get(0,1) );
+}
+
+void EnumeratorTest::testSet()
+{
+  ShardedSet set;
+  std::vector<std::uint64_t> fresh;
+  CPPUNIT_ASSERT( set.insert(0) );
+  CPPUNIT_ASSERT( !set.insert(0) );
+  CPPUNIT_ASSERT( set.contains(0) && !set.contains(1) );
+
+  // Enough keys to grow every shard several times.
+  const std::size_t before=set.bytes();
+  std::vector<std::uint64_t> keys[ShardedSet::SHARDS];
+  for(std::uint64_t k=1;k<=100000;++k)
+    {
+      keys[ShardedSet::shard(k)].push_back(k);
+    }
+  std::size_t added=0;
+  for(unsigned s=0;s<ShardedSet::SHARDS;++s)
+    {
+      added+=set.insert(s,keys[s].data(),keys[s].size(),fresh);
+      added+=set.insert(s,keys[s].data(),keys[s].size(),fresh);
+    }
+  CPPUNIT_ASSERT( 100000==added && 100000==fresh.size() && 100001==set.size() );
+  CPPUNIT_ASSERT( set.bytes()>before );
+  for(std::uint64_t k=0;k<=100000;++k)
+    {
+      CPPUNIT_ASSERT( set.contains(k) );
+    }
+  CPPUNIT_ASSERT( !set.contains(100001) && !set.contains((std::uint64_t)1<<62) );
+
+  // Four threads insert overlapping ranges.
+  ShardedSet shared;
+  WorkerPool pool(4);
+  pool.run(4,[&](std::size_t i)
+	   {
+	     for(std::uint64_t k=i*10000;k<i*10000+30000;++k)
+	       {
+		 shared.insert(k);
+	       }
+	   });
+  CPPUNIT_ASSERT( 60000==shared.size() );
+}
+
+void EnumeratorTest::testPlace()
+{
+  Pcg32 rng(8,0);
+  MoveList moves;
+  Bitboard out[Enumerator::MAX_PLACEMENTS];
+  for(int i=0;i<300;++i)
+    {
+      const unsigned height=1+i%Enumerator::MAX_HEIGHT;
+      const Bitboard board=randomBoard(rng,height);
+      for(int t=0;t<7;++t)
+	{
+	  const PieceType type=(PieceType)t;
+	  std::set<std::uint64_t> expected,found;
+	  moves.generate(board,type,0,Piece::spawn(type));
+	  for(std::size_t j=0;j<moves.size();++j)
+	    {
+	      Bitboard b=board;
+	      b.place(type,moves[j].orientation,moves[j].x,moves[j].y);
+	      if(b.height()<=(int)height)
+		{
+		  expected.insert(Enumerator::pack(b,height));
+		}
+	    }
+	  const std::size_t n=Enumerator::place(board,type,height,out);
+	  for(std::size_t j=0;j<n;++j)
+	    {
+	      CPPUNIT_ASSERT( out[j].height()<=(int)height );
+	      found.insert(Enumerator::pack(out[j],height));
+	    }
+	  CPPUNIT_ASSERT( expected==found );
+	}
+    }
+}
+
+void EnumeratorTest::testSmall()
+{
+  WorkerPool pool(1);
+  Enumerator one(1,true,1<<20,"/tmp");
+  one.run(pool);
+  // Some boards of one row are only reached by clearing a second.
+  CPPUNIT_ASSERT( 23==one.getStates() && 41==one.getBoards() );
+  CPPUNIT_ASSERT( 1==one.getStatesByHeight()[0] && 22==one.getStatesByHeight()[1] );
+
+  Enumerator folded(2,true,1<<20,"/tmp"),unfolded(2,false,1<<20,"/tmp");
+  folded.run(pool);
+  unfolded.run(pool);
+  CPPUNIT_ASSERT( folded.getBoards()==unfolded.getStates() );
+  CPPUNIT_ASSERT( unfolded.getStates()==unfolded.getBoards() );
+  CPPUNIT_ASSERT( folded.getStates()<unfolded.getStates() );
+  CPPUNIT_ASSERT( folded.getLevels().size()==unfolded.getLevels().size() );
+  for(std::size_t d=0;d<folded.getLevels().size();++d)
+    {
+      CPPUNIT_ASSERT( folded.getLevels()[d].boards==unfolded.getLevels()[d].states );
+    }
+
+  // An I laid flat at the left, mirrored to the right, and a board that
+  // cannot be built: a single block.
+  Bitboard b;
+  b.clear();
+  b.rows[0]=0xf;
+  CPPUNIT_ASSERT( folded.contains(b) && unfolded.contains(b) );
+  b.rows[0]=0xf << (FIELD_WIDTH-4);
+  CPPUNIT_ASSERT( folded.contains(b) && unfolded.contains(b) );
+  b.rows[0]=1;
+  CPPUNIT_ASSERT( !folded.contains(b) && !unfolded.contains(b) );
+  b.clear();
+  b.rows[0]=b.rows[1]=b.rows[2]=0xf;
+  CPPUNIT_ASSERT( !folded.contains(b) );
+}
+
+void EnumeratorTest::testSpill()
+{
+  WorkerPool one(1),three(3);
+  Enumerator memory(2,true,1<<30,"/tmp"),disk(2,true,0,"/tmp");
+  memory.run(one);
+  disk.run(three);
+  CPPUNIT_ASSERT( 0==memory.getSpilledBytes() && disk.getSpilledBytes()>0 );
+  CPPUNIT_ASSERT( 0==disk.getPeakFrontierBytes() );
+  CPPUNIT_ASSERT( memory.getStates()==disk.getStates() && memory.getBoards()==disk.getBoards() );
+  CPPUNIT_ASSERT( memory.getLevels().size()==disk.getLevels().size() );
+  for(std::size_t d=0;d<memory.getLevels().size();++d)
+    {
+      CPPUNIT_ASSERT( memory.getLevels()[d].states==disk.getLevels()[d].states );
+      CPPUNIT_ASSERT( memory.getLevels()[d].successors==disk.getLevels()[d].successors );
+    }
+  // The spill files are gone.
+  const std::string prefix="/tmp/enum."+std::to_string(getpid())+".";
+  for(std::size_t d=0;d<=disk.getLevels().size();++d)
+    {
+      CPPUNIT_ASSERT( 0!=access((prefix+std::to_string(d)).c_str(),F_OK) );
+    }
+
+  // A spill directory that does not exist.
+  Enumerator nowhere(2,true,0,"/nonexistent");
+  CPPUNIT_ASSERT_THROW( nowhere.run(one), SpillError );
+}
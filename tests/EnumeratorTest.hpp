@@ -0,0 +1,32 @@
+#ifndef ENUMERATORTEST_HPP
+#define ENUMERATORTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class EnumeratorTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( EnumeratorTest );
+  CPPUNIT_TEST( testPack );
+  CPPUNIT_TEST( testSet );
+  CPPUNIT_TEST( testPlace );
+  CPPUNIT_TEST( testSmall );
+  CPPUNIT_TEST( testSpill );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  void testPack();
+  // Duplicates are dropped, shards grow, and threads inserting the same keys
+  // add each once.
+  void testSet();
+  // Placements made from the masks are the MoveList's.
+  void testPlace();
+  // Folding mirror images finds the same boards as not folding.
+  void testSmall();
+  // A frontier that spills to disk, and more threads, give the same levels.
+  void testSpill();
+};
+
+#endif // ENUMERATORTEST_HPP
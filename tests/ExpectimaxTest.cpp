@@ -0,0 +1,196 @@
+#include "ExpectimaxTest.hpp"
+#include "Expectimax.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <string>
+
+#include <unistd.h>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( ExpectimaxTest );
+
+// Keys that all land in bucket 5 of a small table.
+static std::uint64_t sameBucket(unsigned i)
+{
+  return ((std::uint64_t)(i+1)<<32) | 5;
+}
+
+void ExpectimaxTest::setUp()
+{
+}
+
+void ExpectimaxTest::tearDown()
+{
+}
+
+void ExpectimaxTest::testTable()
+{
+  TranspositionTable table(1<<16);
+  float v;
+
+  CPPUNIT_ASSERT( 4096==table.capacity() );
+  CPPUNIT_ASSERT( 0==table.used() );
+  CPPUNIT_ASSERT( !table.probe(12345,0,v) );
+  table.store(12345,2,-3.5f);
+  CPPUNIT_ASSERT( table.probe(12345,2,v) && -3.5f==v );
+  CPPUNIT_ASSERT( table.probe(12345,1,v) && -3.5f==v );
+  CPPUNIT_ASSERT( !table.probe(12345,3,v) );
+  CPPUNIT_ASSERT( !table.probe(12346,0,v) );
+  CPPUNIT_ASSERT( 1==table.used() );
+
+  // A key is stored once, and a deeper result is not overwritten by a
+  // shallower one.
+  table.store(12345,1,7.0f);
+  CPPUNIT_ASSERT( table.probe(12345,2,v) && -3.5f==v );
+  table.store(12345,3,8.0f);
+  CPPUNIT_ASSERT( table.probe(12345,3,v) && 8.0f==v );
+  CPPUNIT_ASSERT( 1==table.used() );
+
+  table.clear();
+  CPPUNIT_ASSERT( 0==table.used() );
+  CPPUNIT_ASSERT( !table.probe(12345,0,v) );
+}
+
+void ExpectimaxTest::testReplacement()
+{
+  TranspositionTable table(64*16);
+  float v;
+  unsigned i;
+
+  table.store(sameBucket(0),1,0.0f);
+  for(i=1;i<4;++i)
+    {
+      table.store(sameBucket(i),3,i);
+    }
+  // The shallowest goes first.
+  table.store(sameBucket(4),2,4.0f);
+  CPPUNIT_ASSERT( !table.probe(sameBucket(0),0,v) );
+  for(i=1;i<5;++i)
+    {
+      CPPUNIT_ASSERT( table.probe(sameBucket(i),0,v) && i==v );
+    }
+  table.store(sameBucket(5),1,5.0f);
+  CPPUNIT_ASSERT( !table.probe(sameBucket(4),0,v) );
+  CPPUNIT_ASSERT( table.probe(sameBucket(5),0,v) );
+
+  // After a new search the old entries go first, deep or not, but still hit
+  // until then.
+  table.newSearch();
+  CPPUNIT_ASSERT( table.probe(sameBucket(1),3,v) && 1.0f==v );
+  table.store(sameBucket(6),0,6.0f);
+  CPPUNIT_ASSERT( table.probe(sameBucket(6),0,v) );
+  CPPUNIT_ASSERT( 4==table.used() );
+  // An old result for the same key is replaced even by a shallower one.
+  table.store(sameBucket(2),1,-2.0f);
+  CPPUNIT_ASSERT( table.probe(sameBucket(2),1,v) && -2.0f==v );
+  CPPUNIT_ASSERT( 4==table.used() );
+}
+
+void ExpectimaxTest::testGenerations()
+{
+  TranspositionTable table(64*16);
+  float v;
+
+  table.store(sameBucket(0),3,1.0f);
+  table.store(sameBucket(1),3,2.0f);
+  for(int i=0;i<256;++i)
+    {
+      table.newSearch();
+      CPPUNIT_ASSERT( table.probe(sameBucket(0),3,v) && 1.0f==v );
+    }
+  // Deeper, but from an old search: a shallower result replaces it.
+  table.store(sameBucket(0),1,-1.0f);
+  CPPUNIT_ASSERT( table.probe(sameBucket(0),1,v) && -1.0f==v );
+  CPPUNIT_ASSERT( table.probe(sameBucket(1),3,v) && 2.0f==v );
+  // A result of the current search is kept as usual.
+  table.store(sameBucket(0),3,5.0f);
+  table.store(sameBucket(0),2,6.0f);
+  CPPUNIT_ASSERT( table.probe(sameBucket(0),3,v) && 5.0f==v );
+  CPPUNIT_ASSERT( 2==table.used() );
+}
+
+void ExpectimaxTest::testConcurrent()
+{
+  TranspositionTable table(64*64);
+  WorkerPool pool(4);
+  std::atomic<unsigned> wrong(0),hits(0);
+
+  // Many more keys than entries, so threads keep overwriting each other.
+  pool.run(200000,[&](std::size_t i)
+	   {
+	     const std::uint64_t key=(i%5000)*0x9e3779b97f4a7c15ull;
+	     float v;
+	     if(table.probe(key,0,v))
+	       {
+		 hits.fetch_add(1);
+		 if(v!=(float)(i%5000))
+		   {
+		     wrong.fetch_add(1);
+		   }
+	       }
+	     table.store(key,i%3,i%5000);
+	   });
+  CPPUNIT_ASSERT( 0==wrong );
+  CPPUNIT_ASSERT( hits>0 );
+}
+
+void ExpectimaxTest::testMapped()
+{
+  const std::string path="/tmp/ExpectimaxTest."+std::to_string(getpid())+".tt";
+  float v;
+  unsigned i;
+  {
+    TranspositionTable table(path,1<<16);
+    CPPUNIT_ASSERT( table.isMapped() );
+    CPPUNIT_ASSERT( 0==table.used() );
+    for(i=0;i<100;++i)
+      {
+	table.store(i*7919,2,i);
+      }
+  }
+  {
+    // The same size keeps the entries.
+    TranspositionTable table(path,1<<16);
+    CPPUNIT_ASSERT( 100==table.used() );
+    for(i=0;i<100;++i)
+      {
+	CPPUNIT_ASSERT( table.probe(i*7919,2,v) && i==v );
+      }
+  }
+  {
+    // Any other size starts over.
+    TranspositionTable table(path,1<<17);
+    CPPUNIT_ASSERT( 0==table.used() );
+  }
+  std::remove(path.c_str());
+  CPPUNIT_ASSERT_THROW( TranspositionTable("/nonexistent/dir/table",1<<16), ShmError );
+}
+
+void ExpectimaxTest::testSearch()
+{
+  WorkerPool pool(2);
+  TranspositionTable table(1<<24);
+  Expectimax plain(pool,nullptr,2,0), cached(pool,&table,2,0), warm(pool,&table,2,0);
+  HeadlessGame game(9);
+  PieceInput a[MoveList::MAX_PATH],b[MoveList::MAX_PATH],c[MoveList::MAX_PATH];
+  unsigned i;
+
+  for(i=0;i<15;++i)
+    {
+      const std::size_t n=plain.plan(game,a,MoveList::MAX_PATH);
+      CPPUNIT_ASSERT( n>0 );
+      CPPUNIT_ASSERT( n==cached.plan(game,b,MoveList::MAX_PATH) );
+      CPPUNIT_ASSERT( std::equal(a,a+n,b) );
+      // Everything this one looks at was just stored.
+      CPPUNIT_ASSERT( n==warm.plan(game,c,MoveList::MAX_PATH) );
+      CPPUNIT_ASSERT( std::equal(a,a+n,c) );
+      CPPUNIT_ASSERT( warm.getStats().hits==warm.getStats().probes );
+      game.step(a,n);
+    }
+  CPPUNIT_ASSERT( 0==plain.getTotals().probes );
+  CPPUNIT_ASSERT( cached.getTotals().probes>0 );
+  CPPUNIT_ASSERT( cached.getTotals().hitRate()<1.0 );
+  CPPUNIT_ASSERT( 1.0==warm.getTotals().hitRate() );
+}
@@ -0,0 +1,36 @@
+#ifndef EXPECTIMAXTEST_HPP
+#define EXPECTIMAXTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ExpectimaxTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ExpectimaxTest );
+  CPPUNIT_TEST( testTable );
+  CPPUNIT_TEST( testReplacement );
+  CPPUNIT_TEST( testGenerations );
+  CPPUNIT_TEST( testConcurrent );
+  CPPUNIT_TEST( testMapped );
+  CPPUNIT_TEST( testSearch );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Stored values come back at the depth they were searched to or less.
+  void testTable();
+  // Full buckets give up their shallowest and oldest entries first.
+  void testReplacement();
+  // Results from 256 searches ago are still old once the generation counter
+  // has wrapped, and still hit.
+  void testGenerations();
+  // Threads storing and probing at once never read a wrong value.
+  void testConcurrent();
+  // A table mapped from a file keeps its entries between runs.
+  void testMapped();
+  // The table changes how fast the search is, not what it plays.
+  void testSearch();
+};
+
+#endif // EXPECTIMAXTEST_HPP
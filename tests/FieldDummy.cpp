@@ -53,6 +53,16 @@ bool Field::get(int x, int y) const
   it=FieldDummy::get_results.find(arg);
   return (it==FieldDummy::get_results.end() ? false : it->second);
 }
+unsigned int Field::getRow(int y) const
+{
+  // STUB
+  return 0;
+}
+bool Field::insertGarbage(int lines, int hole)
+{
+  // STUB
+  return false;
+}
 // Find the current score
 int Field::readScore() const
 {
@@ -75,6 +85,8 @@ void Field::resetScore()
 {
   ++FieldDummy::resetScore_count;
 }
+// Only HeadlessGame::load calls it - nothing to spy for.
+void Field::setScore(int) {}
 // Set all blocks to false.
 void Field::resetBlocks()
 {
@@ -399,3 +399,60 @@ void FieldTest::testFieldScore()
   CPPUNIT_ASSERT( (1==test_field.readScore() ) );
 
 }
+
+void FieldTest::testGetRow()
+{
+  Field test_field;
+  int j;
+
+  for(j=0;j<FIELD_HEIGHT;++j)
+    {
+      CPPUNIT_ASSERT( 0==test_field.getRow(j) );
+    }
+  test_field.set(0,0);
+  test_field.set(9,0);
+  test_field.set(4,1);
+  CPPUNIT_ASSERT( 0x201==test_field.getRow(0) );
+  CPPUNIT_ASSERT( 0x010==test_field.getRow(1) );
+  CPPUNIT_ASSERT( 0==test_field.getRow(2) );
+
+  CPPUNIT_ASSERT_THROW( test_field.getRow(-1), FieldSizeError );
+  CPPUNIT_ASSERT_THROW( test_field.getRow(FIELD_HEIGHT), FieldSizeError );
+}
+
+void FieldTest::testInsertGarbage()
+{
+  Field test_field;
+  int j;
+
+  test_field.set(0,0);
+  test_field.set(4,1);
+  CPPUNIT_ASSERT( !test_field.insertGarbage(2,3) );
+  CPPUNIT_ASSERT( 0x3f7==test_field.getRow(0) );
+  CPPUNIT_ASSERT( 0x3f7==test_field.getRow(1) );
+  CPPUNIT_ASSERT( 0x001==test_field.getRow(2) );
+  CPPUNIT_ASSERT( 0x010==test_field.getRow(3) );
+  CPPUNIT_ASSERT( 0==test_field.getRow(4) );
+  // Garbage is never full, and scores nothing.
+  CPPUNIT_ASSERT( 0==test_field.readScore() );
+  // Filling the hole clears the line as usual.
+  test_field.set(3,0);
+  CPPUNIT_ASSERT( 1==test_field.readScore() );
+  CPPUNIT_ASSERT( 0x3f7==test_field.getRow(0) );
+  CPPUNIT_ASSERT( 0x001==test_field.getRow(1) );
+
+  CPPUNIT_ASSERT( !test_field.insertGarbage(0,0) );
+  CPPUNIT_ASSERT( 0x3f7==test_field.getRow(0) );
+  // Pushing the top block off the field.
+  CPPUNIT_ASSERT( !test_field.insertGarbage(FIELD_HEIGHT-3,9) );
+  for(j=0;j<FIELD_HEIGHT-3;++j)
+    {
+      CPPUNIT_ASSERT( 0x1ff==test_field.getRow(j) );
+    }
+  CPPUNIT_ASSERT( 0x010==test_field.getRow(FIELD_HEIGHT-1) );
+  CPPUNIT_ASSERT( test_field.insertGarbage(1,9) );
+  CPPUNIT_ASSERT( 0x001==test_field.getRow(FIELD_HEIGHT-1) );
+
+  CPPUNIT_ASSERT_THROW( test_field.insertGarbage(1,-1), FieldSizeError );
+  CPPUNIT_ASSERT_THROW( test_field.insertGarbage(1,FIELD_WIDTH), FieldSizeError );
+}
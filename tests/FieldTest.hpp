@@ -14,6 +14,8 @@ class FieldTest : public CppUnit::TestFixture
   CPPUNIT_TEST( testConstructor2 );
   CPPUNIT_TEST( testSet );
   CPPUNIT_TEST( testFieldScore );
+  CPPUNIT_TEST( testGetRow );
+  CPPUNIT_TEST( testInsertGarbage );
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -29,6 +31,10 @@ public:
 
   void testSet();
   void testFieldScore();
+  // unsigned int getRow(int y) const throw (FieldSizeError);
+  void testGetRow();
+  // bool insertGarbage(int lines, int hole) throw (FieldSizeError);
+  void testInsertGarbage();
 };
 
 #endif  // FIELDTEST_HPP
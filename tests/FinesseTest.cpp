@@ -0,0 +1,119 @@
+#include "FinesseTest.hpp"
+#include "Finesse.hpp"
+
+#include <algorithm>
+
+#include "Bot.hpp"
+#include "Piece.hpp"
+#include "Randomizer.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( FinesseTest );
+
+// Check that every placement MoveList finds from spawn has a Finesse path of
+// the same length that drops the piece in the same place.
+static void compare(const Bitboard &board)
+{
+  MoveList moves;
+  PieceInput a[MoveList::MAX_PATH],b[MoveList::MAX_PATH];
+  for(int t=0;t<7;++t)
+    {
+      const PieceType type=(PieceType)t;
+      const coord spawn=Piece::spawn(type);
+      moves.generate(board,type,0,spawn);
+      for(std::size_t i=0;i<moves.size();++i)
+	{
+	  const Placement &p=moves[i];
+	  const std::size_t n=moves.path(i,a,MoveList::MAX_PATH);
+	  CPPUNIT_ASSERT( n==Finesse::path(board,type,p.orientation,p.x,b,MoveList::MAX_PATH) );
+	  CPPUNIT_ASSERT( hard_drop==b[n-1] );
+	  unsigned o=0;
+	  int x=spawn.x;
+	  for(std::size_t k=0;k+1<n;++k)
+	    {
+	      x+=(shift_right==b[k])-(shift_left==b[k]);
+	      o=(o+(rotate_cw==b[k])+3*(rotate_ccw==b[k]))%4;
+	      CPPUNIT_ASSERT( board.fits(type,o,x,spawn.y) );
+	    }
+	  Bitboard ours=board,theirs=board;
+	  ours.place(type,o,x,board.drop(type,o,x,spawn.y));
+	  theirs.place(type,p.orientation,p.x,p.y);
+	  CPPUNIT_ASSERT( ours==theirs );
+	}
+    }
+}
+
+void FinesseTest::setUp()
+{
+}
+
+void FinesseTest::tearDown()
+{
+}
+
+void FinesseTest::testTable()
+{
+  Bitboard empty;
+  empty.clear();
+  PieceInput path[Finesse::MAX_INPUTS];
+
+  compare(empty);
+  for(int t=0;t<7;++t)
+    {
+      const coord spawn=Piece::spawn((PieceType)t);
+      CPPUNIT_ASSERT( 1==Finesse::length((PieceType)t,0,spawn.x) );
+      CPPUNIT_ASSERT( 1==Finesse::path((PieceType)t,0,spawn.x,path,Finesse::MAX_INPUTS) );
+      CPPUNIT_ASSERT( hard_drop==path[0] );
+    }
+  // Off the field, or too little room.
+  CPPUNIT_ASSERT( 0==Finesse::length(T,0,-1) );
+  CPPUNIT_ASSERT( 0==Finesse::length(T,4,4) );
+  CPPUNIT_ASSERT( 0==Finesse::path(T,0,0,path,1) );
+  CPPUNIT_ASSERT( 0==Finesse::path(empty,T,0,FIELD_WIDTH+5,path,Finesse::MAX_INPUTS) );
+}
+
+void FinesseTest::testEquivalent()
+{
+  // An O looks the same in every orientation, so it never needs to turn.
+  const coord spawn=Piece::spawn(O);
+  for(unsigned o=0;o<4;++o)
+    {
+      CPPUNIT_ASSERT( 1==Finesse::length(O,o,spawn.x) );
+    }
+  // Vertical S, Z and I each have two orientations that drop alike, one
+  // column apart; they share the shorter path.
+  PieceInput a[Finesse::MAX_INPUTS],b[Finesse::MAX_INPUTS];
+  for(PieceType t : {S,Z,I})
+    {
+      const PieceMask &m1=PieceMask::get(t,1), &m3=PieceMask::get(t,3);
+      for(int x=-2;x<FIELD_WIDTH+2;++x)
+	{
+	  const int y=x+m1.left-m3.left;
+	  const unsigned n=Finesse::length(t,1,x);
+	  if(n && Finesse::length(t,3,y))
+	    {
+	      CPPUNIT_ASSERT( n==Finesse::length(t,3,y) );
+	      CPPUNIT_ASSERT( n==Finesse::path(t,1,x,a,Finesse::MAX_INPUTS) );
+	      CPPUNIT_ASSERT( n==Finesse::path(t,3,y,b,Finesse::MAX_INPUTS) );
+	      CPPUNIT_ASSERT( std::equal(a,a+n,b) );
+	    }
+	}
+    }
+}
+
+void FinesseTest::testObstructed()
+{
+  Pcg32 rng(11);
+  for(int i=0;i<50;++i)
+    {
+      // Junk in the rows where pieces move, but never where they spawn.
+      Bitboard board;
+      board.clear();
+      for(int y=FIELD_HEIGHT-4;y<FIELD_HEIGHT;++y)
+	{
+	  board.rows[y]=rng.bounded(Bitboard::FULL+1) & rng.bounded(Bitboard::FULL+1)
+	    & ~(0xf << 3);
+	}
+      compare(board);
+    }
+}
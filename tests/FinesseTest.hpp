@@ -0,0 +1,27 @@
+#ifndef FINESSETEST_HPP
+#define FINESSETEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class FinesseTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( FinesseTest );
+  CPPUNIT_TEST( testTable );
+  CPPUNIT_TEST( testEquivalent );
+  CPPUNIT_TEST( testObstructed );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // On an empty field the table's paths reach their placements and are as
+  // short as MoveList's.
+  void testTable();
+  // Drops that land alike share the shorter path.
+  void testEquivalent();
+  // With the stack in the way, paths still match MoveList's.
+  void testObstructed();
+};
+
+#endif // FINESSETEST_HPP
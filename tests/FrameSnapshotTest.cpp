@@ -0,0 +1,108 @@
+#include "FrameSnapshotTest.hpp"
+#include "FrameSnapshot.hpp"
+
+#include <set>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( FrameSnapshotTest );
+
+inline bool testSameCoords(arrayt a,arrayt b)
+{
+  std::set<coord> ma(a.begin(),a.end()), mb(b.begin(),b.end());
+  return ma==mb;
+}
+
+void FrameSnapshotTest::setUp()
+{
+}
+
+void FrameSnapshotTest::tearDown()
+{
+}
+
+void FrameSnapshotTest::testField()
+{
+  Field field;
+  Piece current(O,0,&field);
+  int i,j;
+
+  // A staircase, so that every row and every row word is different.
+  for(j=0;j<FIELD_HEIGHT;++j)
+    {
+      for(i=0;i<FIELD_WIDTH;++i)
+	{
+	  if((i+j)%FIELD_WIDTH < j%FIELD_WIDTH)
+	    {
+	      field.set(i,j);
+	    }
+	}
+    }
+  FrameSnapshot snap=FrameSnapshot::encode(field,current,nullptr,I,0);
+  for(j=0;j<FIELD_HEIGHT;++j)
+    {
+      CPPUNIT_ASSERT( field.getRow(j)==snap.row(j) );
+      for(i=0;i<FIELD_WIDTH;++i)
+	{
+	  CPPUNIT_ASSERT( field.get(i,j)==snap.get(i,j) );
+	}
+    }
+  // setRow must not disturb the neighbouring rows in the same word.
+  snap.setRow(4,0x3ff);
+  CPPUNIT_ASSERT( 0x3ff==snap.row(4) );
+  CPPUNIT_ASSERT( field.getRow(3)==snap.row(3) );
+  CPPUNIT_ASSERT( field.getRow(5)==snap.row(5) );
+}
+
+void FrameSnapshotTest::testPiece()
+{
+  const PieceType types[7]={I,J,L,O,S,T,Z};
+  const PieceInput turns[2]={rotate_cw,rotate_ccw};
+
+  for(auto t : types)
+    {
+      for(auto turn : turns)
+	{
+	  Field field;
+	  Piece current(t,100,&field);
+	  // Move down so that every orientation fits.
+	  current.timeStep(4);
+	  for(int r=0;r<4;++r)
+	    {
+	      FrameSnapshot snap=FrameSnapshot::encode(field,current,nullptr,I,0);
+	      CPPUNIT_ASSERT( snap.active() );
+	      CPPUNIT_ASSERT( t==snap.pieceType() );
+	      CPPUNIT_ASSERT( current.getCenter()==snap.center() );
+	      CPPUNIT_ASSERT( testSameCoords(current.getBlocks(),snap.blocks()) );
+	      current.handleInput(turn);
+	      if(O!=t)
+		{
+		  CPPUNIT_ASSERT( (rotate_cw==turn ? r+1 : 3-r)%4==(int)current.getOrientation() );
+		}
+	    }
+	  CPPUNIT_ASSERT( 0==current.getOrientation() );
+	}
+    }
+}
+
+void FrameSnapshotTest::testFlags()
+{
+  Field field;
+  Piece current(S,0,&field),hold(Z,0,&field);
+
+  for(int i=0;i<FIELD_WIDTH-1;++i)
+    {
+      field.set(i,0);
+    }
+  field.set(FIELD_WIDTH-1,0);
+
+  FrameSnapshot snap=FrameSnapshot::encode(field,current,nullptr,T,1234);
+  CPPUNIT_ASSERT( 1==snap.score );
+  CPPUNIT_ASSERT( 1234==snap.frame );
+  CPPUNIT_ASSERT( T==snap.next );
+  CPPUNIT_ASSERT( !(snap.flags & FrameSnapshot::HOLDING) );
+
+  snap=FrameSnapshot::encode(field,current,&hold,J,0);
+  CPPUNIT_ASSERT( snap.flags & FrameSnapshot::HOLDING );
+  CPPUNIT_ASSERT( Z==snap.hold );
+  CPPUNIT_ASSERT( J==snap.next );
+}
@@ -0,0 +1,26 @@
+#ifndef FRAMESNAPSHOTTEST_HPP
+#define FRAMESNAPSHOTTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class FrameSnapshotTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( FrameSnapshotTest );
+  CPPUNIT_TEST( testField );
+  CPPUNIT_TEST( testPiece );
+  CPPUNIT_TEST( testFlags );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Row bitmasks decode to the same blocks as the encoded Field.
+  void testField();
+  // Decoded piece blocks match Piece::getBlocks for every type and rotation.
+  void testPiece();
+  // Hold, next, frame and score are carried through.
+  void testFlags();
+};
+
+#endif // FRAMESNAPSHOTTEST_HPP
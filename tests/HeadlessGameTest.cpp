@@ -0,0 +1,428 @@
+#include "HeadlessGameTest.hpp"
+#include "HeadlessGame.hpp"
+
+#include <cstring>
+#include <set>
+#include <stdexcept>
+#include <vector>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( HeadlessGameTest );
+
+inline bool sameSnapshot(const FrameSnapshot &a, const FrameSnapshot &b)
+{
+  return 0==std::memcmp(&a,&b,sizeof(FrameSnapshot));
+}
+
+void HeadlessGameTest::setUp()
+{
+}
+
+void HeadlessGameTest::tearDown()
+{
+}
+
+void HeadlessGameTest::testDeterminism()
+{
+  const PieceInput pattern[]={shift_left,rotate_cw,shift_right,shift_right,
+			      rotate_ccw,hard_drop};
+  const std::size_t patternSize=sizeof(pattern)/sizeof(pattern[0]);
+  HeadlessGame a(42), b(42);
+  unsigned i;
+
+  CPPUNIT_ASSERT( sameSnapshot(a.snapshot(),b.snapshot()) );
+  for(i=0;i<2000 && !a.isGameOver();++i)
+    {
+      // Vary the number of inputs per frame, including none.
+      const std::size_t count=i%3;
+      const PieceInput *inputs=pattern+(i%(patternSize-count+1));
+      CPPUNIT_ASSERT( a.step(inputs,count)==b.step(inputs,count) );
+      CPPUNIT_ASSERT( sameSnapshot(a.snapshot(),b.snapshot()) );
+    }
+  CPPUNIT_ASSERT( a.getPieceCount()==b.getPieceCount() );
+  CPPUNIT_ASSERT( a.getPieceCount()>1 );
+}
+
+void HeadlessGameTest::testFrames()
+{
+  HeadlessGame game(1);
+  const coord start=game.getCurrent().getCenter();
+  unsigned i;
+
+  CPPUNIT_ASSERT( 0==game.getFrame() );
+  CPPUNIT_ASSERT( 1==game.getPieceCount() );
+  for(i=1;i<=60;++i)
+    {
+      CPPUNIT_ASSERT( !game.step() );
+      CPPUNIT_ASSERT( i==game.getFrame() );
+      CPPUNIT_ASSERT( i==game.snapshot().frame );
+    }
+  // A second of gravity must have moved the first piece down.
+  CPPUNIT_ASSERT( 1==game.getPieceCount() );
+  CPPUNIT_ASSERT( game.getCurrent().getCenter().y < start.y );
+}
+
+void HeadlessGameTest::testGameOver()
+{
+  const PieceInput drop=hard_drop;
+  HeadlessGame game(7);
+  unsigned i,frame;
+
+  for(i=0;i<FIELD_HEIGHT*4 && !game.isGameOver();++i)
+    {
+      game.step(&drop,1);
+    }
+  CPPUNIT_ASSERT( game.isGameOver() );
+  CPPUNIT_ASSERT( game.snapshot().flags & FrameSnapshot::GAME_OVER );
+
+  frame=game.getFrame();
+  const FrameSnapshot last=game.snapshot();
+  CPPUNIT_ASSERT( game.step(&drop,1) );
+  CPPUNIT_ASSERT( game.step() );
+  CPPUNIT_ASSERT( frame==game.getFrame() );
+  CPPUNIT_ASSERT( sameSnapshot(last,game.snapshot()) );
+}
+
+void HeadlessGameTest::testReset()
+{
+  const PieceInput drop=hard_drop;
+  HeadlessGame game(3), fresh(99);
+  unsigned i;
+
+  for(i=0;i<10;++i)
+    {
+      game.step(&drop,1);
+    }
+  game.reset(99);
+  CPPUNIT_ASSERT( !game.isGameOver() );
+  CPPUNIT_ASSERT( 0==game.getFrame() );
+  CPPUNIT_ASSERT( 1==game.getPieceCount() );
+  CPPUNIT_ASSERT( 0==game.getField().readScore() );
+  CPPUNIT_ASSERT( sameSnapshot(fresh.snapshot(),game.snapshot()) );
+  for(i=0;i<10;++i)
+    {
+      game.step(&drop,1);
+      fresh.step(&drop,1);
+      CPPUNIT_ASSERT( sameSnapshot(fresh.snapshot(),game.snapshot()) );
+    }
+}
+
+void HeadlessGameTest::testGarbage()
+{
+  const PieceInput drop=hard_drop;
+  HeadlessGame game(4);
+
+  game.addGarbage(3,0);
+  game.addGarbage(2,9);
+  CPPUNIT_ASSERT( 5==game.getPendingGarbage() );
+  CPPUNIT_ASSERT( 0==game.cancelGarbage(4) );
+  CPPUNIT_ASSERT( 1==game.getPendingGarbage() );
+  CPPUNIT_ASSERT( 2==game.cancelGarbage(3) );
+  CPPUNIT_ASSERT( 0==game.getPendingGarbage() );
+
+  game.addGarbage(2,9);
+  // Nothing happens until the piece locks.
+  game.step();
+  CPPUNIT_ASSERT( 0==game.getField().getRow(0) );
+  game.step(&drop,1);
+  CPPUNIT_ASSERT( 0==game.getPendingGarbage() );
+  CPPUNIT_ASSERT( 0x1ff==game.getField().getRow(0) );
+  CPPUNIT_ASSERT( 0x1ff==game.getField().getRow(1) );
+  CPPUNIT_ASSERT( 0!=game.getField().getRow(2) );
+
+  // Enough garbage to push the stack off the top ends the game.
+  game.addGarbage(FIELD_HEIGHT,0);
+  CPPUNIT_ASSERT( game.step(&drop,1) );
+}
+
+void HeadlessGameTest::testPreview()
+{
+  const PieceInput drop=hard_drop;
+  HeadlessGame game(21);
+  std::vector<PieceType> shown,played;
+  unsigned i;
+
+  for(i=0;i<game.getQueue().size();++i)
+    {
+      shown.push_back(game.getQueue().peek(i));
+    }
+  CPPUNIT_ASSERT( game.getNext()==shown[0] );
+  played.push_back(game.getCurrent().getType());
+  while(played.size()<=shown.size())
+    {
+      game.step(&drop,1);
+      played.push_back(game.getCurrent().getType());
+    }
+  CPPUNIT_ASSERT( std::equal(shown.begin(),shown.end(),played.begin()+1) );
+
+  HeadlessGame bag(22,BAG7);
+  std::set<PieceType> types;
+  for(i=0;i<7;++i)
+    {
+      types.insert(bag.getCurrent().getType());
+      bag.step(&drop,1);
+    }
+  CPPUNIT_ASSERT( 7==types.size() );
+}
+
+void HeadlessGameTest::testSave()
+{
+  const PieceInput pattern[]={shift_left,rotate_cw,shift_right,shift_right,
+			      rotate_ccw,hard_drop};
+  const std::size_t patternSize=sizeof(pattern)/sizeof(pattern[0]);
+  const RandomizerKind kinds[]={BAG7,MEMORYLESS,HISTORY};
+  for(RandomizerKind kind : kinds)
+    {
+      HeadlessGame a(7,kind), b(8,kind);
+      HeadlessGame::State state;
+      unsigned i;
+      for(i=0;i<301;++i)
+	{
+	  a.step(pattern+i%4,i%3);
+	}
+      a.addGarbage(2,3);
+      a.addGarbage(1,5);
+      a.save(state);
+      b.load(state);
+      CPPUNIT_ASSERT( sameSnapshot(a.snapshot(),b.snapshot()) );
+      CPPUNIT_ASSERT( 3==b.getPendingGarbage() && a.getPieceCount()==b.getPieceCount() );
+      for(;i<5000 && !a.isGameOver();++i)
+	{
+	  const std::size_t count=i%3;
+	  const PieceInput *inputs=pattern+(i%(patternSize-count+1));
+	  CPPUNIT_ASSERT( a.step(inputs,count)==b.step(inputs,count) );
+	  CPPUNIT_ASSERT( sameSnapshot(a.snapshot(),b.snapshot()) );
+	  for(unsigned k=0;k<a.getQueue().size();++k)
+	    {
+	      CPPUNIT_ASSERT( a.getQueue().peek(k)==b.getQueue().peek(k) );
+	    }
+	}
+      CPPUNIT_ASSERT( a.isGameOver() && a.getField().readScore()==b.getField().readScore() );
+    }
+
+  HeadlessGame game(1);
+  HeadlessGame::State state;
+  for(unsigned i=0;i<=HeadlessGame::State::GARBAGE;++i)
+    {
+      game.addGarbage(1,i);
+    }
+  CPPUNIT_ASSERT_THROW( game.save(state), std::length_error );
+}
+
+void HeadlessGameTest::testEarlyInput()
+{
+  const PieceInput pattern[]={shift_left,rotate_cw,shift_right,hard_drop,
+			      rotate_ccw,hard_drop};
+  const std::size_t patternSize=sizeof(pattern)/sizeof(pattern[0]);
+  HeadlessGame a(7), b(7);
+  unsigned i;
+
+  for(i=0;i<5000 && !a.isGameOver();++i)
+    {
+      const std::size_t count=i%4,split=i%(count+1);
+      const PieceInput *inputs=pattern+(i%(patternSize-count+1));
+      // Some of the frame's inputs in one or two goes, the rest with it.
+      b.input(inputs,split/2);
+      b.input(inputs+split/2,split-split/2);
+      CPPUNIT_ASSERT( a.step(inputs,count)==b.step(inputs+split,count-split) );
+      CPPUNIT_ASSERT( sameSnapshot(a.snapshot(),b.snapshot()) );
+    }
+  CPPUNIT_ASSERT( a.isGameOver() );
+  CPPUNIT_ASSERT( a.getFrame()==b.getFrame() );
+
+  // A game lost to early inputs counts their frame, then stays lost.
+  HeadlessGame c(7), d(7);
+  while(!d.step(pattern+3,1))
+    {
+      CPPUNIT_ASSERT( !c.input(pattern+3,1) );
+      CPPUNIT_ASSERT( !c.step() );
+    }
+  CPPUNIT_ASSERT( c.input(pattern+3,1) );
+  CPPUNIT_ASSERT( c.getFrame()+1==d.getFrame() );
+  CPPUNIT_ASSERT( c.step() );
+  CPPUNIT_ASSERT( c.getFrame()==d.getFrame() );
+  CPPUNIT_ASSERT( c.input(pattern+3,1) );
+  CPPUNIT_ASSERT( c.step() );
+  CPPUNIT_ASSERT( c.getFrame()==d.getFrame() );
+}
+
+void HeadlessGameTest::testTickRate()
+{
+  CPPUNIT_ASSERT_THROW( HeadlessGame(1,BAG7,0), std::invalid_argument );
+  CPPUNIT_ASSERT_THROW( HeadlessGame(1,BAG7,HeadlessGame::MAX_TICK_RATE+1), std::invalid_argument );
+
+  // Without input, pieces stack up until the game is lost.
+  for(unsigned rate : {120u,240u})
+    {
+      HeadlessGame slow(5), fast(5,BAG7,rate);
+      CPPUNIT_ASSERT( rate==fast.getTickRate() );
+      while(!slow.isGameOver())
+	{
+	  slow.step();
+	  for(unsigned i=0;i<rate/60;++i)
+	    {
+	      fast.step();
+	    }
+	  CPPUNIT_ASSERT( slow.isGameOver()==fast.isGameOver() );
+	  CPPUNIT_ASSERT( slow.getPieceCount()==fast.getPieceCount() );
+	  CPPUNIT_ASSERT( slow.getCurrent().getCenter()==fast.getCurrent().getCenter() );
+	  for(int y=0;y<FIELD_HEIGHT;++y)
+	    {
+	      CPPUNIT_ASSERT( slow.getField().getRow(y)==fast.getField().getRow(y) );
+	    }
+	}
+      CPPUNIT_ASSERT( rate/60*slow.getFrame()==fast.getFrame() );
+    }
+
+  // A row is due every 31/60 s, which 1000 Hz does not divide: it falls on
+  // the first tick at or after that, and the remainder carries.
+  HeadlessGame game(5,BAG7,1000);
+  const int start=game.getCurrent().getCenter().y;
+  for(int row=1;row<=6;++row)
+    {
+      const unsigned due=(row*31*1000+59)/60;
+      while(game.getFrame()<due-1)
+	{
+	  game.step();
+	}
+      CPPUNIT_ASSERT( start-row+1==game.getCurrent().getCenter().y );
+      game.step();
+      CPPUNIT_ASSERT( start-row==game.getCurrent().getCenter().y );
+    }
+
+  // Changing the rate keeps the time since the last row.
+  HeadlessGame change(5);
+  for(int i=0;i<20;++i)
+    {
+      change.step();
+    }
+  change.setTickRate(120);
+  for(int i=0;i<21;++i)
+    {
+      change.step();
+    }
+  CPPUNIT_ASSERT( start==change.getCurrent().getCenter().y );
+  change.step();
+  CPPUNIT_ASSERT( start-1==change.getCurrent().getCenter().y );
+}
+
+void HeadlessGameTest::testAutoRepeat()
+{
+  const PieceInput press=press_right, release=release_right, shift=shift_right;
+  const HeadlessGame::RepeatTime none(0), tooLong=HeadlessGame::MAX_REPEAT+HeadlessGame::RepeatTime(1);
+  CPPUNIT_ASSERT_THROW( HeadlessGame().setAutoRepeat(tooLong,none), std::invalid_argument );
+
+  // How far the piece can shift right.
+  HeadlessGame wall(5);
+  const int start=wall.getCurrent().getCenter().x;
+  for(int i=0;i<FIELD_WIDTH;++i)
+    {
+      wall.step(&shift,1);
+    }
+  const int cells=wall.getCurrent().getCenter().x-start;
+  CPPUNIT_ASSERT( cells>2 );
+
+  const std::chrono::milliseconds DAS(200),ARR(70);
+  for(unsigned rate : {60u,120u,1000u,7u})
+    {
+      HeadlessGame game(5,BAG7,rate);
+      game.setAutoRepeat(DAS,ARR);
+      game.step(&press,1);
+      for(unsigned k=1;k<rate;++k)
+	{
+	  // Repeat n is due DAS+n*ARR ms after the press, and k ticks are
+	  // k*1000/rate ms.
+	  int shifts=1;
+	  for(unsigned n=0;(DAS.count()+n*ARR.count())*rate<=k*1000;++n)
+	    {
+	      ++shifts;
+	    }
+	  CPPUNIT_ASSERT( start+std::min(shifts,cells)==game.getCurrent().getCenter().x );
+	  game.step();
+	}
+    }
+
+  // The defaults are whole frames at 60 Hz: the first repeat is on the
+  // tenth tick from the press, and the rest every second tick for good.
+  HeadlessGame sixty(5);
+  sixty.step(&press,1);
+  for(unsigned k=1;k<14;++k)
+    {
+      const int shifts=1+(k>=10)+(k>=12);
+      CPPUNIT_ASSERT( start+std::min(shifts,cells)==sixty.getCurrent().getCenter().x );
+      sixty.step();
+    }
+  HeadlessGame::State before,after;
+  sixty.save(before);
+  for(unsigned k=0;k<200;++k)
+    {
+      sixty.step();
+    }
+  sixty.save(after);
+  CPPUNIT_ASSERT( std::equal(before.repeatTime,before.repeatTime+3,after.repeatTime) );
+
+  // Released, the key stops repeating; pressed again without a release, it
+  // is still held.
+  HeadlessGame held(5);
+  held.setAutoRepeat(DAS,ARR);
+  held.step(&press,1);
+  held.step(&press,1);
+  held.step(&release,1);
+  for(int i=0;i<60;++i)
+    {
+      held.step();
+    }
+  CPPUNIT_ASSERT( start+1==held.getCurrent().getCenter().x );
+
+  // The last key pressed repeats, and the other takes over when it is let go.
+  const PieceInput both[]={press_right,press_left}, letGo=release_left;
+  HeadlessGame two(5);
+  two.setAutoRepeat(DAS,ARR);
+  two.step(both,2);
+  CPPUNIT_ASSERT( start==two.getCurrent().getCenter().x );
+  for(int i=0;i<15;++i)
+    {
+      two.step();
+    }
+  const int x=two.getCurrent().getCenter().x;
+  CPPUNIT_ASSERT( x<start );
+  two.step(&letGo,1);
+  CPPUNIT_ASSERT( x==two.getCurrent().getCenter().x );
+  for(int i=0;i<30;++i)
+    {
+      two.step();
+    }
+  CPPUNIT_ASSERT( x<two.getCurrent().getCenter().x );
+
+  // With an ARR of 0 the piece goes as far as tapping would take it, over a
+  // stack, and the held keys carry on from a saved state.
+  const PieceInput pattern[]={shift_left,rotate_cw,shift_right,shift_left,
+			      rotate_ccw,hard_drop};
+  HeadlessGame tapped(9), instant(9), loaded(10);
+  instant.setAutoRepeat(none,none);
+  loaded.setAutoRepeat(none,none);
+  for(unsigned i=0;i<60;++i)
+    {
+      tapped.step(pattern+i%6,1);
+      instant.step(pattern+i%6,1);
+    }
+  CPPUNIT_ASSERT( !tapped.isGameOver() );
+  const PieceInput taps[]={shift_left,shift_left,shift_left,shift_left,shift_left,
+			   shift_left,shift_left,shift_left,shift_left,shift_left};
+  const PieceInput hold=press_left;
+  tapped.step(taps,10);
+  instant.step(&hold,1);
+  CPPUNIT_ASSERT( sameSnapshot(tapped.snapshot(),instant.snapshot()) );
+  HeadlessGame::State state;
+  instant.save(state);
+  loaded.load(state);
+  for(unsigned i=0;i<300 && !instant.isGameOver();++i)
+    {
+      // Still held, every new piece goes to the wall.
+      const PieceInput drop=hard_drop;
+      instant.step(&drop,i%40==0);
+      loaded.step(&drop,i%40==0);
+      CPPUNIT_ASSERT( sameSnapshot(instant.snapshot(),loaded.snapshot()) );
+    }
+  CPPUNIT_ASSERT( instant.getPieceCount()>tapped.getPieceCount() );
+}
@@ -0,0 +1,55 @@
+#ifndef HEADLESSGAMETEST_HPP
+#define HEADLESSGAMETEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class HeadlessGameTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( HeadlessGameTest );
+  CPPUNIT_TEST( testDeterminism );
+  CPPUNIT_TEST( testFrames );
+  CPPUNIT_TEST( testGameOver );
+  CPPUNIT_TEST( testReset );
+  CPPUNIT_TEST( testGarbage );
+  CPPUNIT_TEST( testPreview );
+  CPPUNIT_TEST( testSave );
+  CPPUNIT_TEST( testEarlyInput );
+  CPPUNIT_TEST( testTickRate );
+  CPPUNIT_TEST( testAutoRepeat );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Two games with the same seed and inputs produce identical snapshots.
+  void testDeterminism();
+  // Each step advances exactly one frame, and gravity moves the piece.
+  void testFrames();
+  // Dropping pieces without moving them ends the game; a finished game stays
+  // finished.
+  void testGameOver();
+  // reset gives the same game as a freshly constructed one.
+  void testReset();
+  // Queued garbage can be cancelled, and the rest rises when a piece locks.
+  void testGarbage();
+  // Pieces enter play in the order the preview showed, and the default
+  // randomizer deals every type in each bag of seven.
+  void testPreview();
+  // A game loaded from a saved state carries on exactly as the original,
+  // with every randomizer and with garbage queued.
+  void testSave();
+  // Inputs applied early play exactly as the same inputs stepped with their
+  // frame, through to the frame that loses the game.
+  void testEarlyInput();
+  // Pieces fall and lock at the same times at any tick rate: at multiples of
+  // 60 Hz, frame for frame with a game at 60 Hz.
+  void testTickRate();
+  // A held shift key repeats on the first tick at or after each repeat is
+  // due, at any tick rate, and the defaults exactly on frames at 60 Hz; an
+  // ARR of 0 moves as far as shifting one cell at a time would; and the held
+  // keys are saved with the game.
+  void testAutoRepeat();
+};
+
+#endif // HEADLESSGAMETEST_HPP
@@ -0,0 +1,98 @@
+#include "NetProtocolTest.hpp"
+#include "NetProtocol.hpp"
+#include "HeadlessGame.hpp"
+
+#include <cstring>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( NetProtocolTest );
+
+void NetProtocolTest::setUp()
+{
+}
+
+void NetProtocolTest::tearDown()
+{
+}
+
+void NetProtocolTest::testHeader()
+{
+  NetProtocol::Buffer buf;
+  NetProtocol::MessageHeader in,out;
+  in.length=0x1234;
+  in.type=NetProtocol::GAME_OVER;
+  in.frame=0xdeadbeef;
+  in.stamp=0x0123456789abcdefull;
+  NetProtocol::putHeader(buf,in);
+
+  CPPUNIT_ASSERT( NetProtocol::HEADER_SIZE==buf.size() );
+  // Little-endian on the wire.
+  CPPUNIT_ASSERT( 0x34==(unsigned char)buf[0] );
+  CPPUNIT_ASSERT( 0x12==(unsigned char)buf[1] );
+  CPPUNIT_ASSERT( !NetProtocol::getHeader(buf.data(),buf.size()-1,out) );
+  CPPUNIT_ASSERT( NetProtocol::getHeader(buf.data(),buf.size(),out) );
+  CPPUNIT_ASSERT( in.length==out.length );
+  CPPUNIT_ASSERT( in.type==out.type );
+  CPPUNIT_ASSERT( in.frame==out.frame );
+  CPPUNIT_ASSERT( in.stamp==out.stamp );
+
+  CPPUNIT_ASSERT( NetProtocol::isInput(hard_drop) );
+  CPPUNIT_ASSERT( !NetProtocol::isInput(hard_drop+1) );
+}
+
+void NetProtocolTest::testFrames()
+{
+  const PieceInput pattern[]={shift_left,hard_drop,rotate_cw,shift_right,hard_drop};
+  HeadlessGame game(5);
+  FrameSnapshot prev,state;
+  NetProtocol::Buffer buf;
+  NetProtocol::MessageHeader h;
+  unsigned i;
+
+  std::memset(&state,0,sizeof(state));
+  prev=game.snapshot();
+  NetProtocol::putFrame(buf,prev,prev,1,true);
+  CPPUNIT_ASSERT( NetProtocol::getHeader(buf.data(),buf.size(),h) );
+  CPPUNIT_ASSERT( NetProtocol::FRAME==h.type );
+  CPPUNIT_ASSERT( NetProtocol::MAX_BODY==h.length );
+  CPPUNIT_ASSERT( buf.size()==NetProtocol::HEADER_SIZE+h.length );
+  CPPUNIT_ASSERT( NetProtocol::applyFrame(buf.data()+NetProtocol::HEADER_SIZE,h.length,h,state) );
+  CPPUNIT_ASSERT( 0==std::memcmp(&prev,&state,sizeof(state)) );
+
+  for(i=0;i<300 && !game.isGameOver();++i)
+    {
+      game.step(pattern+i%5,i%2);
+      const FrameSnapshot cur=game.snapshot();
+      unsigned changed=0;
+      for(unsigned w=0;w<FrameSnapshot::ROW_WORDS;++w)
+	{
+	  changed+=(prev.rows[w]!=cur.rows[w]);
+	}
+      buf.clear();
+      NetProtocol::putFrame(buf,prev,cur,i,false);
+      CPPUNIT_ASSERT( NetProtocol::getHeader(buf.data(),buf.size(),h) );
+      CPPUNIT_ASSERT( 1+4*changed+12==h.length );
+      CPPUNIT_ASSERT( NetProtocol::applyFrame(buf.data()+NetProtocol::HEADER_SIZE,h.length,h,state) );
+      CPPUNIT_ASSERT( 0==std::memcmp(&cur,&state,sizeof(state)) );
+      prev=cur;
+    }
+}
+
+void NetProtocolTest::testMalformed()
+{
+  HeadlessGame game(5);
+  const FrameSnapshot snap=game.snapshot();
+  FrameSnapshot state;
+  NetProtocol::Buffer buf;
+  NetProtocol::MessageHeader h;
+
+  std::memset(&state,0,sizeof(state));
+  NetProtocol::putFrame(buf,snap,snap,0,true);
+  NetProtocol::getHeader(buf.data(),buf.size(),h);
+  const char *body=buf.data()+NetProtocol::HEADER_SIZE;
+  CPPUNIT_ASSERT( !NetProtocol::applyFrame(body,0,h,state) );
+  CPPUNIT_ASSERT( !NetProtocol::applyFrame(body,h.length-1,h,state) );
+  CPPUNIT_ASSERT( !NetProtocol::applyFrame(body,10,h,state) );
+  buf.push_back(0);
+  CPPUNIT_ASSERT( !NetProtocol::applyFrame(body,h.length+1,h,state) );
+}
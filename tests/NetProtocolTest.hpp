@@ -0,0 +1,27 @@
+#ifndef NETPROTOCOLTEST_HPP
+#define NETPROTOCOLTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class NetProtocolTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( NetProtocolTest );
+  CPPUNIT_TEST( testHeader );
+  CPPUNIT_TEST( testFrames );
+  CPPUNIT_TEST( testMalformed );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Headers survive a round trip and need all 16 bytes.
+  void testHeader();
+  // A keyframe followed by deltas reproduces every snapshot of a game, and
+  // deltas only carry the row words which changed.
+  void testFrames();
+  // Truncated or oversized bodies are rejected.
+  void testMalformed();
+};
+
+#endif // NETPROTOCOLTEST_HPP
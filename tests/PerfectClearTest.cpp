@@ -0,0 +1,156 @@
+#include "PerfectClearTest.hpp"
+#include "PerfectClear.hpp"
+
+#include "Field.hpp"
+#include "Piece.hpp"
+#include "Randomizer.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( PerfectClearTest );
+
+static Bitboard emptyBoard()
+{
+  Bitboard ret;
+  ret.clear();
+  return ret;
+}
+
+// Play a solution found without hold, checking every step can be reached
+// from where its piece spawns. Returns true if the field ends up empty.
+static bool replay(Bitboard board, const std::vector<PerfectClear::Step> &steps)
+{
+  PieceInput path[MoveList::MAX_PATH];
+  for(const PerfectClear::Step &s : steps)
+    {
+      if(0==PerfectClear::path(board,s,path,MoveList::MAX_PATH))
+	{
+	  return false;
+	}
+      board.place(s.type,s.orientation,s.x,s.y);
+    }
+  return 0==board.height();
+}
+
+void PerfectClearTest::setUp()
+{
+}
+
+void PerfectClearTest::tearDown()
+{
+}
+
+void PerfectClearTest::testSolve()
+{
+  PerfectClear solver;
+  const PieceType pieces[6]={O,O,O,I,I,T};
+
+  CPPUNIT_ASSERT( PerfectClear::FOUND==solver.solve(emptyBoard(),pieces,6) );
+  CPPUNIT_ASSERT( 2==solver.getHeight() );
+  CPPUNIT_ASSERT( 5==solver.getSolution().size() );
+  CPPUNIT_ASSERT( replay(emptyBoard(),solver.getSolution()) );
+  for(const PerfectClear::Step &s : solver.getSolution())
+    {
+      CPPUNIT_ASSERT( !s.hold );
+    }
+
+  // Finish a clear already started, on a Field.
+  Field field;
+  for(int x=0;x<FIELD_WIDTH-4;++x)
+    {
+      field.set(x,0);
+    }
+  CPPUNIT_ASSERT( PerfectClear::FOUND==solver.solve(field,pieces+3,1) );
+  CPPUNIT_ASSERT( 1==solver.getHeight() && 1==solver.getSolution().size() );
+  CPPUNIT_ASSERT( I==solver.getSolution()[0].type );
+  CPPUNIT_ASSERT( replay(Bitboard::fromField(field),solver.getSolution()) );
+}
+
+void PerfectClearTest::testImpossible()
+{
+  PerfectClear solver;
+  const PieceType pieces[10]={O,O,O,I,I,O,O,O,I,I};
+  Bitboard board=emptyBoard();
+
+  // One block leaves an odd number of cells in any height.
+  board.rows[0]=1;
+  CPPUNIT_ASSERT( PerfectClear::NONE==solver.solve(board,pieces,10) );
+  CPPUNIT_ASSERT( 0==solver.getNodes() );
+  // Too few pieces for the lowest clear.
+  CPPUNIT_ASSERT( PerfectClear::NONE==solver.solve(emptyBoard(),pieces,4) );
+  CPPUNIT_ASSERT( 0==solver.getNodes() );
+  // Blocks above the rows a clear can use.
+  board.rows[0]=0;
+  board.rows[PerfectClear::MAX_HEIGHT]=3;
+  CPPUNIT_ASSERT( PerfectClear::NONE==solver.solve(board,pieces,10) );
+
+  // Two cells walled off in a corner can never be filled.
+  board=emptyBoard();
+  board.rows[0]=Bitboard::FULL & ~3u & ~(1u<<9) & ~(1u<<8);
+  board.rows[1]=3;
+  CPPUNIT_ASSERT( PerfectClear::NONE==solver.solve(board,pieces,10,2) );
+  CPPUNIT_ASSERT( 1==solver.getNodes() );
+
+  // Two columns of four empty cells need an I each, though an O fits the
+  // square beside them: an O covers as many cells of the even columns as
+  // of the odd.
+  board=emptyBoard();
+  board.rows[0]=board.rows[1]=Bitboard::FULL & ~(1u<<3) & ~(1u<<5);
+  board.rows[2]=board.rows[3]=board.rows[0] & ~3u;
+  const PieceType squares[3]={O,O,O}, lines[3]={O,I,I};
+  CPPUNIT_ASSERT( PerfectClear::NONE==solver.solve(board,squares,3) );
+  CPPUNIT_ASSERT( 1==solver.getNodes() );
+  CPPUNIT_ASSERT( PerfectClear::FOUND==solver.solve(board,lines,3) );
+  CPPUNIT_ASSERT( replay(board,solver.getSolution()) );
+
+  // Two cells split from two more by a row that an I clears are not walled
+  // off: once it has, an O fills all four.
+  board=emptyBoard();
+  board.rows[0]=board.rows[2]=Bitboard::FULL & ~3u & ~(1u<<9);
+  board.rows[1]=board.rows[3]=Bitboard::FULL & ~(1u<<9);
+  const PieceType split[2]={I,O};
+  CPPUNIT_ASSERT( PerfectClear::FOUND==solver.solve(board,split,2) );
+  CPPUNIT_ASSERT( 4==solver.getHeight() && 2==solver.getSolution().size() );
+  CPPUNIT_ASSERT( replay(board,solver.getSolution()) );
+
+  PerfectClear limited(false,1);
+  CPPUNIT_ASSERT( PerfectClear::GAVE_UP==limited.solve(emptyBoard(),pieces,10) );
+  CPPUNIT_ASSERT( limited.getSolution().empty() );
+}
+
+void PerfectClearTest::testHold()
+{
+  // S first would leave a hole only a tuck could fill.
+  const PieceType pieces[6]={S,O,O,O,I,I};
+  PerfectClear plain, hold(true);
+
+  CPPUNIT_ASSERT( PerfectClear::NONE==plain.solve(emptyBoard(),pieces,6,2) );
+  CPPUNIT_ASSERT( PerfectClear::FOUND==hold.solve(emptyBoard(),pieces,6,2) );
+  CPPUNIT_ASSERT( 5==hold.getSolution().size() );
+  CPPUNIT_ASSERT( hold.getSolution()[0].hold && O==hold.getSolution()[0].type );
+  for(std::size_t i=1;i<hold.getSolution().size();++i)
+    {
+      CPPUNIT_ASSERT( S!=hold.getSolution()[i].type );
+    }
+}
+
+void PerfectClearTest::testOpenings()
+{
+  PerfectClear solver;
+  unsigned found=0;
+  for(unsigned seed=16;seed<20;++seed)
+    {
+      PieceQueue queue(BAG7,seed);
+      PieceType pieces[11];
+      for(PieceType &p : pieces)
+	{
+	  p=queue.pop();
+	}
+      if(PerfectClear::FOUND==solver.solve(emptyBoard(),pieces,11))
+	{
+	  ++found;
+	  CPPUNIT_ASSERT( 4==solver.getHeight() && 10==solver.getSolution().size() );
+	  CPPUNIT_ASSERT( replay(emptyBoard(),solver.getSolution()) );
+	}
+    }
+  CPPUNIT_ASSERT( found>0 );
+}
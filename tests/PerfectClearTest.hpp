@@ -0,0 +1,31 @@
+#ifndef PERFECTCLEARTEST_HPP
+#define PERFECTCLEARTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PerfectClearTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( PerfectClearTest );
+  CPPUNIT_TEST( testSolve );
+  CPPUNIT_TEST( testImpossible );
+  CPPUNIT_TEST( testHold );
+  CPPUNIT_TEST( testOpenings );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // A simple clear is found, and its steps can be played.
+  void testSolve();
+  // Counts, columns, regions and blocks too high rule a clear out before
+  // searching, but regions a line clear joins do not; and the limit stops a
+  // search.
+  void testImpossible();
+  // Hold lets a piece wait, but only when asked for.
+  void testHold();
+  // Every clear found in real openings empties the field when played.
+  void testOpenings();
+};
+
+#endif // PERFECTCLEARTEST_HPP
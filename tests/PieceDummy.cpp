@@ -35,7 +35,13 @@ namespace PieceDummy
 
 //public:
 Piece::Piece(PieceType t, unsigned int d, Field *f):
-  type(t),baseDelay(d),field(f)
+  type(t),baseDelay(d),field(f),orientation(0)
+{
+
+}
+
+Piece::Piece(PieceType t, unsigned int o, const coord &c, unsigned int d, Field *f):
+  type(t),baseDelay(d),field(f),center(c),orientation(o)
 {
 
 }
@@ -63,6 +69,17 @@ arrayt Piece::getBlocks() const
   // STUB
   return arrayt();
 }
+const arrayt& Piece::shape(PieceType t, unsigned int orientation)
+{
+  // STUB
+  static const arrayt blocks;
+  return blocks;
+}
+coord Piece::spawn(PieceType t)
+{
+  // STUB
+  return coord();
+}
 
 //private:
 bool Piece::can_shift (const coord &displacement) const
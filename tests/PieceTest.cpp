@@ -180,6 +180,22 @@ void PieceTest::testConstructor()
 
   delete test_piece;
 
+  // J Block placed directly in play, turned clockwise once
+  expectedBlocks[0](2,6);
+  expectedBlocks[1](3,6);
+  expectedBlocks[2](2,5);
+  expectedBlocks[3](2,4);
+
+  test_piece=new Piece(J,1,coord(2,5),testDelay,&testField);
+  CPPUNIT_ASSERT( coord(2,5)==test_piece->getCenter() );
+  CPPUNIT_ASSERT( 1 == test_piece->getOrientation() );
+
+  CPPUNIT_ASSERT( testSameCoords(expectedBlocks, test_piece->getBlocks()) );
+
+  CPPUNIT_ASSERT(J == test_piece->getType() );
+
+  delete test_piece;
+
 }
 
 void PieceTest::testStep()
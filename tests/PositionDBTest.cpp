@@ -0,0 +1,156 @@
+#include "PositionDBTest.hpp"
+#include "PositionDB.hpp"
+
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+#include "Enumerator.hpp"
+#include "Randomizer.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( PositionDBTest );
+
+static std::string tempPath()
+{
+  return "/tmp/PositionDBTest."+std::to_string(getpid())+".db";
+}
+
+static PositionDB::Result result(float value, unsigned x)
+{
+  const PositionDB::Result r={value,PositionDB::MOVE,(std::uint8_t)(x%4),(std::int8_t)x,0};
+  return r;
+}
+
+void PositionDBTest::setUp()
+{
+}
+
+void PositionDBTest::tearDown()
+{
+  std::remove(tempPath().c_str());
+}
+
+void PositionDBTest::testKeys()
+{
+  Bitboard b,m;
+  b.clear();
+  m.clear();
+  b.rows[0]=0x0f;
+  b.rows[1]=0x01;
+  m.rows[0]=0x0f << (FIELD_WIDTH-4);
+  m.rows[1]=0x01 << (FIELD_WIDTH-1);
+  CPPUNIT_ASSERT( PositionDB::key(b)==PositionDB::key(m) );
+  CPPUNIT_ASSERT( PositionDB::key(b,J)!=PositionDB::key(m,J) );
+  CPPUNIT_ASSERT( PositionDB::key(b,J)!=PositionDB::key(b,L) );
+  CPPUNIT_ASSERT( PositionDB::key(b)!=PositionDB::key(b,I) );
+  CPPUNIT_ASSERT( PositionDB::key(b,Z)<(std::uint64_t)1<<63 );
+
+  // Too high to be stored.
+  b.rows[Enumerator::MAX_HEIGHT]=1;
+  CPPUNIT_ASSERT( PositionDB::NONE==PositionDB::key(b) );
+  CPPUNIT_ASSERT( PositionDB::NONE==PositionDB::key(b,T) );
+}
+
+void PositionDBTest::testBuild()
+{
+  const unsigned COUNT=50000;
+  PositionDB::Builder builder;
+  Pcg32 rng(5,0);
+  std::vector<std::uint64_t> keys;
+  for(unsigned i=0;i<COUNT;++i)
+    {
+      keys.push_back(((std::uint64_t)rng()<<32 | rng()) >> 2);
+      builder.add(keys.back(),result(i,i%FIELD_WIDTH));
+    }
+  // Replaced by a later result.
+  builder.add(keys[7],result(-1,3));
+  builder.write(tempPath());
+
+  PositionDB db(tempPath());
+  CPPUNIT_ASSERT( COUNT==db.size() );
+  CPPUNIT_ASSERT( 4*db.size()<=3*PositionDB::WAYS*db.getBuckets() );
+  PositionDB::Result r;
+  for(unsigned i=0;i<COUNT;++i)
+    {
+      CPPUNIT_ASSERT( db.find(keys[i],r) );
+      CPPUNIT_ASSERT( (7==i ? -1.0f : (float)i)==r.value );
+      CPPUNIT_ASSERT( PositionDB::MOVE==r.flags && (7==i ? 3 : i%FIELD_WIDTH)==(unsigned)r.x );
+    }
+  // Every key added is below 2^62.
+  CPPUNIT_ASSERT( !db.find((std::uint64_t)1<<62,r) );
+  CPPUNIT_ASSERT( !db.find(PositionDB::NONE,r) );
+
+  std::uint64_t walked=0,key;
+  for(std::uint64_t i=0;i<PositionDB::WAYS*db.getBuckets();++i)
+    {
+      if(db.record(i,key,r))
+	{
+	  ++walked;
+	  CPPUNIT_ASSERT( db.find(key,r) );
+	}
+    }
+  CPPUNIT_ASSERT( COUNT==walked );
+
+  // Boards by their keys.
+  PositionDB::Builder boards;
+  Bitboard b;
+  b.clear();
+  b.rows[0]=0x3c;
+  boards.add(PositionDB::key(b),result(2,0));
+  boards.add(PositionDB::key(b,O),result(3,7));
+  boards.write(tempPath());
+  PositionDB small(tempPath());
+  CPPUNIT_ASSERT( small.find(b,r) && 2==r.value );
+  CPPUNIT_ASSERT( small.find(b,O,r) && 3==r.value && 7==r.x );
+  CPPUNIT_ASSERT( !small.find(b,I,r) );
+  b.rows[0]=0x3c << 1;
+  CPPUNIT_ASSERT( !small.find(b,r) );
+}
+
+void PositionDBTest::testEmpty()
+{
+  PositionDB::Builder builder;
+  builder.write(tempPath());
+  PositionDB db(tempPath());
+  PositionDB::Result r;
+  CPPUNIT_ASSERT( 0==db.size() && 1==db.getBuckets() );
+  CPPUNIT_ASSERT( !db.find(0,r) && !db.find(12345,r) );
+}
+
+void PositionDBTest::testErrors()
+{
+  const std::string path=tempPath();
+  CPPUNIT_ASSERT_THROW( PositionDB db(path), DatabaseError );
+
+  PositionDB::Builder builder;
+  for(std::uint64_t k=0;k<100;++k)
+    {
+      builder.add(k,result(k,0));
+    }
+  builder.write(path);
+  std::ifstream file(path.c_str(),std::ios::binary);
+  const std::string data((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+  file.close();
+
+  // Cut short, shorter than a header, a wrong version and a bucket count
+  // that is not a power of two.
+  std::ofstream(path.c_str(),std::ios::binary) << data.substr(0,data.size()-16);
+  CPPUNIT_ASSERT_THROW( PositionDB db(path), DatabaseError );
+  std::ofstream(path.c_str(),std::ios::binary) << data.substr(0,10);
+  CPPUNIT_ASSERT_THROW( PositionDB db(path), DatabaseError );
+  std::string bad=data;
+  bad[8]=2;
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  CPPUNIT_ASSERT_THROW( PositionDB db(path), DatabaseError );
+  bad=data;
+  bad[16]=3;
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  CPPUNIT_ASSERT_THROW( PositionDB db(path), DatabaseError );
+  std::ofstream(path.c_str(),std::ios::binary) << data;
+  PositionDB db(path);
+  CPPUNIT_ASSERT( 100==db.size() );
+
+  // A directory that does not exist.
+  CPPUNIT_ASSERT_THROW( builder.write("/nonexistent/db"), DatabaseError );
+}
@@ -0,0 +1,29 @@
+#ifndef POSITIONDBTEST_HPP
+#define POSITIONDBTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class PositionDBTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( PositionDBTest );
+  CPPUNIT_TEST( testKeys );
+  CPPUNIT_TEST( testBuild );
+  CPPUNIT_TEST( testEmpty );
+  CPPUNIT_TEST( testErrors );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Boards alone fold with their mirror images, boards with a piece do not.
+  void testKeys();
+  // Everything added is found, the last result for a key wins, and the
+  // records can be walked.
+  void testBuild();
+  void testEmpty();
+  // Missing, short, foreign and damaged files are refused.
+  void testErrors();
+};
+
+#endif // POSITIONDBTEST_HPP
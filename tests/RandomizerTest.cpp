@@ -0,0 +1,147 @@
+#include "RandomizerTest.hpp"
+#include "Randomizer.hpp"
+
+#include <algorithm>
+#include <set>
+#include <vector>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( RandomizerTest );
+
+static std::vector<PieceType> deal(Randomizer &r, unsigned n)
+{
+  std::vector<PieceType> ret;
+  for(unsigned i=0;i<n;++i)
+    {
+      ret.push_back(r.next());
+    }
+  return ret;
+}
+
+// How many pieces match one of the four before them.
+static unsigned countRepeats(const std::vector<PieceType> &seq)
+{
+  unsigned ret=0;
+  for(std::size_t i=4;i<seq.size();++i)
+    {
+      ret+=(0!=std::count(seq.begin()+i-4,seq.begin()+i,seq[i]));
+    }
+  return ret;
+}
+
+void RandomizerTest::setUp()
+{
+}
+
+void RandomizerTest::tearDown()
+{
+}
+
+void RandomizerTest::testPcg()
+{
+  // From the PCG reference pcg32-demo, seeded with 42 on stream 54.
+  const std::uint32_t expected[6]={0xa15c02b7,0x7b47f409,0xba1d3330,
+				   0x83d2f293,0xbfa4784b,0xcbed606e};
+  Pcg32 rng(42,54);
+  unsigned i;
+
+  for(i=0;i<6;++i)
+    {
+      CPPUNIT_ASSERT( expected[i]==rng() );
+    }
+  rng.seed(42,54);
+  CPPUNIT_ASSERT( expected[0]==rng() );
+
+  std::set<std::uint32_t> seen;
+  for(i=0;i<1000;++i)
+    {
+      const std::uint32_t n=rng.bounded(7);
+      CPPUNIT_ASSERT( n<7 );
+      seen.insert(n);
+    }
+  CPPUNIT_ASSERT( 7==seen.size() );
+  CPPUNIT_ASSERT( 0==rng.bounded(1) );
+}
+
+void RandomizerTest::testBag()
+{
+  BagRandomizer a(5), b(5), c(6);
+  const std::vector<PieceType> seq=deal(a,700);
+  unsigned i;
+
+  for(i=0;i<seq.size();i+=7)
+    {
+      std::set<PieceType> bag(seq.begin()+i,seq.begin()+i+7);
+      CPPUNIT_ASSERT( 7==bag.size() );
+    }
+  CPPUNIT_ASSERT( seq==deal(b,700) );
+  CPPUNIT_ASSERT( seq!=deal(c,700) );
+  a.reset(5);
+  CPPUNIT_ASSERT( seq==deal(a,700) );
+}
+
+void RandomizerTest::testMemoryless()
+{
+  MemorylessRandomizer r(7);
+  unsigned counts[7]={0,0,0,0,0,0,0};
+  unsigned i;
+
+  for(i=0;i<7000;++i)
+    {
+      counts[r.next()]++;
+    }
+  for(i=0;i<7;++i)
+    {
+      CPPUNIT_ASSERT( 850<counts[i] && counts[i]<1150 );
+    }
+}
+
+void RandomizerTest::testHistory()
+{
+  MemorylessRandomizer plain(8);
+  unsigned seed;
+
+  for(seed=0;seed<50;++seed)
+    {
+      HistoryRandomizer r(seed);
+      const PieceType first=r.next();
+      CPPUNIT_ASSERT( S!=first && Z!=first && O!=first );
+    }
+  HistoryRandomizer r(8);
+  // By chance about 46% of pieces repeat one of the last four; four tries
+  // bring that under 10%.
+  const unsigned repeats=countRepeats(deal(r,7000));
+  CPPUNIT_ASSERT( repeats<700 );
+  CPPUNIT_ASSERT( countRepeats(deal(plain,7000))>2*repeats );
+}
+
+void RandomizerTest::testQueue()
+{
+  PieceQueue queue(BAG7,9,5), small(MEMORYLESS,9,0), big(HISTORY,9,100);
+  BagRandomizer bag(9);
+  const std::vector<PieceType> seq=deal(bag,50);
+  unsigned i,j;
+
+  CPPUNIT_ASSERT( 5==queue.size() );
+  CPPUNIT_ASSERT( 1==small.size() );
+  CPPUNIT_ASSERT( PieceQueue::CAPACITY==big.size() );
+  CPPUNIT_ASSERT( BAG7==queue.getKind() );
+  for(i=0;i<40;++i)
+    {
+      for(j=0;j<queue.size();++j)
+	{
+	  CPPUNIT_ASSERT( seq[i+j]==queue.peek(j) );
+	}
+      CPPUNIT_ASSERT( seq[i]==queue.pop() );
+    }
+  queue.reset(9);
+  CPPUNIT_ASSERT( seq[0]==queue.peek(0) );
+
+  HistoryRandomizer history(9);
+  const std::vector<PieceType> hseq=deal(history,40);
+  for(i=0;i<30;++i)
+    {
+      CPPUNIT_ASSERT( hseq[i+PieceQueue::CAPACITY-1]==big.peek(PieceQueue::CAPACITY-1) );
+      CPPUNIT_ASSERT( hseq[i]==big.pop() );
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef RANDOMIZERTEST_HPP
+#define RANDOMIZERTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class RandomizerTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( RandomizerTest );
+  CPPUNIT_TEST( testPcg );
+  CPPUNIT_TEST( testBag );
+  CPPUNIT_TEST( testMemoryless );
+  CPPUNIT_TEST( testHistory );
+  CPPUNIT_TEST( testQueue );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Pcg32 matches the reference implementation, and bounded stays in range.
+  void testPcg();
+  // Every seven pieces from a bag are one of each; seeds repeat exactly.
+  void testBag();
+  // Every piece type turns up about equally often.
+  void testMemoryless();
+  // The first piece is never S, Z or O, and repeats are rarer than chance.
+  void testHistory();
+  // The preview shows exactly the pieces that pop will return.
+  void testQueue();
+};
+
+#endif // RANDOMIZERTEST_HPP
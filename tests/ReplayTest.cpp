@@ -0,0 +1,403 @@
+#include "ReplayTest.hpp"
+#include "Replay.hpp"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
+#include "Agent.hpp"
+#include "ReplayScanner.hpp"
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( ReplayTest );
+
+static std::string tempPath()
+{
+  return "/tmp/ReplayTest."+std::to_string(getpid())+".rep";
+}
+
+// Record a game played by a random agent until it is lost or has played
+// pieces pieces. With snapshots, also keep a snapshot of every frame.
+static Replay* record(std::uint64_t seed, unsigned pieces,
+		      std::uint32_t interval=Replay::DEFAULT_INTERVAL,
+		      std::vector<FrameSnapshot> *snapshots=nullptr,
+		      unsigned tickRate=HeadlessGame::DEFAULT_TICK_RATE)
+{
+  Replay *ret=new Replay(seed,BAG7,interval);
+  HeadlessGame game(seed,BAG7,tickRate);
+  RandomAgent agent(seed,3,2);
+  PieceInput inputs[ReplayCursor::MAX_INPUTS];
+  while(!game.isGameOver() && game.getPieceCount()<=pieces)
+    {
+      if(snapshots)
+	{
+	  snapshots->push_back(game.snapshot());
+	}
+      const std::size_t n=agent.act(game,inputs,ReplayCursor::MAX_INPUTS);
+      ret->step(game,inputs,n);
+    }
+  if(snapshots)
+    {
+      snapshots->push_back(game.snapshot());
+    }
+  ret->finish(game);
+  return ret;
+}
+
+static bool sameSnapshot(const FrameSnapshot &a, const FrameSnapshot &b)
+{
+  return 0==std::memcmp(&a,&b,sizeof(FrameSnapshot));
+}
+
+static std::string results(const std::vector<Aggregate*> &aggregates)
+{
+  std::ostringstream out;
+  for(const Aggregate *a : aggregates)
+    {
+      a->write(out);
+    }
+  return out.str();
+}
+
+void ReplayTest::setUp()
+{
+}
+
+void ReplayTest::tearDown()
+{
+  std::remove(tempPath().c_str());
+}
+
+void ReplayTest::testEvents()
+{
+  // Inputs, 300 empty frames, inputs, one empty frame.
+  Replay replay(7,HISTORY);
+  const PieceInput first[]={shift_left,rotate_cw,hard_drop},second[]={shift_right};
+  replay.frame(first,3);
+  for(int i=0;i<300;++i)
+    {
+      replay.frame(nullptr,0);
+    }
+  replay.frame(second,1);
+  replay.frame(nullptr,0);
+  const ReplayView v=replay.view();
+  CPPUNIT_ASSERT( 7==v.seed && HISTORY==v.kind && 303==v.frames );
+  // Three bytes of inputs and one more for each run of up to 128 frames.
+  CPPUNIT_ASSERT( 3+3+1+1==v.bytes );
+
+  ReplayCursor cursor(v);
+  PieceInput inputs[ReplayCursor::MAX_INPUTS];
+  std::size_t count,frames=0;
+  CPPUNIT_ASSERT( cursor.next(inputs,count) && 3==count );
+  CPPUNIT_ASSERT( shift_left==inputs[0] && rotate_cw==inputs[1] && hard_drop==inputs[2] );
+  while(cursor.next(inputs,count) && 0==count)
+    {
+      ++frames;
+    }
+  CPPUNIT_ASSERT( 300==frames && 1==count && shift_right==inputs[0] );
+  CPPUNIT_ASSERT( cursor.next(inputs,count) && 0==count );
+  CPPUNIT_ASSERT( !cursor.next(inputs,count) );
+
+  std::vector<PieceInput> many(ReplayCursor::MAX_INPUTS+1,shift_left);
+  CPPUNIT_ASSERT_THROW( replay.frame(many.data(),many.size()), ReplayError );
+}
+
+void ReplayTest::testFile()
+{
+  std::unique_ptr<Replay> a(record(1,200,50)),b(record(2,50,600,nullptr,1000));
+  {
+    ReplayWriter writer(tempPath());
+    writer.write(*a);
+  }
+  {
+    // Appending adds no second header.
+    ReplayWriter writer(tempPath());
+    writer.write(*b);
+    writer.write(Replay(3,MEMORYLESS));
+  }
+  ReplayFile file(tempPath());
+  CPPUNIT_ASSERT( 3==file.size() );
+  for(std::size_t i=0;i<2;++i)
+    {
+      const ReplayView want=(i ? b : a)->view(),got=file.get(i);
+      CPPUNIT_ASSERT( want.seed==got.seed && want.kind==got.kind && want.flags==got.flags );
+      CPPUNIT_ASSERT( want.frames==got.frames && want.pieces==got.pieces );
+      CPPUNIT_ASSERT( want.bytes==got.bytes
+		      && std::equal(want.events,want.events+want.bytes,got.events) );
+      CPPUNIT_ASSERT( want.interval==got.interval && want.keyframes==got.keyframes );
+      CPPUNIT_ASSERT( std::equal(want.keyframeData,want.keyframeData+want.keyframes*sizeof(ReplayKeyframe),
+				 got.keyframeData) );
+      CPPUNIT_ASSERT( want.tickRate==got.tickRate );
+      // Played again at the rate it was recorded at.
+      ReplayPlayer player(got);
+      player.seek(got.frames);
+      CPPUNIT_ASSERT( got.pieces==player.getGame().getPieceCount() );
+    }
+  CPPUNIT_ASSERT( a->view().keyframes>0 );
+  CPPUNIT_ASSERT( 60==file.get(0).getTickRate() && 1000==file.get(1).getTickRate() );
+  // A replay never finished has the default rate.
+  CPPUNIT_ASSERT( 0==file.get(2).tickRate && 60==file.get(2).getTickRate() );
+  CPPUNIT_ASSERT( 3==file.get(2).seed && MEMORYLESS==file.get(2).kind && 0==file.get(2).bytes );
+  CPPUNIT_ASSERT_THROW( file.get(3), std::out_of_range );
+
+  // Held keys play back with the auto-repeat they were recorded with, from
+  // the start or from a keyframe taken while a key was held.
+  const PieceInput keys[]={press_left,hard_drop,release_left,press_right,rotate_cw,
+			   hard_drop,release_right};
+  HeadlessGame game(5);
+  game.setAutoRepeat(std::chrono::milliseconds(50),std::chrono::milliseconds(0));
+  Replay held(5,BAG7,10);
+  std::vector<FrameSnapshot> snapshots(1,game.snapshot());
+  for(unsigned i=0;i<400 && !game.isGameOver();++i)
+    {
+      held.step(game,keys+i/9%7,0==i%9);
+      snapshots.push_back(game.snapshot());
+    }
+  held.finish(game);
+  {
+    ReplayWriter writer(tempPath());
+    writer.write(held);
+  }
+  ReplayFile again(tempPath());
+  const ReplayView r=again.get(3);
+  CPPUNIT_ASSERT( 150==r.das && 0==r.arr && r.keyframes>10 );
+  ReplayPlayer player(r);
+  for(std::uint32_t f : {r.frames,r.frames/2+3,0u,r.frames-1})
+    {
+      player.seek(f);
+      CPPUNIT_ASSERT( sameSnapshot(snapshots[f],player.getGame().snapshot()) );
+    }
+}
+
+void ReplayTest::testErrors()
+{
+  const std::string path=tempPath();
+  CPPUNIT_ASSERT_THROW( ReplayFile f(path), ReplayError );
+  {
+    ReplayWriter writer(path);
+    std::unique_ptr<Replay> r(record(4,20));
+    writer.write(*r);
+  }
+  std::ifstream file(path.c_str(),std::ios::binary);
+  const std::string data((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+  file.close();
+
+  // Cut short, shorter than a header, a wrong version and a bad randomizer.
+  std::ofstream(path.c_str(),std::ios::binary) << data.substr(0,data.size()-1);
+  CPPUNIT_ASSERT_THROW( ReplayFile f(path), ReplayError );
+  std::ofstream(path.c_str(),std::ios::binary) << data.substr(0,10);
+  CPPUNIT_ASSERT_THROW( ReplayFile f(path), ReplayError );
+  std::string bad=data;
+  bad[8]=ReplayWriter::VERSION+1;
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  CPPUNIT_ASSERT_THROW( ReplayFile f(path), ReplayError );
+  bad=data;
+  bad[16+12]=9;
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  CPPUNIT_ASSERT_THROW( ReplayFile f(path), ReplayError );
+  // A header alone holds no replays.
+  std::ofstream(path.c_str(),std::ios::binary) << data.substr(0,16);
+  CPPUNIT_ASSERT( 0==ReplayFile(path).size() );
+
+  // Version 1 files, without keyframes, are read but not appended to.
+  bad=data.substr(0,16);
+  bad[8]=1;
+  bad+=data.substr(16,24);
+  std::uint32_t bytes;
+  std::memcpy(&bytes,data.data()+16,4);
+  bad+=data.substr(16+ReplayWriter::RECORD_SIZE,bytes);
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  {
+    ReplayFile old(path);
+    CPPUNIT_ASSERT( 1==old.size() && 0==old.get(0).keyframes && bytes==old.get(0).bytes );
+    CPPUNIT_ASSERT( 4==old.get(0).seed );
+  }
+  CPPUNIT_ASSERT_THROW( ReplayWriter w(path), ReplayError );
+
+  // Version 2 files, without the auto-repeat, likewise.
+  bad=data.substr(0,16);
+  bad[8]=2;
+  bad+=data.substr(16,32);
+  bad+=data.substr(16+ReplayWriter::RECORD_SIZE);
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  {
+    ReplayFile old(path);
+    CPPUNIT_ASSERT( 1==old.size() && bytes==old.get(0).bytes && 4==old.get(0).seed );
+    CPPUNIT_ASSERT( 0==old.get(0).das && 0==old.get(0).arr );
+    ReplayPlayer player(old.get(0));
+    player.seek(old.get(0).frames);
+    CPPUNIT_ASSERT( old.get(0).pieces==player.getGame().getPieceCount() );
+  }
+  CPPUNIT_ASSERT_THROW( ReplayWriter w(path), ReplayError );
+
+  // An input out of range and a frame that never ends.
+  const std::uint8_t events[]={release_left+1,0x80,1};
+  ReplayView v={1,BAG7,0,2,1,events,sizeof(events)};
+  PieceInput inputs[ReplayCursor::MAX_INPUTS];
+  std::size_t count;
+  CPPUNIT_ASSERT_THROW( ReplayCursor(v).next(inputs,count), ReplayError );
+  v.events=events+1;
+  v.bytes=2;
+  ReplayCursor cursor(v);
+  CPPUNIT_ASSERT( cursor.next(inputs,count) && 0==count );
+  CPPUNIT_ASSERT_THROW( cursor.next(inputs,count), ReplayError );
+}
+
+void ReplayTest::testSeek()
+{
+  const std::uint32_t INTERVAL=20;
+  std::vector<FrameSnapshot> snapshots;
+  std::unique_ptr<Replay> replay(record(9,1000,INTERVAL,&snapshots));
+  const ReplayView v=replay->view();
+  CPPUNIT_ASSERT( v.frames+1==snapshots.size() && v.frames/INTERVAL>=v.keyframes
+		  && v.keyframes+1>=v.frames/INTERVAL && v.keyframes>10 );
+  {
+    ReplayWriter writer(tempPath());
+    writer.write(v);
+    writer.write(Replay(9,BAG7,0).view());
+  }
+  ReplayFile file(tempPath());
+
+  // Forwards, backwards, a frame at a time, onto keyframes and to both ends,
+  // in memory and from the file, and without keyframes.
+  Pcg32 rng(3,0);
+  std::vector<std::uint32_t> frames={0,v.frames,INTERVAL,INTERVAL-1,INTERVAL+1,v.frames-1,0};
+  for(int i=0;i<100;++i)
+    {
+      frames.push_back(rng.bounded(v.frames+1));
+      frames.push_back(std::min(frames.back()+1+rng.bounded(3*INTERVAL),v.frames));
+    }
+  ReplayView plain=v;
+  plain.keyframes=0;
+  for(const ReplayView &r : {v,file.get(0),plain})
+    {
+      ReplayPlayer player(r);
+      CPPUNIT_ASSERT( v.frames==player.getFrames() );
+      CPPUNIT_ASSERT( sameSnapshot(snapshots[0],player.getGame().snapshot()) );
+      for(std::uint32_t f : frames)
+	{
+	  player.seek(f);
+	  CPPUNIT_ASSERT( f==player.getFrame() );
+	  CPPUNIT_ASSERT( sameSnapshot(snapshots[f],player.getGame().snapshot()) );
+	}
+      player.seek(v.frames+100);
+      CPPUNIT_ASSERT( v.frames==player.getFrame() && 0==player.advance(10) );
+      player.seek(v.frames-5);
+      CPPUNIT_ASSERT( 5==player.advance(10) && player.getGame().isGameOver() );
+    }
+
+  // A keyframe that does not match its events.
+  std::vector<std::uint8_t> keyframes(v.keyframeData,v.keyframeData+v.keyframes*sizeof(ReplayKeyframe));
+  ReplayView bad=v;
+  bad.keyframeData=keyframes.data();
+  ReplayKeyframe k;
+  bad.keyframe(0,k);
+  ++k.offset;
+  std::memcpy(keyframes.data(),&k,sizeof(k));
+  ReplayPlayer player(bad);
+  CPPUNIT_ASSERT_THROW( player.seek(INTERVAL), ReplayError );
+
+  // Too much garbage queued at the first keyframe leaves a hole, and the
+  // keyframes after it stay on the grid.
+  Replay holed(9,BAG7,INTERVAL);
+  HeadlessGame game(9);
+  snapshots.assign(1,game.snapshot());
+  for(std::uint32_t f=1;f<=4*INTERVAL;++f)
+    {
+      if(INTERVAL-1==f)
+	{
+	  for(unsigned i=0;i<=HeadlessGame::State::GARBAGE;++i)
+	    {
+	      game.addGarbage(1,i);
+	    }
+	}
+      if(INTERVAL+1==f)
+	{
+	  game.cancelGarbage(HeadlessGame::State::GARBAGE+1);
+	}
+      holed.step(game,nullptr,0);
+      snapshots.push_back(game.snapshot());
+    }
+  const ReplayView h=holed.view();
+  CPPUNIT_ASSERT( 4==h.keyframes );
+  h.keyframe(0,k);
+  CPPUNIT_ASSERT( 0==k.frame );
+  h.keyframe(3,k);
+  CPPUNIT_ASSERT( 4*INTERVAL==k.frame );
+  ReplayPlayer seeker(h);
+  for(std::uint32_t f : {4*INTERVAL,INTERVAL+5,2*INTERVAL-1,INTERVAL,3*INTERVAL+1,0u})
+    {
+      seeker.seek(f);
+      CPPUNIT_ASSERT( f==seeker.getFrame() );
+      CPPUNIT_ASSERT( sameSnapshot(snapshots[f],seeker.getGame().snapshot()) );
+    }
+}
+
+void ReplayTest::testScan()
+{
+  const unsigned GAMES=300;
+  unsigned long pieces=0,frames=0;
+  unsigned lost=0;
+  {
+    ReplayWriter writer(tempPath());
+    for(unsigned i=0;i<GAMES;++i)
+      {
+	// Some at another tick rate, which speed must count apart.
+	std::unique_ptr<Replay> r(record(i+1,i%2 ? 1000 : 30,Replay::DEFAULT_INTERVAL,nullptr,
+					 i%3 ? 60 : 120));
+	writer.write(*r);
+	pieces+=r->view().pieces;
+	frames+=r->view().frames;
+	lost+=r->view().flags & ReplayView::GAME_OVER;
+      }
+  }
+  CPPUNIT_ASSERT( lost>0 && lost<GAMES );
+
+  std::string expected;
+  for(unsigned threads=1;threads<=3;threads+=2)
+    {
+      WorkerPool pool(threads);
+      ReplayScanner scanner(pool);
+      scanner.add(tempPath());
+      scanner.add(tempPath());
+      CPPUNIT_ASSERT( 2*GAMES==scanner.getReplays() );
+      HoleAggregate holes;
+      std::unique_ptr<Aggregate> speed(Aggregate::create("speed")),
+	clears(Aggregate::create("clears")),height(Aggregate::create("height"));
+      const std::vector<Aggregate*> aggregates={&holes,speed.get(),clears.get(),height.get()};
+      const ReplayScanner::Stats stats=scanner.scan(aggregates);
+      CPPUNIT_ASSERT( 2*GAMES==stats.replays && 0==stats.desynced );
+      CPPUNIT_ASSERT( 2*pieces==stats.pieces && 2*frames==stats.frames );
+      unsigned long games=0;
+      for(std::uint64_t n : holes.getCounts())
+	{
+	  games+=n;
+	}
+      CPPUNIT_ASSERT( 2*lost==games );
+      if(expected.empty())
+	{
+	  expected=results(aggregates);
+	}
+      CPPUNIT_ASSERT( expected==results(aggregates) );
+    }
+  CPPUNIT_ASSERT( !Aggregate::create("nothing") );
+
+  // A replay played from the wrong seed, or cut short, does not match.
+  {
+    ReplayWriter writer(tempPath());
+    std::unique_ptr<Replay> r(record(GAMES+1,100));
+    ReplayView v=r->view();
+    ++v.seed;
+    writer.write(v);
+    v=r->view();
+    v.bytes/=2;
+    writer.write(v);
+  }
+  WorkerPool pool(1);
+  ReplayScanner scanner(pool);
+  scanner.add(tempPath());
+  const ReplayScanner::Stats stats=scanner.scan(std::vector<Aggregate*>());
+  CPPUNIT_ASSERT( GAMES+2==stats.replays && 2==stats.desynced );
+}
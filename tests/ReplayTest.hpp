@@ -0,0 +1,34 @@
+#ifndef REPLAYTEST_HPP
+#define REPLAYTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ReplayTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ReplayTest );
+  CPPUNIT_TEST( testEvents );
+  CPPUNIT_TEST( testFile );
+  CPPUNIT_TEST( testErrors );
+  CPPUNIT_TEST( testSeek );
+  CPPUNIT_TEST( testScan );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Frames decode as they were recorded, long idle runs included.
+  void testEvents();
+  // Replays appended to a file, in several writes, read back the same.
+  void testFile();
+  // Short, foreign and damaged files and malformed events are refused.
+  void testErrors();
+  // Seeking anywhere, with or without keyframes, shows the same frame as
+  // playing from the start.
+  void testSeek();
+  // Scanning plays every game again exactly, gives the same aggregates with
+  // any number of threads, and notices replays that do not match.
+  void testScan();
+};
+
+#endif // REPLAYTEST_HPP
@@ -0,0 +1,128 @@
+#include "SeqlockBufferTest.hpp"
+#include "SeqlockBuffer.hpp"
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( SeqlockBufferTest );
+
+// Every word holds the same value, so a torn copy is easy to spot.
+struct Stripe
+{
+  unsigned words[32];
+  Stripe()
+  {
+    for(auto &w : words)
+      w=0;
+  }
+  explicit Stripe(unsigned v)
+  {
+    for(auto &w : words)
+      w=v;
+  }
+  bool consistent() const
+  {
+    for(auto w : words)
+      {
+	if(w!=words[0])
+	  return false;
+      }
+    return true;
+  }
+};
+
+void SeqlockBufferTest::setUp()
+{
+}
+
+void SeqlockBufferTest::tearDown()
+{
+}
+
+void SeqlockBufferTest::testReadWrite()
+{
+  Seqlock<Stripe> slot;
+  Seqlock<Stripe>::Reader reader(slot);
+
+  CPPUNIT_ASSERT( 0 == slot.version() );
+  CPPUNIT_ASSERT( !reader.stale() );
+  CPPUNIT_ASSERT( 0 == reader.read().words[0] );
+
+  slot.write(Stripe(7));
+  CPPUNIT_ASSERT( 1 == slot.version() );
+  CPPUNIT_ASSERT( reader.stale() );
+  CPPUNIT_ASSERT( 7 == reader.read().words[0] );
+  CPPUNIT_ASSERT( reader.last().consistent() );
+  CPPUNIT_ASSERT( 1 == reader.version() );
+  CPPUNIT_ASSERT( !reader.stale() );
+
+  slot.write(Stripe(9));
+  slot.write(Stripe(11));
+  CPPUNIT_ASSERT( 11 == reader.read().words[31] );
+  CPPUNIT_ASSERT( 3 == reader.version() );
+  // No writer was active, so nothing could be torn.
+  CPPUNIT_ASSERT( 0 == reader.retries() );
+  CPPUNIT_ASSERT( 3 == reader.reads() );
+}
+
+void SeqlockBufferTest::testConcurrentReaders()
+{
+  constexpr unsigned WRITES=200000, READERS=8;
+  Seqlock<Stripe> slot;
+  std::atomic_bool done(false);
+  std::atomic_int failures(0);
+  std::vector<std::thread> readers;
+
+  for(unsigned i=0;i<READERS;++i)
+    {
+      readers.push_back(std::thread([&slot,&done,&failures]()
+				    {
+				      Seqlock<Stripe>::Reader reader(slot);
+				      unsigned previous=0;
+				      while(!done)
+					{
+					  const Stripe &s=reader.read();
+					  if(!s.consistent() || s.words[0]<previous)
+					    {
+					      ++failures;
+					    }
+					  previous=s.words[0];
+					}
+				    }));
+    }
+  for(unsigned i=1;i<=WRITES;++i)
+    {
+      slot.write(Stripe(i));
+    }
+  done=true;
+  for(auto &t : readers)
+    {
+      t.join();
+    }
+
+  CPPUNIT_ASSERT( 0 == failures );
+  CPPUNIT_ASSERT( WRITES == slot.version() );
+}
+
+void SeqlockBufferTest::testRenderCallback()
+{
+  SeqlockBuffer buffer;
+  RenderFunc<SeqlockBuffer> rfunc(&buffer,&SeqlockBuffer::write);
+  SeqlockBuffer::Reader reader(buffer);
+  Field field;
+  Piece current(T,0,&field);
+
+  field.set(3,0);
+  rfunc(field,current,nullptr);
+
+  const DataBuffer &frame=reader.read();
+  CPPUNIT_ASSERT( frame.field.get(3,0) );
+  CPPUNIT_ASSERT( !frame.field.get(4,0) );
+  CPPUNIT_ASSERT( T == frame.current.getType() );
+  CPPUNIT_ASSERT( !frame.holding );
+
+  rfunc(field,current,&current);
+  CPPUNIT_ASSERT( reader.read().holding );
+}
@@ -0,0 +1,26 @@
+#ifndef SEQLOCKBUFFERTEST_HPP
+#define SEQLOCKBUFFERTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SeqlockBufferTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( SeqlockBufferTest );
+  CPPUNIT_TEST( testReadWrite );
+  CPPUNIT_TEST( testConcurrentReaders );
+  CPPUNIT_TEST( testRenderCallback );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Values written are the values read, and versions advance.
+  void testReadWrite();
+  // One writer, many readers: no reader may ever observe a torn value.
+  void testConcurrentReaders();
+  // SeqlockBuffer works as a TetrisGame render callback.
+  void testRenderCallback();
+};
+
+#endif // SEQLOCKBUFFERTEST_HPP
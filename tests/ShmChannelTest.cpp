@@ -0,0 +1,162 @@
+#include "ShmChannelTest.hpp"
+#include "ShmChannel.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( ShmChannelTest );
+
+// Unique per test process, so parallel test runs do not collide.
+static std::string channelName()
+{
+  return "UnitTestrisShmChannelTest"+to_string(getpid());
+}
+
+// A frame whose rows all hold the frame number.
+static FrameSnapshot makeFrame(unsigned n)
+{
+  FrameSnapshot ret;
+  std::memset(&ret,0,sizeof(ret));
+  for(auto &r : ret.rows)
+    {
+      r=n;
+    }
+  ret.frame=n;
+  return ret;
+}
+
+static bool consistent(const FrameSnapshot &s)
+{
+  for(auto r : s.rows)
+    {
+      if(r!=s.frame)
+	{
+	  return false;
+	}
+    }
+  return true;
+}
+
+void ShmChannelTest::setUp()
+{
+}
+
+void ShmChannelTest::tearDown()
+{
+}
+
+void ShmChannelTest::testAttach()
+{
+  FrameSnapshot snap;
+
+  CPPUNIT_ASSERT_THROW( ShmViewer viewer(channelName()), ShmError );
+  {
+    ShmPublisher publisher(channelName());
+    ShmViewer viewer(channelName());
+
+    CPPUNIT_ASSERT( 0==viewer.generation() );
+    CPPUNIT_ASSERT( !viewer.readLatest(snap) );
+    publisher.write(makeFrame(5));
+    CPPUNIT_ASSERT( 1==viewer.generation() );
+    CPPUNIT_ASSERT( viewer.readLatest(snap) );
+    CPPUNIT_ASSERT( 5==snap.frame );
+  }
+  // The publisher unlinks the object when it is destroyed.
+  CPPUNIT_ASSERT_THROW( ShmViewer viewer(channelName()), ShmError );
+}
+
+void ShmChannelTest::testRing()
+{
+  constexpr unsigned SLOTS=8;
+  ShmPublisher publisher(channelName(),SLOTS);
+  ShmViewer viewer(channelName());
+  FrameSnapshot snap;
+
+  for(unsigned i=0;i<SLOTS+3;++i)
+    {
+      publisher.write(makeFrame(i));
+    }
+  // Frames 0-2 have been overwritten, 3-10 are still in the ring.
+  CPPUNIT_ASSERT( !viewer.read(0,snap) );
+  CPPUNIT_ASSERT( !viewer.read(2,snap) );
+  for(unsigned i=3;i<SLOTS+3;++i)
+    {
+      CPPUNIT_ASSERT( viewer.read(i,snap) );
+      CPPUNIT_ASSERT( i==snap.frame );
+    }
+  // Not yet published.
+  CPPUNIT_ASSERT( !viewer.read(SLOTS+3,snap) );
+  CPPUNIT_ASSERT( viewer.readLatest(snap) );
+  CPPUNIT_ASSERT( SLOTS+2==snap.frame );
+}
+
+void ShmChannelTest::testConcurrentViewer()
+{
+  constexpr unsigned FRAMES=100000;
+  ShmPublisher publisher(channelName(),4);
+  ShmViewer viewer(channelName());
+  std::atomic_bool done(false);
+  int failures=0;
+
+  std::thread writer([&publisher,&done]()
+		     {
+		       for(unsigned i=1;i<=FRAMES;++i)
+			 {
+			   publisher.write(makeFrame(i));
+			 }
+		       done=true;
+		     });
+  unsigned previous=0;
+  FrameSnapshot snap;
+  while(!done)
+    {
+      if(viewer.readLatest(snap))
+	{
+	  if(!consistent(snap) || snap.frame<previous)
+	    {
+	      ++failures;
+	    }
+	  previous=snap.frame;
+	}
+    }
+  writer.join();
+
+  CPPUNIT_ASSERT( 0==failures );
+  CPPUNIT_ASSERT( viewer.readLatest(snap) );
+  CPPUNIT_ASSERT( FRAMES==snap.frame );
+}
+
+void ShmChannelTest::testDeadWriter()
+{
+  ShmPublisher publisher(channelName(),4);
+  ShmViewer viewer(channelName());
+  FrameSnapshot snap;
+  publisher.write(makeFrame(1));
+  publisher.write(makeFrame(2));
+  CPPUNIT_ASSERT( viewer.readLatest(snap) && !viewer.stalled() );
+
+  // Leave frame 2's slot half written, as a game killed in write would.
+  const int fd=shm_open(("/"+channelName()).c_str(),O_RDWR,0);
+  CPPUNIT_ASSERT( -1!=fd );
+  const std::size_t offset=(sizeof(ShmHeader)+alignof(ShmSlot)-1)/alignof(ShmSlot)*alignof(ShmSlot)
+    +sizeof(ShmSlot);
+  void *base=mmap(nullptr,offset+sizeof(ShmSlot),PROT_READ|PROT_WRITE,MAP_SHARED,fd,0);
+  close(fd);
+  CPPUNIT_ASSERT( MAP_FAILED!=base );
+  // The sequence number comes first in a slot.
+  std::atomic<unsigned> *sequence=static_cast<std::atomic<unsigned>*>(
+    static_cast<void*>(static_cast<char*>(base)+offset));
+  sequence->fetch_add(1);
+
+  const auto start=std::chrono::steady_clock::now();
+  CPPUNIT_ASSERT( !viewer.readLatest(snap) && viewer.stalled() );
+  CPPUNIT_ASSERT( std::chrono::steady_clock::now()-start<10*ShmViewer::WRITER_TIMEOUT );
+  CPPUNIT_ASSERT( viewer.read(0,snap) && !viewer.stalled() && 1==snap.frame );
+  munmap(base,offset+sizeof(ShmSlot));
+}
@@ -0,0 +1,29 @@
+#ifndef SHMCHANNELTEST_HPP
+#define SHMCHANNELTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ShmChannelTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ShmChannelTest );
+  CPPUNIT_TEST( testAttach );
+  CPPUNIT_TEST( testRing );
+  CPPUNIT_TEST( testConcurrentViewer );
+  CPPUNIT_TEST( testDeadWriter );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Viewers attach only to objects created by a publisher.
+  void testAttach();
+  // Frames are readable until the ring laps them.
+  void testRing();
+  // A viewer reading while the publisher writes never sees a torn frame.
+  void testConcurrentViewer();
+  // A writer that dies in the middle of a frame is reported, not waited on.
+  void testDeadWriter();
+};
+
+#endif // SHMCHANNELTEST_HPP
@@ -0,0 +1,240 @@
+#include "SpectatorStreamTest.hpp"
+#include "SpectatorStream.hpp"
+#include "HeadlessGame.hpp"
+#include "DataDoubleBuffer.hpp"
+
+#include <cstring>
+#include <set>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( SpectatorStreamTest );
+
+inline bool testSameCoords(arrayt a,arrayt b)
+{
+  std::set<coord> ma(a.begin(),a.end()), mb(b.begin(),b.end());
+  return ma==mb;
+}
+
+inline bool sameSnapshot(const FrameSnapshot &a, const FrameSnapshot &b)
+{
+  return 0==std::memcmp(&a,&b,sizeof(FrameSnapshot));
+}
+
+// Feed one encoded message to a view.
+static bool deliver(SpectatorView &view, const NetProtocol::Buffer &message)
+{
+  NetProtocol::MessageHeader h;
+  if(!NetProtocol::getHeader(message.data(),message.size(),h) ||
+     message.size()!=NetProtocol::HEADER_SIZE+h.length)
+    {
+      return false;
+    }
+  return view.apply(h,message.data()+NetProtocol::HEADER_SIZE,h.length);
+}
+
+// Inputs for frame i of a game which moves, turns and drops pieces.
+static std::size_t inputsFor(unsigned i, const PieceInput *&inputs)
+{
+  static const PieceInput pattern[]={shift_left,shift_left,rotate_cw,shift_right,
+				     hard_drop,rotate_ccw,shift_right,shift_right,
+				     hard_drop,shift_left,hard_drop};
+  inputs=pattern+(i/7)%11;
+  return 0==i%7 ? 1 : 0;
+}
+
+void SpectatorStreamTest::setUp()
+{
+}
+
+void SpectatorStreamTest::tearDown()
+{
+}
+
+void SpectatorStreamTest::testRoundTrip()
+{
+  HeadlessGame game(11);
+  SpectatorEncoder encoder;
+  SpectatorView view;
+  const PieceInput *inputs;
+  unsigned i;
+
+  CPPUNIT_ASSERT( !view.synced() );
+  for(i=0;i<3000 && !game.isGameOver();++i)
+    {
+      const std::size_t count=inputsFor(i,inputs);
+      game.step(inputs,count);
+      const FrameSnapshot snap=game.snapshot();
+      CPPUNIT_ASSERT( deliver(view,encoder.encode(snap,i)) );
+      CPPUNIT_ASSERT( view.synced() );
+      CPPUNIT_ASSERT( sameSnapshot(snap,view.snapshot()) );
+      if(0==i%50)
+	{
+	  for(int y=0;y<FIELD_HEIGHT;++y)
+	    {
+	      CPPUNIT_ASSERT( game.getField().getRow(y)==view.getField().getRow(y) );
+	    }
+	  CPPUNIT_ASSERT( testSameCoords(game.getCurrent().getBlocks(),
+					 view.getCurrent().getBlocks()) );
+	}
+    }
+  CPPUNIT_ASSERT( 0<encoder.getKeyframes() );
+  CPPUNIT_ASSERT( encoder.getDeltas()>encoder.getKeyframes()*10 );
+}
+
+void SpectatorStreamTest::testLateJoin()
+{
+  HeadlessGame game(12);
+  SpectatorEncoder encoder(1000);
+  SpectatorView early,late;
+  const PieceInput *inputs;
+  unsigned i;
+
+  for(i=0;i<200;++i)
+    {
+      const std::size_t count=inputsFor(i,inputs);
+      game.step(inputs,count);
+      const NetProtocol::Buffer &message=encoder.encode(game.snapshot(),i);
+      CPPUNIT_ASSERT( deliver(early,message) );
+      if(i>0)
+	{
+	  // Deltas mean nothing to a view which has not synced.
+	  CPPUNIT_ASSERT( deliver(late,message) );
+	  CPPUNIT_ASSERT( !late.synced() );
+	}
+    }
+  CPPUNIT_ASSERT( deliver(late,encoder.keyframe()) );
+  CPPUNIT_ASSERT( late.synced() );
+  CPPUNIT_ASSERT( sameSnapshot(early.snapshot(),late.snapshot()) );
+  for(;i<400 && !game.isGameOver();++i)
+    {
+      const std::size_t count=inputsFor(i,inputs);
+      game.step(inputs,count);
+      const NetProtocol::Buffer &message=encoder.encode(game.snapshot(),i);
+      CPPUNIT_ASSERT( deliver(early,message) );
+      CPPUNIT_ASSERT( deliver(late,message) );
+      CPPUNIT_ASSERT( sameSnapshot(game.snapshot(),late.snapshot()) );
+    }
+  // The first frame and the late joiner's.
+  CPPUNIT_ASSERT( 2==encoder.getKeyframes() );
+}
+
+void SpectatorStreamTest::testLineClear()
+{
+  SpectatorEncoder encoder;
+  SpectatorView view;
+  Field field;
+  NetProtocol::MessageHeader h;
+  int x,y;
+
+  // Four rows full but for the right hand column, under a ragged stack which
+  // also leaves that column open.
+  for(y=0;y<4;++y)
+    {
+      for(x=0;x<FIELD_WIDTH-1;++x)
+	{
+	  field.set(x,y);
+	}
+    }
+  for(y=4;y<9;++y)
+    {
+      for(x=y%3;x<FIELD_WIDTH-1;x+=2)
+	{
+	  field.set(x,y);
+	}
+    }
+  Piece piece(I,0,&field);
+  piece.handleInput(rotate_cw);
+  for(x=0;x<FIELD_WIDTH;++x)
+    {
+      piece.handleInput(shift_right);
+    }
+  const FrameSnapshot prev=FrameSnapshot::encode(field,piece,nullptr,O,0);
+  CPPUNIT_ASSERT( deliver(view,encoder.encode(prev,0)) );
+
+  // The I piece fills the column and all four rows clear.
+  CPPUNIT_ASSERT( piece.handleInput(hard_drop) );
+  CPPUNIT_ASSERT( 4==field.readScore() );
+  const FrameSnapshot cur=FrameSnapshot::encode(field,Piece(O,0,&field),nullptr,L,1);
+  const NetProtocol::Buffer &message=encoder.encode(cur,1);
+  CPPUNIT_ASSERT( NetProtocol::getHeader(message.data(),message.size(),h) );
+  CPPUNIT_ASSERT( NetProtocol::SPECTATE_DELTA==h.type );
+  // The stack falls as a whole, so no rows are sent.
+  CPPUNIT_ASSERT( (SpectatorStream::CLEARED|SpectatorStream::PIECE|
+		   SpectatorStream::SCORE|SpectatorStream::STATE)==
+		  (unsigned char)message[NetProtocol::HEADER_SIZE] );
+  CPPUNIT_ASSERT( 1+4+4+4+3==h.length );
+  CPPUNIT_ASSERT( deliver(view,message) );
+  CPPUNIT_ASSERT( sameSnapshot(cur,view.snapshot()) );
+  for(y=0;y<FIELD_HEIGHT;++y)
+    {
+      CPPUNIT_ASSERT( field.getRow(y)==view.getField().getRow(y) );
+    }
+}
+
+void SpectatorStreamTest::testMalformed()
+{
+  HeadlessGame game(13);
+  SpectatorEncoder encoder;
+  SpectatorView view;
+  NetProtocol::MessageHeader h;
+
+  CPPUNIT_ASSERT( deliver(view,encoder.encode(game.snapshot(),0)) );
+  game.step();
+  NetProtocol::Buffer message=encoder.encode(game.snapshot(),1);
+  NetProtocol::getHeader(message.data(),message.size(),h);
+  CPPUNIT_ASSERT( NetProtocol::SPECTATE_DELTA==h.type );
+  const char *body=message.data()+NetProtocol::HEADER_SIZE;
+  CPPUNIT_ASSERT( !view.apply(h,body,h.length-1) );
+  CPPUNIT_ASSERT( !view.synced() );
+  CPPUNIT_ASSERT( view.apply(h,body,h.length) );
+  CPPUNIT_ASSERT( !view.synced() );
+  // Unknown parts.
+  message[NetProtocol::HEADER_SIZE]=(char)0x80;
+  CPPUNIT_ASSERT( deliver(view,encoder.keyframe()) );
+  CPPUNIT_ASSERT( view.synced() );
+  CPPUNIT_ASSERT( !view.apply(h,body,h.length) );
+  CPPUNIT_ASSERT( !view.synced() );
+
+  // Piece types out of range, in a keyframe and in each delta part that
+  // carries one, are rejected before they reach the snapshot.
+  NetProtocol::Buffer key=encoder.keyframe();
+  NetProtocol::getHeader(key.data(),key.size(),h);
+  CPPUNIT_ASSERT( NetProtocol::SPECTATE_KEY==h.type );
+  key[NetProtocol::HEADER_SIZE+4*FrameSnapshot::ROW_WORDS]=7;
+  CPPUNIT_ASSERT( !deliver(view,key) );
+  CPPUNIT_ASSERT( !view.synced() && view.snapshot().type<7 );
+  key[NetProtocol::HEADER_SIZE+4*FrameSnapshot::ROW_WORDS+5]=(char)0xff;
+  CPPUNIT_ASSERT( !deliver(view,key) );
+  CPPUNIT_ASSERT( deliver(view,encoder.keyframe()) );
+  h.type=NetProtocol::SPECTATE_DELTA;
+  const char piece[]={SpectatorStream::PIECE,9,0,4,4};
+  CPPUNIT_ASSERT( !view.apply(h,piece,sizeof(piece)) );
+  CPPUNIT_ASSERT( !view.synced() && view.snapshot().type<7 );
+  CPPUNIT_ASSERT( deliver(view,encoder.keyframe()) );
+  const char state[]={SpectatorStream::STATE,0,7,0};
+  CPPUNIT_ASSERT( !view.apply(h,state,sizeof(state)) );
+  CPPUNIT_ASSERT( !view.synced() && view.snapshot().hold<7 );
+}
+
+void SpectatorStreamTest::testBandwidth()
+{
+  HeadlessGame game(14);
+  SpectatorEncoder encoder;
+  const PieceInput *inputs;
+  unsigned long bytes=0,frames=0;
+  unsigned i;
+
+  for(i=0;i<3600;++i)
+    {
+      const std::size_t count=inputsFor(i,inputs);
+      if(game.step(inputs,count))
+	{
+	  game.reset(i);
+	  encoder.reset();
+	}
+      bytes+=encoder.encode(game.snapshot(),i).size();
+      ++frames;
+    }
+  // Headers included.
+  CPPUNIT_ASSERT( bytes*10 < frames*sizeof(DataBuffer) );
+}
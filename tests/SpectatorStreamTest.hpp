@@ -0,0 +1,34 @@
+#ifndef SPECTATORSTREAMTEST_HPP
+#define SPECTATORSTREAMTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class SpectatorStreamTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( SpectatorStreamTest );
+  CPPUNIT_TEST( testRoundTrip );
+  CPPUNIT_TEST( testLateJoin );
+  CPPUNIT_TEST( testLineClear );
+  CPPUNIT_TEST( testMalformed );
+  CPPUNIT_TEST( testBandwidth );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Every frame of a game decodes to the encoded snapshot, and the rebuilt
+  // Field and Piece match the game's.
+  void testRoundTrip();
+  // A view which starts from keyframe() in mid-game stays in sync, and deltas
+  // before the first keyframe are ignored.
+  void testLateJoin();
+  // A line clear is sent as a clear, not as every row above it.
+  void testLineClear();
+  // A malformed message unsyncs the view until the next keyframe.
+  void testMalformed();
+  // The stream costs under a tenth of sending a DataBuffer every frame.
+  void testBandwidth();
+};
+
+#endif // SPECTATORSTREAMTEST_HPP
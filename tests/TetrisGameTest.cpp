@@ -3,6 +3,14 @@
 #include "PieceDummy.hpp"
 #include "Field.hpp"
 #include "Piece.hpp"
+#include "FrameSnapshot.hpp"
+#include "SeqlockBuffer.hpp"
+#include "Replay.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <unistd.h>
 // Registers the fixture
 CPPUNIT_TEST_SUITE_REGISTRATION( TetrisGameTest );
 
@@ -154,9 +162,110 @@ void TetrisGameTest::testExceptions()
   game.run();
 
   CPPUNIT_ASSERT_THROW(game.setRenderer(&dummyRenderFunctor) , GameRunningError);
+  CPPUNIT_ASSERT_THROW(game.setPublisher(nullptr) , GameRunningError);
   CPPUNIT_ASSERT_THROW(game.run() , GameRunningError);
 }
 
+void TetrisGameTest::testPublisher()
+{
+  Seqlock<FrameSnapshot> slot;
+  SnapshotFunc<Seqlock<FrameSnapshot>> publisher(&slot,&Seqlock<FrameSnapshot>::write);
+  Seqlock<FrameSnapshot>::Reader reader(slot);
+  TetrisGame game;
+
+  CPPUNIT_ASSERT_NO_THROW(game.setPublisher(&publisher));
+  game.run();
+#ifdef HAVE_STDCXX_SYNCH
+  std::this_thread::sleep_for(duration_frames(10));
+#else // HAVE_STDCXX_SYNCH
+#error NYI
+#endif // HAVE_STDCXX_SYNCH
+  game.pause();
+
+  // One snapshot per frame, numbered from one.
+  const FrameSnapshot &snap=reader.read();
+  CPPUNIT_ASSERT( 0 < reader.version() );
+  CPPUNIT_ASSERT( reader.version() == snap.frame );
+  CPPUNIT_ASSERT( snap.active() );
+  CPPUNIT_ASSERT( !(snap.flags & FrameSnapshot::GAME_OVER) );
+}
+
+void TetrisGameTest::testRecorder()
+{
+  const std::string path="/tmp/TetrisGameTest."+std::to_string(getpid())+".rep";
+  unlink(path.c_str());
+  {
+    AsyncWriter writer(path);
+    AsyncWriter::Stream *stream=writer.open();
+    {
+      TetrisGame game;
+      CPPUNIT_ASSERT_NO_THROW(game.setRecorder(stream));
+      game.run();
+      CPPUNIT_ASSERT_THROW(game.setRecorder(stream) , GameRunningError);
+      game.queueInput(shift_left);
+      game.queueInput(hard_drop);
+#ifdef HAVE_STDCXX_SYNCH
+      std::this_thread::sleep_for(duration_frames(10));
+#else // HAVE_STDCXX_SYNCH
+#error NYI
+#endif // HAVE_STDCXX_SYNCH
+      game.pause();
+      CPPUNIT_ASSERT_THROW(game.setRecorder(stream) , GameRunningError);
+    }
+    writer.flush();
+    CPPUNIT_ASSERT( 1==writer.getStats().records );
+  }
+
+  // One record: its header, the events, then the keyframes.
+  std::ifstream in(path,std::ios::binary);
+  const std::vector<char> data((std::istreambuf_iterator<char>(in)),
+			       std::istreambuf_iterator<char>());
+  unlink(path.c_str());
+  std::uint32_t header[3],keyframes[2];
+  CPPUNIT_ASSERT( ReplayWriter::RECORD_SIZE<=data.size() );
+  std::memcpy(header,data.data(),sizeof(header));
+  std::memcpy(keyframes,data.data()+24,sizeof(keyframes));
+  CPPUNIT_ASSERT( ReplayWriter::RECORD_SIZE+header[0]+keyframes[1]*sizeof(ReplayKeyframe)
+		  ==data.size() );
+  CPPUNIT_ASSERT( 0<header[1] );
+  CPPUNIT_ASSERT( shift_left==data[ReplayWriter::RECORD_SIZE] );
+  CPPUNIT_ASSERT( hard_drop==data[ReplayWriter::RECORD_SIZE+1] );
+}
+
+void TetrisGameTest::testImmediateInput()
+{
+  Seqlock<FrameSnapshot> slot;
+  SnapshotFunc<Seqlock<FrameSnapshot>> publisher(&slot,&Seqlock<FrameSnapshot>::write);
+  Seqlock<FrameSnapshot>::Reader reader(slot);
+  TetrisGame game;
+
+  CPPUNIT_ASSERT_NO_THROW(game.setPublisher(&publisher));
+  CPPUNIT_ASSERT_NO_THROW(game.setImmediateInput(true));
+  game.run();
+  CPPUNIT_ASSERT_THROW(game.setImmediateInput(false) , GameRunningError);
+#ifdef HAVE_STDCXX_SYNCH
+  std::this_thread::sleep_for(duration_frames(3));
+  // Just after a frame is published.
+  const unsigned published=slot.version();
+  while(slot.version()==published)
+    {
+      std::this_thread::yield();
+    }
+  const std::uint32_t frame=reader.read().frame;
+  const unsigned version=reader.version();
+  game.queueInput(shift_left);
+  while(slot.version()==version)
+    {
+      std::this_thread::yield();
+    }
+#else // HAVE_STDCXX_SYNCH
+#error NYI
+#endif // HAVE_STDCXX_SYNCH
+  CPPUNIT_ASSERT( frame==reader.read().frame );
+  game.pause();
+  CPPUNIT_ASSERT( PieceDummy::compare_handleInput_arg(std::vector<PieceInput>(1,shift_left)) );
+}
+
 void TetrisGameTest::dummyRenderCallback(const Field &afield, const Piece & curr, 
 					 const Piece * ghost)
 {
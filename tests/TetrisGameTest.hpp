@@ -19,6 +19,9 @@ class TetrisGameTest: public CppUnit::TestFixture
   CPPUNIT_TEST( whitebox_testRunCallback );
   CPPUNIT_TEST( whitebox_testInput );
   CPPUNIT_TEST( testExceptions );
+  CPPUNIT_TEST( testPublisher );
+  CPPUNIT_TEST( testRecorder );
+  CPPUNIT_TEST( testImmediateInput );
   CPPUNIT_TEST_SUITE_END();
 
 public:
@@ -30,6 +33,13 @@ public:
   void whitebox_testRunCallback();
   void whitebox_testInput();
   void testExceptions();
+  void testPublisher();
+  // A recorded game is appended to the stream as a replay record when the
+  // game is destroyed.
+  void testRecorder();
+  // With immediate input, an input queued just after a frame is applied and
+  // published before the next frame.
+  void testImmediateInput();
 
   static void dummyRenderCallback(const Field &, const Piece &, const Piece *);
 protected:
@@ -0,0 +1,209 @@
+#include "TournamentTest.hpp"
+#include "Tournament.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( TournamentTest );
+
+// Short matches between bots without preview keep the tests quick.
+static const unsigned FRAMES=900;
+
+static Tournament::Entrant entrant(const std::string &line)
+{
+  Tournament::Entrant e;
+  CPPUNIT_ASSERT( e.parse(line) );
+  return e;
+}
+
+static std::vector<Tournament::Entrant> field(unsigned count)
+{
+  const char *lines[]={"a nopreview","b nopreview wells -2","c nopreview holes -12",
+		       "d nopreview bumpiness -1","e nopreview delay 1"};
+  std::vector<Tournament::Entrant> ret;
+  for(unsigned i=0;i<count;++i)
+    {
+      ret.push_back(entrant(lines[i%5]));
+    }
+  return ret;
+}
+
+// A match between a and b with a won score.
+static Tournament::Match result(unsigned a, unsigned b, double score)
+{
+  Tournament::Match m;
+  m.number=m.round=0;
+  m.a=a;
+  m.b=b;
+  m.seed=0;
+  m.score=score;
+  m.frames=m.sentA=m.sentB=0;
+  m.checksum=0;
+  return m;
+}
+
+void TournamentTest::setUp()
+{
+}
+
+void TournamentTest::tearDown()
+{
+}
+
+void TournamentTest::testParse()
+{
+  Tournament::Entrant e;
+  CPPUNIT_ASSERT( e.parse("plain") );
+  CPPUNIT_ASSERT( "plain"==e.name && e.preview && 0==e.delay );
+  CPPUNIT_ASSERT( std::equal(e.weights.w,e.weights.w+Evaluator::FEATURE_COUNT,
+			     Evaluator::Weights::defaults().w) );
+  CPPUNIT_ASSERT( e.parse("tuned nopreview delay 2 lines 1.5 holes -3") );
+  CPPUNIT_ASSERT( "tuned"==e.name && !e.preview && 2==e.delay );
+  CPPUNIT_ASSERT( 1.5f==e.weights.w[Evaluator::LINES] && -3.0f==e.weights.w[Evaluator::HOLES] );
+  CPPUNIT_ASSERT( Evaluator::Weights::defaults().w[Evaluator::LANDING]
+		  ==e.weights.w[Evaluator::LANDING] );
+  CPPUNIT_ASSERT( !e.parse("") );
+  CPPUNIT_ASSERT( !e.parse("x delay") );
+  CPPUNIT_ASSERT( !e.parse("x holes") );
+  CPPUNIT_ASSERT( !e.parse("x speed 3") );
+}
+
+void TournamentTest::testMatch()
+{
+  const Tournament::Entrant good=entrant("good nopreview"),
+    bad=entrant("bad nopreview holes 5");
+  Tournament::Match first=result(0,1,0),again=result(0,1,0);
+  first.seed=again.seed=77;
+  Tournament::play(good,bad,FRAMES,first);
+  Tournament::play(good,bad,FRAMES,again);
+  CPPUNIT_ASSERT( 1==first.score );
+  CPPUNIT_ASSERT( first.frames<FRAMES );
+  CPPUNIT_ASSERT( first.checksum==again.checksum && first.frames==again.frames );
+  CPPUNIT_ASSERT( first.sentA==again.sentA && first.sentB==again.sentB );
+  CPPUNIT_ASSERT( first.sentA>first.sentB );
+}
+
+void TournamentTest::testRoundRobin()
+{
+  const std::vector<Tournament::Entrant> entrants=field(4);
+  WorkerPool one(1),three(3);
+  Tournament a(entrants,5,FRAMES),b(entrants,5,FRAMES);
+  unsigned heard=0;
+  a.setListener([&](const Tournament::Match &)
+		{
+		  ++heard;
+		});
+  a.playRoundRobin(one,1);
+  b.playRoundRobin(three,1);
+
+  // Rounded up to two games per pair.
+  CPPUNIT_ASSERT( 12==a.getMatches().size() && 12==heard );
+  for(std::size_t i=0;i<a.getMatches().size();++i)
+    {
+      const Tournament::Match &m=a.getMatches()[i],&n=b.getMatches()[i];
+      CPPUNIT_ASSERT( i==m.number );
+      CPPUNIT_ASSERT( m.a==n.a && m.b==n.b && m.seed==n.seed );
+      CPPUNIT_ASSERT( m.score==n.score && m.checksum==n.checksum );
+      if(i%2)
+	{
+	  const Tournament::Match &pair=a.getMatches()[i-1];
+	  CPPUNIT_ASSERT( pair.a==m.b && pair.b==m.a && pair.seed==m.seed );
+	}
+    }
+  double total=0;
+  for(double p : a.getPoints())
+    {
+      total+=p;
+    }
+  CPPUNIT_ASSERT( 12==total );
+  CPPUNIT_ASSERT( a.getPoints()==b.getPoints() );
+}
+
+void TournamentTest::testSwiss()
+{
+  const std::vector<Tournament::Entrant> entrants=field(5);
+  WorkerPool pool(2);
+  Tournament t(entrants,9,300);
+  t.playSwiss(pool,3,2);
+
+  // Two pairings of two games a round, and a different entrant sits out each
+  // round.
+  CPPUNIT_ASSERT( 12==t.getMatches().size() );
+  std::vector<unsigned> played(5*3,0);
+  for(const Tournament::Match &m : t.getMatches())
+    {
+      ++played[m.round*5+m.a];
+      ++played[m.round*5+m.b];
+    }
+  std::vector<unsigned> sat;
+  for(unsigned r=0;r<3;++r)
+    {
+      for(unsigned i=0;i<5;++i)
+	{
+	  CPPUNIT_ASSERT( 0==played[r*5+i] || 2==played[r*5+i] );
+	  if(0==played[r*5+i])
+	    {
+	      sat.push_back(i);
+	    }
+	}
+    }
+  CPPUNIT_ASSERT( 3==sat.size() );
+  std::sort(sat.begin(),sat.end());
+  CPPUNIT_ASSERT( std::unique(sat.begin(),sat.end())==sat.end() );
+
+  // No pair meets twice in the first two rounds.
+  for(std::size_t i=0;i<8;i+=2)
+    {
+      for(std::size_t j=i+2;j<8;j+=2)
+	{
+	  const Tournament::Match &m=t.getMatches()[i],&n=t.getMatches()[j];
+	  CPPUNIT_ASSERT( !(std::min(m.a,m.b)==std::min(n.a,n.b)
+			    && std::max(m.a,m.b)==std::max(n.a,n.b)) );
+	}
+    }
+  double total=0;
+  for(double p : t.getPoints())
+    {
+      total+=p;
+    }
+  // Each bye counts as two won games.
+  CPPUNIT_ASSERT( 12+3*2==total );
+}
+
+void TournamentTest::testRatings()
+{
+  // 0 beats 1 three times in four, 1 and 2 draw, and 3 beats everyone.
+  std::vector<Tournament::Match> list;
+  for(int k=0;k<4;++k)
+    {
+      list.push_back(result(0,1,k<3 ? 1 : 0));
+      list.push_back(result(1,2,0.5));
+      list.push_back(result(3,k%3,1));
+    }
+  const std::vector<double> elo=Tournament::fit(4,list);
+  CPPUNIT_ASSERT( elo[3]>elo[0] && elo[0]>elo[1] );
+  CPPUNIT_ASSERT( std::isfinite(elo[3]) && elo[3]<1000 );
+  double sum=0;
+  for(double e : elo)
+    {
+      sum+=e;
+    }
+  CPPUNIT_ASSERT( std::fabs(sum)<1e-6 );
+  // More of the same results make the gap wider.
+  std::vector<Tournament::Match> twice=list;
+  twice.insert(twice.end(),list.begin(),list.end());
+  CPPUNIT_ASSERT( Tournament::fit(4,twice)[0]-Tournament::fit(4,twice)[1]>elo[0]-elo[1] );
+
+  const std::vector<Tournament::Entrant> entrants=field(2);
+  WorkerPool pool(1);
+  Tournament t(entrants,3,300);
+  t.playRoundRobin(pool,4);
+  const std::vector<Tournament::Rating> ratings=t.ratings(100);
+  for(const Tournament::Rating &r : ratings)
+    {
+      CPPUNIT_ASSERT( 4==r.games );
+      CPPUNIT_ASSERT( r.low<=r.elo+1e-9 && r.elo<=r.high+1e-9 );
+    }
+  CPPUNIT_ASSERT( 4==ratings[0].points+ratings[1].points );
+}
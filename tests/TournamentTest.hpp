@@ -0,0 +1,34 @@
+#ifndef TOURNAMENTTEST_HPP
+#define TOURNAMENTTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TournamentTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( TournamentTest );
+  CPPUNIT_TEST( testParse );
+  CPPUNIT_TEST( testMatch );
+  CPPUNIT_TEST( testRoundRobin );
+  CPPUNIT_TEST( testSwiss );
+  CPPUNIT_TEST( testRatings );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  void testParse();
+  // A match played again from its seed ends the same, and a bot that seeks
+  // out holes loses.
+  void testMatch();
+  // Every pair plays, from shared seeds with the sides swapped, and the
+  // results do not depend on the number of threads.
+  void testRoundRobin();
+  // Pairings avoid rematches and byes go round.
+  void testSwiss();
+  // Ratings follow the results, stay finite for an unbeaten record, and
+  // their intervals hold them.
+  void testRatings();
+};
+
+#endif // TOURNAMENTTEST_HPP
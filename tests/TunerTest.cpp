@@ -0,0 +1,106 @@
+#include "TunerTest.hpp"
+#include "Tuner.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+
+#include <unistd.h>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( TunerTest );
+
+static Tuner::Settings small()
+{
+  Tuner::Settings s;
+  s.population=8;
+  s.elite=3;
+  s.games=2;
+  s.pieces=60;
+  s.seed=5;
+  return s;
+}
+
+static bool sameWeights(const Evaluator::Weights &a, const Evaluator::Weights &b)
+{
+  return std::equal(a.w,a.w+Evaluator::FEATURE_COUNT,b.w);
+}
+
+void TunerTest::setUp()
+{
+}
+
+void TunerTest::tearDown()
+{
+}
+
+void TunerTest::testPlay()
+{
+  Evaluator::Weights zero;
+  std::fill(zero.w,zero.w+Evaluator::FEATURE_COUNT,0.0f);
+  const Evaluator::Weights good=Evaluator::Weights::defaults();
+
+  CPPUNIT_ASSERT( Tuner::play(good,3,300)==Tuner::play(good,3,300) );
+  CPPUNIT_ASSERT( Tuner::play(good,3,300)>100 );
+  CPPUNIT_ASSERT( Tuner::play(good,3,300)>Tuner::play(zero,3,300) );
+  CPPUNIT_ASSERT( 0==Tuner::play(good,3,0) );
+  CPPUNIT_ASSERT( std::string("holes")==Tuner::featureName(Evaluator::HOLES) );
+}
+
+void TunerTest::testThreads()
+{
+  WorkerPool one(1), three(3);
+  Tuner a(one,small()), b(three,small());
+  unsigned i;
+
+  for(i=0;i<3;++i)
+    {
+      const Tuner::Generation &ga=a.step(), &gb=b.step();
+      CPPUNIT_ASSERT( i+1==ga.number && i+1==gb.number );
+      CPPUNIT_ASSERT( ga.meanScore==gb.meanScore );
+      CPPUNIT_ASSERT( ga.bestScore==gb.bestScore );
+      CPPUNIT_ASSERT( ga.bestScore>=ga.eliteScore && ga.eliteScore>=ga.meanScore );
+      CPPUNIT_ASSERT( sameWeights(ga.best,gb.best) );
+      CPPUNIT_ASSERT( sameWeights(a.getMean(),b.getMean()) );
+    }
+  CPPUNIT_ASSERT( 3*8*2==a.getGamesPlayed() );
+  CPPUNIT_ASSERT( !sameWeights(a.getMean(),Evaluator::Weights::defaults()) );
+}
+
+void TunerTest::testCheckpoint()
+{
+  const std::string path="/tmp/TunerTest."+std::to_string(getpid())+".txt";
+  WorkerPool pool(2);
+  Tuner straight(pool,small()), first(pool,small()), second(pool,small());
+
+  CPPUNIT_ASSERT( !second.load(path) );
+  straight.step();
+  straight.step();
+  straight.step();
+  first.step();
+  first.step();
+  first.save(path);
+  CPPUNIT_ASSERT( second.load(path) );
+  CPPUNIT_ASSERT( 2==second.getGeneration() );
+  CPPUNIT_ASSERT( 2*8*2==second.getGamesPlayed() );
+  CPPUNIT_ASSERT( sameWeights(first.getMean(),second.getMean()) );
+  CPPUNIT_ASSERT( first.getSigma()==second.getSigma() );
+  second.step();
+  CPPUNIT_ASSERT( sameWeights(straight.getMean(),second.getMean()) );
+  CPPUNIT_ASSERT( straight.getSigma()==second.getSigma() );
+
+  // Another seed is another run.
+  Tuner::Settings other=small();
+  other.seed=6;
+  Tuner third(pool,other);
+  CPPUNIT_ASSERT_THROW( third.load(path), CheckpointError );
+
+  // So is anything cut short.
+  {
+    std::ofstream out(path.c_str(),std::ios::trunc);
+    out << "tetris_tune 1\nsettings 8 3 2 60 5 2 1 0\ngeneration 2 32\nlines 1 1\n";
+  }
+  CPPUNIT_ASSERT_THROW( second.load(path), CheckpointError );
+  std::remove(path.c_str());
+}
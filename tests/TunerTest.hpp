@@ -0,0 +1,27 @@
+#ifndef TUNERTEST_HPP
+#define TUNERTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class TunerTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( TunerTest );
+  CPPUNIT_TEST( testPlay );
+  CPPUNIT_TEST( testThreads );
+  CPPUNIT_TEST( testCheckpoint );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // A game's score depends only on the weights and the seed, and good
+  // weights beat bad ones.
+  void testPlay();
+  // A run gives the same weights with any number of threads.
+  void testThreads();
+  // A run resumed from a checkpoint ends where an unbroken one does.
+  void testCheckpoint();
+};
+
+#endif // TUNERTEST_HPP
@@ -0,0 +1,146 @@
+#include "ValueNetTest.hpp"
+#include "ValueNet.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <unistd.h>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( ValueNetTest );
+
+static bool near(float a, float b)
+{
+  return std::fabs(a-b)<=1e-4f*(1+std::fabs(a));
+}
+
+// Input rows for the boards along a game played by a Bot.
+static std::vector<float> rows(unsigned count)
+{
+  std::vector<float> ret(count*ValueNet::STRIDE);
+  HeadlessGame game(11);
+  Bot bot(Evaluator::Weights::defaults(),false);
+  PieceInput inputs[MoveList::MAX_PATH];
+  for(unsigned i=0;i<count;++i)
+    {
+      game.step(inputs,bot.plan(game,inputs,MoveList::MAX_PATH));
+      ValueNet::encode(Bitboard::fromField(game.getField()),i%3,i%7,&ret[i*ValueNet::STRIDE]);
+    }
+  return ret;
+}
+
+void ValueNetTest::setUp()
+{
+}
+
+void ValueNetTest::tearDown()
+{
+}
+
+void ValueNetTest::testKernels()
+{
+  const unsigned COUNT=37;
+  const std::vector<float> in=rows(COUNT);
+  ValueNet net({29,16,3},5);
+  float batch[COUNT],scalar[COUNT],one;
+
+  net.setKernel(ValueNet::SCALAR);
+  CPPUNIT_ASSERT( ValueNet::SCALAR==net.getKernel() );
+  net.evaluate(in.data(),COUNT,scalar);
+  for(unsigned i=0;i<COUNT;++i)
+    {
+      net.evaluate(&in[i*ValueNet::STRIDE],1,&one);
+      CPPUNIT_ASSERT( one==scalar[i] );
+    }
+
+  net.setKernel(ValueNet::AVX2);
+  CPPUNIT_ASSERT( ValueNet::haveAvx2()==(ValueNet::AVX2==net.getKernel()) );
+  for(unsigned n : {1u,2u,3u,COUNT})
+    {
+      net.evaluate(in.data(),n,batch);
+      for(unsigned i=0;i<n;++i)
+	{
+	  CPPUNIT_ASSERT( near(batch[i],scalar[i]) );
+	}
+    }
+  // Not every output is the same.
+  CPPUNIT_ASSERT( scalar[0]!=scalar[COUNT-1] );
+}
+
+void ValueNetTest::testLinear()
+{
+  const Evaluator::Weights w=Evaluator::Weights::defaults();
+  const unsigned COUNT=20;
+  const std::vector<float> in=rows(COUNT);
+  float out[COUNT];
+  for(const std::vector<unsigned> &hidden : {std::vector<unsigned>(),std::vector<unsigned>{8},
+					     std::vector<unsigned>{64,32}})
+    {
+      ValueNet net=ValueNet::linear(w,hidden);
+      net.evaluate(in.data(),COUNT,out);
+      for(unsigned i=0;i<COUNT;++i)
+	{
+	  const float *row=&in[i*ValueNet::STRIDE];
+	  float expected=0;
+	  for(unsigned f=0;f<Evaluator::FEATURE_COUNT;++f)
+	    {
+	      expected+=w.w[f]*row[FIELD_SIZE+f];
+	    }
+	  CPPUNIT_ASSERT( near(out[i],expected) );
+	}
+    }
+  CPPUNIT_ASSERT_THROW( ValueNet::linear(w,{1}), ModelError );
+
+  // The scalar kernel adds in the evaluator's order, so ties break alike.
+  ValueNet net=ValueNet::linear(w,{16});
+  net.setKernel(ValueNet::SCALAR);
+  NetBot netBot(net);
+  Bot bot(w,false);
+  HeadlessGame game(4);
+  PieceInput a[MoveList::MAX_PATH],b[MoveList::MAX_PATH];
+  for(int i=0;i<300 && !game.isGameOver();++i)
+    {
+      const std::size_t n=netBot.plan(game,a,MoveList::MAX_PATH);
+      CPPUNIT_ASSERT( n>0 && n==bot.plan(game,b,MoveList::MAX_PATH) );
+      CPPUNIT_ASSERT( std::equal(a,a+n,b) );
+      game.step(a,n);
+    }
+  CPPUNIT_ASSERT( !game.isGameOver() && game.getField().readScore()>100 );
+}
+
+void ValueNetTest::testFile()
+{
+  const std::string path="/tmp/ValueNetTest."+std::to_string(getpid())+".net";
+  const unsigned COUNT=9;
+  const std::vector<float> in=rows(COUNT);
+  float before[COUNT],after[COUNT];
+  ValueNet net({12,5},77);
+  net.evaluate(in.data(),COUNT,before);
+  net.save(path);
+  ValueNet loaded(path);
+  CPPUNIT_ASSERT( net.getSizes()==loaded.getSizes() );
+  loaded.evaluate(in.data(),COUNT,after);
+  CPPUNIT_ASSERT( std::equal(before,before+COUNT,after) );
+
+  // Cut short, then with a bad first size, then with layers far bigger
+  // than the file, then not a net at all.
+  std::ifstream file(path.c_str(),std::ios::binary);
+  std::string data((std::istreambuf_iterator<char>(file)),std::istreambuf_iterator<char>());
+  file.close();
+  std::ofstream(path.c_str(),std::ios::binary) << data.substr(0,data.size()-1);
+  CPPUNIT_ASSERT_THROW( (void)ValueNet(path), ModelError );
+  std::string bad=data;
+  bad[12]=1;
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  CPPUNIT_ASSERT_THROW( (void)ValueNet(path), ModelError );
+  bad=data;
+  bad[16]=bad[20]=0;
+  bad[18]=bad[22]=1;
+  std::ofstream(path.c_str(),std::ios::binary) << bad;
+  CPPUNIT_ASSERT_THROW( (void)ValueNet(path), ModelError );
+  std::ofstream(path.c_str(),std::ios::binary) << "hello";
+  CPPUNIT_ASSERT_THROW( (void)ValueNet(path), ModelError );
+  std::remove(path.c_str());
+  CPPUNIT_ASSERT_THROW( (void)ValueNet(path), ModelError );
+}
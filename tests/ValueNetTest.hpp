@@ -0,0 +1,28 @@
+#ifndef VALUENETTEST_HPP
+#define VALUENETTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class ValueNetTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( ValueNetTest );
+  CPPUNIT_TEST( testKernels );
+  CPPUNIT_TEST( testLinear );
+  CPPUNIT_TEST( testFile );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // Batches of any size score as rows one at a time, and the AVX2 kernel
+  // agrees with the scalar one.
+  void testKernels();
+  // A linear net scores as the evaluator, and a NetBot with it plays as a
+  // Bot without preview.
+  void testLinear();
+  // Saved nets load with the same scores, and damaged files are refused.
+  void testFile();
+};
+
+#endif // VALUENETTEST_HPP
@@ -0,0 +1,145 @@
+#include "WorkerPoolTest.hpp"
+#include "WorkerPool.hpp"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+
+// Registers the fixture into the 'registry'
+CPPUNIT_TEST_SUITE_REGISTRATION( WorkerPoolTest );
+
+void WorkerPoolTest::setUp()
+{
+}
+
+void WorkerPoolTest::tearDown()
+{
+}
+
+void WorkerPoolTest::testSize()
+{
+  WorkerPool one(1), four(4), automatic;
+  const std::thread::id caller=std::this_thread::get_id();
+  bool elsewhere=false;
+  auto check=[&](std::size_t)
+    {
+      elsewhere=elsewhere || std::this_thread::get_id()!=caller;
+    };
+
+  CPPUNIT_ASSERT( 1==one.size() );
+  CPPUNIT_ASSERT( 4==four.size() );
+  CPPUNIT_ASSERT( 1<=automatic.size() );
+  one.run(100,check);
+  CPPUNIT_ASSERT( !elsewhere );
+}
+
+void WorkerPoolTest::testEveryIndex()
+{
+  const std::size_t count=1000;
+  WorkerPool pool(4);
+  std::atomic<unsigned> hits[count];
+  unsigned run,i;
+
+  for(i=0;i<count;++i)
+    {
+      hits[i]=0;
+    }
+  auto task=[&](std::size_t n)
+    {
+      hits[n].fetch_add(1);
+    };
+  for(run=1;run<=50;++run)
+    {
+      pool.run(count,task);
+      for(i=0;i<count;++i)
+	{
+	  CPPUNIT_ASSERT( run==hits[i] );
+	}
+    }
+  // Nothing to do is fine too.
+  pool.run(0,task);
+  CPPUNIT_ASSERT( 50==hits[0] );
+}
+
+void WorkerPoolTest::testException()
+{
+  WorkerPool pool(3);
+  std::atomic<unsigned> done(0);
+  auto task=[&](std::size_t n)
+    {
+      if(7==n)
+	{
+	  throw std::runtime_error("seven");
+	}
+      done.fetch_add(1);
+    };
+  CPPUNIT_ASSERT_THROW( pool.run(100,task), std::runtime_error );
+  // The other tasks still ran.
+  CPPUNIT_ASSERT( 99==done );
+
+  done=0;
+  auto fine=[&](std::size_t)
+    {
+      done.fetch_add(1);
+    };
+  CPPUNIT_ASSERT_NO_THROW( pool.run(100,fine) );
+  CPPUNIT_ASSERT( 100==done );
+}
+
+void WorkerPoolTest::testStealing()
+{
+  const std::size_t count=1000;
+  WorkerPool one(1), pool(4);
+  const std::thread::id caller=std::this_thread::get_id();
+  std::atomic<unsigned> hits[count];
+  std::atomic<bool> badThread(false);
+  unsigned run,i;
+
+  for(i=0;i<count;++i)
+    {
+      hits[i]=0;
+    }
+  auto task=[&](std::size_t n, unsigned thread)
+    {
+      if(thread>=pool.size() || (0==thread)!=(std::this_thread::get_id()==caller))
+	{
+	  badThread=true;
+	}
+      // All of the slow tasks are at the front, in the caller's range.
+      if(n<count/8)
+	{
+	  std::this_thread::sleep_for(std::chrono::microseconds(20));
+	}
+      hits[n].fetch_add(1);
+    };
+  for(run=1;run<=20;++run)
+    {
+      pool.runStealing(count,task);
+      for(i=0;i<count;++i)
+	{
+	  CPPUNIT_ASSERT( run==hits[i] );
+	}
+    }
+  CPPUNIT_ASSERT( !badThread );
+  CPPUNIT_ASSERT( pool.getSteals()>0 );
+
+  // Fewer tasks than threads, and a pool of one.
+  pool.runStealing(2,task);
+  CPPUNIT_ASSERT( 21==hits[0] && 21==hits[1] && 20==hits[2] );
+  unsigned threads=0;
+  one.runStealing(100,[&](std::size_t, unsigned thread)
+		  {
+		    threads|=1u<<thread;
+		  });
+  CPPUNIT_ASSERT( 1==threads );
+  CPPUNIT_ASSERT( 0==one.getSteals() );
+
+  auto thrower=[&](std::size_t n, unsigned)
+    {
+      if(500==n)
+	{
+	  throw std::runtime_error("five hundred");
+	}
+    };
+  CPPUNIT_ASSERT_THROW( pool.runStealing(count,thrower), std::runtime_error );
+}
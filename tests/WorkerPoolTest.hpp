@@ -0,0 +1,30 @@
+#ifndef WORKERPOOLTEST_HPP
+#define WORKERPOOLTEST_HPP
+
+#include <cppunit/extensions/HelperMacros.h>
+
+class WorkerPoolTest : public CppUnit::TestFixture
+{
+  CPPUNIT_TEST_SUITE( WorkerPoolTest );
+  CPPUNIT_TEST( testSize );
+  CPPUNIT_TEST( testEveryIndex );
+  CPPUNIT_TEST( testException );
+  CPPUNIT_TEST( testStealing );
+  CPPUNIT_TEST_SUITE_END();
+
+public:
+  void setUp();
+  void tearDown();
+
+  // A pool of one runs everything on the caller's thread.
+  void testSize();
+  // Every index runs exactly once, over many runs of one pool.
+  void testEveryIndex();
+  // An exception from a task reaches the caller, and the pool still works.
+  void testException();
+  // runStealing runs every index exactly once, names the thread, and
+  // balances uneven work by stealing.
+  void testStealing();
+};
+
+#endif // WORKERPOOLTEST_HPP